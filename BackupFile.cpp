@@ -23,9 +23,20 @@
 #include "BackupFile.h"
 #include "MoveToTrash.h"
 #include "FileUtils.h"
+#include "FileStat.h"
+#include "DirReader.h"
 
 #include <QDateTime>
+#include <QDir>
 #include <QFileInfo>
+#include <QRegularExpression>
+
+#include <algorithm>
+#include <vector>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
 
 namespace NSABUtils
 {
@@ -45,77 +56,211 @@ namespace NSABUtils
             return backup( fileInfo.absoluteFilePath(), msg, format, keepBackups, useTrash, moveOrCopyFile );
         }
 
-        bool removeFile( const QString &backupFile, bool useTrash, QString *msg )
+        bool backup( const QString &fileName, QString *msg /*= nullptr*/, const QString &format /*= "%FN.bak"*/, bool keepBackups /*= true*/, bool useTrash /*= false*/, EMoveOrCopy moveOrCopyFile /*= EMoveOrCopy::eMove */ )
         {
-            if ( !QFileInfo::exists( backupFile ) )
-                return true;
-
-            bool aOK = false;
-            if ( useTrash )
-                aOK = NFileUtils::moveToTrash( backupFile, msg );
-            else
-                aOK = NFileUtils::removePath( backupFile, msg );
-            return aOK;
+            SBackupOptions options;
+            options.fFormat = format;
+            options.fKeepBackups = keepBackups;
+            options.fUseTrash = useTrash;
+            options.fMoveOrCopy = moveOrCopyFile;
+            return backup( fileName, options, msg );
         }
 
-        bool backup( const QString &fileName, QString *msg /*= nullptr*/, const QString &format /*= "%FN.bak"*/, bool keepBackups /*= true*/, bool useTrash /*= false*/, EMoveOrCopy moveOrCopyFile /*= EMoveOrCopy::eMove */ )
+        namespace
         {
-            if ( !QFileInfo( fileName ).exists() )
-                return true;
+            const char *kTimeStampFormat{ "ddMMyyyy_hhmmss.zzz" };
+            const char *kTimeStampRegEx{ R"(\d{8}_\d{6}\.\d{3})" };
 
-            auto backupFile = format;
-            if ( backupFile.isEmpty() )
-                backupFile = "%FN.bak";   // filename(num).bak
+            struct SBackupSlot
+            {
+                QString fPath;
+                QString fPlainName;   // the name without the (N)
+                int fNumber{ 0 };   // 0 for the plain name
+                int64_t fBackupTime{ SFileStat::kUnknownTime };
+            };
 
-            auto pos = backupFile.indexOf( "%FN" );
-            if ( pos != -1 )
+            // the names in the directory, one pass without a stat per entry
+            QStringList listDir( const QString &dir )
             {
-                backupFile = backupFile.replace( pos, 3, fileName );
+#ifdef Q_OS_LINUX
+                QStringList retVal;
+                CDirReader reader( QFile::encodeName( dir ).constData() );
+                CDirReader::SEntry entry;
+                while ( reader.next( entry ) )
+                    retVal << QFile::decodeName( entry.fName );
+                return retVal;
+#else
+                return QDir( dir ).entryList( QDir::Files | QDir::System | QDir::Hidden | QDir::NoDotAndDotDot );
+#endif
             }
 
-            pos = backupFile.indexOf( "%TS" );
-            if ( pos != -1 )
+            // rename and link update the status change time, a reflink or copy is a new file
+            int64_t backupTime( const SFileStat &stat )
             {
-                backupFile = backupFile.replace( pos, 3, QDateTime::currentDateTime().toString( "ddMMyyyy_hhmmss.zzz" ) );
+                if ( stat.fMetadataChangeTime != SFileStat::kUnknownTime )
+                    return stat.fMetadataChangeTime;
+                if ( stat.fBirthTime != SFileStat::kUnknownTime )
+                    return stat.fBirthTime;
+                return stat.fModificationTime;
             }
 
-            if ( backupFile == fileName )
-                backupFile = fileName + ".bak";   // someones is trying to backup the backup
-            auto backupFileTemplate = backupFile;
-
-            // backup already exists, move it out of the way
-            auto backupFI = QFileInfo( backupFile );
-            if ( backupFI.exists() )
+            bool removeBackups( const QStringList &files, bool useTrash, QString *msg )
             {
-                if ( keepBackups )
+                if ( files.isEmpty() )
+                    return true;
+
+                if ( useTrash )
                 {
-                    auto backupNum = 1;
-                    while ( backupFI.exists() )
+                    auto results = moveFilesToTrash( files );
+                    for ( auto &&ii : results )
                     {
-                        auto baseName = QFileInfo( backupFileTemplate ).baseName();
-                        auto suffix = QFileInfo( backupFileTemplate ).suffix();
-                        backupFile = QString( "%1 (%2).%3" ).arg( baseName ).arg( backupNum++ ).arg( suffix );
-                        backupFI = QFileInfo( backupFile );
+                        if ( ii.fAOK )
+                            continue;
+                        if ( msg )
+                            *msg = ii.fErrorMsg;
+                        return false;
                     }
+                    return true;
                 }
-                else
+
+                auto result = removePaths( files );
+                if ( !result.fAOK && msg && !result.fErrors.empty() )
+                    *msg = result.fErrors.front().fErrorMsg;
+                return result.fAOK;
+            }
+
+            bool copyBackup( const QString &fileName, const QString &backupFile, const SBackupOptions &options, QString *msg )
+            {
+#ifdef Q_OS_UNIX
+                if ( options.fAllowHardLink && ( ::link( QFile::encodeName( fileName ).constData(), QFile::encodeName( backupFile ).constData() ) == 0 ) )
+                    return true;
+#endif
+                SCopyOptions copyOptions;
+                copyOptions.fAllowReflink = options.fAllowReflink;
+                return copyFile( fileName, backupFile, copyOptions, msg );
+            }
+        }
+
+        bool backup( const QString &fileName, const SBackupOptions &options, QString *msg /*= nullptr*/, QString *backupFileName /*= nullptr*/ )
+        {
+            if ( !QFileInfo( fileName ).exists() )
+                return true;
+
+            auto backupTemplate = options.fFormat;
+            if ( backupTemplate.isEmpty() )
+                backupTemplate = "%FN.bak";   // filename(num).bak
+
+            auto pos = backupTemplate.indexOf( "%FN" );
+            if ( pos != -1 )
+                backupTemplate = backupTemplate.replace( pos, 3, fileName );
+
+            auto timeStamp = QDateTime::currentDateTime().toString( kTimeStampFormat );
+            auto resolve = [ &timeStamp ]( QString name )
+            {
+                auto tsPos = name.indexOf( "%TS" );
+                if ( tsPos != -1 )
+                    name = name.replace( tsPos, 3, timeStamp );
+                return name;
+            };
+
+            if ( resolve( backupTemplate ) == fileName )
+                backupTemplate = fileName + ".bak";   // someones is trying to backup the backup
+
+            // the (N) goes between the base name and the last suffix of the template, "name (1).bak"
+            auto templateFI = QFileInfo( backupTemplate );
+            auto dir = templateFI.absolutePath();
+            auto templateName = templateFI.fileName();
+            auto suffixPos = templateName.lastIndexOf( '.' );
+            auto templateBase = ( suffixPos > 0 ) ? templateName.left( suffixPos ) : templateName;
+            auto templateSuffix = ( suffixPos > 0 ) ? templateName.mid( suffixPos ) : QString();
+
+            auto plainName = resolve( templateBase ) + templateSuffix;
+            auto slotPath = [ &dir, &templateBase, &templateSuffix, &resolve ]( int number ) { return dir + "/" + resolve( templateBase ) + QString( " (%1)" ).arg( number ) + templateSuffix; };
+
+            // every backup of the file, a timestamp in the template matches any timestamp
+            QStringList baseParts;
+            for ( auto &&ii : templateBase.split( "%TS" ) )
+                baseParts << QRegularExpression::escape( ii );
+            auto regExStr = QString( R"(^(%1)(?: \((\d+)\))?(%2)$)" ).arg( baseParts.join( QString( kTimeStampRegEx ) ) ).arg( QRegularExpression::escape( templateSuffix ) );
+#ifdef Q_OS_WINDOWS
+            auto regEx = QRegularExpression( regExStr, QRegularExpression::CaseInsensitiveOption );
+#else
+            auto regEx = QRegularExpression( regExStr );
+#endif
+
+            std::vector< SBackupSlot > backups;
+            int maxNumber = -1;   // -1 no backup uses the resolved name
+            bool plainExists = false;
+            for ( auto &&ii : listDir( dir ) )
+            {
+                auto match = regEx.match( ii );
+                if ( !match.hasMatch() )
+                    continue;
+
+                SBackupSlot slot;
+                slot.fPath = dir + "/" + ii;
+                slot.fPlainName = match.captured( 1 ) + match.captured( 3 );
+                slot.fNumber = match.captured( 2 ).isEmpty() ? 0 : match.captured( 2 ).toInt();
+                if ( slot.fPlainName == plainName )
                 {
-                    bool aOK = removeFile( backupFile, useTrash, msg );
-                    if ( !aOK )
-                        return false;
+                    maxNumber = std::max( maxNumber, slot.fNumber );
+                    plainExists = plainExists || ( slot.fNumber == 0 );
                 }
+                backups.push_back( slot );
+            }
+
+            QString backupFile;
+            if ( maxNumber == -1 )
+                backupFile = dir + "/" + plainName;
+            else if ( options.fKeepBackups )
+                backupFile = slotPath( maxNumber + 1 );
+            else
+            {
+                // the numbered backups are left alone, only the plain one is replaced
+                backupFile = dir + "/" + plainName;
+                if ( plainExists && !removeBackups( { backupFile }, options.fUseTrash, msg ) )
+                    return false;
             }
-            Q_ASSERT( !backupFI.exists() );
 
-            auto fi = QFile( fileName );
             bool retVal = false;
-            if ( moveOrCopyFile == EMoveOrCopy::eMove )
+            if ( options.fMoveOrCopy == EMoveOrCopy::eMove )
+            {
+                auto fi = QFile( fileName );
                 retVal = fi.rename( backupFile );
+                if ( !retVal && msg )
+                    *msg = fi.errorString();
+            }
             else
-                retVal = fi.copy( backupFile );
-            if ( !retVal && msg )
-                *msg = fi.errorString();
-            return retVal;
+                retVal = copyBackup( fileName, backupFile, options, msg );
+
+            if ( !retVal )
+                return false;
+            if ( backupFileName )
+                *backupFileName = backupFile;
+
+            if ( !options.fKeepBackups || backups.empty() || ( ( options.fMaxBackups <= 0 ) && ( options.fMaxAgeSecs <= 0 ) ) )
+                return true;
+
+            // only the existing backups are stat'ed, the new one is always the newest
+            QStringList paths;
+            for ( auto &&ii : backups )
+                paths << ii.fPath;
+            auto stats = fileStats( paths, false );
+            for ( size_t ii = 0; ii < backups.size(); ++ii )
+                backups[ ii ].fBackupTime = backupTime( stats[ ii ] );
+            std::sort( backups.begin(), backups.end(), []( const SBackupSlot &lhs, const SBackupSlot &rhs ) { return ( lhs.fBackupTime != rhs.fBackupTime ) ? ( lhs.fBackupTime < rhs.fBackupTime ) : ( lhs.fNumber < rhs.fNumber ); } );
+
+            auto numToDrop = ( options.fMaxBackups > 0 ) ? static_cast< int >( backups.size() ) + 1 - options.fMaxBackups : 0;
+            auto oldest = ( options.fMaxAgeSecs > 0 ) ? QDateTime::currentMSecsSinceEpoch() - options.fMaxAgeSecs * 1000 : SFileStat::kUnknownTime;
+
+            QStringList toRemove;
+            for ( int ii = 0; ii < static_cast< int >( backups.size() ); ++ii )
+            {
+                if ( ( ii < numToDrop ) || ( ( backups[ ii ].fBackupTime != SFileStat::kUnknownTime ) && ( backups[ ii ].fBackupTime < oldest ) ) )
+                    toRemove << backups[ ii ].fPath;
+            }
+            removeBackups( toRemove, options.fUseTrash, nullptr );
+            return true;
         }
     }
 }
@@ -25,6 +25,7 @@
 
 #include "SABUtilsExport.h"
 
+#include <cstdint>
 #include <string>
 #include <QString>
 class QFileInfo;
@@ -45,6 +46,22 @@ namespace NSABUtils
         // useTrash -> if removing a file use the trash rather than destroy the file
         // move -> if EMoveOrCopy::eMove moves the souurce file, otherwise copies it
 
+        struct SABUTILS_EXPORT SBackupOptions
+        {
+            QString fFormat{ "%FN.bak" };
+            bool fKeepBackups{ true };
+            bool fUseTrash{ false };
+            EMoveOrCopy fMoveOrCopy{ EMoveOrCopy::eMove };
+            int fMaxBackups{ 0 };   // keep backups only, the newest are kept including the new one, 0 is unlimited
+            int64_t fMaxAgeSecs{ 0 };   // keep backups only, older backups are removed, 0 is unlimited
+            bool fAllowReflink{ true };   // eCopy, the backup shares the blocks of the file until either is written
+            bool fAllowHardLink{ false };   // eCopy, only safe when the file is replaced rather than rewritten in place, a write to the file changes the backup
+        };
+
+        // the directory is listed once to find the next free "name (N).ext" slot and the existing backups of the file
+        // backups the retention policy drops are removed (or trashed) after the new backup is made, failing to remove one does not fail the backup
+        SABUTILS_EXPORT bool backup( const QString &fileName, const SBackupOptions &options, QString *msg = nullptr, QString *backupFileName = nullptr );
+
         SABUTILS_EXPORT bool backup( const std::string &fileName, std::string *msg = nullptr, const std::string &format = "%FN.bak", bool keepBackups = true, bool useTrash = false, EMoveOrCopy moveOrCopyFile = EMoveOrCopy::eMove );
         SABUTILS_EXPORT bool backup( const QFileInfo &fileInfo, QString *msg = nullptr, const QString &format = "%FN.bak", bool keepBackups = true, bool useTrash = false, EMoveOrCopy moveOrCopyFile = EMoveOrCopy::eMove );
         SABUTILS_EXPORT bool backup( const QString &fileName, QString *msg = nullptr, const QString &format = "%FN.bak", bool keepBackups = true, bool useTrash = false, EMoveOrCopy moveOrCopyFile = EMoveOrCopy::eMove );
@@ -0,0 +1,658 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "ContentHash.h"
+
+#include <QCryptographicHash>
+#include <QThread>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace NSABUtils
+{
+    namespace
+    {
+        inline uint64_t readLE64( const uint8_t *ptr )
+        {
+            uint64_t retVal = 0;
+            for ( int ii = 7; ii >= 0; --ii )
+                retVal = ( retVal << 8 ) | ptr[ ii ];
+            return retVal;
+        }
+
+        inline uint32_t readLE32( const uint8_t *ptr )
+        {
+            return static_cast< uint32_t >( ptr[ 0 ] ) | ( static_cast< uint32_t >( ptr[ 1 ] ) << 8 ) | ( static_cast< uint32_t >( ptr[ 2 ] ) << 16 ) | ( static_cast< uint32_t >( ptr[ 3 ] ) << 24 );
+        }
+
+        inline uint64_t rotl64( uint64_t value, int bits )
+        {
+            return ( value << bits ) | ( value >> ( 64 - bits ) );
+        }
+
+        inline uint32_t rotr32( uint32_t value, int bits )
+        {
+            return ( value >> bits ) | ( value << ( 32 - bits ) );
+        }
+
+        // XXH64, see https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md
+        class CXXHash64
+        {
+        public:
+            static constexpr uint64_t kPrime1 = 11400714785074694791ULL;
+            static constexpr uint64_t kPrime2 = 14029467366897019727ULL;
+            static constexpr uint64_t kPrime3 = 1609587929392839161ULL;
+            static constexpr uint64_t kPrime4 = 9650029242287828579ULL;
+            static constexpr uint64_t kPrime5 = 2870177450012600261ULL;
+
+            CXXHash64( uint64_t seed = 0 ) { reset( seed ); }
+
+            void reset( uint64_t seed = 0 )
+            {
+                fSeed = seed;
+                fAcc = { seed + kPrime1 + kPrime2, seed + kPrime2, seed, seed - kPrime1 };
+                fTotalLen = 0;
+                fBufferLen = 0;
+            }
+
+            void update( const uint8_t *data, size_t len )
+            {
+                fTotalLen += len;
+                if ( ( fBufferLen + len ) < 32 )
+                {
+                    std::memcpy( fBuffer.data() + fBufferLen, data, len );
+                    fBufferLen += len;
+                    return;
+                }
+
+                if ( fBufferLen )
+                {
+                    auto take = 32 - fBufferLen;
+                    std::memcpy( fBuffer.data() + fBufferLen, data, take );
+                    data += take;
+                    len -= take;
+                    processStripe( fBuffer.data() );
+                    fBufferLen = 0;
+                }
+
+                while ( len >= 32 )
+                {
+                    processStripe( data );
+                    data += 32;
+                    len -= 32;
+                }
+
+                std::memcpy( fBuffer.data(), data, len );
+                fBufferLen = len;
+            }
+
+            uint64_t digest() const
+            {
+                uint64_t retVal = 0;
+                if ( fTotalLen >= 32 )
+                {
+                    retVal = rotl64( fAcc[ 0 ], 1 ) + rotl64( fAcc[ 1 ], 7 ) + rotl64( fAcc[ 2 ], 12 ) + rotl64( fAcc[ 3 ], 18 );
+                    for ( auto &&acc : fAcc )
+                        retVal = mergeRound( retVal, acc );
+                }
+                else
+                    retVal = fSeed + kPrime5;
+
+                retVal += fTotalLen;
+
+                auto ptr = fBuffer.data();
+                auto remaining = fBufferLen;
+                while ( remaining >= 8 )
+                {
+                    retVal ^= round( 0, readLE64( ptr ) );
+                    retVal = rotl64( retVal, 27 ) * kPrime1 + kPrime4;
+                    ptr += 8;
+                    remaining -= 8;
+                }
+                if ( remaining >= 4 )
+                {
+                    retVal ^= static_cast< uint64_t >( readLE32( ptr ) ) * kPrime1;
+                    retVal = rotl64( retVal, 23 ) * kPrime2 + kPrime3;
+                    ptr += 4;
+                    remaining -= 4;
+                }
+                while ( remaining > 0 )
+                {
+                    retVal ^= ( *ptr ) * kPrime5;
+                    retVal = rotl64( retVal, 11 ) * kPrime1;
+                    ptr++;
+                    remaining--;
+                }
+
+                retVal ^= retVal >> 33;
+                retVal *= kPrime2;
+                retVal ^= retVal >> 29;
+                retVal *= kPrime3;
+                retVal ^= retVal >> 32;
+                return retVal;
+            }
+
+        private:
+            static uint64_t round( uint64_t acc, uint64_t input )
+            {
+                acc += input * kPrime2;
+                acc = rotl64( acc, 31 );
+                return acc * kPrime1;
+            }
+
+            static uint64_t mergeRound( uint64_t acc, uint64_t value )
+            {
+                acc ^= round( 0, value );
+                return acc * kPrime1 + kPrime4;
+            }
+
+            void processStripe( const uint8_t *data )
+            {
+                for ( size_t ii = 0; ii < 4; ++ii )
+                    fAcc[ ii ] = round( fAcc[ ii ], readLE64( data + ( ii * 8 ) ) );
+            }
+
+            uint64_t fSeed{ 0 };
+            std::array< uint64_t, 4 > fAcc;
+            uint64_t fTotalLen{ 0 };
+            std::array< uint8_t, 32 > fBuffer;
+            size_t fBufferLen{ 0 };
+        };
+
+        // BLAKE3, see https://github.com/BLAKE3-team/BLAKE3-specs
+        // the hasher follows the lazy merging of the reference C implementation, so that any input of
+        // a power of 2 number of chunks can be hashed as a complete subtree, and those subtrees are split across threads
+        class CBlake3
+        {
+        public:
+            static constexpr size_t kBlockLen = 64;
+            static constexpr size_t kChunkLen = 1024;
+            static constexpr size_t kMaxDepth = 54;
+            static constexpr size_t kMinParallelPiece = 64 * 1024;
+
+            using TCV = std::array< uint32_t, 8 >;
+
+            enum EFlags : uint32_t
+            {
+                eChunkStart = 1 << 0,
+                eChunkEnd = 1 << 1,
+                eParent = 1 << 2,
+                eRoot = 1 << 3
+            };
+
+            static constexpr TCV kIV = { 0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19 };
+
+            struct SOutput
+            {
+                TCV fInputCV;
+                std::array< uint32_t, 16 > fBlockWords;
+                uint64_t fCounter{ 0 };
+                uint32_t fBlockLen{ 0 };
+                uint32_t fFlags{ 0 };
+
+                TCV chainingValue() const
+                {
+                    auto state = compress( fInputCV, fBlockWords, fCounter, fBlockLen, fFlags );
+                    TCV retVal;
+                    std::copy( state.begin(), state.begin() + 8, retVal.begin() );
+                    return retVal;
+                }
+
+                std::array< uint8_t, 32 > rootBytes() const
+                {
+                    auto state = compress( fInputCV, fBlockWords, 0, fBlockLen, fFlags | eRoot );
+                    std::array< uint8_t, 32 > retVal;
+                    for ( size_t ii = 0; ii < 8; ++ii )
+                    {
+                        for ( size_t jj = 0; jj < 4; ++jj )
+                            retVal[ ii * 4 + jj ] = static_cast< uint8_t >( state[ ii ] >> ( 8 * jj ) );
+                    }
+                    return retVal;
+                }
+            };
+
+            class CChunkState
+            {
+            public:
+                CChunkState( uint64_t chunkCounter = 0 ) :
+                    fChunkCounter( chunkCounter )
+                {
+                }
+
+                size_t len() const { return ( kBlockLen * fBlocksCompressed ) + fBlockLen; }
+                uint64_t chunkCounter() const { return fChunkCounter; }
+
+                void update( const uint8_t *data, size_t len )
+                {
+                    while ( len > 0 )
+                    {
+                        if ( fBlockLen == kBlockLen )
+                        {
+                            auto state = compress( fCV, blockWords(), fChunkCounter, kBlockLen, startFlag() );
+                            std::copy( state.begin(), state.begin() + 8, fCV.begin() );
+                            fBlocksCompressed++;
+                            fBlock.fill( 0 );
+                            fBlockLen = 0;
+                        }
+
+                        auto take = std::min( kBlockLen - fBlockLen, len );
+                        std::memcpy( fBlock.data() + fBlockLen, data, take );
+                        fBlockLen += take;
+                        data += take;
+                        len -= take;
+                    }
+                }
+
+                SOutput output() const { return { fCV, blockWords(), fChunkCounter, static_cast< uint32_t >( fBlockLen ), startFlag() | eChunkEnd }; }
+
+            private:
+                uint32_t startFlag() const { return ( fBlocksCompressed == 0 ) ? static_cast< uint32_t >( eChunkStart ) : 0; }
+                std::array< uint32_t, 16 > blockWords() const
+                {
+                    std::array< uint32_t, 16 > retVal;
+                    for ( size_t ii = 0; ii < 16; ++ii )
+                        retVal[ ii ] = readLE32( fBlock.data() + ( ii * 4 ) );
+                    return retVal;
+                }
+
+                TCV fCV{ kIV };
+                uint64_t fChunkCounter{ 0 };
+                std::array< uint8_t, kBlockLen > fBlock{};
+                size_t fBlockLen{ 0 };
+                size_t fBlocksCompressed{ 0 };
+            };
+
+            CBlake3( int maxThreads = 1 ) :
+                fMaxThreads( std::max( 1, maxThreads ) )
+            {
+            }
+
+            void setMaxThreads( int maxThreads ) { fMaxThreads = std::max( 1, maxThreads ); }
+
+            void reset()
+            {
+                fChunk = CChunkState( 0 );
+                fCVStackLen = 0;
+            }
+
+            void update( const uint8_t *data, size_t len )
+            {
+                if ( len == 0 )
+                    return;
+
+                if ( fChunk.len() > 0 )
+                {
+                    auto take = std::min( kChunkLen - fChunk.len(), len );
+                    fChunk.update( data, take );
+                    data += take;
+                    len -= take;
+                    if ( len == 0 )
+                        return;
+
+                    // the chunk is full and more is coming, so it can not be the root
+                    pushCV( fChunk.output().chainingValue(), fChunk.chunkCounter() );
+                    fChunk = CChunkState( fChunk.chunkCounter() + 1 );
+                }
+
+                while ( len > kChunkLen )
+                {
+                    size_t subtreeLen = roundDownToPowerOf2( len );
+                    auto countSoFar = fChunk.chunkCounter() * kChunkLen;
+                    while ( ( ( subtreeLen - 1 ) & countSoFar ) != 0 )
+                        subtreeLen /= 2;
+
+                    auto subtreeChunks = subtreeLen / kChunkLen;
+                    if ( subtreeLen <= kChunkLen )
+                    {
+                        CChunkState chunk( fChunk.chunkCounter() );
+                        chunk.update( data, subtreeLen );
+                        pushCV( chunk.output().chainingValue(), chunk.chunkCounter() );
+                    }
+                    else
+                    {
+                        // the subtree might be the root, so push its two children rather than the subtree cv
+                        auto children = compressSubtreeToParentNode( data, subtreeLen, fChunk.chunkCounter() );
+                        pushCV( children.first, fChunk.chunkCounter() );
+                        pushCV( children.second, fChunk.chunkCounter() + ( subtreeChunks / 2 ) );
+                    }
+                    fChunk = CChunkState( fChunk.chunkCounter() + subtreeChunks );
+                    data += subtreeLen;
+                    len -= subtreeLen;
+                }
+
+                if ( len > 0 )
+                {
+                    fChunk.update( data, len );
+                    mergeCVStack( fChunk.chunkCounter() );
+                }
+            }
+
+            std::array< uint8_t, 32 > digest() const
+            {
+                if ( fCVStackLen == 0 )
+                    return fChunk.output().rootBytes();
+
+                SOutput output;
+                size_t cvsRemaining = 0;
+                if ( fChunk.len() > 0 )
+                {
+                    output = fChunk.output();
+                    cvsRemaining = fCVStackLen;
+                }
+                else
+                {
+                    output = parentOutput( fCVStack[ fCVStackLen - 2 ], fCVStack[ fCVStackLen - 1 ] );
+                    cvsRemaining = fCVStackLen - 2;
+                }
+
+                while ( cvsRemaining > 0 )
+                {
+                    cvsRemaining--;
+                    output = parentOutput( fCVStack[ cvsRemaining ], output.chainingValue() );
+                }
+                return output.rootBytes();
+            }
+
+        private:
+            static std::array< uint32_t, 16 > compress( const TCV &cv, const std::array< uint32_t, 16 > &blockWords, uint64_t counter, uint32_t blockLen, uint32_t flags )
+            {
+                static constexpr std::array< size_t, 16 > kPermutation = { 2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8 };
+
+                std::array< uint32_t, 16 > state = { cv[ 0 ], cv[ 1 ], cv[ 2 ], cv[ 3 ], cv[ 4 ], cv[ 5 ], cv[ 6 ], cv[ 7 ], kIV[ 0 ], kIV[ 1 ], kIV[ 2 ], kIV[ 3 ], static_cast< uint32_t >( counter ), static_cast< uint32_t >( counter >> 32 ), blockLen, flags };
+                auto msg = blockWords;
+
+                auto g = [ &state ]( size_t a, size_t b, size_t c, size_t d, uint32_t mx, uint32_t my )
+                {
+                    state[ a ] = state[ a ] + state[ b ] + mx;
+                    state[ d ] = rotr32( state[ d ] ^ state[ a ], 16 );
+                    state[ c ] = state[ c ] + state[ d ];
+                    state[ b ] = rotr32( state[ b ] ^ state[ c ], 12 );
+                    state[ a ] = state[ a ] + state[ b ] + my;
+                    state[ d ] = rotr32( state[ d ] ^ state[ a ], 8 );
+                    state[ c ] = state[ c ] + state[ d ];
+                    state[ b ] = rotr32( state[ b ] ^ state[ c ], 7 );
+                };
+
+                for ( int round = 0; round < 7; ++round )
+                {
+                    g( 0, 4, 8, 12, msg[ 0 ], msg[ 1 ] );
+                    g( 1, 5, 9, 13, msg[ 2 ], msg[ 3 ] );
+                    g( 2, 6, 10, 14, msg[ 4 ], msg[ 5 ] );
+                    g( 3, 7, 11, 15, msg[ 6 ], msg[ 7 ] );
+                    g( 0, 5, 10, 15, msg[ 8 ], msg[ 9 ] );
+                    g( 1, 6, 11, 12, msg[ 10 ], msg[ 11 ] );
+                    g( 2, 7, 8, 13, msg[ 12 ], msg[ 13 ] );
+                    g( 3, 4, 9, 14, msg[ 14 ], msg[ 15 ] );
+
+                    if ( round < 6 )
+                    {
+                        std::array< uint32_t, 16 > permuted;
+                        for ( size_t ii = 0; ii < 16; ++ii )
+                            permuted[ ii ] = msg[ kPermutation[ ii ] ];
+                        msg = permuted;
+                    }
+                }
+
+                for ( size_t ii = 0; ii < 8; ++ii )
+                {
+                    state[ ii ] ^= state[ ii + 8 ];
+                    state[ ii + 8 ] ^= cv[ ii ];
+                }
+                return state;
+            }
+
+            static SOutput parentOutput( const TCV &lhs, const TCV &rhs )
+            {
+                SOutput retVal;
+                retVal.fInputCV = kIV;
+                std::copy( lhs.begin(), lhs.end(), retVal.fBlockWords.begin() );
+                std::copy( rhs.begin(), rhs.end(), retVal.fBlockWords.begin() + 8 );
+                retVal.fCounter = 0;
+                retVal.fBlockLen = kBlockLen;
+                retVal.fFlags = eParent;
+                return retVal;
+            }
+
+            static TCV parentCV( const TCV &lhs, const TCV &rhs ) { return parentOutput( lhs, rhs ).chainingValue(); }
+
+            static size_t roundDownToPowerOf2( size_t value )
+            {
+                size_t retVal = 1;
+                while ( ( retVal << 1 ) <= value )
+                    retVal <<= 1;
+                return retVal;
+            }
+
+            // len must be a power of 2 number of chunks (or a single partial chunk)
+            static TCV subtreeCV( const uint8_t *data, size_t len, uint64_t chunkCounter )
+            {
+                if ( len <= kChunkLen )
+                {
+                    CChunkState chunk( chunkCounter );
+                    chunk.update( data, len );
+                    return chunk.output().chainingValue();
+                }
+
+                auto half = len / 2;
+                return parentCV( subtreeCV( data, half, chunkCounter ), subtreeCV( data + half, half, chunkCounter + ( half / kChunkLen ) ) );
+            }
+
+            // returns the two children of a subtree of a power of 2 number of chunks (at least 2)
+            // the subtree is split into equal pieces which are hashed on separate threads, then combined
+            std::pair< TCV, TCV > compressSubtreeToParentNode( const uint8_t *data, size_t len, uint64_t chunkCounter ) const
+            {
+                size_t numPieces = 2;
+                while ( ( numPieces < static_cast< size_t >( fMaxThreads ) ) && ( ( len / ( numPieces * 2 ) ) >= kMinParallelPiece ) )
+                    numPieces *= 2;
+
+                auto pieceLen = len / numPieces;
+                std::vector< TCV > cvs( numPieces );
+                auto hashPiece = [ &cvs, data, pieceLen, chunkCounter ]( size_t piece ) { cvs[ piece ] = subtreeCV( data + ( piece * pieceLen ), pieceLen, chunkCounter + ( piece * pieceLen / kChunkLen ) ); };
+
+                if ( ( fMaxThreads > 1 ) && ( pieceLen >= kMinParallelPiece ) )
+                {
+                    std::vector< std::thread > threads;
+                    threads.reserve( numPieces - 1 );
+                    for ( size_t ii = 1; ii < numPieces; ++ii )
+                        threads.emplace_back( hashPiece, ii );
+                    hashPiece( 0 );
+                    for ( auto &&ii : threads )
+                        ii.join();
+                }
+                else
+                {
+                    for ( size_t ii = 0; ii < numPieces; ++ii )
+                        hashPiece( ii );
+                }
+
+                while ( cvs.size() > 2 )
+                {
+                    std::vector< TCV > parents( cvs.size() / 2 );
+                    for ( size_t ii = 0; ii < parents.size(); ++ii )
+                        parents[ ii ] = parentCV( cvs[ 2 * ii ], cvs[ 2 * ii + 1 ] );
+                    cvs = std::move( parents );
+                }
+                return { cvs[ 0 ], cvs[ 1 ] };
+            }
+
+            void mergeCVStack( uint64_t totalChunks )
+            {
+                size_t postMergeStackLen = 0;
+                for ( auto ii = totalChunks; ii; ii &= ( ii - 1 ) )
+                    postMergeStackLen++;
+
+                while ( fCVStackLen > postMergeStackLen )
+                {
+                    fCVStack[ fCVStackLen - 2 ] = parentCV( fCVStack[ fCVStackLen - 2 ], fCVStack[ fCVStackLen - 1 ] );
+                    fCVStackLen--;
+                }
+            }
+
+            void pushCV( const TCV &cv, uint64_t chunkCounter )
+            {
+                mergeCVStack( chunkCounter );
+                fCVStack[ fCVStackLen++ ] = cv;
+            }
+
+            int fMaxThreads{ 1 };
+            CChunkState fChunk;
+            std::array< TCV, kMaxDepth + 1 > fCVStack;
+            size_t fCVStackLen{ 0 };
+        };
+    }
+
+    QString toString( EHashAlgorithm algorithm )
+    {
+        switch ( algorithm )
+        {
+            case EHashAlgorithm::eMD5:
+                return QStringLiteral( "MD5" );
+            case EHashAlgorithm::eXXHash64:
+                return QStringLiteral( "XXH64" );
+            case EHashAlgorithm::eBLAKE3:
+                return QStringLiteral( "BLAKE3" );
+        }
+        return {};
+    }
+
+    class CContentHashImpl
+    {
+    public:
+        CContentHashImpl( EHashAlgorithm algorithm ) :
+            fAlgorithm( algorithm ),
+            fMaxThreads( QThread::idealThreadCount() ),
+            fBlake3( QThread::idealThreadCount() )
+        {
+            if ( fAlgorithm == EHashAlgorithm::eMD5 )
+                fMD5 = std::make_unique< QCryptographicHash >( QCryptographicHash::Md5 );
+        }
+
+        EHashAlgorithm fAlgorithm;
+        int fMaxThreads{ 1 };
+        std::unique_ptr< QCryptographicHash > fMD5;
+        CXXHash64 fXXHash64;
+        CBlake3 fBlake3;
+    };
+
+    CContentHash::CContentHash( EHashAlgorithm algorithm ) :
+        fImpl( std::make_unique< CContentHashImpl >( algorithm ) )
+    {
+    }
+
+    CContentHash::~CContentHash()
+    {
+    }
+
+    EHashAlgorithm CContentHash::algorithm() const
+    {
+        return fImpl->fAlgorithm;
+    }
+
+    void CContentHash::setMaxThreads( int value )
+    {
+        fImpl->fMaxThreads = ( value > 0 ) ? value : QThread::idealThreadCount();
+        fImpl->fBlake3.setMaxThreads( fImpl->fMaxThreads );
+    }
+
+    int CContentHash::maxThreads() const
+    {
+        return fImpl->fMaxThreads;
+    }
+
+    qint64 CContentHash::preferredBlockSize() const
+    {
+        if ( ( fImpl->fAlgorithm == EHashAlgorithm::eBLAKE3 ) && ( fImpl->fMaxThreads > 1 ) )
+            return 16 * 1024 * 1024;
+        return 0;
+    }
+
+    void CContentHash::reset()
+    {
+        switch ( fImpl->fAlgorithm )
+        {
+            case EHashAlgorithm::eMD5:
+                fImpl->fMD5->reset();
+                break;
+            case EHashAlgorithm::eXXHash64:
+                fImpl->fXXHash64.reset();
+                break;
+            case EHashAlgorithm::eBLAKE3:
+                fImpl->fBlake3.reset();
+                break;
+        }
+    }
+
+    void CContentHash::addData( QByteArrayView data )
+    {
+        auto ptr = reinterpret_cast< const uint8_t * >( data.data() );
+        auto len = static_cast< size_t >( data.size() );
+        switch ( fImpl->fAlgorithm )
+        {
+            case EHashAlgorithm::eMD5:
+                fImpl->fMD5->addData( data );
+                break;
+            case EHashAlgorithm::eXXHash64:
+                fImpl->fXXHash64.update( ptr, len );
+                break;
+            case EHashAlgorithm::eBLAKE3:
+                fImpl->fBlake3.update( ptr, len );
+                break;
+        }
+    }
+
+    QByteArray CContentHash::result() const
+    {
+        switch ( fImpl->fAlgorithm )
+        {
+            case EHashAlgorithm::eMD5:
+                return fImpl->fMD5->result();
+            case EHashAlgorithm::eXXHash64:
+            {
+                // canonical (big endian) form, so the hex string matches the xxhsum output
+                auto digest = fImpl->fXXHash64.digest();
+                QByteArray retVal( 8, Qt::Uninitialized );
+                for ( int ii = 0; ii < 8; ++ii )
+                    retVal[ ii ] = static_cast< char >( digest >> ( 56 - ( 8 * ii ) ) );
+                return retVal;
+            }
+            case EHashAlgorithm::eBLAKE3:
+            {
+                auto digest = fImpl->fBlake3.digest();
+                return QByteArray( reinterpret_cast< const char * >( digest.data() ), static_cast< qsizetype >( digest.size() ) );
+            }
+        }
+        return {};
+    }
+
+    QByteArray CContentHash::hash( QByteArrayView data, EHashAlgorithm algorithm )
+    {
+        CContentHash hash( algorithm );
+        hash.addData( data );
+        return hash.result();
+    }
+}
@@ -0,0 +1,72 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __CONTENTHASH_H
+#define __CONTENTHASH_H
+
+#include "SABUtilsExport.h"
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+#include <memory>
+
+namespace NSABUtils
+{
+    enum class EHashAlgorithm
+    {
+        eMD5,   // QCryptographicHash::Md5, the default everywhere
+        eXXHash64,   // non cryptographic 64 bit hash, for change detection and de-duplication
+        eBLAKE3   // 256 bit tree hash, large blocks are split across multiple threads
+    };
+    SABUTILS_EXPORT QString toString( EHashAlgorithm algorithm );
+
+    // incremental hash with the same usage as QCryptographicHash, but selectable algorithm
+    class CContentHashImpl;
+    class SABUTILS_EXPORT CContentHash
+    {
+    public:
+        CContentHash( EHashAlgorithm algorithm = EHashAlgorithm::eMD5 );
+        ~CContentHash();
+
+        CContentHash( const CContentHash & ) = delete;
+        CContentHash &operator=( const CContentHash & ) = delete;
+
+        EHashAlgorithm algorithm() const;
+
+        void setMaxThreads( int value );   // only used by BLAKE3, default is QThread::idealThreadCount(), 1 hashes on the calling thread only
+        int maxThreads() const;
+
+        qint64 preferredBlockSize() const;   // passing blocks at least this large to addData lets BLAKE3 use its threads, 0 means no preference
+
+        void reset();
+        void addData( QByteArrayView data );
+        QByteArray result() const;   // raw digest, formatMd5 produces the display form
+
+        static QByteArray hash( QByteArrayView data, EHashAlgorithm algorithm );
+
+    private:
+        std::unique_ptr< CContentHashImpl > fImpl;
+    };
+}
+
+#endif
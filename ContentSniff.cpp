@@ -0,0 +1,272 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "ContentSniff.h"
+#include "ParallelFor.h"
+
+#include <QFile>
+
+#include <algorithm>
+#include <cstring>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && ( _M_IX86_FP >= 2 ) )
+    #define SAB_SNIFF_SSE2
+    #include <emmintrin.h>
+#endif
+
+#ifdef Q_OS_UNIX
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+namespace NSABUtils
+{
+    namespace NFileUtils
+    {
+        namespace
+        {
+            bool isBinaryByte( unsigned char ch )
+            {
+                return ( ch < 9 ) || ( ( ch > 13 ) && ( ch < 32 ) ) || ( ch == 127 );
+            }
+
+            // returns true if any byte is binary, *hasHighBytes is set when any byte is above 127
+            bool scanBytes( const unsigned char *data, std::size_t size, bool *hasHighBytes )
+            {
+                std::size_t pos = 0;
+                *hasHighBytes = false;
+#ifdef SAB_SNIFF_SSE2
+                const auto k31 = _mm_set1_epi8( 31 );
+                const auto k9 = _mm_set1_epi8( 9 );
+                const auto k4 = _mm_set1_epi8( 4 );
+                const auto k127 = _mm_set1_epi8( 127 );
+                int highBits = 0;
+                for ( ; ( pos + 16 ) <= size; pos += 16 )
+                {
+                    auto bytes = _mm_loadu_si128( reinterpret_cast< const __m128i * >( data + pos ) );
+
+                    // unsigned a <= b is min( a, b ) == a
+                    auto isControl = _mm_cmpeq_epi8( _mm_min_epu8( bytes, k31 ), bytes );
+                    auto fromTab = _mm_sub_epi8( bytes, k9 );
+                    auto isWhiteSpace = _mm_cmpeq_epi8( _mm_min_epu8( fromTab, k4 ), fromTab );
+                    auto isBinary = _mm_or_si128( _mm_andnot_si128( isWhiteSpace, isControl ), _mm_cmpeq_epi8( bytes, k127 ) );
+                    if ( _mm_movemask_epi8( isBinary ) != 0 )
+                        return true;
+                    highBits |= _mm_movemask_epi8( bytes );
+                }
+                *hasHighBytes = ( highBits != 0 );
+#endif
+                for ( ; pos < size; ++pos )
+                {
+                    if ( isBinaryByte( data[ pos ] ) )
+                        return true;
+                    if ( data[ pos ] > 127 )
+                        *hasHighBytes = true;
+                }
+                return false;
+            }
+
+            // a sequence cut off by the end of the block is allowed
+            bool isValidUTF8( const unsigned char *data, std::size_t size )
+            {
+                for ( std::size_t pos = 0; pos < size; )
+                {
+                    auto ch = data[ pos ];
+                    if ( ch < 0x80 )
+                    {
+                        ++pos;
+                        continue;
+                    }
+
+                    std::size_t length = 0;
+                    uint32_t minValue = 0;
+                    uint32_t value = 0;
+                    if ( ( ch & 0xE0 ) == 0xC0 )
+                    {
+                        length = 2;
+                        minValue = 0x80;
+                        value = ch & 0x1F;
+                    }
+                    else if ( ( ch & 0xF0 ) == 0xE0 )
+                    {
+                        length = 3;
+                        minValue = 0x800;
+                        value = ch & 0x0F;
+                    }
+                    else if ( ( ch & 0xF8 ) == 0xF0 )
+                    {
+                        length = 4;
+                        minValue = 0x10000;
+                        value = ch & 0x07;
+                    }
+                    else
+                        return false;
+
+                    for ( std::size_t ii = 1; ii < length; ++ii )
+                    {
+                        if ( ( pos + ii ) >= size )
+                            return true;
+                        auto next = data[ pos + ii ];
+                        if ( ( next & 0xC0 ) != 0x80 )
+                            return false;
+                        value = ( value << 6 ) | ( next & 0x3F );
+                    }
+                    if ( ( value < minValue ) || ( value > 0x10FFFF ) || ( ( value >= 0xD800 ) && ( value <= 0xDFFF ) ) )
+                        return false;
+                    pos += length;
+                }
+                return true;
+            }
+
+            bool startsWith( const unsigned char *data, std::size_t size, std::initializer_list< unsigned char > prefix )
+            {
+                return ( size >= prefix.size() ) && std::equal( prefix.begin(), prefix.end(), data );
+            }
+        }
+
+        SContentSniff sniffContent( const char *data, std::size_t size )
+        {
+            SContentSniff retVal;
+            retVal.fAOK = ( data != nullptr ) || ( size == 0 );
+            retVal.fNumBytes = data ? size : 0;
+            if ( !data || ( size == 0 ) )
+                return retVal;
+
+            auto bytes = reinterpret_cast< const unsigned char * >( data );
+
+            // the 32 bit BOMs first, FF FE is also the start of the UTF-32LE BOM
+            if ( startsWith( bytes, size, { 0xFF, 0xFE, 0x00, 0x00 } ) )
+            {
+                retVal.fEncoding = ETextEncoding::eUTF32LE;
+                retVal.fBOMSize = 4;
+                return retVal;
+            }
+            if ( startsWith( bytes, size, { 0x00, 0x00, 0xFE, 0xFF } ) )
+            {
+                retVal.fEncoding = ETextEncoding::eUTF32BE;
+                retVal.fBOMSize = 4;
+                return retVal;
+            }
+            if ( startsWith( bytes, size, { 0xFF, 0xFE } ) )
+            {
+                retVal.fEncoding = ETextEncoding::eUTF16LE;
+                retVal.fBOMSize = 2;
+                return retVal;
+            }
+            if ( startsWith( bytes, size, { 0xFE, 0xFF } ) )
+            {
+                retVal.fEncoding = ETextEncoding::eUTF16BE;
+                retVal.fBOMSize = 2;
+                return retVal;
+            }
+            if ( startsWith( bytes, size, { 0xEF, 0xBB, 0xBF } ) )
+                retVal.fBOMSize = 3;
+
+            bool hasHighBytes = false;
+            if ( scanBytes( bytes + retVal.fBOMSize, size - retVal.fBOMSize, &hasHighBytes ) )
+            {
+                retVal.fIsBinary = true;
+                retVal.fBOMSize = 0;
+                return retVal;
+            }
+
+            if ( retVal.fBOMSize != 0 )
+                retVal.fEncoding = ETextEncoding::eUTF8BOM;
+            else if ( !hasHighBytes )
+                retVal.fEncoding = ETextEncoding::eASCII;
+            else
+                retVal.fEncoding = isValidUTF8( bytes, size ) ? ETextEncoding::eUTF8 : ETextEncoding::eOther;
+            return retVal;
+        }
+
+        SContentSniff sniffContent( QFile &file, std::size_t blockSize )
+        {
+            if ( !file.isOpen() )
+                return {};
+
+            auto pos = file.pos();
+            if ( ( pos != 0 ) && !file.seek( 0 ) )
+                return {};
+
+            std::vector< char > buffer( blockSize );
+            auto numRead = file.peek( buffer.data(), blockSize );
+            if ( pos != 0 )
+                file.seek( pos );
+            if ( numRead < 0 )
+                return {};
+            return sniffContent( buffer.data(), numRead );
+        }
+
+#ifdef Q_OS_UNIX
+        SContentSniff sniffContent( int fd, std::size_t blockSize )
+        {
+            if ( fd < 0 )
+                return {};
+
+            std::vector< char > buffer( blockSize );
+            std::size_t numRead = 0;
+            while ( numRead < blockSize )
+            {
+                auto curr = ::pread( fd, buffer.data() + numRead, blockSize - numRead, numRead );
+                if ( curr < 0 )
+                {
+                    if ( errno == EINTR )
+                        continue;
+                    return {};
+                }
+                if ( curr == 0 )
+                    break;
+                numRead += curr;
+            }
+            return sniffContent( buffer.data(), numRead );
+        }
+#endif
+
+        SContentSniff sniffFile( const QString &path, std::size_t blockSize )
+        {
+#ifdef Q_OS_UNIX
+            if ( !path.startsWith( ':' ) )   // resources go through QFile
+            {
+                auto fd = ::open( QFile::encodeName( path ).constData(), O_RDONLY | O_CLOEXEC );
+                if ( fd < 0 )
+                    return {};
+                auto retVal = sniffContent( fd, blockSize );
+                ::close( fd );
+                return retVal;
+            }
+#endif
+            QFile file( path );
+            if ( !file.open( QIODevice::ReadOnly ) )
+                return {};
+            return sniffContent( file, blockSize );
+        }
+
+        std::vector< SContentSniff > sniffFiles( const QStringList &paths, std::size_t blockSize, int maxThreads )
+        {
+            std::vector< SContentSniff > retVal( paths.size() );
+
+            parallelFor< qsizetype >( paths.size(), 64, maxThreads, [ &paths, &retVal, blockSize ]( qsizetype ii ) { retVal[ ii ] = sniffFile( paths[ ii ], blockSize ); } );
+            return retVal;
+        }
+    }
+}
@@ -0,0 +1,80 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __CONTENTSNIFF_H
+#define __CONTENTSNIFF_H
+
+#include "SABUtilsExport.h"
+
+#include <QStringList>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class QFile;
+
+namespace NSABUtils
+{
+    namespace NFileUtils
+    {
+        enum class ETextEncoding
+        {
+            eNone,   // empty or binary
+            eASCII,
+            eUTF8,   // valid UTF-8 with at least one multi byte sequence
+            eUTF8BOM,
+            eUTF16LE,   // from the BOM, the bytes are not classified
+            eUTF16BE,
+            eUTF32LE,
+            eUTF32BE,
+            eOther   // text, but not valid UTF-8, most likely an 8 bit code page
+        };
+
+        // binary means one of the first bytes is a control character other than tab, newline, vertical tab, form feed or carriage return (or DEL)
+        // bytes above 127 are text, the same as isBinaryFile has always treated them
+        struct SABUTILS_EXPORT SContentSniff
+        {
+            bool fAOK{ false };   // false when the file could not be opened or read
+            bool fIsBinary{ false };
+            ETextEncoding fEncoding{ ETextEncoding::eNone };
+            std::size_t fBOMSize{ 0 };
+            std::size_t fNumBytes{ 0 };   // examined
+
+            bool isText() const { return fAOK && !fIsBinary && ( fNumBytes > 0 ); }
+        };
+
+        static constexpr std::size_t kDefaultSniffSize{ 4096 };
+
+        // the bytes are classified 16 at a time with SSE2 when it is available
+        SABUTILS_EXPORT SContentSniff sniffContent( const char *data, std::size_t size );   // a block already read (or mapped) for hashing for instance, nothing more is read
+        SABUTILS_EXPORT SContentSniff sniffContent( QFile &file, std::size_t blockSize = kDefaultSniffSize );   // peeks, the position of the open file is unchanged
+#ifdef Q_OS_UNIX
+        SABUTILS_EXPORT SContentSniff sniffContent( int fd, std::size_t blockSize = kDefaultSniffSize );   // reads from the start with pread, the offset of the fd is unchanged
+#endif
+        SABUTILS_EXPORT SContentSniff sniffFile( const QString &path, std::size_t blockSize = kDefaultSniffSize );
+        // the files are read on a pool of threads (large batches only), the results are in the order of paths
+        SABUTILS_EXPORT std::vector< SContentSniff > sniffFiles( const QStringList &paths, std::size_t blockSize = kDefaultSniffSize, int maxThreads = 0 );
+    }
+}
+
+#endif
@@ -0,0 +1,311 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "DigestCache.h"
+#include "FileBasedCache.h"
+#include "RecordLog.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QObject>
+#include <QStandardPaths>
+
+#include <map>
+
+namespace NSABUtils
+{
+    namespace
+    {
+        constexpr quint32 kMagic = 0x53414244;   // SABD
+        constexpr quint32 kVersion = 2;
+
+        enum class ERecordType : quint8
+        {
+            eAdd = 1,
+            eInvalidate = 2
+        };
+
+        using TDigests = std::map< EHashAlgorithm, QByteArray >;
+
+        void writeAddRecord( QDataStream &ds, const SFileBasedCacheNode &node, EHashAlgorithm algorithm, const QByteArray &digest )
+        {
+            ds << static_cast< quint8 >( ERecordType::eAdd ) << node.filePath() << static_cast< quint64 >( node.size() ) << node.modificationTime().toMSecsSinceEpoch() << static_cast< qint32 >( algorithm ) << digest;
+        }
+    }
+
+    class CDigestCacheImpl
+    {
+    public:
+        bool open( const QString &fileName, QString *msg );
+        void close();
+
+        bool readRecord( QDataStream &ds );
+        bool compact( QString *msg );
+        void autoCompact();
+
+        std::size_t numEntries() const;
+
+        mutable QMutex fMutex;
+        CRecordLog fLog{ kMagic, kVersion };
+        CFileBasedCache< TDigests > fCache;
+    };
+
+    CDigestCache *CDigestCache::instance()
+    {
+        static CDigestCache retVal;
+        return &retVal;
+    }
+
+    CDigestCache::CDigestCache() :
+        fImpl( std::make_unique< CDigestCacheImpl >() )
+    {
+    }
+
+    CDigestCache::~CDigestCache()
+    {
+        close();
+    }
+
+    QString CDigestCache::defaultFileName()
+    {
+        return QDir( QStandardPaths::writableLocation( QStandardPaths::CacheLocation ) ).absoluteFilePath( "digests.dat" );
+    }
+
+    bool CDigestCache::open( const QString &fileName, QString *msg )
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        return fImpl->open( fileName.isEmpty() ? defaultFileName() : fileName, msg );
+    }
+
+    void CDigestCache::close()
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        fImpl->close();
+    }
+
+    bool CDigestCache::isOpen() const
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        return fImpl->fLog.isOpen();
+    }
+
+    QString CDigestCache::fileName() const
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        return fImpl->fLog.fileName();
+    }
+
+    QByteArray CDigestCache::find( const QFileInfo &fi, EHashAlgorithm algorithm ) const
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        if ( !fImpl->fLog.isOpen() )
+            return {};
+
+        // a fresh stat, the callers file info may have been cached before the file changed
+        auto digests = fImpl->fCache.find( QFileInfo( fi.absoluteFilePath() ) );
+        auto pos = digests.find( algorithm );
+        if ( pos == digests.end() )
+            return {};
+        return ( *pos ).second;
+    }
+
+    void CDigestCache::add( const QFileInfo &fi, EHashAlgorithm algorithm, const QByteArray &digest )
+    {
+        add( SFileBasedCacheNode( QFileInfo( fi.absoluteFilePath() ) ), algorithm, digest );
+    }
+
+    void CDigestCache::add( const SFileBasedCacheNode &node, EHashAlgorithm algorithm, const QByteArray &digest )
+    {
+        if ( digest.isEmpty() )
+            return;
+
+        QMutexLocker locker( &fImpl->fMutex );
+        if ( !fImpl->fLog.isOpen() )
+            return;
+
+        TDigests digests;
+        auto prev = fImpl->fCache.findByPath( node.filePath() );
+        if ( prev && ( ( *prev ).first == node ) )
+            digests = ( *prev ).second;   // same version of the file, keep the other algorithms
+        digests[ algorithm ] = digest;
+        fImpl->fCache.add( node, digests );
+
+        writeAddRecord( fImpl->fLog.appendStream(), node, algorithm, digest );
+        fImpl->fLog.recordAdded();
+        fImpl->autoCompact();
+    }
+
+    void CDigestCache::invalidate( const QString &path )
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        if ( !fImpl->fLog.isOpen() )
+            return;
+
+        auto absPath = QFileInfo( path ).absoluteFilePath();
+        if ( !fImpl->fCache.contains( absPath, true ) )
+            return;
+
+        fImpl->fCache.remove( absPath );
+        fImpl->fLog.appendStream() << static_cast< quint8 >( ERecordType::eInvalidate ) << absPath;
+        fImpl->fLog.recordAdded();
+    }
+
+    void CDigestCache::invalidateAll()
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        if ( !fImpl->fLog.isOpen() )
+            return;
+
+        fImpl->fCache.clear();
+        fImpl->compact( nullptr );
+    }
+
+    bool CDigestCache::compact( QString *msg )
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        if ( !fImpl->fLog.isOpen() )
+        {
+            if ( msg )
+                *msg = QObject::tr( "Digest cache is not open" );
+            return false;
+        }
+        return fImpl->compact( msg );
+    }
+
+    void CDigestCache::setAutoCompactRatio( int value )
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        fImpl->fLog.setAutoCompactRatio( value );
+    }
+
+    int CDigestCache::autoCompactRatio() const
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        return fImpl->fLog.autoCompactRatio();
+    }
+
+    std::size_t CDigestCache::numEntries() const
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        return fImpl->numEntries();
+    }
+
+    std::size_t CDigestCache::numRecords() const
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        return fImpl->fLog.numRecords();
+    }
+
+    std::size_t CDigestCacheImpl::numEntries() const
+    {
+        std::size_t retVal = 0;
+        fCache.forEach( [ &retVal ]( const SFileBasedCacheNode & /*node*/, const TDigests &digests ) { retVal += digests.size(); } );
+        return retVal;
+    }
+
+    bool CDigestCacheImpl::open( const QString &fileName, QString *msg )
+    {
+        close();
+        if ( !fLog.open( fileName, [ this ]( QDataStream &ds ) { return readRecord( ds ); }, msg ) )
+        {
+            fCache.clear();
+            return false;
+        }
+        return true;
+    }
+
+    void CDigestCacheImpl::close()
+    {
+        fLog.close();
+        fCache.clear();
+    }
+
+    bool CDigestCacheImpl::readRecord( QDataStream &ds )
+    {
+        quint8 type = 0;
+        ds >> type;
+        if ( type == static_cast< quint8 >( ERecordType::eAdd ) )
+        {
+            QString path;
+            quint64 size = 0;
+            qint64 msecs = 0;
+            qint32 algorithm = 0;
+            QByteArray digest;
+            ds >> path >> size >> msecs >> algorithm >> digest;
+            if ( ds.status() != QDataStream::Ok )
+                return false;
+
+            auto node = SFileBasedCacheNode( path, size, QDateTime::fromMSecsSinceEpoch( msecs ) );
+            TDigests digests;
+            // only keep the older digests when they were for the same version of the file
+            auto prev = fCache.findByPath( path );
+            if ( prev && ( ( *prev ).first == node ) )
+                digests = ( *prev ).second;
+            digests[ static_cast< EHashAlgorithm >( algorithm ) ] = digest;
+            fCache.add( node, digests );
+            return true;
+        }
+        else if ( type == static_cast< quint8 >( ERecordType::eInvalidate ) )
+        {
+            QString path;
+            ds >> path;
+            if ( ds.status() != QDataStream::Ok )
+                return false;
+            fCache.remove( path );
+            return true;
+        }
+        return false;
+    }
+
+    void CDigestCacheImpl::autoCompact()
+    {
+        // compare against the number of paths, most paths only have a single digest and this avoids counting them all on every add
+        if ( fLog.needsCompact( fCache.size() ) )
+            compact( nullptr );
+    }
+
+    bool CDigestCacheImpl::compact( QString *msg )
+    {
+        auto aOK = fLog.compact(
+            [ this ]( QDataStream &ds )
+            {
+                std::size_t numRecords = 0;
+                fCache.forEach(
+                    [ &ds, &numRecords ]( const SFileBasedCacheNode &node, const TDigests &digests )
+                    {
+                        for ( auto &&ii : digests )
+                        {
+                            writeAddRecord( ds, node, ii.first, ii.second );
+                            numRecords++;
+                        }
+                    } );
+                return numRecords;
+            },
+            msg );
+        if ( !fLog.isOpen() )
+            fCache.clear();
+        return aOK;
+    }
+}
@@ -0,0 +1,80 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __DIGESTCACHE_H
+#define __DIGESTCACHE_H
+
+#include "SABUtilsExport.h"
+#include "ContentHash.h"
+
+#include <QByteArray>
+#include <QString>
+#include <memory>
+
+class QFileInfo;
+namespace NSABUtils
+{
+    struct SFileBasedCacheNode;
+
+    // persistent store of file digests, keyed by path, size and modification time (SFileBasedCacheNode)
+    // so an unchanged file is answered without reading it, and any change to the file is a miss
+    //
+    // the store is an append only log, every add or invalidate is a record appended to the file
+    // loading replays the log, a torn record at the end (from a crash) is truncated away
+    // when the log is mostly superseded records it is compacted, rewriting only the live entries
+    //
+    // the cache does nothing until open is called, once open getMd5( QFileInfo ), CComputeMD5 and CFileCompare consult it
+    class CDigestCacheImpl;
+    class SABUTILS_EXPORT CDigestCache
+    {
+    public:
+        static CDigestCache *instance();
+        ~CDigestCache();
+
+        static QString defaultFileName();   // <cache location>/digests.dat
+        bool open( const QString &fileName = {}, QString *msg = nullptr );   // empty uses defaultFileName, fails without touching a file that is not a digest cache
+        void close();
+        bool isOpen() const;
+        QString fileName() const;
+
+        // returns the formatted digest, empty if the file has changed or was never added
+        QByteArray find( const QFileInfo &fi, EHashAlgorithm algorithm ) const;
+        void add( const SFileBasedCacheNode &node, EHashAlgorithm algorithm, const QByteArray &digest );
+        void add( const QFileInfo &fi, EHashAlgorithm algorithm, const QByteArray &digest );   // uses the current size and timestamp of the file
+
+        void invalidate( const QString &path );   // all digests for the path
+        void invalidateAll();
+
+        bool compact( QString *msg = nullptr );
+        void setAutoCompactRatio( int value );   // default 4, compacts when there are more than ratio x the live records, 0 disables
+        int autoCompactRatio() const;
+
+        std::size_t numEntries() const;   // live path/algorithm entries
+        std::size_t numRecords() const;   // records in the log
+
+    private:
+        CDigestCache();
+        std::unique_ptr< CDigestCacheImpl > fImpl;
+    };
+}
+
+#endif
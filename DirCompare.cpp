@@ -0,0 +1,488 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "DirCompare.h"
+
+#include <QDir>
+#include <QThread>
+#include <QThreadPool>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSemaphore>
+#include <QElapsedTimer>
+
+#include <atomic>
+#include <map>
+#include <algorithm>
+
+namespace NSABUtils
+{
+    namespace NFileUtils
+    {
+        QString toString( EDirCompareResult result )
+        {
+            switch ( result )
+            {
+                case EDirCompareResult::eIdentical:
+                    return QObject::tr( "Identical" );
+                case EDirCompareResult::eOnlyLeft:
+                    return QObject::tr( "Only Left" );
+                case EDirCompareResult::eOnlyRight:
+                    return QObject::tr( "Only Right" );
+                case EDirCompareResult::eTypeDiffers:
+                    return QObject::tr( "Type Differs" );
+                case EDirCompareResult::eMetaDataDiffers:
+                    return QObject::tr( "Metadata Differs" );
+                case EDirCompareResult::eContentDiffers:
+                    return QObject::tr( "Content Differs" );
+                case EDirCompareResult::eError:
+                    return QObject::tr( "Error" );
+            }
+            return {};
+        }
+
+        class CDirCompareImpl
+        {
+        public:
+            using TEntries = std::map< QString, QFileInfo >;
+
+            CDirCompareImpl( CDirCompare *parent ) :
+                fParent( parent )
+            {
+                fContentPool.setMaxThreadCount( QThread::idealThreadCount() );
+                fWalkPool.setMaxThreadCount( 4 );
+            }
+
+            ~CDirCompareImpl()
+            {
+                fCanceled = true;
+                fWalkPool.waitForDone();
+                fContentPool.waitForDone();
+            }
+
+            bool start( const QString &lhsRoot, const QString &rhsRoot, QString *msg );
+            void compareDir( const QString &relDir );
+            bool compareMetaData( const SDirCompareEntry &entry, SFileStat &lhsStat, SFileStat &rhsStat ) const;
+            void compareContent( const QString &relPath, const QFileInfo &lhs, const QFileInfo &rhs, const SFileStat &lhsStat, const SFileStat &rhsStat );
+            bool listDir( const QString &relDir, const QString &root, TEntries &entries ) const;
+            QString relativePath( const QString &relDir, const QString &name ) const;
+            void report( const SDirCompareEntry &entry );
+            void taskFinished();
+            void emitResults( bool force );
+
+            CDirCompare *fParent{ nullptr };
+            QThreadPool fWalkPool;
+            QThreadPool fContentPool;
+            int fMaxPendingChecks{ 1024 };
+            int fProgressInterval{ 100 };
+            SFileCompareOptions fOptions;
+            QStringList fNameFilters;
+            bool fReportIdentical{ false };
+            std::function< void( const SDirCompareEntry &entry ) > fResultFunc;
+
+            // fixed for the length of a run
+            QString fLHSRoot;
+            QString fRHSRoot;
+            SFileCompareOptions fRunOptions;
+            QStringList fRunNameFilters;
+            bool fRunReportIdentical{ false };
+            std::unique_ptr< QSemaphore > fPendingChecks;
+
+            mutable QMutex fMutex;
+            TDirCompareEntries fResults;
+            TDirCompareEntries fBatch;
+            int fNumCompared{ 0 };
+            QElapsedTimer fProgressTimer;
+            bool fRunning{ false };
+            std::atomic< int > fOutstanding{ 0 };
+            std::atomic< bool > fCanceled{ false };
+        };
+
+        bool CDirCompareImpl::start( const QString &lhsRoot, const QString &rhsRoot, QString *msg )
+        {
+            QMutexLocker locker( &fMutex );
+            if ( fRunning )
+            {
+                if ( msg )
+                    *msg = QObject::tr( "A comparison is already running" );
+                return false;
+            }
+
+            for ( auto &&ii : { lhsRoot, rhsRoot } )
+            {
+                auto fi = QFileInfo( ii );
+                if ( !fi.isDir() || !fi.isReadable() )
+                {
+                    if ( msg )
+                        *msg = QObject::tr( "Directory '%1' does not exist or is not readable" ).arg( ii );
+                    return false;
+                }
+            }
+
+            fLHSRoot = QFileInfo( lhsRoot ).absoluteFilePath();
+            fRHSRoot = QFileInfo( rhsRoot ).absoluteFilePath();
+            fRunOptions = fOptions;
+            fRunNameFilters = fNameFilters;
+            fRunReportIdentical = fReportIdentical;
+            fPendingChecks = std::make_unique< QSemaphore >( fMaxPendingChecks );
+
+            fCanceled = false;
+            fResults.clear();
+            fBatch.clear();
+            fNumCompared = 0;
+            fRunning = true;
+            fProgressTimer.start();
+
+            fOutstanding = 1;
+            fWalkPool.start( [ this ]() { compareDir( QString() ); } );
+            return true;
+        }
+
+        QString CDirCompareImpl::relativePath( const QString &relDir, const QString &name ) const
+        {
+            return relDir.isEmpty() ? name : ( relDir + "/" + name );
+        }
+
+        bool CDirCompareImpl::listDir( const QString &relDir, const QString &root, TEntries &entries ) const
+        {
+            auto dir = QDir( relDir.isEmpty() ? root : QDir( root ).absoluteFilePath( relDir ) );
+            if ( !dir.exists() || !dir.isReadable() )
+                return false;
+
+            auto infos = dir.entryInfoList( QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System, QDir::NoSort );
+            for ( auto &&ii : infos )
+            {
+                if ( !ii.isDir() && !fRunNameFilters.isEmpty() && !QDir::match( fRunNameFilters, ii.fileName() ) )
+                    continue;
+#ifdef Q_OS_WINDOWS
+                entries[ ii.fileName().toLower() ] = ii;
+#else
+                entries[ ii.fileName() ] = ii;
+#endif
+            }
+            return true;
+        }
+
+        void CDirCompareImpl::compareDir( const QString &relDir )
+        {
+            if ( fCanceled )
+                return taskFinished();
+
+            TEntries lhsEntries;
+            TEntries rhsEntries;
+            auto lhsOK = listDir( relDir, fLHSRoot, lhsEntries );
+            auto rhsOK = listDir( relDir, fRHSRoot, rhsEntries );
+            if ( !lhsOK || !rhsOK )
+            {
+                SDirCompareEntry entry;
+                entry.fRelativePath = relDir;
+                entry.fResult = EDirCompareResult::eError;
+                entry.fIsDir = true;
+                entry.fErrorMsg = QObject::tr( "Could not read directory '%1'" ).arg( QDir( lhsOK ? fRHSRoot : fLHSRoot ).absoluteFilePath( relDir ) );
+                report( entry );
+                return taskFinished();
+            }
+
+            // both maps are sorted by name, walk them together
+            auto lhsPos = lhsEntries.begin();
+            auto rhsPos = rhsEntries.begin();
+            while ( !fCanceled && ( ( lhsPos != lhsEntries.end() ) || ( rhsPos != rhsEntries.end() ) ) )
+            {
+                SDirCompareEntry entry;
+                if ( ( rhsPos == rhsEntries.end() ) || ( ( lhsPos != lhsEntries.end() ) && ( ( *lhsPos ).first < ( *rhsPos ).first ) ) )
+                {
+                    entry.fLHS = ( *lhsPos ).second;
+                    entry.fRelativePath = relativePath( relDir, entry.fLHS.fileName() );
+                    entry.fIsDir = entry.fLHS.isDir();
+                    entry.fResult = EDirCompareResult::eOnlyLeft;
+                    report( entry );
+                    ++lhsPos;
+                    continue;
+                }
+                if ( ( lhsPos == lhsEntries.end() ) || ( ( *rhsPos ).first < ( *lhsPos ).first ) )
+                {
+                    entry.fRHS = ( *rhsPos ).second;
+                    entry.fRelativePath = relativePath( relDir, entry.fRHS.fileName() );
+                    entry.fIsDir = entry.fRHS.isDir();
+                    entry.fResult = EDirCompareResult::eOnlyRight;
+                    report( entry );
+                    ++rhsPos;
+                    continue;
+                }
+
+                entry.fLHS = ( *lhsPos ).second;
+                entry.fRHS = ( *rhsPos ).second;
+                entry.fRelativePath = relativePath( relDir, entry.fLHS.fileName() );
+                entry.fIsDir = entry.fLHS.isDir();
+                ++lhsPos;
+                ++rhsPos;
+
+                SFileStat lhsStat;
+                SFileStat rhsStat;
+                if ( entry.fLHS.isDir() != entry.fRHS.isDir() )
+                {
+                    entry.fResult = EDirCompareResult::eTypeDiffers;
+                    report( entry );
+                }
+                else if ( entry.fIsDir && ( entry.fLHS.isSymLink() || entry.fRHS.isSymLink() ) )
+                {
+                    // never follow directory links, they can loop, compare where they point instead
+                    entry.fResult = ( entry.fLHS.symLinkTarget() == entry.fRHS.symLinkTarget() ) ? EDirCompareResult::eIdentical : EDirCompareResult::eMetaDataDiffers;
+                    report( entry );
+                }
+                else if ( entry.fIsDir )
+                {
+                    fOutstanding++;
+                    auto relPath = entry.fRelativePath;
+                    fWalkPool.start( [ this, relPath ]() { compareDir( relPath ); } );
+                }
+                else if ( !compareMetaData( entry, lhsStat, rhsStat ) )
+                {
+                    entry.fResult = EDirCompareResult::eMetaDataDiffers;
+                    report( entry );
+                }
+                else if ( !fRunOptions.fMD5 )
+                {
+                    entry.fResult = EDirCompareResult::eIdentical;
+                    report( entry );
+                }
+                else
+                {
+                    // bounded, wait for the content checks to catch up
+                    while ( !fPendingChecks->tryAcquire( 1, 100 ) )
+                    {
+                        if ( fCanceled )
+                            return taskFinished();
+                    }
+                    fOutstanding++;
+                    fContentPool.start( [ this, entry, lhsStat, rhsStat ]() { compareContent( entry.fRelativePath, entry.fLHS, entry.fRHS, lhsStat, rhsStat ); } );
+                }
+            }
+            taskFinished();
+        }
+
+        // one stat per file, kept for the content check
+        bool CDirCompareImpl::compareMetaData( const SDirCompareEntry &entry, SFileStat &lhsStat, SFileStat &rhsStat ) const
+        {
+            lhsStat = fileStat( entry.fLHS.absoluteFilePath() );
+            rhsStat = fileStat( entry.fRHS.absoluteFilePath() );
+            CFileCompare compare( entry.fLHS, entry.fRHS, fRunOptions );
+            compare.setFileStats( lhsStat, rhsStat );
+            return compare.compareMetaData();
+        }
+
+        void CDirCompareImpl::compareContent( const QString &relPath, const QFileInfo &lhs, const QFileInfo &rhs, const SFileStat &lhsStat, const SFileStat &rhsStat )
+        {
+            if ( !fCanceled )
+            {
+                SDirCompareEntry entry;
+                entry.fRelativePath = relPath;
+                entry.fLHS = lhs;
+                entry.fRHS = rhs;
+                CFileCompare compare( lhs, rhs, fRunOptions );
+                compare.setFileStats( lhsStat, rhsStat );
+                entry.fResult = compare.compareContent() ? EDirCompareResult::eIdentical : EDirCompareResult::eContentDiffers;
+                report( entry );
+            }
+            fPendingChecks->release();
+            taskFinished();
+        }
+
+        void CDirCompareImpl::report( const SDirCompareEntry &entry )
+        {
+            QMutexLocker locker( &fMutex );
+            fNumCompared++;
+            if ( ( entry.fResult == EDirCompareResult::eIdentical ) && !fRunReportIdentical )
+                return;
+
+            fResults << entry;
+            fBatch << entry;
+            auto resultFunc = fResultFunc;
+            locker.unlock();
+
+            if ( resultFunc )
+                resultFunc( entry );
+            emitResults( false );
+        }
+
+        void CDirCompareImpl::taskFinished()
+        {
+            if ( --fOutstanding > 0 )
+                return;
+
+            QMutexLocker locker( &fMutex );
+            fRunning = false;
+            std::sort( fResults.begin(), fResults.end(), []( const SDirCompareEntry &lhs, const SDirCompareEntry &rhs ) { return lhs.fRelativePath < rhs.fRelativePath; } );
+            bool canceled = fCanceled;
+            locker.unlock();
+
+            emitResults( true );
+            emit fParent->sigFinished( canceled );
+        }
+
+        void CDirCompareImpl::emitResults( bool force )
+        {
+            QMutexLocker locker( &fMutex );
+            if ( !force && ( fProgressTimer.elapsed() < fProgressInterval ) )
+                return;
+            fProgressTimer.restart();
+            TDirCompareEntries batch;
+            batch.swap( fBatch );
+            auto numCompared = fNumCompared;
+            auto numPending = fPendingChecks ? ( fMaxPendingChecks - fPendingChecks->available() ) : 0;
+            locker.unlock();
+
+            if ( !batch.isEmpty() )
+                emit fParent->sigResults( batch );
+            emit fParent->sigProgress( numCompared, numPending );
+        }
+
+        CDirCompare::CDirCompare( QObject *parent ) :
+            QObject( parent ),
+            fImpl( std::make_unique< CDirCompareImpl >( this ) )
+        {
+        }
+
+        CDirCompare::~CDirCompare()
+        {
+        }
+
+        void CDirCompare::setOptions( const SFileCompareOptions &options )
+        {
+            QMutexLocker locker( &fImpl->fMutex );
+            fImpl->fOptions = options;
+        }
+
+        SFileCompareOptions CDirCompare::options() const
+        {
+            QMutexLocker locker( &fImpl->fMutex );
+            return fImpl->fOptions;
+        }
+
+        void CDirCompare::setNameFilters( const QStringList &nameFilters )
+        {
+            QMutexLocker locker( &fImpl->fMutex );
+            fImpl->fNameFilters = nameFilters;
+        }
+
+        QStringList CDirCompare::nameFilters() const
+        {
+            QMutexLocker locker( &fImpl->fMutex );
+            return fImpl->fNameFilters;
+        }
+
+        void CDirCompare::setReportIdentical( bool value )
+        {
+            QMutexLocker locker( &fImpl->fMutex );
+            fImpl->fReportIdentical = value;
+        }
+
+        bool CDirCompare::reportIdentical() const
+        {
+            QMutexLocker locker( &fImpl->fMutex );
+            return fImpl->fReportIdentical;
+        }
+
+        void CDirCompare::setMaxThreads( int value )
+        {
+            fImpl->fContentPool.setMaxThreadCount( ( value > 0 ) ? value : QThread::idealThreadCount() );
+        }
+
+        int CDirCompare::maxThreads() const
+        {
+            return fImpl->fContentPool.maxThreadCount();
+        }
+
+        void CDirCompare::setMaxWalkThreads( int value )
+        {
+            fImpl->fWalkPool.setMaxThreadCount( std::max( 1, value ) );
+        }
+
+        int CDirCompare::maxWalkThreads() const
+        {
+            return fImpl->fWalkPool.maxThreadCount();
+        }
+
+        void CDirCompare::setMaxPendingChecks( int value )
+        {
+            QMutexLocker locker( &fImpl->fMutex );
+            if ( !fImpl->fRunning )
+                fImpl->fMaxPendingChecks = std::max( 1, value );
+        }
+
+        int CDirCompare::maxPendingChecks() const
+        {
+            QMutexLocker locker( &fImpl->fMutex );
+            return fImpl->fMaxPendingChecks;
+        }
+
+        void CDirCompare::setProgressInterval( int msecs )
+        {
+            QMutexLocker locker( &fImpl->fMutex );
+            fImpl->fProgressInterval = std::max( 0, msecs );
+        }
+
+        int CDirCompare::progressInterval() const
+        {
+            QMutexLocker locker( &fImpl->fMutex );
+            return fImpl->fProgressInterval;
+        }
+
+        void CDirCompare::setResultFunc( std::function< void( const SDirCompareEntry &entry ) > func )
+        {
+            QMutexLocker locker( &fImpl->fMutex );
+            fImpl->fResultFunc = func;
+        }
+
+        bool CDirCompare::start( const QString &lhsRoot, const QString &rhsRoot, QString *msg )
+        {
+            return fImpl->start( lhsRoot, rhsRoot, msg );
+        }
+
+        bool CDirCompare::isRunning() const
+        {
+            QMutexLocker locker( &fImpl->fMutex );
+            return fImpl->fRunning;
+        }
+
+        bool CDirCompare::waitForDone( int msecs )
+        {
+            // the walk queues content checks, so it has to finish first
+            QElapsedTimer timer;
+            timer.start();
+            if ( !fImpl->fWalkPool.waitForDone( msecs ) )
+                return false;
+            return fImpl->fContentPool.waitForDone( ( msecs < 0 ) ? -1 : static_cast< int >( std::max< qint64 >( 0, msecs - timer.elapsed() ) ) );
+        }
+
+        TDirCompareEntries CDirCompare::results() const
+        {
+            QMutexLocker locker( &fImpl->fMutex );
+            return fImpl->fResults;
+        }
+
+        void CDirCompare::slotCancel()
+        {
+            fImpl->fCanceled = true;
+        }
+    }
+}
@@ -0,0 +1,120 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __DIRCOMPARE_H
+#define __DIRCOMPARE_H
+
+#include "SABUtilsExport.h"
+#include "FileCompare.h"
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QFileInfo>
+#include <QList>
+#include <functional>
+#include <memory>
+
+namespace NSABUtils
+{
+    namespace NFileUtils
+    {
+        enum class EDirCompareResult
+        {
+            eIdentical,   // only reported when reportIdentical is set
+            eOnlyLeft,   // for a directory, the whole subtree
+            eOnlyRight,
+            eTypeDiffers,   // a file on one side and a directory on the other
+            eMetaDataDiffers,   // size, timestamp or attribute bits per the options, content is not checked
+            eContentDiffers,   // the metadata matches but the content does not
+            eError   // the entry could not be read, see fErrorMsg
+        };
+        SABUTILS_EXPORT QString toString( EDirCompareResult result );
+
+        struct SABUTILS_EXPORT SDirCompareEntry
+        {
+            QString fRelativePath;   // uses '/' as the separator
+            EDirCompareResult fResult{ EDirCompareResult::eIdentical };
+            bool fIsDir{ false };
+            QFileInfo fLHS;   // empty for eOnlyRight
+            QFileInfo fRHS;   // empty for eOnlyLeft
+            QString fErrorMsg;
+        };
+        using TDirCompareEntries = QList< SDirCompareEntry >;
+
+        // compares two directory trees, matching entries by their path relative to the roots
+        // directory pairs are listed in parallel, files that pass the metadata check of the options have
+        // their content checked on a bounded pool, so the walk never gets far ahead of the content checks
+        // results are delivered in batches through sigResults (throttled by the progress interval), or as
+        // they happen via the result function
+        class CDirCompareImpl;
+        class SABUTILS_EXPORT CDirCompare : public QObject
+        {
+            Q_OBJECT;
+
+        public:
+            CDirCompare( QObject *parent = nullptr );
+            virtual ~CDirCompare() override;
+
+            void setOptions( const SFileCompareOptions &options );
+            SFileCompareOptions options() const;
+
+            void setNameFilters( const QStringList &nameFilters );   // applied to files only, default all files
+            QStringList nameFilters() const;
+
+            void setReportIdentical( bool value );   // default false
+            bool reportIdentical() const;
+
+            void setMaxThreads( int value );   // content checks, default QThread::idealThreadCount()
+            int maxThreads() const;
+
+            void setMaxWalkThreads( int value );   // directory listing, default 4
+            int maxWalkThreads() const;
+
+            void setMaxPendingChecks( int value );   // content checks queued before the walk waits, default 1024
+            int maxPendingChecks() const;
+
+            void setProgressInterval( int msecs );   // default 100ms
+            int progressInterval() const;
+
+            void setResultFunc( std::function< void( const SDirCompareEntry &entry ) > func );   // called from the worker threads
+
+            bool start( const QString &lhsRoot, const QString &rhsRoot, QString *msg = nullptr );   // returns false if a compare is already running or a root is not a readable directory
+            bool isRunning() const;
+            bool waitForDone( int msecs = -1 );
+            TDirCompareEntries results() const;   // everything reported so far, sorted by relative path once finished
+
+        public Q_SLOTS:
+            void slotCancel();
+
+        Q_SIGNALS:
+            void sigResults( const NSABUtils::NFileUtils::TDirCompareEntries &entries );
+            void sigProgress( int numCompared, int numPendingChecks );
+            void sigFinished( bool canceled );
+
+        private:
+            std::unique_ptr< CDirCompareImpl > fImpl;
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,85 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __DIRREADER_H
+#define __DIRREADER_H
+
+#include <QtGlobal>
+
+#ifdef Q_OS_LINUX
+#include <cstddef>
+#include <vector>
+#include <sys/stat.h>
+
+namespace NSABUtils
+{
+    namespace NFileUtils
+    {
+        enum class EDirEntryType
+        {
+            eUnknown,   // the entry vanished or could not be stat'ed
+            eFile,
+            eDir,
+            eSymLink,   // only when not following links
+            eOther   // devices, fifos and sockets
+        };
+
+        // reads a directory with getdents64 into a large buffer, the names point into that buffer and are valid until the next call to next
+        // the type comes from d_type, fstatat relative to the directory is only called when the filesystem does not report one
+        // or when a symbolic link is followed
+        class CDirReader
+        {
+        public:
+            struct SEntry
+            {
+                const char *fName{ nullptr };
+                unsigned char fDType{ 0 };   // DT_xxx as returned by the kernel
+            };
+
+            explicit CDirReader( const char *path );
+            CDirReader( int parentFD, const char *name, bool followSymLinks );   // openat relative to an open directory
+            ~CDirReader();
+
+            CDirReader( const CDirReader & ) = delete;
+            CDirReader &operator=( const CDirReader & ) = delete;
+
+            bool isOpen() const { return fFD >= 0; }
+            int fd() const { return fFD; }
+            int error() const { return fErrno; }   // errno of the failed open or read
+
+            bool next( SEntry &entry );   // skips "." and "..", false at the end or on error
+            EDirEntryType type( const SEntry &entry, bool followSymLinks ) const;
+            bool stat( const char *name, struct stat &st, bool followSymLinks ) const;
+
+        private:
+            static constexpr std::size_t kBufferSize{ 256 * 1024 };
+
+            int fFD{ -1 };
+            int fErrno{ 0 };
+            std::vector< char > fBuffer;
+            std::size_t fPos{ 0 };
+            std::size_t fEnd{ 0 };
+        };
+    }
+}
+#endif
+#endif
@@ -0,0 +1,145 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "DirReader.h"
+
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+namespace NSABUtils
+{
+    namespace NFileUtils
+    {
+        namespace
+        {
+            // glibc only exposes getdents64 as of 2.30
+            struct SLinuxDirent64
+            {
+                ino64_t d_ino;
+                off64_t d_off;
+                unsigned short d_reclen;
+                unsigned char d_type;
+                char d_name[ 1 ];
+            };
+
+            EDirEntryType typeFromMode( mode_t mode )
+            {
+                if ( S_ISREG( mode ) )
+                    return EDirEntryType::eFile;
+                if ( S_ISDIR( mode ) )
+                    return EDirEntryType::eDir;
+                if ( S_ISLNK( mode ) )
+                    return EDirEntryType::eSymLink;
+                return EDirEntryType::eOther;
+            }
+        }
+
+        CDirReader::CDirReader( const char *path ) :
+            CDirReader( AT_FDCWD, path, true )
+        {
+        }
+
+        CDirReader::CDirReader( int parentFD, const char *name, bool followSymLinks )
+        {
+            auto flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+            if ( !followSymLinks )
+                flags |= O_NOFOLLOW;
+            fFD = ::openat( parentFD, name, flags );
+            if ( fFD < 0 )
+                fErrno = errno;
+            else
+                fBuffer.resize( kBufferSize );
+        }
+
+        CDirReader::~CDirReader()
+        {
+            if ( fFD >= 0 )
+                ::close( fFD );
+        }
+
+        bool CDirReader::next( SEntry &entry )
+        {
+            if ( fFD < 0 )
+                return false;
+
+            while ( true )
+            {
+                if ( fPos >= fEnd )
+                {
+                    auto numRead = ::syscall( SYS_getdents64, fFD, fBuffer.data(), fBuffer.size() );
+                    if ( numRead <= 0 )
+                    {
+                        if ( numRead < 0 )
+                            fErrno = errno;
+                        return false;
+                    }
+                    fPos = 0;
+                    fEnd = static_cast< std::size_t >( numRead );
+                }
+
+                auto curr = reinterpret_cast< const SLinuxDirent64 * >( fBuffer.data() + fPos );
+                fPos += curr->d_reclen;
+
+                auto name = curr->d_name;
+                if ( ( name[ 0 ] == '.' ) && ( ( name[ 1 ] == 0 ) || ( ( name[ 1 ] == '.' ) && ( name[ 2 ] == 0 ) ) ) )
+                    continue;
+
+                entry.fName = name;
+                entry.fDType = curr->d_type;
+                return true;
+            }
+        }
+
+        EDirEntryType CDirReader::type( const SEntry &entry, bool followSymLinks ) const
+        {
+            switch ( entry.fDType )
+            {
+                case DT_REG:
+                    return EDirEntryType::eFile;
+                case DT_DIR:
+                    return EDirEntryType::eDir;
+                case DT_LNK:
+                    if ( !followSymLinks )
+                        return EDirEntryType::eSymLink;
+                    break;
+                case DT_UNKNOWN:
+                    break;
+                default:
+                    return EDirEntryType::eOther;
+            }
+
+            struct stat st;
+            if ( !stat( entry.fName, st, followSymLinks ) )
+                return EDirEntryType::eUnknown;
+            return typeFromMode( st.st_mode );
+        }
+
+        bool CDirReader::stat( const char *name, struct stat &st, bool followSymLinks ) const
+        {
+            return ::fstatat( fFD, name, &st, followSymLinks ? 0 : AT_SYMLINK_NOFOLLOW ) == 0;
+        }
+    }
+}
@@ -0,0 +1,577 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "DirSnapshot.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QObject>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace NSABUtils
+{
+    namespace NFileUtils
+    {
+        namespace
+        {
+            constexpr quint32 kMagic = 0x53414253;   // SABS
+            constexpr quint32 kVersion = 1;
+            constexpr quint32 kNone = 0xFFFFFFFF;
+            constexpr qint64 kUnread = std::numeric_limits< qint64 >::min();   // never listed, or listed too close to its modification to trust the time
+            constexpr qint64 kRacyWindow = 2000;   // msecs, a directory changed this close to the scan is read again next time
+
+            struct SDir
+            {
+                qint64 fMTime{ kUnread };
+                quint32 fFirstEntry{ 0 };
+                quint32 fNumEntries{ 0 };
+            };
+
+            struct SEntry
+            {
+                quint32 fName{ 0 };   // offset into the name pool
+                quint32 fDir{ kNone };   // the directory index for sub directories, kNone for files
+                qint64 fSize{ 0 };
+                qint64 fMTime{ 0 };
+            };
+
+            // the names are stored nul terminated, the set holds their offsets
+            struct SNameHash
+            {
+                const std::string *fPool{ nullptr };
+                std::size_t operator()( quint32 offset ) const { return std::hash< std::string_view >()( std::string_view( fPool->data() + offset ) ); }
+            };
+
+            struct SNameEqual
+            {
+                const std::string *fPool{ nullptr };
+                bool operator()( quint32 lhs, quint32 rhs ) const { return std::strcmp( fPool->data() + lhs, fPool->data() + rhs ) == 0; }
+            };
+        }
+
+        class CDirSnapshotImpl
+        {
+        public:
+            CDirSnapshotImpl() :
+                fNameIndex( 0, SNameHash{ &fNamePool }, SNameEqual{ &fNamePool } )
+            {
+            }
+
+            void clear();
+            quint32 intern( const QString &name );
+            QString name( quint32 offset ) const { return QString::fromUtf8( fNamePool.data() + offset ); }
+            QString childPath( const QString &dirPath, quint32 name ) const { return dirPath + '/' + this->name( name ); }
+
+            quint32 newDir();
+            void readDir( quint32 dirIdx, const QString &path, SDirSnapshotDiff &diff );
+            void statFiles( quint32 dirIdx, const QString &path, SDirSnapshotDiff &diff );
+            void removeDir( quint32 dirIdx, const QString &path, SDirSnapshotDiff &diff );
+            void storeEntries( quint32 dirIdx, const std::vector< SEntry > &entries );
+            std::optional< SDirSnapshotDiff > rescan( QString *msg );
+            void compact();
+            void rebuildNameIndex();
+
+            QString fRootPath;
+            bool fStatFiles{ false };
+
+            std::string fNamePool;
+            std::unordered_set< quint32, SNameHash, SNameEqual > fNameIndex;
+            std::vector< SDir > fDirs;   // 0 is the root
+            std::vector< SEntry > fEntries;   // each directory owns a contiguous range
+            std::size_t fDeadDirs{ 0 };
+            std::size_t fDeadEntries{ 0 };
+            std::size_t fCompactedPoolSize{ 0 };   // the name pool after the last compact, names of removed entries pile up past it
+        };
+
+        void CDirSnapshotImpl::clear()
+        {
+            fRootPath.clear();
+            fNameIndex.clear();
+            fNamePool.clear();
+            fDirs.clear();
+            fEntries.clear();
+            fDeadDirs = 0;
+            fDeadEntries = 0;
+            fCompactedPoolSize = 0;
+        }
+
+        quint32 CDirSnapshotImpl::intern( const QString &name )
+        {
+            // append it, then drop it again if it was already there, std::unordered_set has no lookup by a different key type
+            auto utf8 = name.toUtf8();
+            auto offset = static_cast< quint32 >( fNamePool.size() );
+            fNamePool.append( utf8.constData(), utf8.size() );
+            fNamePool.push_back( 0 );
+
+            auto pos = fNameIndex.find( offset );
+            if ( pos != fNameIndex.end() )
+            {
+                fNamePool.resize( offset );
+                return *pos;
+            }
+            fNameIndex.insert( offset );
+            return offset;
+        }
+
+        void CDirSnapshotImpl::rebuildNameIndex()
+        {
+            fNameIndex.clear();
+            for ( std::size_t ii = 0; ii < fNamePool.size(); ii += std::strlen( fNamePool.data() + ii ) + 1 )
+                fNameIndex.insert( static_cast< quint32 >( ii ) );
+        }
+
+        quint32 CDirSnapshotImpl::newDir()
+        {
+            fDirs.push_back( SDir() );
+            return static_cast< quint32 >( fDirs.size() - 1 );
+        }
+
+        void CDirSnapshotImpl::storeEntries( quint32 dirIdx, const std::vector< SEntry > &entries )
+        {
+            auto &&dir = fDirs[ dirIdx ];
+            if ( entries.size() <= dir.fNumEntries )
+            {
+                fDeadEntries += dir.fNumEntries - entries.size();
+                std::copy( entries.begin(), entries.end(), fEntries.begin() + dir.fFirstEntry );
+            }
+            else
+            {
+                fDeadEntries += dir.fNumEntries;
+                dir.fFirstEntry = static_cast< quint32 >( fEntries.size() );
+                fEntries.insert( fEntries.end(), entries.begin(), entries.end() );
+            }
+            dir.fNumEntries = static_cast< quint32 >( entries.size() );
+        }
+
+        // new sub directories are left unread, the walk in rescan reads them
+        void CDirSnapshotImpl::readDir( quint32 dirIdx, const QString &path, SDirSnapshotDiff &diff )
+        {
+            diff.fDirsRead++;
+            auto now = QDateTime::currentMSecsSinceEpoch();
+            auto mtime = QFileInfo( path ).lastModified().toMSecsSinceEpoch();
+
+            std::unordered_map< quint32, SEntry > prev;
+            prev.reserve( fDirs[ dirIdx ].fNumEntries );
+            for ( quint32 ii = 0; ii < fDirs[ dirIdx ].fNumEntries; ++ii )
+            {
+                auto &&entry = fEntries[ fDirs[ dirIdx ].fFirstEntry + ii ];
+                prev[ entry.fName ] = entry;
+            }
+
+            auto listing = QDir( path ).entryInfoList( QDir::Files | QDir::AllDirs | QDir::NoDotAndDotDot, QDir::SortFlag::NoSort );
+            std::vector< SEntry > entries;
+            entries.reserve( listing.count() );
+            for ( auto &&ii : listing )
+            {
+                SEntry entry;
+                entry.fName = intern( ii.fileName() );
+                auto isDir = ii.isDir() && !ii.isSymLink();
+
+                std::optional< SEntry > old;
+                auto pos = prev.find( entry.fName );
+                if ( pos != prev.end() )
+                {
+                    old = ( *pos ).second;
+                    prev.erase( pos );
+                }
+                auto wasDir = old.has_value() && ( old->fDir != kNone );
+
+                if ( isDir )
+                {
+                    if ( old.has_value() && !wasDir )
+                        diff.fRemoved << ii.absoluteFilePath();
+                    entry.fDir = wasDir ? old->fDir : newDir();
+                }
+                else
+                {
+                    entry.fSize = ii.size();
+                    entry.fMTime = ii.lastModified().toMSecsSinceEpoch();
+                    if ( wasDir )
+                        removeDir( old->fDir, ii.absoluteFilePath(), diff );
+                    if ( !old.has_value() || wasDir )
+                        diff.fAdded << ii.absoluteFilePath();
+                    else if ( ( old->fSize != entry.fSize ) || ( old->fMTime != entry.fMTime ) )
+                        diff.fModified << ii.absoluteFilePath();
+                }
+                entries.push_back( entry );
+            }
+
+            for ( auto &&ii : prev )
+            {
+                if ( ii.second.fDir == kNone )
+                    diff.fRemoved << childPath( path, ii.first );
+                else
+                    removeDir( ii.second.fDir, childPath( path, ii.first ), diff );
+            }
+
+            storeEntries( dirIdx, entries );
+            fDirs[ dirIdx ].fMTime = ( ( now - mtime ) < kRacyWindow ) ? kUnread : mtime;
+        }
+
+        void CDirSnapshotImpl::statFiles( quint32 dirIdx, const QString &path, SDirSnapshotDiff &diff )
+        {
+            for ( quint32 ii = 0; ii < fDirs[ dirIdx ].fNumEntries; ++ii )
+            {
+                auto &&entry = fEntries[ fDirs[ dirIdx ].fFirstEntry + ii ];
+                if ( entry.fDir != kNone )
+                    continue;
+
+                auto fi = QFileInfo( childPath( path, entry.fName ) );
+                if ( !fi.exists() )
+                {
+                    // some network filesystems do not update the directory time, fall back to reading it
+                    readDir( dirIdx, path, diff );
+                    diff.fDirsSkipped--;
+                    return;
+                }
+
+                auto size = fi.size();
+                auto mtime = fi.lastModified().toMSecsSinceEpoch();
+                if ( ( size != entry.fSize ) || ( mtime != entry.fMTime ) )
+                {
+                    entry.fSize = size;
+                    entry.fMTime = mtime;
+                    diff.fModified << fi.absoluteFilePath();
+                }
+            }
+        }
+
+        void CDirSnapshotImpl::removeDir( quint32 dirIdx, const QString &path, SDirSnapshotDiff &diff )
+        {
+            std::vector< std::pair< quint32, QString > > stack = { { dirIdx, path } };
+            while ( !stack.empty() )
+            {
+                auto curr = std::move( stack.back() );
+                stack.pop_back();
+
+                auto &&dir = fDirs[ curr.first ];
+                for ( quint32 ii = 0; ii < dir.fNumEntries; ++ii )
+                {
+                    auto &&entry = fEntries[ dir.fFirstEntry + ii ];
+                    if ( entry.fDir == kNone )
+                        diff.fRemoved << childPath( curr.second, entry.fName );
+                    else
+                        stack.emplace_back( entry.fDir, childPath( curr.second, entry.fName ) );
+                }
+                fDeadEntries += dir.fNumEntries;
+                fDeadDirs++;
+                dir = SDir();
+            }
+        }
+
+        std::optional< SDirSnapshotDiff > CDirSnapshotImpl::rescan( QString *msg )
+        {
+            if ( fDirs.empty() )
+            {
+                if ( msg )
+                    *msg = QObject::tr( "No snapshot has been taken" );
+                return {};
+            }
+
+            auto rootInfo = QFileInfo( fRootPath );
+            if ( !rootInfo.exists() || !rootInfo.isDir() )
+            {
+                if ( msg )
+                    *msg = QObject::tr( "Directory '%1' does not exist." ).arg( fRootPath );
+                return {};
+            }
+
+            SDirSnapshotDiff retVal;
+            std::vector< std::pair< quint32, QString > > stack = { { 0, fRootPath } };
+            while ( !stack.empty() )
+            {
+                auto curr = std::move( stack.back() );
+                stack.pop_back();
+
+                auto mtime = QFileInfo( curr.second ).lastModified().toMSecsSinceEpoch();
+                if ( fDirs[ curr.first ].fMTime != mtime )
+                    readDir( curr.first, curr.second, retVal );
+                else
+                {
+                    retVal.fDirsSkipped++;
+                    if ( fStatFiles )
+                        statFiles( curr.first, curr.second, retVal );
+                }
+
+                auto &&dir = fDirs[ curr.first ];
+                for ( auto ii = dir.fNumEntries; ii > 0; --ii )
+                {
+                    auto &&entry = fEntries[ dir.fFirstEntry + ii - 1 ];
+                    if ( entry.fDir != kNone )
+                        stack.emplace_back( entry.fDir, childPath( curr.second, entry.fName ) );
+                }
+            }
+
+            if ( ( fDeadEntries > fEntries.size() / 2 ) || ( fDeadDirs > fDirs.size() / 2 ) || ( fNamePool.size() > ( 2 * fCompactedPoolSize + 65536 ) ) )
+                compact();
+            return retVal;
+        }
+
+        // drops the ranges and directories that were replaced, and the names only they used
+        void CDirSnapshotImpl::compact()
+        {
+            std::string namePool;
+            std::unordered_map< quint32, quint32 > newNames;   // old offset, new offset
+            auto moveName = [ this, &namePool, &newNames ]( quint32 oldName )
+            {
+                auto pos = newNames.find( oldName );
+                if ( pos != newNames.end() )
+                    return ( *pos ).second;
+                auto offset = static_cast< quint32 >( namePool.size() );
+                namePool.append( fNamePool.data() + oldName );
+                namePool.push_back( 0 );
+                newNames[ oldName ] = offset;
+                return offset;
+            };
+
+            std::vector< SDir > dirs;
+            std::vector< SEntry > entries;
+            dirs.reserve( fDirs.size() - fDeadDirs );
+            entries.reserve( fEntries.size() - fDeadEntries );
+
+            dirs.push_back( fDirs[ 0 ] );
+            std::vector< std::pair< quint32, quint32 > > stack = { { 0, 0 } };   // old, new
+            while ( !stack.empty() )
+            {
+                auto curr = stack.back();
+                stack.pop_back();
+
+                auto &&oldDir = fDirs[ curr.first ];
+                dirs[ curr.second ].fFirstEntry = static_cast< quint32 >( entries.size() );
+                for ( quint32 ii = 0; ii < oldDir.fNumEntries; ++ii )
+                {
+                    auto entry = fEntries[ oldDir.fFirstEntry + ii ];
+                    entry.fName = moveName( entry.fName );
+                    if ( entry.fDir != kNone )
+                    {
+                        auto newIdx = static_cast< quint32 >( dirs.size() );
+                        dirs.push_back( fDirs[ entry.fDir ] );
+                        stack.emplace_back( entry.fDir, newIdx );
+                        entry.fDir = newIdx;
+                    }
+                    entries.push_back( entry );
+                }
+            }
+
+            fDirs = std::move( dirs );
+            fEntries = std::move( entries );
+            fDeadDirs = 0;
+            fDeadEntries = 0;
+            fNamePool = std::move( namePool );
+            fCompactedPoolSize = fNamePool.size();
+            rebuildNameIndex();
+        }
+
+        CDirSnapshot::CDirSnapshot() :
+            fImpl( std::make_unique< CDirSnapshotImpl >() )
+        {
+        }
+
+        CDirSnapshot::~CDirSnapshot()
+        {
+        }
+
+        bool CDirSnapshot::scan( const QString &rootDir, QString *msg )
+        {
+            fImpl->clear();
+            auto dir = QDir( rootDir );
+            if ( !dir.exists() || !dir.isReadable() )
+            {
+                if ( msg )
+                    *msg = QObject::tr( "Directory '%1' does not exist." ).arg( dir.absolutePath() );
+                return false;
+            }
+
+            fImpl->fRootPath = dir.absolutePath();
+            fImpl->newDir();
+            return fImpl->rescan( msg ).has_value();
+        }
+
+        std::optional< SDirSnapshotDiff > CDirSnapshot::rescan( QString *msg )
+        {
+            return fImpl->rescan( msg );
+        }
+
+        void CDirSnapshot::setStatFiles( bool value )
+        {
+            fImpl->fStatFiles = value;
+        }
+
+        bool CDirSnapshot::statFiles() const
+        {
+            return fImpl->fStatFiles;
+        }
+
+        // the arrays are written as is, the header records the struct sizes so a snapshot from a different layout is rejected rather than misread
+        bool CDirSnapshot::save( const QString &fileName, QString *msg ) const
+        {
+            QSaveFile file( fileName );
+            if ( !file.open( QIODevice::WriteOnly ) )
+            {
+                if ( msg )
+                    *msg = QObject::tr( "Could not open '%1': %2" ).arg( fileName ).arg( file.errorString() );
+                return false;
+            }
+
+            QDataStream ds( &file );
+            ds.setVersion( QDataStream::Qt_6_0 );
+            ds << kMagic << kVersion << static_cast< quint32 >( sizeof( SDir ) ) << static_cast< quint32 >( sizeof( SEntry ) );
+            ds << fImpl->fRootPath;
+            ds << static_cast< quint64 >( fImpl->fNamePool.size() ) << static_cast< quint64 >( fImpl->fDirs.size() ) << static_cast< quint64 >( fImpl->fEntries.size() );
+            ds.writeRawData( fImpl->fNamePool.data(), static_cast< int >( fImpl->fNamePool.size() ) );
+            ds.writeRawData( reinterpret_cast< const char * >( fImpl->fDirs.data() ), static_cast< int >( fImpl->fDirs.size() * sizeof( SDir ) ) );
+            ds.writeRawData( reinterpret_cast< const char * >( fImpl->fEntries.data() ), static_cast< int >( fImpl->fEntries.size() * sizeof( SEntry ) ) );
+
+            if ( ( ds.status() != QDataStream::Ok ) || !file.commit() )
+            {
+                if ( msg )
+                    *msg = QObject::tr( "Could not write '%1': %2" ).arg( fileName ).arg( file.errorString() );
+                return false;
+            }
+            return true;
+        }
+
+        bool CDirSnapshot::load( const QString &fileName, QString *msg )
+        {
+            clear();
+
+            QFile file( fileName );
+            if ( !file.open( QIODevice::ReadOnly ) )
+            {
+                if ( msg )
+                    *msg = QObject::tr( "Could not open '%1': %2" ).arg( fileName ).arg( file.errorString() );
+                return false;
+            }
+
+            QDataStream ds( &file );
+            ds.setVersion( QDataStream::Qt_6_0 );
+            quint32 magic = 0;
+            quint32 version = 0;
+            quint32 dirSize = 0;
+            quint32 entrySize = 0;
+            quint64 poolSize = 0;
+            quint64 numDirs = 0;
+            quint64 numEntries = 0;
+            ds >> magic >> version >> dirSize >> entrySize >> fImpl->fRootPath >> poolSize >> numDirs >> numEntries;
+            if ( ( ds.status() != QDataStream::Ok ) || ( magic != kMagic ) || ( version != kVersion ) || ( dirSize != sizeof( SDir ) ) || ( entrySize != sizeof( SEntry ) ) || ( numDirs == 0 ) || ( poolSize >= kNone ) || ( numDirs >= kNone ) || ( numEntries >= kNone ) )
+            {
+                fImpl->clear();
+                if ( msg )
+                    *msg = QObject::tr( "'%1' is not a directory snapshot" ).arg( fileName );
+                return false;
+            }
+
+            auto &&impl = *fImpl;
+            impl.fNamePool.resize( poolSize );
+            impl.fDirs.resize( numDirs );
+            impl.fEntries.resize( numEntries );
+            auto aOK = ( ds.readRawData( impl.fNamePool.data(), static_cast< int >( poolSize ) ) == static_cast< int >( poolSize ) );
+            aOK = aOK && ( ds.readRawData( reinterpret_cast< char * >( impl.fDirs.data() ), static_cast< int >( numDirs * sizeof( SDir ) ) ) == static_cast< int >( numDirs * sizeof( SDir ) ) );
+            aOK = aOK && ( ds.readRawData( reinterpret_cast< char * >( impl.fEntries.data() ), static_cast< int >( numEntries * sizeof( SEntry ) ) ) == static_cast< int >( numEntries * sizeof( SEntry ) ) );
+            aOK = aOK && ( poolSize == 0 || ( impl.fNamePool.back() == 0 ) );
+            for ( std::size_t ii = 0; aOK && ( ii < impl.fDirs.size() ); ++ii )
+                aOK = ( static_cast< quint64 >( impl.fDirs[ ii ].fFirstEntry ) + impl.fDirs[ ii ].fNumEntries ) <= numEntries;
+            for ( std::size_t ii = 0; aOK && ( ii < impl.fEntries.size() ); ++ii )
+                aOK = ( impl.fEntries[ ii ].fName < poolSize ) && ( ( impl.fEntries[ ii ].fDir == kNone ) || ( impl.fEntries[ ii ].fDir < numDirs ) );
+            if ( !aOK )
+            {
+                impl.clear();
+                if ( msg )
+                    *msg = QObject::tr( "'%1' is truncated or corrupt" ).arg( fileName );
+                return false;
+            }
+
+            impl.rebuildNameIndex();
+            return true;
+        }
+
+        void CDirSnapshot::clear()
+        {
+            fImpl->clear();
+        }
+
+        QString CDirSnapshot::rootPath() const
+        {
+            return fImpl->fRootPath;
+        }
+
+        QStringList CDirSnapshot::files() const
+        {
+            QStringList retVal;
+            if ( fImpl->fDirs.empty() )
+                return retVal;
+
+            retVal.reserve( static_cast< qsizetype >( numFiles() ) );
+            std::vector< std::pair< quint32, QString > > stack = { { 0, fImpl->fRootPath } };
+            while ( !stack.empty() )
+            {
+                auto curr = std::move( stack.back() );
+                stack.pop_back();
+
+                auto &&dir = fImpl->fDirs[ curr.first ];
+                for ( auto ii = dir.fNumEntries; ii > 0; --ii )
+                {
+                    auto &&entry = fImpl->fEntries[ dir.fFirstEntry + ii - 1 ];
+                    if ( entry.fDir != kNone )
+                        stack.emplace_back( entry.fDir, fImpl->childPath( curr.second, entry.fName ) );
+                }
+                for ( quint32 ii = 0; ii < dir.fNumEntries; ++ii )
+                {
+                    auto &&entry = fImpl->fEntries[ dir.fFirstEntry + ii ];
+                    if ( entry.fDir == kNone )
+                        retVal << fImpl->childPath( curr.second, entry.fName );
+                }
+            }
+            return retVal;
+        }
+
+        std::size_t CDirSnapshot::numFiles() const
+        {
+            return fImpl->fEntries.size() - fImpl->fDeadEntries - ( numDirs() ? ( numDirs() - 1 ) : 0 );
+        }
+
+        std::size_t CDirSnapshot::numDirs() const
+        {
+            return fImpl->fDirs.size() - fImpl->fDeadDirs;
+        }
+
+        std::size_t CDirSnapshot::memoryUsage() const
+        {
+            // the node based set costs roughly a pointer pair and the hash per name on top of the offset
+            return fImpl->fNamePool.capacity() + fImpl->fDirs.capacity() * sizeof( SDir ) + fImpl->fEntries.capacity() * sizeof( SEntry ) + fImpl->fNameIndex.size() * ( sizeof( quint32 ) + 3 * sizeof( void * ) ) + fImpl->fNameIndex.bucket_count() * sizeof( void * );
+        }
+    }
+}
@@ -0,0 +1,89 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __DIRSNAPSHOT_H
+#define __DIRSNAPSHOT_H
+
+#include "SABUtilsExport.h"
+
+#include <QString>
+#include <QStringList>
+#include <memory>
+#include <optional>
+
+namespace NSABUtils
+{
+    namespace NFileUtils
+    {
+        struct SABUTILS_EXPORT SDirSnapshotDiff
+        {
+            QStringList fAdded;
+            QStringList fRemoved;
+            QStringList fModified;   // size or modification time changed
+
+            int fDirsRead{ 0 };   // directories whose listing was read
+            int fDirsSkipped{ 0 };   // unchanged directories, only stat'ed
+
+            bool isEmpty() const { return fAdded.isEmpty() && fRemoved.isEmpty() && fModified.isEmpty(); }
+        };
+
+        // a persistent index of a directory tree, so a periodic rescan reads only the directories that changed
+        //
+        // each directory stores its modification time and its entries (name, size, modification time)
+        // rescan stats every known directory, but lists only those whose time changed, new directories are read in full
+        // a file modified in place does not touch its directory, so those are found in unchanged directories only with setStatFiles
+        //
+        // the names are interned in a single pool and the directories and entries are flat arrays, about 24 bytes per file plus its unique names
+        // the walk follows the findAllFiles rules, hidden entries are skipped and links to directories are not followed
+        class CDirSnapshotImpl;
+        class SABUTILS_EXPORT CDirSnapshot
+        {
+        public:
+            CDirSnapshot();
+            ~CDirSnapshot();
+
+            CDirSnapshot( const CDirSnapshot & ) = delete;
+            CDirSnapshot &operator=( const CDirSnapshot & ) = delete;
+
+            bool scan( const QString &rootDir, QString *msg = nullptr );   // a full scan, replacing the current snapshot
+            std::optional< SDirSnapshotDiff > rescan( QString *msg = nullptr );   // std::nullopt when there is no snapshot or the root is gone
+
+            void setStatFiles( bool value );   // default false, when true the files of unchanged directories are stat'ed for modifications
+            bool statFiles() const;
+
+            bool save( const QString &fileName, QString *msg = nullptr ) const;
+            bool load( const QString &fileName, QString *msg = nullptr );
+            void clear();
+
+            QString rootPath() const;
+            QStringList files() const;   // absolute paths, in walk order
+            std::size_t numFiles() const;
+            std::size_t numDirs() const;
+            std::size_t memoryUsage() const;   // bytes held by the pool and arrays
+
+        private:
+            std::unique_ptr< CDirSnapshotImpl > fImpl;
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,459 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "DuplicateFinder.h"
+#include "DigestCache.h"
+#include "FileStat.h"
+#include "FileUtils.h"
+#include "MD5.h"
+
+#include <QDir>
+#include <QFile>
+#include <QThread>
+#include <QThreadPool>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QSet>
+
+#include <atomic>
+#include <map>
+#include <algorithm>
+
+namespace NSABUtils
+{
+    class CDuplicateFinderImpl
+    {
+    public:
+        CDuplicateFinderImpl( CDuplicateFinder *parent ) :
+            fParent( parent )
+        {
+            fPool.setMaxThreadCount( QThread::idealThreadCount() );
+        }
+
+        ~CDuplicateFinderImpl()
+        {
+            fCanceled = true;
+            fPool.waitForDone();
+        }
+
+        bool start( const QList< QFileInfo > &files );
+        void processBucket( qint64 size, const QStringList &files, qint64 sampleSize, EHashAlgorithm algorithm );
+        QByteArray sampleDigest( const QString &fileName, qint64 size, qint64 sampleSize );
+        QByteArray fullDigest( const QString &fileName, qint64 size, EHashAlgorithm algorithm );
+        void addGroups( qint64 size, const std::map< QByteArray, QStringList > &byDigest );
+        void addBytesRead( qint64 numBytes );
+        void bucketFinished();
+        void emitProgress( bool force );
+
+        CDuplicateFinder *fParent{ nullptr };
+        QThreadPool fPool;
+        qint64 fSampleSize{ 64 * 1024 };
+        qint64 fMinFileSize{ 1 };
+        int fProgressInterval{ 100 };
+        EHashAlgorithm fAlgorithm{ EHashAlgorithm::eMD5 };
+        std::function< void( const SDuplicateGroup &group ) > fGroupFunc;
+
+        mutable QMutex fMutex;
+        TDuplicateGroups fGroups;
+        SDuplicateFinderStats fStats;
+        QHash< QString, QStringList > fHardLinks;   // the path hashed for a file to its other paths, set before the buckets start
+        int fActiveBuckets{ 0 };
+        QElapsedTimer fProgressTimer;
+        bool fRunning{ false };
+        std::atomic< bool > fCanceled{ false };
+    };
+
+    bool CDuplicateFinderImpl::start( const QList< QFileInfo > &files )
+    {
+        QMutexLocker locker( &fMutex );
+        if ( fRunning )
+            return false;
+
+        fCanceled = false;
+        fGroups.clear();
+        fHardLinks.clear();
+        fStats = SDuplicateFinderStats();
+
+        // stage 1, size buckets, keyed on the absolute path so the same file listed twice is not its own duplicate
+        std::map< qint64, QStringList > bySize;
+        QSet< QString > seen;
+        for ( auto &&ii : files )
+        {
+            if ( !ii.isFile() || ( ii.size() < fMinFileSize ) )
+                continue;
+            auto path = ii.absoluteFilePath();
+            if ( seen.contains( path ) )
+                continue;
+            seen.insert( path );
+            fStats.fNumFiles++;
+            fStats.fTotalBytes += ii.size();
+            bySize[ ii.size() ] << path;
+        }
+
+        // only the files sharing a size are stat'ed for their device and inode, the first path to each file stands for all of them
+        QStringList sizeCandidates;
+        for ( auto &&ii : bySize )
+        {
+            if ( ii.second.count() > 1 )
+                sizeCandidates << ii.second;
+        }
+        auto fileStats = NFileUtils::fileStats( sizeCandidates );
+        std::map< std::pair< uint64_t, uint64_t >, QString > byInode;
+        int statPos = 0;
+
+        std::vector< std::pair< qint64, QStringList > > buckets;
+        for ( auto &&ii : bySize )
+        {
+            if ( ii.second.count() < 2 )
+                continue;
+
+            QStringList distinct;
+            for ( auto &&jj : ii.second )
+            {
+                auto &&stat = fileStats[ statPos++ ];
+                if ( stat.fInode == 0 )
+                {
+                    distinct << jj;
+                    continue;
+                }
+
+                auto pos = byInode.emplace( std::make_pair( stat.fDevice, stat.fInode ), jj );
+                if ( pos.second )
+                    distinct << jj;
+                else
+                {
+                    fHardLinks[ ( *pos.first ).second ] << jj;
+                    fStats.fNumHardLinks++;
+                }
+            }
+
+            if ( distinct.count() < 2 )
+                continue;
+            fStats.fNumSizeCandidates += distinct.count();
+            buckets.emplace_back( ii.first, distinct );
+        }
+
+        if ( buckets.empty() )
+        {
+            auto stats = fStats;
+            locker.unlock();
+            emit fParent->sigProgress( stats );
+            emit fParent->sigFinished( {}, stats, false );
+            return true;
+        }
+
+        // largest sizes first, they take the longest and hold the most reclaimable space
+        fRunning = true;
+        fProgressTimer.start();
+        fActiveBuckets = static_cast< int >( buckets.size() );
+        auto sampleSize = fSampleSize;
+        auto algorithm = fAlgorithm;
+        for ( auto ii = buckets.rbegin(); ii != buckets.rend(); ++ii )
+        {
+            auto size = ( *ii ).first;
+            auto bucketFiles = ( *ii ).second;
+            fPool.start( [ this, size, bucketFiles, sampleSize, algorithm ]() { processBucket( size, bucketFiles, sampleSize, algorithm ); } );
+        }
+        return true;
+    }
+
+    void CDuplicateFinderImpl::processBucket( qint64 size, const QStringList &files, qint64 sampleSize, EHashAlgorithm algorithm )
+    {
+        // stage 2, head and tail samples, when the samples cover the whole file they are the full hash
+        bool sampleIsFull = size <= ( 2 * sampleSize );
+        std::map< QByteArray, QStringList > bySample;
+        for ( auto &&ii : files )
+        {
+            if ( fCanceled )
+                break;
+            auto digest = sampleIsFull ? fullDigest( ii, size, algorithm ) : sampleDigest( ii, size, sampleSize );
+            if ( !digest.isEmpty() )
+                bySample[ digest ] << ii;
+        }
+
+        if ( sampleIsFull )
+            addGroups( size, bySample );
+        else
+        {
+            // stage 3, full hash of the files whose samples collide
+            std::map< QByteArray, QStringList > byDigest;
+            for ( auto &&ii : bySample )
+            {
+                if ( ii.second.count() < 2 )
+                    continue;
+
+                {
+                    QMutexLocker locker( &fMutex );
+                    fStats.fNumSampleCandidates += ii.second.count();
+                }
+
+                for ( auto &&jj : ii.second )
+                {
+                    if ( fCanceled )
+                        break;
+                    auto digest = fullDigest( jj, size, algorithm );
+                    if ( !digest.isEmpty() )
+                        byDigest[ digest ] << jj;
+                }
+            }
+            addGroups( size, byDigest );
+        }
+        bucketFinished();
+    }
+
+    QByteArray CDuplicateFinderImpl::sampleDigest( const QString &fileName, qint64 size, qint64 sampleSize )
+    {
+        QFile file( fileName );
+        if ( !file.open( QIODevice::ReadOnly ) )
+            return {};
+
+        // the sample only has to separate files, not identify them, so the fast hash is always used
+        CContentHash hash( EHashAlgorithm::eXXHash64 );
+        auto head = file.read( sampleSize );
+        if ( !file.seek( size - sampleSize ) )
+            return {};
+        auto tail = file.read( sampleSize );
+        if ( ( head.size() != sampleSize ) || ( tail.size() != sampleSize ) )
+            return {};   // the file changed since it was listed
+
+        hash.addData( head );
+        hash.addData( tail );
+        addBytesRead( head.size() + tail.size() );
+        return hash.result();
+    }
+
+    QByteArray CDuplicateFinderImpl::fullDigest( const QString &fileName, qint64 size, EHashAlgorithm algorithm )
+    {
+        // a digest from the cache reads nothing, so it is counted apart from the bytes read
+        QFileInfo fi( fileName );
+        auto retVal = CDigestCache::instance()->find( fi, algorithm );
+        if ( !retVal.isEmpty() )
+        {
+            QMutexLocker locker( &fMutex );
+            fStats.fCacheHits++;
+            fStats.fBytesFromCache += size;
+            return retVal;
+        }
+
+        qint64 lastPos = 0;
+        return getMd5(
+            fi,
+            [ this, &lastPos ]( qint64 pos )
+            {
+                addBytesRead( pos - lastPos );
+                lastPos = pos;
+                return !fCanceled;
+            },
+            algorithm );
+    }
+
+    void CDuplicateFinderImpl::addGroups( qint64 size, const std::map< QByteArray, QStringList > &byDigest )
+    {
+        if ( fCanceled )
+            return;
+
+        for ( auto &&ii : byDigest )
+        {
+            if ( ii.second.count() < 2 )
+                continue;
+
+            SDuplicateGroup group;
+            group.fSize = size;
+            group.fMD5 = ii.first;
+            group.fFiles = ii.second;
+            group.fFiles.sort();
+
+            QMutexLocker locker( &fMutex );
+            for ( auto &&jj : group.fFiles )
+                group.fHardLinks << fHardLinks.value( jj );
+            group.fHardLinks.sort();
+            fGroups << group;
+            fStats.fNumGroups++;
+            fStats.fNumDuplicates += group.fFiles.count() - 1;
+            fStats.fDuplicateBytes += size * ( group.fFiles.count() - 1 );
+            auto groupFunc = fGroupFunc;
+            locker.unlock();
+
+            if ( groupFunc )
+                groupFunc( group );
+            emit fParent->sigGroupFound( group );
+        }
+        emitProgress( false );
+    }
+
+    void CDuplicateFinderImpl::addBytesRead( qint64 numBytes )
+    {
+        QMutexLocker locker( &fMutex );
+        fStats.fBytesRead += numBytes;
+        locker.unlock();
+        emitProgress( false );
+    }
+
+    void CDuplicateFinderImpl::bucketFinished()
+    {
+        QMutexLocker locker( &fMutex );
+        if ( --fActiveBuckets > 0 )
+            return;
+
+        fRunning = false;
+        std::stable_sort( fGroups.begin(), fGroups.end(), []( const SDuplicateGroup &lhs, const SDuplicateGroup &rhs ) { return ( lhs.fSize != rhs.fSize ) ? ( lhs.fSize > rhs.fSize ) : ( lhs.fFiles < rhs.fFiles ); } );
+        auto groups = fGroups;
+        auto stats = fStats;
+        bool canceled = fCanceled;
+        locker.unlock();
+
+        emitProgress( true );
+        emit fParent->sigFinished( groups, stats, canceled );
+    }
+
+    void CDuplicateFinderImpl::emitProgress( bool force )
+    {
+        QMutexLocker locker( &fMutex );
+        if ( !force && ( fProgressTimer.elapsed() < fProgressInterval ) )
+            return;
+        fProgressTimer.restart();
+        auto stats = fStats;
+        locker.unlock();
+
+        emit fParent->sigProgress( stats );
+    }
+
+    CDuplicateFinder::CDuplicateFinder( QObject *parent ) :
+        QObject( parent ),
+        fImpl( std::make_unique< CDuplicateFinderImpl >( this ) )
+    {
+    }
+
+    CDuplicateFinder::~CDuplicateFinder()
+    {
+    }
+
+    void CDuplicateFinder::setSampleSize( qint64 value )
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        fImpl->fSampleSize = std::max< qint64 >( 1, value );
+    }
+
+    qint64 CDuplicateFinder::sampleSize() const
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        return fImpl->fSampleSize;
+    }
+
+    void CDuplicateFinder::setMinFileSize( qint64 value )
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        fImpl->fMinFileSize = std::max< qint64 >( 0, value );
+    }
+
+    qint64 CDuplicateFinder::minFileSize() const
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        return fImpl->fMinFileSize;
+    }
+
+    void CDuplicateFinder::setAlgorithm( EHashAlgorithm algorithm )
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        fImpl->fAlgorithm = algorithm;
+    }
+
+    EHashAlgorithm CDuplicateFinder::algorithm() const
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        return fImpl->fAlgorithm;
+    }
+
+    void CDuplicateFinder::setMaxThreads( int value )
+    {
+        fImpl->fPool.setMaxThreadCount( ( value > 0 ) ? value : QThread::idealThreadCount() );
+    }
+
+    int CDuplicateFinder::maxThreads() const
+    {
+        return fImpl->fPool.maxThreadCount();
+    }
+
+    void CDuplicateFinder::setProgressInterval( int msecs )
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        fImpl->fProgressInterval = std::max( 0, msecs );
+    }
+
+    int CDuplicateFinder::progressInterval() const
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        return fImpl->fProgressInterval;
+    }
+
+    void CDuplicateFinder::setGroupFunc( std::function< void( const SDuplicateGroup &group ) > func )
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        fImpl->fGroupFunc = func;
+    }
+
+    bool CDuplicateFinder::start( const QList< QFileInfo > &files )
+    {
+        return fImpl->start( files );
+    }
+
+    bool CDuplicateFinder::start( const QDir &dir, const QStringList &nameFilters, bool recursive, QString *errorMsg )
+    {
+        if ( isRunning() )
+            return false;
+
+        auto files = NFileUtils::findAllFiles( dir, nameFilters, recursive, false, errorMsg );
+        if ( !files.has_value() )
+            return false;
+        return start( files.value() );
+    }
+
+    bool CDuplicateFinder::isRunning() const
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        return fImpl->fRunning;
+    }
+
+    bool CDuplicateFinder::waitForDone( int msecs )
+    {
+        return fImpl->fPool.waitForDone( msecs );
+    }
+
+    TDuplicateGroups CDuplicateFinder::groups() const
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        return fImpl->fGroups;
+    }
+
+    SDuplicateFinderStats CDuplicateFinder::stats() const
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        return fImpl->fStats;
+    }
+
+    void CDuplicateFinder::slotCancel()
+    {
+        fImpl->fCanceled = true;
+    }
+}
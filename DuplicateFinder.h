@@ -0,0 +1,119 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __DUPLICATEFINDER_H
+#define __DUPLICATEFINDER_H
+
+#include "SABUtilsExport.h"
+#include "ContentHash.h"
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QFileInfo>
+#include <QList>
+#include <functional>
+#include <memory>
+
+class QDir;
+namespace NSABUtils
+{
+    struct SABUTILS_EXPORT SDuplicateGroup
+    {
+        qint64 fSize{ 0 };
+        QByteArray fMD5;   // formatted full digest, shared by every file in the group
+        QStringList fFiles;   // sorted, one path for each distinct file
+        QStringList fHardLinks;   // sorted, the other paths (hard or symbolic links) to a file in fFiles, removing them reclaims nothing
+    };
+    using TDuplicateGroups = QList< SDuplicateGroup >;
+
+    struct SABUTILS_EXPORT SDuplicateFinderStats
+    {
+        int fNumFiles{ 0 };
+        qint64 fTotalBytes{ 0 };   // size of every file considered
+        qint64 fBytesRead{ 0 };   // bytes actually read for samples and full hashes
+        int fCacheHits{ 0 };   // full hashes answered by CDigestCache without reading the file
+        qint64 fBytesFromCache{ 0 };   // size of the files whose full hash came from CDigestCache
+        int fNumHardLinks{ 0 };   // paths that are another name for a file already listed, never hashed
+
+        int fNumSizeCandidates{ 0 };   // files sharing their size with another file
+        int fNumSampleCandidates{ 0 };   // files sharing their size and sample digest with another file, these are fully hashed
+
+        int fNumGroups{ 0 };
+        int fNumDuplicates{ 0 };   // files in groups, not counting the first of each group
+        qint64 fDuplicateBytes{ 0 };   // bytes that could be reclaimed by keeping one file of each group
+    };
+
+    // finds files with identical content in stages, each stage only looks at files the previous stage could not separate
+    //   1) bucket by size, a file with a unique size has no duplicate, hard links to the same file (device and inode) are hashed once
+    //   2) within a size bucket hash a sample from the head and tail of each file
+    //   3) fully hash the files whose samples match (via getMd5, so CDigestCache is used when open)
+    // size buckets are processed in parallel, and each group is reported as soon as it is confirmed
+    class CDuplicateFinderImpl;
+    class SABUTILS_EXPORT CDuplicateFinder : public QObject
+    {
+        Q_OBJECT;
+
+    public:
+        CDuplicateFinder( QObject *parent = nullptr );
+        virtual ~CDuplicateFinder() override;
+
+        void setSampleSize( qint64 value );   // bytes read from both the head and the tail, default 64KB, files no larger than twice this are fully hashed in stage 2
+        qint64 sampleSize() const;
+
+        void setMinFileSize( qint64 value );   // default 1, empty files are ignored
+        qint64 minFileSize() const;
+
+        void setAlgorithm( EHashAlgorithm algorithm );   // full hash, default MD5
+        EHashAlgorithm algorithm() const;
+
+        void setMaxThreads( int value );   // default QThread::idealThreadCount()
+        int maxThreads() const;
+
+        void setProgressInterval( int msecs );   // default 100ms
+        int progressInterval() const;
+
+        void setGroupFunc( std::function< void( const SDuplicateGroup &group ) > func );   // called from the worker thread as each group is confirmed
+
+        bool start( const QList< QFileInfo > &files );   // returns false if a search is already running
+        bool start( const QDir &dir, const QStringList &nameFilters, bool recursive, QString *errorMsg = nullptr );   // uses findAllFiles to gather the files
+        bool isRunning() const;
+        bool waitForDone( int msecs = -1 );
+
+        TDuplicateGroups groups() const;   // largest files first once finished
+        SDuplicateFinderStats stats() const;
+
+    public Q_SLOTS:
+        void slotCancel();
+
+    Q_SIGNALS:
+        void sigGroupFound( const NSABUtils::SDuplicateGroup &group );
+        void sigProgress( const NSABUtils::SDuplicateFinderStats &stats );
+        void sigFinished( const NSABUtils::TDuplicateGroups &groups, const NSABUtils::SDuplicateFinderStats &stats, bool canceled );
+
+    private:
+        std::unique_ptr< CDuplicateFinderImpl > fImpl;
+    };
+}
+
+#endif
@@ -21,6 +21,10 @@
 // SOFTWARE.
 
 #include "FileBasedCache.h"
+
+#include <QFile>
+#include <QObject>
+#include <QSaveFile>
 //#include "MKVUtils.h"
 //
 //#include "utils.h"
@@ -33,8 +37,16 @@
 
 namespace NSABUtils
 {
+    namespace
+    {
+        constexpr quint32 kMagic = 0x53414243;   // SABC
+        constexpr quint32 kVersion = 1;
+        constexpr QDataStream::Version kStreamVersion = QDataStream::Qt_6_0;
+    }
+
     SFileBasedCacheNode::SFileBasedCacheNode( const QFileInfo &fileInfo ) :
-        fFileInfo( fileInfo ),
+        fPath( fileInfo.absoluteFilePath() ),
+        fHash( hashPath( fPath ) ),
         fDateTime( fileInfo.fileTime( QFileDevice::FileModificationTime ) ),
         fSize( fileInfo.size() )
     {
@@ -45,9 +57,31 @@ namespace NSABUtils
     {
     }
 
+    SFileBasedCacheNode::SFileBasedCacheNode( const QString &path, uint64_t size, const QDateTime &modificationTime ) :
+        fPath( QFileInfo( path ).absoluteFilePath() ),
+        fHash( hashPath( fPath ) ),
+        fDateTime( modificationTime ),
+        fSize( size )
+    {
+    }
+
+    SFileBasedCacheNode::SFileBasedCacheNode( const QString &path, const NFileUtils::SFileStat &stat ) :
+        fPath( QFileInfo( path ).absoluteFilePath() ),
+        fHash( hashPath( fPath ) ),
+        fDateTime( stat.fileTime( QFileDevice::FileModificationTime ) ),
+        fSize( stat.fSize )
+    {
+    }
+
     bool SFileBasedCacheNode::operator==( const SFileBasedCacheNode &rhs ) const
     {
-        bool aOK = fFileInfo == rhs.fFileInfo;
+        if ( fHash != rhs.fHash )
+            return false;
+#ifdef Q_OS_WIN
+        bool aOK = fPath.compare( rhs.fPath, Qt::CaseInsensitive ) == 0;
+#else
+        bool aOK = fPath == rhs.fPath;
+#endif
         if ( pathOnlySearch() || rhs.pathOnlySearch() )
             return aOK;
 
@@ -59,6 +93,163 @@ namespace NSABUtils
 
     std::size_t SFileBasedCacheNode::hash() const
     {
-        return std::hash< QString >()( fFileInfo.absoluteFilePath() );
+        return fHash;
+    }
+
+    std::size_t SFileBasedCacheNode::hashPath( const QString &path )
+    {
+#ifdef Q_OS_WIN
+        return std::hash< QString >()( path.toLower() );
+#else
+        return std::hash< QString >()( path );
+#endif
+    }
+
+    SFileBasedCacheStats &SFileBasedCacheStats::operator+=( const SFileBasedCacheStats &rhs )
+    {
+        fHits += rhs.fHits;
+        fMisses += rhs.fMisses;
+        fEvictions += rhs.fEvictions;
+        fInvalidations += rhs.fInvalidations;
+        fNumEntries += rhs.fNumEntries;
+        fNumBytes += rhs.fNumBytes;
+        fNumPinned += rhs.fNumPinned;
+        return *this;
+    }
+
+    CFileBasedCacheBase::CFileBasedCacheBase()
+    {
+    }
+
+    CFileBasedCacheBase::~CFileBasedCacheBase()
+    {
+        if ( auto watcher = fWatcher.load() )
+            watcher->unregisterCache( this );
+    }
+
+    void CFileBasedCacheBase::setValidation( EFileBasedCacheValidation validation, int timeToLiveMS )
+    {
+        fTimeToLiveMS = timeToLiveMS;
+        fValidation = validation;
+    }
+
+    CFileBasedCacheBase::SLookup CFileBasedCacheBase::lookupFor( const QString &path ) const
+    {
+        SLookup retVal;
+        auto validation = fValidation.load();
+        if ( validation == EFileBasedCacheValidation::eExternal )
+        {
+            retVal.fPathOnly = true;
+            return retVal;
+        }
+
+        // a watched path is trusted whatever the validation
+        auto watched = skipStat( path );
+        retVal.fPathOnly = watched || ( validation == EFileBasedCacheValidation::eTimeToLive );
+        if ( !watched && ( validation == EFileBasedCacheValidation::eTimeToLive ) )
+            retVal.fTimeToLiveMS = fTimeToLiveMS;
+        return retVal;
+    }
+
+    void CFileBasedCacheBase::setWatcher( CFileBasedCacheWatcher *watcher )
+    {
+        fWatcher = watcher;
+    }
+
+    bool CFileBasedCacheBase::writeCacheFile( const QString &fileName, quint32 typeVersion, quint64 numEntries, const std::function< void( QDataStream &ds ) > &writeEntries, QString *msg )
+    {
+        QSaveFile file( fileName );
+        if ( !file.open( QIODevice::WriteOnly ) )
+        {
+            if ( msg )
+                *msg = QObject::tr( "Could not open '%1': %2" ).arg( fileName ).arg( file.errorString() );
+            return false;
+        }
+
+        QDataStream ds( &file );
+        ds.setVersion( kStreamVersion );
+        ds << kMagic << kVersion << typeVersion << numEntries;
+        writeEntries( ds );
+        if ( ( ds.status() != QDataStream::Ok ) || !file.commit() )
+        {
+            if ( msg )
+                *msg = QObject::tr( "Could not write '%1': %2" ).arg( fileName ).arg( file.errorString() );
+            return false;
+        }
+        return true;
+    }
+
+    bool CFileBasedCacheBase::readCacheFile( const QString &fileName, quint32 typeVersion, const std::function< bool( QDataStream &ds, quint64 numEntries ) > &readEntries, QString *msg )
+    {
+        QFile file( fileName );
+        if ( !file.open( QIODevice::ReadOnly ) )
+        {
+            if ( msg )
+                *msg = QObject::tr( "Could not open '%1': %2" ).arg( fileName ).arg( file.errorString() );
+            return false;
+        }
+
+        QDataStream ds( &file );
+        ds.setVersion( kStreamVersion );
+        quint32 magic = 0;
+        quint32 version = 0;
+        quint32 savedTypeVersion = 0;
+        quint64 numEntries = 0;
+        ds >> magic >> version >> savedTypeVersion >> numEntries;
+        if ( ( ds.status() != QDataStream::Ok ) || ( magic != kMagic ) || ( version != kVersion ) || ( savedTypeVersion != typeVersion ) )
+        {
+            if ( msg )
+                *msg = QObject::tr( "'%1' is not a cache file of this version" ).arg( fileName );
+            return false;
+        }
+
+        if ( !readEntries( ds, numEntries ) )
+        {
+            if ( msg )
+                *msg = QObject::tr( "'%1' is truncated or corrupt" ).arg( fileName );
+            return false;
+        }
+        return true;
+    }
+
+    bool CFileBasedCacheBase::skipStat( const QString &path ) const
+    {
+        auto watcher = fWatcher.load();
+        return watcher && watcher->isWatched( path );
+    }
+
+    void CFileBasedCacheBase::queueInvalidate( const QStringList &files, const QStringList &dirs )
+    {
+        std::lock_guard< std::mutex > lock( fPendingMutex );
+        fPendingFiles << files;
+        fPendingDirs << dirs;
+        fHasPending = true;
+    }
+
+    void CFileBasedCacheBase::queueInvalidateAll()
+    {
+        std::lock_guard< std::mutex > lock( fPendingMutex );
+        fPendingFiles.clear();
+        fPendingDirs.clear();
+        fPendingAll = true;
+        fHasPending = true;
+    }
+
+    void CFileBasedCacheBase::applyPendingInvalidations() const
+    {
+        if ( !fHasPending )
+            return;
+
+        QStringList files;
+        QStringList dirs;
+        bool all = false;
+        {
+            std::lock_guard< std::mutex > lock( fPendingMutex );
+            files.swap( fPendingFiles );
+            dirs.swap( fPendingDirs );
+            std::swap( all, fPendingAll );
+            fHasPending = false;
+        }
+        applyInvalidations( files, dirs, all );
     }
-}
\ No newline at end of file
+}
@@ -23,12 +23,27 @@
 #define __FILEBASEDCACHE_H
 
 #include "SABUtilsExport.h"
+#include "FileStat.h"
 
+#include <QDataStream>
 #include <QDateTime>
 #include <QFileInfo>
+#include <QStringList>
 #include <unordered_map>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <limits>
+#include <list>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
 
 namespace NSABUtils
 {
@@ -36,6 +51,8 @@ namespace NSABUtils
     {
         explicit SFileBasedCacheNode( const QString &path );
         explicit SFileBasedCacheNode( const QFileInfo &fileInfo );
+        SFileBasedCacheNode( const QString &path, uint64_t size, const QDateTime &modificationTime );   // a node as it was recorded, used when reloading a persisted cache
+        SFileBasedCacheNode( const QString &path, const NFileUtils::SFileStat &stat );   // a prefetched stat, no further system calls
 
         bool operator==( const SFileBasedCacheNode &rhs ) const;
 
@@ -44,8 +61,15 @@ namespace NSABUtils
         void setPathOnlySearch( bool value ) { fPathOnlySearch = value; }
         bool pathOnlySearch() const { return fPathOnlySearch; }
 
+        QString filePath() const { return fPath; }
+        uint64_t size() const { return fSize; }
+        QDateTime modificationTime() const { return fDateTime; }
+
     private:
-        QFileInfo fFileInfo;
+        static std::size_t hashPath( const QString &path );
+
+        QString fPath;   // absolute
+        std::size_t fHash{ 0 };   // of the path, computed once
         QDateTime fDateTime;
         uint64_t fSize{ 0 };
         bool fPathOnlySearch{ false };
@@ -77,54 +101,830 @@ namespace NSABUtils
     template< typename T >
     constexpr bool has_fileNamePtr< T, std::void_t< decltype( std::declval< T >()->fileName() ) > > = true;
 
+    class CFileBasedCacheBase;
+
+    // save and load write T with SFileBasedCacheSerializer< T >, by default the QDataStream operators of T
+    // specialize it for a T without them, kVersion is saved with the cache so changing the layout of T discards older files
+    template< typename T, typename = void >
+    struct SFileBasedCacheSerializer
+    {
+        static constexpr quint32 kVersion{ 1 };
+        static void write( QDataStream &ds, const T &object ) { ds << object; }
+        static void read( QDataStream &ds, T &object ) { ds >> object; }
+    };
+
+    enum class EFileBasedCacheValidation
+    {
+        eAlwaysStat,   // every lookup stats the file, a changed size or timestamp is a miss (the default)
+        eTimeToLive,   // a lookup matches on the path, the file is stat'ed again once the entry was last validated longer than the time to live ago
+        eExternal   // a lookup matches on the path and never stats, changes come from remove, queueInvalidate or a CFileWatcher
+    };
+
+    // what a cache needs from its watcher, implemented by CFileWatcher
+    class SABUTILS_EXPORT CFileBasedCacheWatcher
+    {
+    public:
+        virtual ~CFileBasedCacheWatcher() {}
+
+        virtual bool isWatched( const QString &path ) const = 0;   // the watch is healthy and covers the path
+        virtual void unregisterCache( CFileBasedCacheBase *cache ) = 0;
+    };
+
+    // the part of a cache a CFileWatcher talks to
+    // invalidations arrive on the watchers thread, they are queued and applied by the next call into the cache on the caches own thread
+    // while the watcher reports a path as watched, lookups match on the path alone and skip the stat
+    class SABUTILS_EXPORT CFileBasedCacheBase
+    {
+    public:
+        CFileBasedCacheBase();
+        virtual ~CFileBasedCacheBase();   // unregisters from the watcher
+
+        CFileBasedCacheBase( const CFileBasedCacheBase & ) = delete;
+        CFileBasedCacheBase &operator=( const CFileBasedCacheBase & ) = delete;
+
+        void queueInvalidate( const QStringList &files, const QStringList &dirs );   // a directory drops everything below it
+        void queueInvalidateAll();
+
+        void setWatcher( CFileBasedCacheWatcher *watcher );   // called by CFileWatcher::registerCache and unregisterCache
+        CFileBasedCacheWatcher *watcher() const { return fWatcher; }
+
+        // a lookup of a watched path never stats, whatever the validation
+        void setValidation( EFileBasedCacheValidation validation, int timeToLiveMS = 0 );
+        EFileBasedCacheValidation validation() const { return fValidation; }
+        int timeToLiveMS() const { return fTimeToLiveMS; }
+
+    protected:
+        // the header shared by every saved cache, the entries follow it
+        static bool writeCacheFile( const QString &fileName, quint32 typeVersion, quint64 numEntries, const std::function< void( QDataStream &ds ) > &writeEntries, QString *msg );
+        // readEntries returns false on a torn or corrupt entry
+        static bool readCacheFile( const QString &fileName, quint32 typeVersion, const std::function< bool( QDataStream &ds, quint64 numEntries ) > &readEntries, QString *msg );
+
+        // how a lookup of a path validates its entry
+        struct SLookup
+        {
+            bool fPathOnly{ false };   // the lookup hashes and compares the path only
+            int fTimeToLiveMS{ -1 };   // -1 when the entry is not revalidated on lookup
+        };
+
+        bool skipStat( const QString &path ) const;   // the watcher is healthy and watching the path
+        SLookup lookupFor( const QString &path ) const;   // asks the watcher once
+        void applyPendingInvalidations() const;
+
+        // only drops entries known to be stale, so it is safe to call from a const lookup
+        virtual void applyInvalidations( const QStringList &files, const QStringList &dirs, bool all ) const = 0;
+
+    private:
+        std::atomic< CFileBasedCacheWatcher * > fWatcher{ nullptr };
+        std::atomic< EFileBasedCacheValidation > fValidation{ EFileBasedCacheValidation::eAlwaysStat };
+        std::atomic< int > fTimeToLiveMS{ 0 };
+        mutable std::mutex fPendingMutex;
+        mutable QStringList fPendingFiles;
+        mutable QStringList fPendingDirs;
+        mutable bool fPendingAll{ false };
+        mutable std::atomic< bool > fHasPending{ false };
+    };
+
+    struct SABUTILS_EXPORT SFileBasedCacheStats
+    {
+        SFileBasedCacheStats &operator+=( const SFileBasedCacheStats &rhs );
+
+        uint64_t fHits{ 0 };   // find and findOrCreate only
+        uint64_t fMisses{ 0 };
+        uint64_t fEvictions{ 0 };   // dropped to stay within the limits
+        uint64_t fInvalidations{ 0 };   // dropped by a queued invalidation
+        std::size_t fNumEntries{ 0 };
+        std::size_t fNumBytes{ 0 };   // as reported by the size of function
+        std::size_t fNumPinned{ 0 };   // pinned paths
+    };
+
+    // the entries of a CFileBasedCache, or of one shard of a CConcurrentFileBasedCache, the owner does any locking
+    // with a limit set the entries are evicted with CLOCK, a hit only sets the referenced bit of the entry so a lookup is safe under a shared lock
+    // the hand clears and skips referenced entries and skips pinned paths, so an eviction is O(1) amortized
+    template< typename T >
+    class CFileBasedCacheEntries
+    {
+    public:
+        using TSizeOfFunc = std::function< std::size_t( const T &object ) >;
+
+        CFileBasedCacheEntries() {}
+        CFileBasedCacheEntries( const CFileBasedCacheEntries & ) = delete;
+        CFileBasedCacheEntries &operator=( const CFileBasedCacheEntries & ) = delete;
+
+        static SFileBasedCacheNode pathOnlyNode( const QString &path )
+        {
+            auto retVal = NSABUtils::SFileBasedCacheNode( path, 0, QDateTime() );
+            retVal.setPathOnlySearch( true );
+            return retVal;
+        }
+
+        // counts the hit or miss, the pointer is valid until the entry is removed
+        // with a time to live (>= 0) an entry validated longer ago is compared against a new stat of the file, a changed file is a miss
+        const T *find( const SFileBasedCacheNode &node, int timeToLiveMS = -1 ) const
+        {
+            auto pos = fEntries.find( node );
+            if ( ( pos == fEntries.end() ) || !validate( *pos, node.pathOnlySearch(), timeToLiveMS ) )
+            {
+                fMisses.fetch_add( 1, std::memory_order_relaxed );
+                return nullptr;
+            }
+            fHits.fetch_add( 1, std::memory_order_relaxed );
+            ( *pos ).second.fReferenced.store( true, std::memory_order_relaxed );
+            return &( *pos ).second.fObject;
+        }
+
+        std::optional< std::pair< SFileBasedCacheNode, T > > findByPath( const QString &path ) const
+        {
+            auto pos = fEntries.find( pathOnlyNode( path ) );
+            if ( pos == fEntries.end() )
+                return {};
+            return std::make_pair( ( *pos ).first, ( *pos ).second.fObject );
+        }
+
+        bool contains( const SFileBasedCacheNode &node, int timeToLiveMS = -1 ) const
+        {
+            auto pos = fEntries.find( node );
+            return ( pos != fEntries.end() ) && validate( *pos, node.pathOnlySearch(), timeToLiveMS );
+        }
+
+        // replaces any entry for the path, an entry that is not validated is checked against its file on its first lookup
+        void add( const SFileBasedCacheNode &node, const T &object, bool validated = true )
+        {
+            erase( pathOnlyNode( node.filePath() ) );
+            auto pos = fEntries.try_emplace( node ).first;
+            auto &&entry = ( *pos ).second;
+            entry.fObject = object;
+            entry.fBytes = sizeOf( object );
+            entry.fValidatedAt = validated ? nowMS() : kNotValidated;
+            entry.fRingPos = fRing.insert( fHand, &( *pos ).first );   // just behind the hand, the last to be checked
+            fNumBytes += entry.fBytes;
+            evict( &( *pos ).first );
+        }
+
+        bool erase( const SFileBasedCacheNode &node )
+        {
+            auto pos = fEntries.find( node );
+            if ( pos == fEntries.end() )
+                return false;
+            removeEntry( pos );
+            return true;
+        }
+
+        void invalidate( const QString &path )
+        {
+            if ( erase( pathOnlyNode( path ) ) )
+                ++fInvalidations;
+        }
+
+        void invalidateBelow( const QStringList &dirs )   // a directory drops everything below it
+        {
+            for ( auto ii = fEntries.begin(); ii != fEntries.end(); )
+            {
+                auto path = ( *ii ).first.filePath();
+                auto below = std::any_of( dirs.begin(), dirs.end(), [ &path ]( const QString &dir ) { return ( path == dir ) || ( path.startsWith( dir ) && ( path.length() > dir.length() ) && ( path[ dir.length() ] == '/' ) ); } );
+                if ( !below )
+                {
+                    ++ii;
+                    continue;
+                }
+                ++fInvalidations;
+                ii = removeEntry( ii );
+            }
+        }
+
+        void invalidateAll()
+        {
+            fInvalidations += fEntries.size();
+            clear();
+        }
+
+        void clear()
+        {
+            fEntries.clear();
+            fRing.clear();
+            fHand = fRing.end();
+            fNumBytes = 0;
+        }
+
+        std::size_t size() const { return fEntries.size(); }
+
+        template< typename FuncType >
+        void forEach( FuncType func ) const
+        {
+            for ( auto &&ii : fEntries )
+                func( ii.first, ii.second.fObject );
+        }
+
+        // the node as it was added, then the object
+        void write( QDataStream &ds ) const
+        {
+            for ( auto &&ii : fEntries )
+            {
+                ds << ii.first.filePath() << static_cast< quint64 >( ii.first.size() ) << ii.first.modificationTime().toMSecsSinceEpoch();
+                SFileBasedCacheSerializer< T >::write( ds, ii.second.fObject );
+            }
+        }
+
+        static std::optional< SFileBasedCacheNode > read( QDataStream &ds, T &object )
+        {
+            QString path;
+            quint64 size = 0;
+            qint64 msecs = 0;
+            ds >> path >> size >> msecs;
+            SFileBasedCacheSerializer< T >::read( ds, object );
+            if ( ds.status() != QDataStream::Ok )
+                return {};
+            return SFileBasedCacheNode( path, size, QDateTime::fromMSecsSinceEpoch( msecs ) );
+        }
+
+        // 0 is unlimited, without a size of function each entry counts as sizeof( T )
+        void setLimits( std::size_t maxEntries, std::size_t maxBytes, const TSizeOfFunc &sizeOfFunc )
+        {
+            fMaxEntries = maxEntries;
+            fMaxBytes = maxBytes;
+            fSizeOfFunc = sizeOfFunc;
+            fNumBytes = 0;
+            for ( auto &&ii : fEntries )
+            {
+                ii.second.fBytes = sizeOf( ii.second.fObject );
+                fNumBytes += ii.second.fBytes;
+            }
+            evict();
+        }
+
+        // pins are counted per path, whether or not the path is cached, and survive the entry being replaced
+        void pin( const QString &path ) { ++fPins[ path ]; }
+        void unpin( const QString &path )
+        {
+            auto pos = fPins.find( path );
+            if ( pos == fPins.end() )
+                return;
+            if ( --( *pos ).second <= 0 )
+                fPins.erase( pos );
+            evict();   // the pin may have held the cache over its limits
+        }
+
+        SFileBasedCacheStats stats() const
+        {
+            SFileBasedCacheStats retVal;
+            retVal.fHits = fHits.load( std::memory_order_relaxed );
+            retVal.fMisses = fMisses.load( std::memory_order_relaxed );
+            retVal.fEvictions = fEvictions;
+            retVal.fInvalidations = fInvalidations;
+            retVal.fNumEntries = fEntries.size();
+            retVal.fNumBytes = fNumBytes;
+            retVal.fNumPinned = fPins.size();
+            return retVal;
+        }
+
+    private:
+        using TRing = std::list< const SFileBasedCacheNode * >;
+        struct SEntry
+        {
+            T fObject;
+            std::size_t fBytes{ 0 };
+            mutable std::atomic< bool > fReferenced{ false };
+            mutable std::atomic< int64_t > fValidatedAt{ 0 };   // steady clock ms, or kNotValidated
+            typename TRing::iterator fRingPos;
+        };
+        using TEntries = std::unordered_map< SFileBasedCacheNode, SEntry >;
+        static constexpr int64_t kNotValidated{ std::numeric_limits< int64_t >::min() };
+
+        static int64_t nowMS() { return std::chrono::duration_cast< std::chrono::milliseconds >( std::chrono::steady_clock::now().time_since_epoch() ).count(); }
+
+        // the stale entry is left for the next add to replace, a lookup may only hold a shared lock
+        // a loaded entry is always checked on its first path only lookup, a full node lookup already matched the size and timestamp
+        static bool validate( const typename TEntries::value_type &entry, bool pathOnlySearch, int timeToLiveMS )
+        {
+            auto validatedAt = entry.second.fValidatedAt.load( std::memory_order_relaxed );
+            if ( !pathOnlySearch )
+            {
+                if ( validatedAt == kNotValidated )
+                    entry.second.fValidatedAt.store( nowMS(), std::memory_order_relaxed );
+                return true;
+            }
+
+            if ( ( validatedAt != kNotValidated ) && ( timeToLiveMS < 0 ) )
+                return true;
+            auto now = nowMS();
+            if ( ( validatedAt != kNotValidated ) && ( ( now - validatedAt ) <= timeToLiveMS ) )
+                return true;
+            if ( !( entry.first == SFileBasedCacheNode( entry.first.filePath() ) ) )
+                return false;
+            entry.second.fValidatedAt.store( now, std::memory_order_relaxed );
+            return true;
+        }
+
+        std::size_t sizeOf( const T &object ) const { return fSizeOfFunc ? fSizeOfFunc( object ) : sizeof( T ); }
+        bool overLimit() const { return ( ( fMaxEntries != 0 ) && ( fEntries.size() > fMaxEntries ) ) || ( ( fMaxBytes != 0 ) && ( fNumBytes > fMaxBytes ) ); }
+
+        typename TEntries::iterator removeEntry( typename TEntries::iterator pos )
+        {
+            auto &&entry = ( *pos ).second;
+            if ( fHand == entry.fRingPos )
+                ++fHand;
+            fRing.erase( entry.fRingPos );
+            fNumBytes -= entry.fBytes;
+            return fEntries.erase( pos );
+        }
+
+        // two passes of the hand clear every referenced bit, anything left is pinned
+        // the entry being added is never the one evicted
+        void evict( const SFileBasedCacheNode *added = nullptr )
+        {
+            for ( auto numChecked = 2 * fRing.size(); overLimit() && numChecked; --numChecked )
+            {
+                if ( fHand == fRing.end() )
+                    fHand = fRing.begin();
+                if ( *fHand == added )
+                {
+                    ++fHand;
+                    continue;
+                }
+
+                auto pos = fEntries.find( **fHand );
+                auto &&entry = ( *pos ).second;
+                if ( entry.fReferenced.exchange( false, std::memory_order_relaxed ) || ( !fPins.empty() && ( fPins.find( ( *pos ).first.filePath() ) != fPins.end() ) ) )
+                {
+                    ++fHand;
+                    continue;
+                }
+                removeEntry( pos );
+                ++fEvictions;
+            }
+        }
+
+        TEntries fEntries;
+        TRing fRing;   // the clock, in insertion order
+        typename TRing::iterator fHand{ fRing.end() };
+        std::unordered_map< QString, int > fPins;
+        std::size_t fNumBytes{ 0 };
+        std::size_t fMaxEntries{ 0 };
+        std::size_t fMaxBytes{ 0 };
+        TSizeOfFunc fSizeOfFunc;
+        mutable std::atomic< uint64_t > fHits{ 0 };
+        mutable std::atomic< uint64_t > fMisses{ 0 };
+        uint64_t fEvictions{ 0 };
+        uint64_t fInvalidations{ 0 };
+    };
+
     // a cache that can be used for items that are filebased
     // but a miss should happen if the file has changed (checks size and timestamp)
+    // unbounded unless setLimits is called
     template< typename T >
-    class CFileBasedCache
+    class CFileBasedCache : public CFileBasedCacheBase
     {
     public:
+        using TSizeOfFunc = typename CFileBasedCacheEntries< T >::TSizeOfFunc;
+
         CFileBasedCache() {}
 
         T find( const QString &path ) const { return find( QFileInfo( path ) ); }
+        T find( const QString &path, const NFileUtils::SFileStat &stat ) const
+        {
+            auto lookup = lookupFor( path );
+            return find( lookup.fPathOnly ? pathOnlyNode( path ) : NSABUtils::SFileBasedCacheNode( path, stat ), lookup.fTimeToLiveMS );
+        }
         T find( const QFileInfo &fi ) const
         {
-            auto node = NSABUtils::SFileBasedCacheNode( fi );
-            auto pos = fCache.find( node );
-            if ( pos == fCache.end() )
-                return {};
-            return ( *pos ).second;
+            int timeToLiveMS = -1;
+            auto node = lookupNode( fi, timeToLiveMS );
+            return find( node, timeToLiveMS );
+        }
+
+        // path only lookup, returns the node as it was added (with its recorded size and timestamp) and the object
+        std::optional< std::pair< SFileBasedCacheNode, T > > findByPath( const QString &path ) const
+        {
+            applyPendingInvalidations();
+            return fCache.findByPath( path );
+        }
+
+        bool contains( const QString &path, bool pathOnlySearch = false ) const { return contains( QFileInfo( path ), pathOnlySearch ); }
+        bool contains( const QFileInfo &fi, bool pathOnlySearch = false ) const
+        {
+            applyPendingInvalidations();
+            int timeToLiveMS = -1;
+            auto node = lookupNode( fi, timeToLiveMS );
+            if ( pathOnlySearch )
+                node.setPathOnlySearch( true );
+            return fCache.contains( node, timeToLiveMS );
+        }
+
+        template< typename U = T >
+        typename std::enable_if< has_fileNamePtr< U >, void >::type add( const U &object )
+        {
+            return add( object->fileName(), object );
+        }
+
+        void add( const QString &path, const T &object ) { add( NSABUtils::SFileBasedCacheNode( path ), object ); }
+        void add( const QString &path, const NFileUtils::SFileStat &stat, const T &object ) { add( NSABUtils::SFileBasedCacheNode( path, stat ), object ); }
+
+        // the node captures the size and timestamp, capture it before reading the file so a change during the read is a miss
+        void add( const SFileBasedCacheNode &node, const T &object )
+        {
+            applyPendingInvalidations();
+
+            // a watched entry is never stat'ed again, if the file changed since the node was captured
+            // the invalidation may already have been applied, so it is not added
+            if ( skipStat( node.filePath() ) && !( node == SFileBasedCacheNode( node.filePath() ) ) )
+            {
+                fCache.erase( pathOnlyNode( node.filePath() ) );
+                return;
+            }
+            fCache.add( node, object );
+        }
+
+        void remove( const QString &path ) { fCache.erase( pathOnlyNode( path ) ); }   // removes the entry for the path, regardless of its size and timestamp
+        void clear() { fCache.clear(); }
+
+        std::size_t size() const
+        {
+            applyPendingInvalidations();
+            return fCache.size();
+        }
+
+        bool empty() const { return size() == 0; }
+
+        // func( const SFileBasedCacheNode &node, const T &object )
+        template< typename FuncType >
+        void forEach( FuncType func ) const
+        {
+            applyPendingInvalidations();
+            fCache.forEach( func );
+        }
+
+        // 0 is unlimited, the least recently used entries that are not pinned are evicted past either limit
+        // sizeOf estimates the memory held by an entry, without it each entry counts as sizeof( T )
+        void setLimits( std::size_t maxEntries, std::size_t maxBytes = 0, const TSizeOfFunc &sizeOf = {} ) { fCache.setLimits( maxEntries, maxBytes, sizeOf ); }
+
+        // a pinned path is never evicted, the pins are counted
+        void pin( const QString &path ) { fCache.pin( path ); }
+        void unpin( const QString &path ) { fCache.unpin( path ); }
+
+        SFileBasedCacheStats stats() const { return fCache.stats(); }
+
+        // one binary file, T is written with SFileBasedCacheSerializer< T >
+        bool save( const QString &fileName, QString *msg = nullptr ) const
+        {
+            applyPendingInvalidations();
+            return writeCacheFile( fileName, SFileBasedCacheSerializer< T >::kVersion, fCache.size(), [ this ]( QDataStream &ds ) { fCache.write( ds ); }, msg );
+        }
+
+        // replaces the contents, the entries are not stat'ed until they are looked up so a large cache loads quickly
+        // on failure the cache is left empty
+        bool load( const QString &fileName, QString *msg = nullptr )
+        {
+            fCache.clear();
+            auto aOK = readCacheFile(
+                fileName, SFileBasedCacheSerializer< T >::kVersion,
+                [ this ]( QDataStream &ds, quint64 numEntries )
+                {
+                    for ( quint64 ii = 0; ii < numEntries; ++ii )
+                    {
+                        T object;
+                        auto node = CFileBasedCacheEntries< T >::read( ds, object );
+                        if ( !node )
+                            return false;
+                        fCache.add( *node, object, false );
+                    }
+                    return true;
+                },
+                msg );
+            if ( !aOK )
+                fCache.clear();
+            return aOK;
+        }
+
+    private:
+        T find( const SFileBasedCacheNode &node, int timeToLiveMS ) const
+        {
+            applyPendingInvalidations();
+            auto object = fCache.find( node, timeToLiveMS );
+            return object ? *object : T();
+        }
+
+        // a path only node built without a stat when the watcher vouches for the path or the validation does not stat
+        SFileBasedCacheNode lookupNode( const QFileInfo &fi, int &timeToLiveMS ) const
+        {
+            auto path = fi.absoluteFilePath();
+            auto lookup = lookupFor( path );
+            timeToLiveMS = lookup.fTimeToLiveMS;
+            if ( !lookup.fPathOnly )
+                return NSABUtils::SFileBasedCacheNode( fi );
+            return pathOnlyNode( path );
+        }
+
+        static SFileBasedCacheNode pathOnlyNode( const QString &path ) { return CFileBasedCacheEntries< T >::pathOnlyNode( path ); }
+
+        void applyInvalidations( const QStringList &files, const QStringList &dirs, bool all ) const override
+        {
+            if ( all )
+            {
+                fCache.invalidateAll();
+                return;
+            }
+
+            for ( auto &&ii : files )
+                fCache.invalidate( ii );
+            if ( !dirs.isEmpty() )
+                fCache.invalidateBelow( dirs );
+        }
+
+        mutable CFileBasedCacheEntries< T > fCache;   // mutable so a lookup can drop the entries the watcher invalidated
+    };
+
+    // the same as CFileBasedCache, but safe to call from any number of threads
+    // the entries are split over NumShards maps by the path hash, each with a reader/writer lock, so lookups of different files rarely contend
+    // findOrCreate builds the value outside of any lock, a second thread asking for the same file waits for the first rather than building it again
+    template< typename T, std::size_t NumShards = 16 >
+    class CConcurrentFileBasedCache : public CFileBasedCacheBase
+    {
+    public:
+        using TSizeOfFunc = typename CFileBasedCacheEntries< T >::TSizeOfFunc;
+
+        CConcurrentFileBasedCache() {}
+
+        T find( const QString &path ) const { return find( QFileInfo( path ) ); }
+        T find( const QString &path, const NFileUtils::SFileStat &stat ) const
+        {
+            auto lookup = lookupFor( path );
+            return find( lookup.fPathOnly ? pathOnlyNode( path ) : NSABUtils::SFileBasedCacheNode( path, stat ), lookup.fTimeToLiveMS );
+        }
+        T find( const QFileInfo &fi ) const
+        {
+            int timeToLiveMS = -1;
+            auto node = lookupNode( fi, timeToLiveMS );
+            return find( node, timeToLiveMS );
         }
 
         bool contains( const QString &path, bool pathOnlySearch = false ) const { return contains( QFileInfo( path ), pathOnlySearch ); }
         bool contains( const QFileInfo &fi, bool pathOnlySearch = false ) const
         {
-            auto node = NSABUtils::SFileBasedCacheNode( fi );
-            node.setPathOnlySearch( pathOnlySearch );
-            auto pos = fCache.find( node );
-            return ( pos != fCache.end() );
+            applyPendingInvalidations();
+            int timeToLiveMS = -1;
+            auto node = lookupNode( fi, timeToLiveMS );
+            if ( pathOnlySearch )
+                node.setPathOnlySearch( true );
+            auto &&shard = shardFor( node );
+            std::shared_lock< std::shared_mutex > lock( shard.fMutex );
+            return shard.fCache.contains( node, timeToLiveMS );
         }
 
-        typename std::enable_if< has_fileNamePtr< T >, void >::type add( const T &object ) { return add( object->fileName(), object ); }
+        // returns the cached value, or the value create returns which is then added
+        // create is called at most once per file at a time, other threads asking for the file wait for its value
+        // an exception thrown by create is rethrown in every waiting thread and nothing is added
+        T findOrCreate( const QString &path, const std::function< T() > &create ) { return findOrCreate( QFileInfo( path ), create ); }
+        T findOrCreate( const QFileInfo &fi, const std::function< T() > &create )
+        {
+            applyPendingInvalidations();
+            int timeToLiveMS = -1;
+            auto lookup = lookupNode( fi, timeToLiveMS );
+            auto path = lookup.filePath();
+            auto &&shard = shardFor( lookup );
+
+            std::shared_future< T > pending;
+            std::promise< T > promise;
+            {
+                std::unique_lock< std::shared_mutex > lock( shard.fMutex );
+                if ( auto object = shard.fCache.find( lookup, timeToLiveMS ) )
+                    return *object;
+
+                auto inFlight = shard.fInFlight.find( path );
+                if ( inFlight != shard.fInFlight.end() )
+                    pending = ( *inFlight ).second;
+                else
+                    shard.fInFlight[ path ] = promise.get_future().share();
+            }
+            if ( pending.valid() )
+                return pending.get();
+
+            auto node = lookup.pathOnlySearch() ? NSABUtils::SFileBasedCacheNode( fi ) : lookup;   // captured before create reads the file, a change during the read is a miss
+            T retVal;
+            try
+            {
+                retVal = create();
+            }
+            catch ( ... )
+            {
+                promise.set_exception( std::current_exception() );
+                std::unique_lock< std::shared_mutex > lock( shard.fMutex );
+                shard.fInFlight.erase( path );
+                throw;
+            }
 
-        void add( const QString &path, const T &object )
+            {
+                std::unique_lock< std::shared_mutex > lock( shard.fMutex );
+                shard.fInFlight.erase( path );
+                addLocked( shard, node, retVal );
+            }
+            promise.set_value( retVal );
+            return retVal;
+        }
+
+        template< typename U = T >
+        typename std::enable_if< has_fileNamePtr< U >, void >::type add( const U &object )
+        {
+            return add( object->fileName(), object );
+        }
+
+        void add( const QString &path, const T &object ) { add( NSABUtils::SFileBasedCacheNode( path ), object ); }
+        void add( const QString &path, const NFileUtils::SFileStat &stat, const T &object ) { add( NSABUtils::SFileBasedCacheNode( path, stat ), object ); }
+        void add( const SFileBasedCacheNode &node, const T &object )
+        {
+            applyPendingInvalidations();
+            auto &&shard = shardFor( node );
+            std::unique_lock< std::shared_mutex > lock( shard.fMutex );
+            addLocked( shard, node, object );
+        }
+
+        void remove( const QString &path )
+        {
+            auto node = pathOnlyNode( path );
+            auto &&shard = shardFor( node );
+            std::unique_lock< std::shared_mutex > lock( shard.fMutex );
+            shard.fCache.erase( node );
+        }
+
+        void clear()
+        {
+            for ( auto &&shard : fShards )
+            {
+                std::unique_lock< std::shared_mutex > lock( shard.fMutex );
+                shard.fCache.clear();
+            }
+        }
+
+        std::size_t size() const
+        {
+            applyPendingInvalidations();
+            std::size_t retVal = 0;
+            for ( auto &&shard : fShards )
+            {
+                std::shared_lock< std::shared_mutex > lock( shard.fMutex );
+                retVal += shard.fCache.size();
+            }
+            return retVal;
+        }
+
+        bool empty() const { return size() == 0; }
+
+        // func( const SFileBasedCacheNode &node, const T &object ), called with the shard locked for reading, func must not call back into the cache
+        template< typename FuncType >
+        void forEach( FuncType func ) const
+        {
+            applyPendingInvalidations();
+            for ( auto &&shard : fShards )
+            {
+                std::shared_lock< std::shared_mutex > lock( shard.fMutex );
+                shard.fCache.forEach( func );
+            }
+        }
+
+        // the limits are approximate, each shard enforces its own share so no lock is held across shards
+        // the shares add up to the limit, a shard evicts once its share is full even when others have room, so the cache may hold fewer
+        // a non zero limit below NumShards is raised to one per shard (0 is unlimited per shard), so the cache may hold up to NumShards
+        void setLimits( std::size_t maxEntries, std::size_t maxBytes = 0, const TSizeOfFunc &sizeOf = {} )
+        {
+            auto share = []( std::size_t value, std::size_t shardNum ) { return ( value == 0 ) ? 0 : std::max< std::size_t >( 1, ( value / NumShards ) + ( ( shardNum < ( value % NumShards ) ) ? 1 : 0 ) ); };
+            for ( std::size_t ii = 0; ii < NumShards; ++ii )
+            {
+                std::unique_lock< std::shared_mutex > lock( fShards[ ii ].fMutex );
+                fShards[ ii ].fCache.setLimits( share( maxEntries, ii ), share( maxBytes, ii ), sizeOf );
+            }
+        }
+
+        void pin( const QString &path ) { withShard( path, [ &path ]( CFileBasedCacheEntries< T > &cache ) { cache.pin( path ); } ); }
+        void unpin( const QString &path ) { withShard( path, [ &path ]( CFileBasedCacheEntries< T > &cache ) { cache.unpin( path ); } ); }
+
+        SFileBasedCacheStats stats() const
         {
-            if ( contains( path, true ) )
+            SFileBasedCacheStats retVal;
+            for ( auto &&shard : fShards )
             {
-                clear( path, true );
+                std::shared_lock< std::shared_mutex > lock( shard.fMutex );
+                retVal += shard.fCache.stats();
             }
-            fCache[ NSABUtils::SFileBasedCacheNode( path ) ] = object;
+            return retVal;
+        }
+
+        // every shard is locked for reading while the file is written, so the file is a consistent snapshot
+        bool save( const QString &fileName, QString *msg = nullptr ) const
+        {
+            applyPendingInvalidations();
+            std::vector< std::shared_lock< std::shared_mutex > > locks;
+            std::size_t numEntries = 0;
+            for ( auto &&shard : fShards )
+            {
+                locks.emplace_back( shard.fMutex );
+                numEntries += shard.fCache.size();
+            }
+            return writeCacheFile(
+                fileName, SFileBasedCacheSerializer< T >::kVersion, numEntries,
+                [ this ]( QDataStream &ds )
+                {
+                    for ( auto &&shard : fShards )
+                        shard.fCache.write( ds );
+                },
+                msg );
+        }
+
+        // replaces the contents, the entries are not stat'ed until they are looked up so a large cache loads quickly
+        // on failure the cache is left empty
+        bool load( const QString &fileName, QString *msg = nullptr )
+        {
+            clear();
+            auto aOK = readCacheFile(
+                fileName, SFileBasedCacheSerializer< T >::kVersion,
+                [ this ]( QDataStream &ds, quint64 numEntries )
+                {
+                    for ( quint64 ii = 0; ii < numEntries; ++ii )
+                    {
+                        T object;
+                        auto node = CFileBasedCacheEntries< T >::read( ds, object );
+                        if ( !node )
+                            return false;
+                        auto &&shard = shardFor( *node );
+                        std::unique_lock< std::shared_mutex > lock( shard.fMutex );
+                        shard.fCache.add( *node, object, false );
+                    }
+                    return true;
+                },
+                msg );
+            if ( !aOK )
+                clear();
+            return aOK;
         }
 
     private:
-        void clear( const QString &path, bool pathOnlySearch )
+        struct SShard
+        {
+            mutable std::shared_mutex fMutex;
+            CFileBasedCacheEntries< T > fCache;
+            std::unordered_map< QString, std::shared_future< T > > fInFlight;   // paths whose value is being created
+        };
+
+        T find( const SFileBasedCacheNode &node, int timeToLiveMS ) const
+        {
+            applyPendingInvalidations();
+            auto &&shard = shardFor( node );
+            std::shared_lock< std::shared_mutex > lock( shard.fMutex );
+            auto object = shard.fCache.find( node, timeToLiveMS );
+            return object ? *object : T();
+        }
+
+        SShard &shardFor( const SFileBasedCacheNode &node ) const { return fShards[ node.hash() % NumShards ]; }
+
+        template< typename FuncType >
+        void withShard( const QString &path, FuncType func )
+        {
+            auto &&shard = shardFor( pathOnlyNode( path ) );
+            std::unique_lock< std::shared_mutex > lock( shard.fMutex );
+            func( shard.fCache );
+        }
+
+        void addLocked( SShard &shard, const SFileBasedCacheNode &node, const T &object )
+        {
+            if ( skipStat( node.filePath() ) && !( node == SFileBasedCacheNode( node.filePath() ) ) )
+            {
+                shard.fCache.erase( pathOnlyNode( node.filePath() ) );
+                return;
+            }
+            shard.fCache.add( node, object );
+        }
+
+        SFileBasedCacheNode lookupNode( const QFileInfo &fi, int &timeToLiveMS ) const
+        {
+            auto path = fi.absoluteFilePath();
+            auto lookup = lookupFor( path );
+            timeToLiveMS = lookup.fTimeToLiveMS;
+            if ( !lookup.fPathOnly )
+                return NSABUtils::SFileBasedCacheNode( fi );
+            return pathOnlyNode( path );
+        }
+
+        static SFileBasedCacheNode pathOnlyNode( const QString &path ) { return CFileBasedCacheEntries< T >::pathOnlyNode( path ); }
+
+        void applyInvalidations( const QStringList &files, const QStringList &dirs, bool all ) const override
         {
-            auto node = NSABUtils::SFileBasedCacheNode( path );
-            node.setPathOnlySearch( pathOnlySearch );
-            auto pos = fCache.find( node );
-            if ( pos != fCache.end() )
-                fCache.erase( pos );
+            for ( auto &&ii : files )
+            {
+                auto &&shard = shardFor( pathOnlyNode( ii ) );
+                std::unique_lock< std::shared_mutex > lock( shard.fMutex );
+                shard.fCache.invalidate( ii );
+            }
+            if ( !all && dirs.isEmpty() )
+                return;
+
+            for ( auto &&shard : fShards )
+            {
+                std::unique_lock< std::shared_mutex > lock( shard.fMutex );
+                if ( all )
+                    shard.fCache.invalidateAll();
+                else
+                    shard.fCache.invalidateBelow( dirs );
+            }
         }
-        std::unordered_map< SFileBasedCacheNode, T > fCache;
+
+        mutable std::array< SShard, NumShards > fShards;   // mutable so a lookup can drop the entries the watcher invalidated
     };
 }
 
@@ -23,36 +23,228 @@
 #include "FileCompare.h"
 #include "FileUtils.h"
 #include "MD5.h"
+#include "DigestCache.h"
 
 #include <QString>
+#include <QFile>
 #include <QFileInfo>
 
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
 namespace NSABUtils
 {
     namespace NFileUtils
     {
+        namespace
+        {
+            // reads a file on its own thread into two alternating blocks
+            // the consumer takes block N while the reader fills block N+1
+            class CBlockReader
+            {
+            public:
+                CBlockReader( const QString &fileName, qint64 blockSize ) :
+                    fFile( fileName ),
+                    fBlockSize( blockSize )
+                {
+                    for ( auto &&ii : fBlocks )
+                        ii.resize( blockSize );
+                }
+
+                ~CBlockReader() { stop(); }
+
+                bool open( QString *msg )
+                {
+                    if ( fFile.open( QIODevice::ReadOnly ) )
+                        return true;
+                    if ( msg )
+                        *msg = QString( "Could not open '%1': %2" ).arg( fFile.fileName() ).arg( fFile.errorString() );
+                    return false;
+                }
+
+                void start()
+                {
+                    fThread = std::thread( [ this ]() { run(); } );
+                }
+
+                // waits for the next block, returns its length, 0 at the end of the file and -1 on a read error
+                qint64 next( const char *&data )
+                {
+                    std::unique_lock< std::mutex > lock( fMutex );
+                    fCondition.wait( lock, [ this ]() { return fFull[ fConsumerSlot ]; } );
+                    data = fBlocks[ fConsumerSlot ].data();
+                    return fLengths[ fConsumerSlot ];
+                }
+
+                // the block returned by next is no longer needed
+                void release()
+                {
+                    {
+                        std::lock_guard< std::mutex > lock( fMutex );
+                        fFull[ fConsumerSlot ] = false;
+                    }
+                    fConsumerSlot = 1 - fConsumerSlot;
+                    fCondition.notify_all();
+                }
+
+                void stop()
+                {
+                    {
+                        std::lock_guard< std::mutex > lock( fMutex );
+                        fStopped = true;
+                    }
+                    fCondition.notify_all();
+                    if ( fThread.joinable() )
+                        fThread.join();
+                }
+
+                QString errorString() const { return fFile.errorString(); }
+
+            private:
+                void run()
+                {
+                    for ( int slot = 0;; slot = 1 - slot )
+                    {
+                        {
+                            std::unique_lock< std::mutex > lock( fMutex );
+                            fCondition.wait( lock, [ this, slot ]() { return fStopped || !fFull[ slot ]; } );
+                            if ( fStopped )
+                                return;
+                        }
+
+                        auto len = fFile.read( fBlocks[ slot ].data(), fBlockSize );
+                        {
+                            std::lock_guard< std::mutex > lock( fMutex );
+                            fLengths[ slot ] = len;
+                            fFull[ slot ] = true;
+                        }
+                        fCondition.notify_all();
+                        if ( len <= 0 )
+                            return;
+                    }
+                }
+
+                QFile fFile;
+                qint64 fBlockSize{ 0 };
+                std::vector< char > fBlocks[ 2 ];
+                qint64 fLengths[ 2 ]{ 0, 0 };
+                bool fFull[ 2 ]{ false, false };
+                int fConsumerSlot{ 0 };
+                bool fStopped{ false };
+                std::mutex fMutex;
+                std::condition_variable fCondition;
+                std::thread fThread;
+            };
+
+            // both files fit in one block, read them on the calling thread, starting two readers costs more than the read
+            bool compareSmallContents( const QString &lhs, const QString &rhs, qint64 size, QString *msg )
+            {
+                QFile lhsFile( lhs );
+                QFile rhsFile( rhs );
+                for ( auto &&file : { &lhsFile, &rhsFile } )
+                {
+                    if ( !file->open( QIODevice::ReadOnly ) )
+                    {
+                        if ( msg )
+                            *msg = QString( "Could not open '%1': %2" ).arg( file->fileName() ).arg( file->errorString() );
+                        return false;
+                    }
+                }
+
+                // one byte more than the stat said, so a file that grew since is not equal
+                std::vector< char > lhsData( size + 1 );
+                std::vector< char > rhsData( size + 1 );
+                auto lhsLen = lhsFile.read( lhsData.data(), size + 1 );
+                auto rhsLen = rhsFile.read( rhsData.data(), size + 1 );
+                if ( ( lhsLen < 0 ) || ( rhsLen < 0 ) )
+                {
+                    if ( msg )
+                        *msg = QString( "Could not read '%1': %2" ).arg( ( lhsLen < 0 ) ? lhs : rhs ).arg( ( lhsLen < 0 ) ? lhsFile.errorString() : rhsFile.errorString() );
+                    return false;
+                }
+                return ( lhsLen == rhsLen ) && ( std::memcmp( lhsData.data(), rhsData.data(), lhsLen ) == 0 );
+            }
+
+            bool compareContents( const QString &lhs, const QString &rhs, qint64 lhsSize, qint64 rhsSize, qint64 blockSize, QString *msg )
+            {
+                if ( lhsSize != rhsSize )
+                    return false;
+                if ( blockSize <= 0 )
+                    blockSize = CFileCompare::kDefaultBlockSize;
+                if ( lhsSize <= blockSize )
+                    return compareSmallContents( lhs, rhs, lhsSize, msg );
+
+                CBlockReader lhsReader( lhs, blockSize );
+                CBlockReader rhsReader( rhs, blockSize );
+                if ( !lhsReader.open( msg ) || !rhsReader.open( msg ) )
+                    return false;
+
+                lhsReader.start();
+                rhsReader.start();
+                while ( true )
+                {
+                    const char *lhsData = nullptr;
+                    const char *rhsData = nullptr;
+                    auto lhsLen = lhsReader.next( lhsData );
+                    auto rhsLen = rhsReader.next( rhsData );
+                    if ( ( lhsLen < 0 ) || ( rhsLen < 0 ) )
+                    {
+                        if ( msg )
+                            *msg = QString( "Could not read '%1': %2" ).arg( ( lhsLen < 0 ) ? lhs : rhs ).arg( ( lhsLen < 0 ) ? lhsReader.errorString() : rhsReader.errorString() );
+                        return false;
+                    }
+
+                    if ( lhsLen != rhsLen )
+                        return false;
+                    if ( lhsLen == 0 )
+                        return true;
+                    if ( std::memcmp( lhsData, rhsData, lhsLen ) != 0 )
+                        return false;
+
+                    lhsReader.release();
+                    rhsReader.release();
+                }
+            }
+        }
+
         class CFileCompareImpl
         {
         public:
-            CFileCompareImpl( const QFileInfo &lhs, const QFileInfo &rhs ) :
+            CFileCompareImpl( const QFileInfo &lhs, const QFileInfo &rhs, const SFileCompareOptions &options ) :
                 fLHS( lhs ),
-                fRHS( rhs )
+                fRHS( rhs ),
+                fOptions( options )
             {
             }
 
-            bool compare() const;
+            bool compare() const { return compareMetaData() && compareContent(); }
+            bool compareMetaData() const;
+            bool compareContent() const;
+
+            // one stat per file for everything the metadata compare reads
+            const SFileStat &lhsStat() const
+            {
+                if ( !fLHSStat.has_value() )
+                    fLHSStat = fileStat( fLHS.absoluteFilePath() );
+                return fLHSStat.value();
+            }
+            const SFileStat &rhsStat() const
+            {
+                if ( !fRHSStat.has_value() )
+                    fRHSStat = fileStat( fRHS.absoluteFilePath() );
+                return fRHSStat.value();
+            }
 
             QFileInfo fLHS;
             QFileInfo fRHS;
+            mutable std::optional< SFileStat > fLHSStat;
+            mutable std::optional< SFileStat > fRHSStat;
 
-            bool fCheckSize{ true };
-            std::list< QFileDevice::FileTime > fTimeStampsToCheck{ QFileDevice::FileTime::FileModificationTime };
-            int fTolerance{ 2 };
-            bool fArchiveBit{ false };
-            bool fSystemBit{ false };
-            bool fHiddenBit{ false };
-            bool fReadOnlyBit{ false };
-            bool fMD5{ true };
+            SFileCompareOptions fOptions;
         };
 
         CFileCompare::CFileCompare( const std::string &lhs, const std::string &rhs ) :
@@ -66,8 +258,29 @@ namespace NSABUtils
         }
 
         CFileCompare::CFileCompare( const QFileInfo &lhs, const QFileInfo &rhs ) :
-            fImpl( new CFileCompareImpl( lhs, rhs ) )
+            CFileCompare( lhs, rhs, SFileCompareOptions() )
+        {
+        }
+
+        CFileCompare::CFileCompare( const QFileInfo &lhs, const QFileInfo &rhs, const SFileCompareOptions &options ) :
+            fImpl( new CFileCompareImpl( lhs, rhs, options ) )
+        {
+        }
+
+        void CFileCompare::setOptions( const SFileCompareOptions &options )
+        {
+            fImpl->fOptions = options;
+        }
+
+        const SFileCompareOptions &CFileCompare::options() const
         {
+            return fImpl->fOptions;
+        }
+
+        void CFileCompare::setFileStats( const SFileStat &lhs, const SFileStat &rhs )
+        {
+            fImpl->fLHSStat = lhs;
+            fImpl->fRHSStat = rhs;
         }
 
         CFileCompare::~CFileCompare()
@@ -77,12 +290,12 @@ namespace NSABUtils
 
         void CFileCompare::setCheckSize( bool value )
         {
-            fImpl->fCheckSize = value;
+            fImpl->fOptions.fCheckSize = value;
         }
 
         bool CFileCompare::checkSize() const
         {
-            return fImpl->fCheckSize;
+            return fImpl->fOptions.fCheckSize;
         }
 
         void CFileCompare::disableCheckTimeStamps()
@@ -92,72 +305,119 @@ namespace NSABUtils
 
         void CFileCompare::checkTimeStamp( std::list< QFileDevice::FileTime > value )   // default modtime only
         {
-            fImpl->fTimeStampsToCheck = value;
+            fImpl->fOptions.fTimeStampsToCheck = value;
         }
 
         std::list< QFileDevice::FileTime > CFileCompare::timeStampsChecked() const
         {
-            return fImpl->fTimeStampsToCheck;
+            return fImpl->fOptions.fTimeStampsToCheck;
         }
 
         void CFileCompare::setTimeStampTolerance( int seconds )   // default 2 seconds
         {
-            fImpl->fTolerance = seconds;
+            fImpl->fOptions.fTolerance = seconds;
         }
 
         int CFileCompare::timeStampTolerance() const
         {
-            return fImpl->fTolerance;
+            return fImpl->fOptions.fTolerance;
         }
 
         void CFileCompare::compareArchiveBit( bool value )   // default false
         {
-            fImpl->fArchiveBit = value;
+            fImpl->fOptions.fArchiveBit = value;
         }
 
         bool CFileCompare::archiveBit() const
         {
-            return fImpl->fArchiveBit;
+            return fImpl->fOptions.fArchiveBit;
         }
 
         void CFileCompare::compareSystemBit( bool value )   // default false
         {
-            fImpl->fSystemBit = value;
+            fImpl->fOptions.fSystemBit = value;
         }
 
         bool CFileCompare::systemBit() const
         {
-            return fImpl->fSystemBit;
+            return fImpl->fOptions.fSystemBit;
         }
 
         void CFileCompare::compareHiddenBit( bool value )   // default false
         {
-            fImpl->fHiddenBit = value;
+            fImpl->fOptions.fHiddenBit = value;
         }
 
         bool CFileCompare::hiddenBit() const
         {
-            return fImpl->fHiddenBit;
+            return fImpl->fOptions.fHiddenBit;
         }
 
         void CFileCompare::compareReadOnlyBit( bool value )   // default false
         {
-            fImpl->fReadOnlyBit = value;
+            fImpl->fOptions.fReadOnlyBit = value;
         }
 
         bool CFileCompare::readOnlyBit() const
         {
-            return fImpl->fReadOnlyBit;
+            return fImpl->fOptions.fReadOnlyBit;
         }
 
         void CFileCompare::compareMD5( bool value )   // default true
         {
-            fImpl->fMD5 = value;
+            fImpl->fOptions.fMD5 = value;
         }
 
         bool CFileCompare::md5() const
         {
-            return fImpl->fMD5;
+            return fImpl->fOptions.fMD5;
+        }
+
+        void CFileCompare::setContentCompareMode( EContentCompareMode value )
+        {
+            fImpl->fOptions.fContentCompareMode = value;
+        }
+
+        EContentCompareMode CFileCompare::contentCompareMode() const
+        {
+            return fImpl->fOptions.fContentCompareMode;
+        }
+
+        void CFileCompare::setUseCachedDigests( bool value )
+        {
+            fImpl->fOptions.fUseCachedDigests = value;
+        }
+
+        bool CFileCompare::useCachedDigests() const
+        {
+            return fImpl->fOptions.fUseCachedDigests;
+        }
+
+        void CFileCompare::setBlockSize( qint64 value )
+        {
+            fImpl->fOptions.fBlockSize = ( value > 0 ) ? value : kDefaultBlockSize;
+        }
+
+        qint64 CFileCompare::blockSize() const
+        {
+            return fImpl->fOptions.fBlockSize;
+        }
+
+        bool CFileCompare::compareContents( const QFileInfo &lhs, const QFileInfo &rhs, qint64 blockSize, QString *msg )
+        {
+            auto lhsPath = lhs.absoluteFilePath();
+            auto rhsPath = rhs.absoluteFilePath();
+            return NFileUtils::compareContents( lhsPath, rhsPath, fileStat( lhsPath ).fSize, fileStat( rhsPath ).fSize, blockSize, msg );
+        }
+
+        void CFileCompare::setHashAlgorithm( EHashAlgorithm value )
+        {
+            fImpl->fOptions.fHashAlgorithm = value;
+        }
+
+        EHashAlgorithm CFileCompare::hashAlgorithm() const
+        {
+            return fImpl->fOptions.fHashAlgorithm;
         }
 
         bool CFileCompare::compare() const
@@ -165,6 +425,16 @@ namespace NSABUtils
             return fImpl->compare();
         }
 
+        bool CFileCompare::compareMetaData() const
+        {
+            return fImpl->compareMetaData();
+        }
+
+        bool CFileCompare::compareContent() const
+        {
+            return fImpl->compareContent();
+        }
+
         // order of comparison
         // size
         // timestamp
@@ -175,44 +445,68 @@ namespace NSABUtils
         //   readonly
         // md5
 
-        bool CFileCompareImpl::compare() const
+        bool CFileCompareImpl::compareMetaData() const
         {
-            if ( fCheckSize )
+            if ( fOptions.fCheckSize )
             {
-                if ( fLHS.size() != fRHS.size() )
+                if ( lhsStat().fSize != rhsStat().fSize )
                     return false;
             }
 
-            if ( !compareTimeStamp( fLHS, fRHS, fTolerance, fTimeStampsToCheck ) )
+            if ( !compareTimeStamp( lhsStat(), rhsStat(), fOptions.fTolerance, fOptions.fTimeStampsToCheck ) )
             {
                 return false;
             }
 
-            if ( fArchiveBit )
+            if ( fOptions.fArchiveBit )
             {
                 if ( isArchiveFile( fLHS ) != isArchiveFile( fRHS ) )
                     return false;
             }
 
-            if ( fSystemBit )
+            if ( fOptions.fSystemBit )
             {
                 if ( isSystemFile( fLHS ) != isSystemFile( fRHS ) )
                     return false;
             }
 
-            if ( fHiddenBit )
+            if ( fOptions.fHiddenBit )
             {
                 if ( isHiddenFile( fLHS ) != isHiddenFile( fRHS ) )
                     return false;
             }
 
-            if ( fReadOnlyBit )
+            if ( fOptions.fReadOnlyBit )
             {
                 if ( isReadOnlyFile( fLHS ) != isReadOnlyFile( fRHS ) )
                     return false;
             }
+            return true;
+        }
+
+        bool CFileCompareImpl::compareContent() const
+        {
+            if ( !fOptions.fMD5 )
+                return true;
+
+            // different sizes can never have the same content, even when the size is not part of the policy
+            auto lhsSize = static_cast< qint64 >( lhsStat().fSize );
+            auto rhsSize = static_cast< qint64 >( rhsStat().fSize );
+            if ( lhsSize != rhsSize )
+                return false;
+
+            if ( fOptions.fUseCachedDigests )
+            {
+                auto lhsDigest = CDigestCache::instance()->find( fLHS, fOptions.fHashAlgorithm );
+                auto rhsDigest = lhsDigest.isEmpty() ? QByteArray() : CDigestCache::instance()->find( fRHS, fOptions.fHashAlgorithm );
+                if ( !lhsDigest.isEmpty() && !rhsDigest.isEmpty() )
+                    return lhsDigest == rhsDigest;
+            }
+
+            if ( fOptions.fContentCompareMode == EContentCompareMode::eBytes )
+                return NFileUtils::compareContents( fLHS.absoluteFilePath(), fRHS.absoluteFilePath(), lhsSize, rhsSize, fOptions.fBlockSize, nullptr );
 
-            return NSABUtils::getMd5( fLHS ) == NSABUtils::getMd5( fRHS );
+            return NSABUtils::getMd5( fLHS, fOptions.fHashAlgorithm ) == NSABUtils::getMd5( fRHS, fOptions.fHashAlgorithm );
         }
 
     }
@@ -24,8 +24,11 @@
 #define __FILECOMPARE_H
 
 #include "SABUtilsExport.h"
+#include "ContentHash.h"
+#include "FileStat.h"
 
 #include <string>
+#include <list>
 #include <QFileDevice>
 class QFileInfo;
 class QString;
@@ -42,16 +45,49 @@ namespace NSABUtils
         //   system  // windows only
         //   hidden  // windows only
         //   readonly
-        // md5
+        // content (when compareMD5 is set)
+        //   cached digests, if both are known to CDigestCache
+        //   otherwise either a block by block compare that stops at the first difference, or the digests of both files
+        enum class EContentCompareMode
+        {
+            eBytes,   // read both files in lockstep, stop at the first differing block
+            eDigest   // compute (and cache) the digest of each file
+        };
+
+        // the comparison policy, shared by CFileCompare and CDirCompare
+        struct SABUTILS_EXPORT SFileCompareOptions
+        {
+            bool fCheckSize{ true };
+            std::list< QFileDevice::FileTime > fTimeStampsToCheck{ QFileDevice::FileTime::FileModificationTime };
+            int fTolerance{ 2 };   // seconds
+            bool fArchiveBit{ false };
+            bool fSystemBit{ false };
+            bool fHiddenBit{ false };
+            bool fReadOnlyBit{ false };
+            bool fMD5{ true };
+            EContentCompareMode fContentCompareMode{ EContentCompareMode::eBytes };
+            bool fUseCachedDigests{ true };
+            qint64 fBlockSize{ 4 * 1024 * 1024 };
+            EHashAlgorithm fHashAlgorithm{ EHashAlgorithm::eMD5 };
+        };
+
         class CFileCompareImpl;
         class SABUTILS_EXPORT CFileCompare
         {
         public:
+            static constexpr qint64 kDefaultBlockSize{ 4 * 1024 * 1024 };   // same as SFileCompareOptions::fBlockSize
+
             CFileCompare( const std::string &lhs, const std::string &rhs );
             CFileCompare( const QString &lhs, const QString &rhs );
             CFileCompare( const QFileInfo &lhs, const QFileInfo &rhs );
+            CFileCompare( const QFileInfo &lhs, const QFileInfo &rhs, const SFileCompareOptions &options );
             virtual ~CFileCompare();
 
+            void setOptions( const SFileCompareOptions &options );
+            const SFileCompareOptions &options() const;
+
+            void setFileStats( const SFileStat &lhs, const SFileStat &rhs );   // prefetched (fileStats for instance), the size and timestamps are then compared without a system call
+
             void setCheckSize( bool value );   // default true
             bool checkSize() const;
 
@@ -74,10 +110,29 @@ namespace NSABUtils
             void compareReadOnlyBit( bool value );   // default false
             bool readOnlyBit() const;
 
-            void compareMD5( bool value );   // default true
+            void compareMD5( bool value );   // default true, false skips the content check
             bool md5() const;
 
-            bool compare() const;
+            void setContentCompareMode( EContentCompareMode value );   // default eBytes
+            EContentCompareMode contentCompareMode() const;
+
+            void setUseCachedDigests( bool value );   // default true, uses the digests in CDigestCache when both files have one
+            bool useCachedDigests() const;
+
+            void setBlockSize( qint64 value );   // default 4MB, the byte compare keeps 2 blocks per file in flight
+            qint64 blockSize() const;
+
+            void setHashAlgorithm( EHashAlgorithm value );   // default MD5, used when comparing the content
+            EHashAlgorithm hashAlgorithm() const;
+
+            bool compare() const;   // compareMetaData() && compareContent()
+            bool compareMetaData() const;   // size, timestamps and attribute bits
+            bool compareContent() const;   // always true when compareMD5 is off
+
+            // files larger than a block are read on their own thread, double buffered, and compared block by block
+            // smaller files are read and compared on the calling thread
+            // returns false at the first difference, when the sizes differ or when either file can not be read
+            static bool compareContents( const QFileInfo &lhs, const QFileInfo &rhs, qint64 blockSize = kDefaultBlockSize, QString *msg = nullptr );
 
         private:
             CFileCompareImpl *fImpl;
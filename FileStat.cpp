@@ -0,0 +1,172 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "FileStat.h"
+#include "ParallelFor.h"
+
+#include <QFile>
+#include <QFileInfo>
+
+#ifdef Q_OS_LINUX
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <sys/stat.h>
+    #include <sys/sysmacros.h>
+#endif
+
+namespace NSABUtils
+{
+    namespace NFileUtils
+    {
+        QDateTime SFileStat::fileTime( QFileDevice::FileTime whichTime ) const
+        {
+            int64_t msecs = kUnknownTime;
+            switch ( whichTime )
+            {
+                case QFileDevice::FileAccessTime:
+                    msecs = fAccessTime;
+                    break;
+                case QFileDevice::FileBirthTime:
+                    msecs = fBirthTime;
+                    break;
+                case QFileDevice::FileMetadataChangeTime:
+                    msecs = fMetadataChangeTime;
+                    break;
+                case QFileDevice::FileModificationTime:
+                    msecs = fModificationTime;
+                    break;
+            }
+            if ( !fExists || ( msecs == kUnknownTime ) )
+                return {};
+            return QDateTime::fromMSecsSinceEpoch( msecs );
+        }
+
+        std::unordered_map< QFileDevice::FileTime, QDateTime > SFileStat::timeStamps( const std::list< QFileDevice::FileTime > &timeStampsToGet ) const
+        {
+            if ( !fExists )
+                return {};
+
+            std::unordered_map< QFileDevice::FileTime, QDateTime > retVal;
+            for ( auto &&ii : timeStampsToGet )
+                retVal[ ii ] = fileTime( ii );
+            return retVal;
+        }
+
+        namespace
+        {
+#ifdef Q_OS_LINUX
+            int64_t toMSecs( int64_t secs, int64_t nsecs )
+            {
+                return ( secs * 1000 ) + ( nsecs / 1000000 );
+            }
+
+            void fromStat( const struct stat &st, SFileStat &retVal )
+            {
+                retVal.fExists = true;
+                retVal.fIsFile = S_ISREG( st.st_mode );
+                retVal.fIsDir = S_ISDIR( st.st_mode );
+                retVal.fIsSymLink = S_ISLNK( st.st_mode );
+                retVal.fPermissions = st.st_mode & 07777;
+                retVal.fSize = st.st_size;
+                retVal.fInode = st.st_ino;
+                retVal.fDevice = st.st_dev;
+                retVal.fAccessTime = toMSecs( st.st_atim.tv_sec, st.st_atim.tv_nsec );
+                retVal.fModificationTime = toMSecs( st.st_mtim.tv_sec, st.st_mtim.tv_nsec );
+                retVal.fMetadataChangeTime = toMSecs( st.st_ctim.tv_sec, st.st_ctim.tv_nsec );
+            }
+#endif
+
+            SFileStat statPath( const QString &path, bool followSymLinks )
+            {
+                SFileStat retVal;
+                if ( path.isEmpty() )
+                    return retVal;
+#ifdef Q_OS_LINUX
+                if ( !path.startsWith( ':' ) )   // resources go through QFileInfo
+                {
+                    auto nativePath = QFile::encodeName( path );
+                    struct statx stx;
+                    if ( ::statx( AT_FDCWD, nativePath.constData(), followSymLinks ? 0 : AT_SYMLINK_NOFOLLOW, STATX_BASIC_STATS | STATX_BTIME, &stx ) == 0 )
+                    {
+                        retVal.fExists = true;
+                        retVal.fIsFile = S_ISREG( stx.stx_mode );
+                        retVal.fIsDir = S_ISDIR( stx.stx_mode );
+                        retVal.fIsSymLink = S_ISLNK( stx.stx_mode );
+                        retVal.fPermissions = stx.stx_mode & 07777;
+                        retVal.fSize = stx.stx_size;
+                        retVal.fInode = stx.stx_ino;
+                        retVal.fDevice = makedev( stx.stx_dev_major, stx.stx_dev_minor );
+                        retVal.fAttributes = stx.stx_attributes & stx.stx_attributes_mask;
+                        retVal.fAccessTime = toMSecs( stx.stx_atime.tv_sec, stx.stx_atime.tv_nsec );
+                        retVal.fModificationTime = toMSecs( stx.stx_mtime.tv_sec, stx.stx_mtime.tv_nsec );
+                        retVal.fMetadataChangeTime = toMSecs( stx.stx_ctime.tv_sec, stx.stx_ctime.tv_nsec );
+                        if ( stx.stx_mask & STATX_BTIME )
+                            retVal.fBirthTime = toMSecs( stx.stx_btime.tv_sec, stx.stx_btime.tv_nsec );
+                        return retVal;
+                    }
+                    if ( errno != ENOSYS )
+                        return retVal;
+
+                    // a kernel without statx
+                    struct stat st;
+                    if ( ( followSymLinks ? ::stat( nativePath.constData(), &st ) : ::lstat( nativePath.constData(), &st ) ) == 0 )
+                        fromStat( st, retVal );
+                    return retVal;
+                }
+#endif
+                QFileInfo fi( path );
+                if ( !fi.exists() && !( !followSymLinks && fi.isSymLink() ) )
+                    return retVal;
+
+                auto isLink = !followSymLinks && fi.isSymLink();
+                retVal.fExists = true;
+                retVal.fIsFile = !isLink && fi.isFile();
+                retVal.fIsDir = !isLink && fi.isDir();
+                retVal.fIsSymLink = isLink;
+                auto permissions = fi.permissions();
+                retVal.fPermissions = ( permissions.testFlag( QFile::ReadOwner ) ? 0400 : 0 ) | ( permissions.testFlag( QFile::WriteOwner ) ? 0200 : 0 ) | ( permissions.testFlag( QFile::ExeOwner ) ? 0100 : 0 )
+                                      | ( permissions.testFlag( QFile::ReadGroup ) ? 0040 : 0 ) | ( permissions.testFlag( QFile::WriteGroup ) ? 0020 : 0 ) | ( permissions.testFlag( QFile::ExeGroup ) ? 0010 : 0 )
+                                      | ( permissions.testFlag( QFile::ReadOther ) ? 0004 : 0 ) | ( permissions.testFlag( QFile::WriteOther ) ? 0002 : 0 ) | ( permissions.testFlag( QFile::ExeOther ) ? 0001 : 0 );
+                retVal.fSize = fi.size();
+                auto msecs = []( const QDateTime &dt ) { return dt.isValid() ? dt.toMSecsSinceEpoch() : SFileStat::kUnknownTime; };
+                retVal.fAccessTime = msecs( fi.fileTime( QFileDevice::FileAccessTime ) );
+                retVal.fModificationTime = msecs( fi.fileTime( QFileDevice::FileModificationTime ) );
+                retVal.fMetadataChangeTime = msecs( fi.fileTime( QFileDevice::FileMetadataChangeTime ) );
+                retVal.fBirthTime = msecs( fi.fileTime( QFileDevice::FileBirthTime ) );
+                return retVal;
+            }
+        }
+
+        SFileStat fileStat( const QString &path, bool followSymLinks )
+        {
+            return statPath( path, followSymLinks );
+        }
+
+        std::vector< SFileStat > fileStats( const QStringList &paths, bool followSymLinks, int maxThreads )
+        {
+            std::vector< SFileStat > retVal( paths.size() );
+
+            parallelFor< qsizetype >( paths.size(), 256, maxThreads, [ &paths, &retVal, followSymLinks ]( qsizetype ii ) { retVal[ ii ] = statPath( paths[ ii ], followSymLinks ); } );
+            return retVal;
+        }
+    }
+}
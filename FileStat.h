@@ -0,0 +1,73 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __FILESTAT_H
+#define __FILESTAT_H
+
+#include "SABUtilsExport.h"
+
+#include <QDateTime>
+#include <QFileDevice>
+#include <QStringList>
+
+#include <cstdint>
+#include <limits>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace NSABUtils
+{
+    namespace NFileUtils
+    {
+        // everything the file helpers read from a file, filled by one statx call on linux (one QFileInfo elsewhere)
+        // the times are milliseconds since the epoch, the same resolution QFileInfo reports
+        struct SABUTILS_EXPORT SFileStat
+        {
+            static constexpr int64_t kUnknownTime{ std::numeric_limits< int64_t >::min() };
+
+            bool exists() const { return fExists; }
+            QDateTime fileTime( QFileDevice::FileTime whichTime ) const;   // invalid when the file system does not record it
+            std::unordered_map< QFileDevice::FileTime, QDateTime > timeStamps( const std::list< QFileDevice::FileTime > &timeStampsToGet ) const;
+
+            bool fExists{ false };
+            bool fIsFile{ false };
+            bool fIsDir{ false };
+            bool fIsSymLink{ false };   // only when the link is not followed
+            uint32_t fPermissions{ 0 };   // the unix 07777 bits
+            uint64_t fSize{ 0 };
+            uint64_t fInode{ 0 };   // 0 when not known
+            uint64_t fDevice{ 0 };
+            uint64_t fAttributes{ 0 };   // STATX_ATTR_xxx on linux
+            int64_t fAccessTime{ kUnknownTime };
+            int64_t fModificationTime{ kUnknownTime };
+            int64_t fMetadataChangeTime{ kUnknownTime };
+            int64_t fBirthTime{ kUnknownTime };
+        };
+
+        SABUTILS_EXPORT SFileStat fileStat( const QString &path, bool followSymLinks = true );
+        // the paths are stat'ed on a pool of threads (large batches only), the results are in the order of paths
+        SABUTILS_EXPORT std::vector< SFileStat > fileStats( const QStringList &paths, bool followSymLinks = true, int maxThreads = 0 );
+    }
+}
+
+#endif
@@ -21,10 +21,12 @@
 // SOFTWARE.
 
 #include "FileUtils.h"
+#include "ContentSniff.h"
 #include "MoveToTrash.h"
 #include "StringUtils.h"
 #include "utils.h"
 #include "WindowsError.h"
+#include "DirReader.h"
 
 #include <Qt>
 #include <QDebug>
@@ -47,9 +49,11 @@
 #else
     #include <wordexp.h>
     #include <sys/stat.h>
+    #include <unistd.h>
 #endif
 
 #include <map>
+#include <set>
 #include <cctype>
 #pragma comment( lib, "version.lib" )
 
@@ -133,13 +137,14 @@ namespace NSABUtils
             if ( pattern.empty() || filename.empty() )
                 return false;
 
+            static const QRegularExpression sSeparators( "[\\\\/]" );
             QString qPattern = QString::fromStdString( pattern );
-            auto patternList = qPattern.split( QRegularExpression( "[\\\\/]" ), NStringUtils::TSkipEmptyParts );
+            auto patternList = qPattern.split( sSeparators, NStringUtils::TSkipEmptyParts );
             if ( patternList.isEmpty() )
                 return false;
 
             QString qFileName = QString::fromStdString( filename );
-            auto fileNameList = qFileName.split( QRegularExpression( "[\\\\/]" ), NStringUtils::TSkipEmptyParts );
+            auto fileNameList = qFileName.split( sSeparators, NStringUtils::TSkipEmptyParts );
             if ( fileNameList.isEmpty() )
                 return false;
 
@@ -163,6 +168,16 @@ namespace NSABUtils
             return matches;
         }
 
+        bool extCompare( const CPathPatternSet &patterns, const std::string &extension )
+        {
+            return patterns.matchesExtension( QString::fromStdString( extension ) );
+        }
+
+        bool fileCompare( const CPathPatternSet &patterns, const std::string &filename )
+        {
+            return patterns.matchesPath( QString::fromStdString( filename ) );
+        }
+
         bool isRelativePath( const std::string &relPath )
         {
             if ( relPath.empty() )
@@ -246,12 +261,12 @@ namespace NSABUtils
 #endif
         }
 
-        bool isBinaryFile( const std::string &fileName )   // if any char in the first 100 characters is non std::isprint return true
+        bool isBinaryFile( const std::string &fileName )
         {
             return isBinaryFile( fileName, std::string() );
         }
 
-        bool isBinaryFile( const std::string &fileName, const std::string &relToDir )   // if any char in the first 100 characters is non std::isprint return true
+        bool isBinaryFile( const std::string &fileName, const std::string &relToDir )
         {
             auto fullPath = fileName;
             if ( isRelativePath( fileName ) && !relToDir.empty() )
@@ -259,29 +274,7 @@ namespace NSABUtils
                 fullPath = relToDir + "/" + fullPath;
             }
 
-            std::ifstream ifs( fullPath, std::ios::binary | std::ios::in );
-            if ( !ifs.is_open() )
-                return false;
-
-            size_t chNum = 0;
-            char ch;
-            while ( ifs.get( ch ) && !ifs.eof() && ifs.good() )
-            {
-                auto uch = static_cast< unsigned char >( ch );
-                bool isAsciiChar = ( ( uch >= 9 ) && ( uch <= 13 ) );
-                isAsciiChar = isAsciiChar || ( ( uch >= 32 ) && ( uch <= 126 ) );
-                isAsciiChar = isAsciiChar || ( ( uch >= 128 ) /*&& ( ch <= 255 )*/ );
-
-                if ( !isAsciiChar )
-                {
-                    ifs.close();
-                    return true;
-                }
-                if ( chNum++ > 500 )
-                    break;
-            }
-            ifs.close();
-            return false;
+            return sniffFile( QString::fromStdString( fullPath ), 512 ).fIsBinary;
         }
 
         QString expandEnvVars( const QString &fileName, std::set< QString > *envVars )
@@ -371,8 +364,13 @@ namespace NSABUtils
 
         bool compareTimeStamp( const QFileInfo &lhs, const QFileInfo &rhs, int toleranceInSecs, const std::list< QFileDevice::FileTime > timeStampsToCheck )
         {
-            auto lhsTimeStamps = timeStamps( lhs.absoluteFilePath(), timeStampsToCheck );
-            auto rhsTimeStamps = timeStamps( rhs.absoluteFilePath(), timeStampsToCheck );
+            return compareTimeStamp( fileStat( lhs.absoluteFilePath() ), fileStat( rhs.absoluteFilePath() ), toleranceInSecs, timeStampsToCheck );
+        }
+
+        bool compareTimeStamp( const SFileStat &lhs, const SFileStat &rhs, int toleranceInSecs, const std::list< QFileDevice::FileTime > &timeStampsToCheck )
+        {
+            auto lhsTimeStamps = lhs.timeStamps( timeStampsToCheck );
+            auto rhsTimeStamps = rhs.timeStamps( timeStampsToCheck );
             if ( lhsTimeStamps.size() != rhsTimeStamps.size() )
                 return false;
             for ( auto &&ii : lhsTimeStamps )
@@ -631,9 +629,13 @@ namespace NSABUtils
                 }
             }
 
-            if ( !QFile::copy( QString::fromStdString( from ), QString::fromStdString( to ) ) )
+            // the same as the QFile::copy this used to be, the copy gets the current time
+            SCopyOptions options;
+            options.fPreserveTimeStamps = false;
+            QString msg;
+            if ( !copyFile( QString::fromStdString( from ), QString::fromStdString( to ), options, &msg ) )
             {
-                fprintf( stderr, "Error copying file '%s' to '%s'\n", from.c_str(), to.c_str() );
+                fprintf( stderr, "Error copying file '%s' to '%s': %s\n", from.c_str(), to.c_str(), qPrintable( msg ) );
                 return false;
             }
             return true;
@@ -835,21 +837,61 @@ namespace NSABUtils
 
         bool copy( const std::string &fileName, const std::string &newFileName )
         {
-            return QFile::copy( QString::fromStdString( fileName ), QString::fromStdString( newFileName ) );
+            // the same as the QFile::copy this used to be, the copy gets the current time
+            SCopyOptions options;
+            options.fPreserveTimeStamps = false;
+            return copyFile( QString::fromStdString( fileName ), QString::fromStdString( newFileName ), options );
         }
 
+#ifdef Q_OS_LINUX
+        namespace
+        {
+            // readable, non hidden sub directories, links to directories are followed
+            // each directory is read once, a link back to a directory already read (a loop) is listed but not read again
+            void getSubDirsNative( int parentFD, const char *name, const std::string &path, bool recursive, std::set< std::pair< dev_t, ino_t > > &visited, std::list< std::string > &retVal )
+            {
+                CDirReader reader( parentFD, name, true );
+                if ( !reader.isOpen() )
+                    return;
+
+                struct stat st;
+                if ( ( ::fstat( reader.fd(), &st ) != 0 ) || !visited.emplace( st.st_dev, st.st_ino ).second )
+                    return;
+
+                CDirReader::SEntry entry;
+                while ( reader.next( entry ) )
+                {
+                    if ( entry.fName[ 0 ] == '.' )
+                        continue;
+                    if ( reader.type( entry, true ) != EDirEntryType::eDir )
+                        continue;
+                    if ( ::faccessat( reader.fd(), entry.fName, R_OK, 0 ) != 0 )
+                        continue;
+
+                    auto subDir = ( ( path == "/" ) ? path : ( path + "/" ) ) + entry.fName;
+                    retVal.push_back( subDir );
+                    if ( recursive )
+                        getSubDirsNative( reader.fd(), entry.fName, subDir, true, visited, retVal );
+                }
+            }
+        }
+#endif
+
         std::list< std::string > getSubDirs( const std::string &dirString, bool recursive, bool includeTopDir )
         {
             QDir dir( QString::fromStdString( dirString ) );
             if ( !dir.exists() )
                 return std::list< std::string >();
 
-            QDirIterator::IteratorFlags flags = QDirIterator::FollowSymlinks | QDirIterator::Subdirectories;
-
             std::list< std::string > retVal;
             if ( includeTopDir )
                 retVal = { dirString };
-            QDirIterator di( dir.absolutePath(), QDir::AllDirs | QDir::NoDotAndDotDot | QDir::Readable, flags );
+#ifdef Q_OS_LINUX
+            auto absPath = dir.absolutePath();
+            std::set< std::pair< dev_t, ino_t > > visited;
+            getSubDirsNative( AT_FDCWD, QFile::encodeName( absPath ).constData(), QFile::encodeName( absPath ).toStdString(), recursive, visited, retVal );
+#else
+            QDirIterator di( dir.absolutePath(), QDir::AllDirs | QDir::NoDotAndDotDot | QDir::Readable, QDirIterator::FollowSymlinks );
             while ( di.hasNext() )
             {
                 QString str = di.next();
@@ -860,6 +902,7 @@ namespace NSABUtils
                     retVal.insert( retVal.end(), subs.begin(), subs.end() );
                 }
             }
+#endif
             return retVal;
         }
 
@@ -1183,27 +1226,17 @@ namespace NSABUtils
 
         QDateTime timeStamp( const QString &path, QFileDevice::FileTime whichTimeStamp )
         {
-            auto fi = QFileInfo( path );
-            if ( !fi.exists() )
-                return {};
-            return fi.fileTime( whichTimeStamp );
+            return fileStat( path ).fileTime( whichTimeStamp );
         }
 
         std::unordered_map< QFileDevice::FileTime, QDateTime > timeStamps( const QString &path, const std::list< QFileDevice::FileTime > &timeStampsToGet )
         {
-            auto fi = QFileInfo( path );
-            if ( !fi.exists() )
-                return {};
-            std::unordered_map< QFileDevice::FileTime, QDateTime > retVal;
-
-            for ( auto &&ii : timeStampsToGet )
-            {
-                auto currTime = fi.fileTime( ii );
-                // qDebug() << "AccessTime: " << currTime;
-                retVal[ ii ] = currTime;
-            }
+            return fileStat( path ).timeStamps( timeStampsToGet );
+        }
 
-            return retVal;
+        std::unordered_map< QFileDevice::FileTime, QDateTime > timeStamps( const SFileStat &stat, const std::list< QFileDevice::FileTime > &timeStampsToGet )
+        {
+            return stat.timeStamps( timeStampsToGet );
         }
 
         std::unordered_map< QFileDevice::FileTime, QDateTime > timeStamps( const QString &path )
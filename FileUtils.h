@@ -24,6 +24,8 @@
 #define __FILEUTILS_H
 
 #include "SABUtilsExport.h"
+#include "PathPatternSet.h"
+#include "FileStat.h"
 
 #include <string>
 #include <list>
@@ -35,6 +37,9 @@
 #include <QFileDevice>
 #include <QList>
 #include <functional>
+#include <atomic>
+#include <memory>
+#include <vector>
 
 class QFileInfo;
 class QDateTime;
@@ -48,6 +53,8 @@ namespace NSABUtils
         SABUTILS_EXPORT void extractFilePath( const std::string &pathName, std::string *dirPath = nullptr, std::string *fileName = nullptr, std::string *ext = nullptr );
         SABUTILS_EXPORT bool extCompare( const std::string &pattern, const std::string &extension, bool wildcards );
         SABUTILS_EXPORT bool fileCompare( const std::string &pattern, const std::string &filename, bool wildcards );
+        SABUTILS_EXPORT bool extCompare( const CPathPatternSet &patterns, const std::string &extension );   // patterns built with EPatternType::eExtension
+        SABUTILS_EXPORT bool fileCompare( const CPathPatternSet &patterns, const std::string &filename );
 
         SABUTILS_EXPORT std::string changeExtension( const std::string &pathName, const std::string &newExt );
         SABUTILS_EXPORT bool isAbsPath( const std::string &pathName );
@@ -90,8 +97,8 @@ namespace NSABUtils
         SABUTILS_EXPORT std::list< std::string > getDirsFromPath( const std::string &searchPath );
         SABUTILS_EXPORT std::string getPathFromDirs( const std::list< std::string > &dirs );
 
-        SABUTILS_EXPORT bool isBinaryFile( const std::string &fileName );   // if any char in the first 100 characters is non std::isprint return true
-        SABUTILS_EXPORT bool isBinaryFile( const std::string &fileName, const std::string &relToDir );   // if any char in the first 100 characters is non std::isprint return true
+        SABUTILS_EXPORT bool isBinaryFile( const std::string &fileName );   // if any char in the first 512 characters is a control character other than white space, see sniffContent
+        SABUTILS_EXPORT bool isBinaryFile( const std::string &fileName, const std::string &relToDir );   // a file with a UTF-16 or UTF-32 BOM is text
 
         // searches for environmental vars inside filenames of the form
         // $foo or %foo% \$foo \%foo\%
@@ -107,6 +114,7 @@ namespace NSABUtils
 
         SABUTILS_EXPORT std::unordered_map< QFileDevice::FileTime, QDateTime > timeStamps( const QString &path, const std::list< QFileDevice::FileTime > &timeStampsToGet );
         SABUTILS_EXPORT std::unordered_map< QFileDevice::FileTime, QDateTime > timeStamps( const QString &path );
+        SABUTILS_EXPORT std::unordered_map< QFileDevice::FileTime, QDateTime > timeStamps( const SFileStat &stat, const std::list< QFileDevice::FileTime > &timeStampsToGet );   // no further system calls
         SABUTILS_EXPORT QDateTime timeStamp( const QString &path, QFileDevice::FileTime = QFileDevice::FileTime::FileModificationTime );
         SABUTILS_EXPORT QDateTime oldestTimeStamp( const QString &path );   // returns the oldest time based on QFile Device::FileTime types
         SABUTILS_EXPORT bool setTimeStamp( const QString &path, const QFileInfo &srcPath, QString *msg = nullptr );   // uses the ts info on srcPath setting it on path for all filetimes
@@ -136,10 +144,156 @@ namespace NSABUtils
         SABUTILS_EXPORT bool compareTimeStamp( const QDateTime &lhs, const QDateTime &rhs, int toleranceInSecs );
         SABUTILS_EXPORT bool compareTimeStamp( const QFileInfo &lhs, const QFileInfo &rhs, int toleranceInSecs, QFileDevice::FileTime timeToCheck );
         SABUTILS_EXPORT bool compareTimeStamp( const QFileInfo &lhs, const QFileInfo &rhs, int toleranceInSecs, const std::list< QFileDevice::FileTime > timeStampsToCheck );
+        SABUTILS_EXPORT bool compareTimeStamp( const SFileStat &lhs, const SFileStat &rhs, int toleranceInSecs, const std::list< QFileDevice::FileTime > &timeStampsToCheck );   // no further system calls
 
         SABUTILS_EXPORT QString getCorrectPathCase( QString path );   // note, on linux returns path, windows does the actual analysis, and returns the absolute path
 
+        // shared between copies, cancel from any thread
+        class SABUTILS_EXPORT CCancelToken
+        {
+        public:
+            CCancelToken() :
+                fCanceled( std::make_shared< std::atomic< bool > >( false ) )
+            {
+            }
+
+            void cancel() { *fCanceled = true; }
+            bool isCanceled() const { return *fCanceled; }
+
+        private:
+            std::shared_ptr< std::atomic< bool > > fCanceled;
+        };
+
+        struct SABUTILS_EXPORT SFindAllFilesOptions
+        {
+            QStringList fNameFilters;   // applied to files only, empty matches all, compiled into a CPathPatternSet once per walk
+            CPathPatternSet fNamePatterns;   // when not empty, used instead of fNameFilters, for callers that walk repeatedly with the same filters
+            bool fRecursive{ true };
+            bool fSortByName{ false };   // the files of a directory by name, then each sub directory by name, identical to the single threaded walk
+            int fMaxThreads{ 0 };   // 0 uses QThread::idealThreadCount(), 1 walks on the calling thread only
+            std::function< bool( const QDir &dir ) > fSkipDir;
+            std::function< bool( const QFileInfo &file ) > fSkipFile;
+            bool fCallbacksThreadSafe{ false };   // when false, the skip functions are never called concurrently (they may still be called from a worker thread)
+            bool fUseNativeEnumeration{ true };   // linux only, reads the directories with getdents64 rather than QDir, the QFileInfos are not stat'ed until used
+
+            CCancelToken fCancelToken;   // stops the walk, findAllFiles returns what was found so far
+            int fMaxResults{ 0 };   // 0 is unlimited, the walk stops once this many files are found (with fSortByName, the files found are sorted, not the first files of the sorted walk)
+            int fMaxQueuedFiles{ 4096 };   // CFileEnumerator and visitAllFiles only, the walk waits when the consumer falls this far behind
+        };
+
+        // sub directories are walked in parallel, each worker thread takes new directories from its own queue
+        // and steals from the other workers when it runs out
+        // returns std::nullopt when the directory does not exist or is skipped
+        SABUTILS_EXPORT std::optional< QList< QFileInfo > > findAllFiles( const QDir &dir, const SFindAllFilesOptions &options, QString *errorMsg = nullptr );
+        // when skipDir or skipFile is given the walk stays on the calling thread, as it always did
         SABUTILS_EXPORT std::optional< QList< QFileInfo > > findAllFiles( const QDir &dir, const QStringList &nameFilters, bool recursive, bool sortByName = false, QString *errorMsg = nullptr, std::function< bool( const QDir &dir ) > skipDir = {}, std::function< bool( const QFileInfo &file ) > skipFile = {} );
+
+        // streams the files as they are found, the walk runs on background threads and stays at most fMaxQueuedFiles ahead of next()
+        // with fSortByName the files of each directory are sorted, but the directories arrive in the order they are walked
+        class CFileEnumeratorImpl;
+        class SABUTILS_EXPORT CFileEnumerator
+        {
+        public:
+            CFileEnumerator( const QDir &dir, const SFindAllFilesOptions &options );
+            ~CFileEnumerator();   // cancels and waits for the walk
+
+            CFileEnumerator( const CFileEnumerator & ) = delete;
+            CFileEnumerator &operator=( const CFileEnumerator & ) = delete;
+
+            std::optional< QFileInfo > next();   // blocks until a file is found, std::nullopt when the walk is finished, canceled or fMaxResults is reached
+            void cancel();
+
+            bool aOK() const;   // false when the directory does not exist or is skipped
+            QString errorMsg() const;
+            int numFound() const;   // returned by next so far
+
+        private:
+            std::unique_ptr< CFileEnumeratorImpl > fImpl;
+        };
+
+        // calls visitor on the calling thread for each file as it is found, return false from the visitor to stop
+        // returns false when the directory does not exist or is skipped
+        SABUTILS_EXPORT bool visitAllFiles( const QDir &dir, const SFindAllFilesOptions &options, const std::function< bool( const QFileInfo &file ) > &visitor, QString *errorMsg = nullptr );
+
+        enum class ECopyMethod
+        {
+            eNone,
+            eReflink,   // FICLONE, the destination shares the source blocks until either is written
+            eCopyFileRange,   // copied inside the kernel
+            eSendFile,
+            eReadWrite   // through a fBufferSize user space buffer
+        };
+
+        struct SABUTILS_EXPORT SCopyProgress
+        {
+            QString fFrom;   // the file that last reported
+            QString fTo;
+            uint64_t fBytesCopied{ 0 };   // all files
+            uint64_t fTotalBytes{ 0 };
+            int fFilesCopied{ 0 };
+            int fTotalFiles{ 0 };
+            double fBytesPerSecond{ 0.0 };
+        };
+
+        struct SABUTILS_EXPORT SCopyOptions
+        {
+            bool fOverwrite{ false };   // when false, copying onto an existing file fails the same as QFile::copy
+            bool fPreserveTimeStamps{ true };
+            bool fAllowReflink{ true };
+            bool fAllowKernelCopy{ true };   // copy_file_range and sendfile
+            size_t fBufferSize{ 4 * 1024 * 1024 };
+            int fMaxThreads{ 0 };   // copyFiles only, 0 uses QThread::idealThreadCount()
+            CCancelToken fCancelToken;   // the file being copied is removed
+            std::function< void( const SCopyProgress &progress ) > fProgressFunc;   // called on the copying threads, never concurrently
+            int fProgressIntervalMS{ 250 };   // the final report is always made
+        };
+
+        struct SABUTILS_EXPORT SCopyResult
+        {
+            QString fFrom;
+            QString fTo;
+            bool fAOK{ false };
+            QString fErrorMsg;
+            ECopyMethod fMethod{ ECopyMethod::eNone };
+            uint64_t fBytes{ 0 };
+        };
+
+        // on linux tries a reflink, then copy_file_range, then sendfile, then a large buffer read/write
+        // a partially written destination is removed, copying a file onto itself (by any name) fails and leaves it untouched
+        // the destination gets the permissions of the source, whether it is created or overwritten
+        SABUTILS_EXPORT bool copyFile( const QString &from, const QString &to, const SCopyOptions &options, QString *msg = nullptr, ECopyMethod *method = nullptr );
+        // the files are copied on a bounded pool, the results are in the order of files
+        SABUTILS_EXPORT std::vector< SCopyResult > copyFiles( const std::vector< std::pair< QString, QString > > &files, const SCopyOptions &options );
+
+        struct SRecycleOptions;
+        struct SABUTILS_EXPORT SRemoveError
+        {
+            QString fPath;
+            QString fErrorMsg;
+        };
+
+        struct SABUTILS_EXPORT SRemoveOptions
+        {
+            bool fRemoveTopDir{ true };   // when false, only the contents of the directories are removed
+            int fMaxThreads{ 0 };   // 0 uses QThread::idealThreadCount(), sub directories are removed in parallel
+            CCancelToken fCancelToken;   // what has been removed stays removed
+            std::function< void( uint64_t numRemoved, uint64_t numErrors ) > fProgressFunc;   // called on the removing threads, never concurrently
+            int fProgressIntervalMS{ 250 };   // the final report is always made
+            std::shared_ptr< SRecycleOptions > fRecycleOptions;   // when set, each path is moved to the trash, and only removed when that fails and fDeleteOnRecycleFailure is set
+        };
+
+        struct SABUTILS_EXPORT SRemoveResult
+        {
+            bool fAOK{ true };   // false on any error or when canceled
+            bool fCanceled{ false };
+            uint64_t fNumRemoved{ 0 };   // files, links and directories
+            std::list< SRemoveError > fErrors;   // every path that could not be removed, a directory that is not empty because of them is not listed
+        };
+
+        // keeps going after an error, paths that do not exist are not errors
+        // on linux the directories are read with getdents64 and removed with unlinkat, symbolic links are removed, never followed
+        SABUTILS_EXPORT SRemoveResult removePaths( const QStringList &paths, const SRemoveOptions &options = {} );
+
         SABUTILS_EXPORT bool isIPAddressNetworkPath( const QFileInfo &info );
 
         SABUTILS_EXPORT std::tuple< uint16_t, uint16_t, uint16_t, uint16_t > getVersionInfoFromFile( const QString &fileName, bool &aOK );
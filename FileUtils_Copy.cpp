@@ -0,0 +1,447 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "FileUtils.h"
+#include "ParallelFor.h"
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+#ifdef Q_OS_LINUX
+    #include <cerrno>
+    #include <cstring>
+    #include <fcntl.h>
+    #include <linux/fs.h>
+    #include <sys/ioctl.h>
+    #include <sys/sendfile.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace NSABUtils
+{
+    namespace NFileUtils
+    {
+        namespace
+        {
+            // shared by every file of a copy, reports at most every fProgressIntervalMS
+            class CCopyProgress
+            {
+            public:
+                CCopyProgress( const SCopyOptions &options, uint64_t totalBytes, int totalFiles ) :
+                    fOptions( options ),
+                    fTotalBytes( totalBytes ),
+                    fTotalFiles( totalFiles )
+                {
+                    fTimer.start();
+                }
+
+                bool canceled() const { return fOptions.fCancelToken.isCanceled(); }
+
+                void addBytes( const QString &from, const QString &to, uint64_t bytes )
+                {
+                    fBytesCopied += bytes;
+                    if ( !fOptions.fProgressFunc )
+                        return;
+
+                    auto now = fTimer.elapsed();
+                    auto last = fLastReport.load();
+                    if ( ( now - last ) < fOptions.fProgressIntervalMS )
+                        return;
+                    if ( fLastReport.compare_exchange_strong( last, now ) )
+                        report( from, to );
+                }
+
+                void fileFinished() { fFilesCopied++; }
+
+                void finished( const QString &from, const QString &to )
+                {
+                    if ( fOptions.fProgressFunc )
+                        report( from, to );
+                }
+
+            private:
+                void report( const QString &from, const QString &to )
+                {
+                    std::lock_guard< std::mutex > lock( fMutex );
+
+                    SCopyProgress progress;
+                    progress.fFrom = from;
+                    progress.fTo = to;
+                    progress.fBytesCopied = fBytesCopied;
+                    progress.fTotalBytes = fTotalBytes;
+                    progress.fFilesCopied = fFilesCopied;
+                    progress.fTotalFiles = fTotalFiles;
+                    auto elapsed = fTimer.elapsed();
+                    if ( elapsed > 0 )
+                        progress.fBytesPerSecond = ( 1000.0 * progress.fBytesCopied ) / elapsed;
+                    fOptions.fProgressFunc( progress );
+                }
+
+                const SCopyOptions &fOptions;
+                uint64_t fTotalBytes{ 0 };
+                int fTotalFiles{ 0 };
+                QElapsedTimer fTimer;
+                std::atomic< uint64_t > fBytesCopied{ 0 };
+                std::atomic< int > fFilesCopied{ 0 };
+                std::atomic< int64_t > fLastReport{ 0 };
+                std::mutex fMutex;
+            };
+
+            QString canceledMsg( const QString &from )
+            {
+                return QObject::tr( "Copy of '%1' was canceled" ).arg( from );
+            }
+
+            // through QFile, used when not on linux and for resources
+            bool qtCopyData( const QString &from, const QString &to, const SCopyOptions &options, CCopyProgress &progress, ECopyMethod *method, QString *msg )
+            {
+                QFile src( from );
+                if ( !src.open( QIODevice::ReadOnly ) )
+                {
+                    *msg = QObject::tr( "Could not open '%1': %2" ).arg( from ).arg( src.errorString() );
+                    return false;
+                }
+
+                if ( !options.fOverwrite && QFileInfo::exists( to ) )
+                {
+                    *msg = QObject::tr( "Could not create '%1': %2" ).arg( to ).arg( QObject::tr( "File exists" ) );
+                    return false;
+                }
+                if ( QFileInfo( from ) == QFileInfo( to ) )   // truncating the destination would empty the source
+                {
+                    *msg = QObject::tr( "Could not copy '%1' onto '%2': they are the same file" ).arg( from ).arg( to );
+                    return false;
+                }
+
+                QFile dst( to );
+                if ( !dst.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+                {
+                    *msg = QObject::tr( "Could not create '%1': %2" ).arg( to ).arg( dst.errorString() );
+                    return false;
+                }
+
+                *method = ECopyMethod::eReadWrite;
+                std::vector< char > buffer( std::max< size_t >( options.fBufferSize, 64 * 1024 ) );
+                auto aOK = true;
+                while ( aOK )
+                {
+                    if ( progress.canceled() )
+                    {
+                        *msg = canceledMsg( from );
+                        aOK = false;
+                        break;
+                    }
+
+                    auto numRead = src.read( buffer.data(), buffer.size() );
+                    if ( numRead < 0 )
+                    {
+                        *msg = QObject::tr( "Could not read '%1': %2" ).arg( from ).arg( src.errorString() );
+                        aOK = false;
+                    }
+                    else if ( numRead == 0 )
+                        break;
+                    else if ( dst.write( buffer.data(), numRead ) != numRead )
+                    {
+                        *msg = QObject::tr( "Could not write '%1': %2" ).arg( to ).arg( dst.errorString() );
+                        aOK = false;
+                    }
+                    else
+                        progress.addBytes( from, to, numRead );
+                }
+
+                dst.close();
+                if ( aOK )
+                    dst.setPermissions( src.permissions() );
+                else
+                    dst.remove();
+                return aOK;
+            }
+
+#ifdef Q_OS_LINUX
+            QString errnoMsg( const QString &fmt, const QString &path, int error )
+            {
+                return fmt.arg( path ).arg( QString::fromLocal8Bit( strerror( error ) ) );
+            }
+
+            // each kernel call is limited so progress and cancel are checked between them
+            constexpr size_t kKernelChunk = 64 * 1024 * 1024;
+
+            // returns false on a hard error, an unsupported method leaves *supported false and nothing written
+            template< typename FuncType >
+            bool kernelCopy( FuncType func, uint64_t size, const QString &from, const QString &to, CCopyProgress &progress, bool *supported, QString *msg )
+            {
+                *supported = true;
+                uint64_t copied = 0;
+                while ( copied < size )
+                {
+                    if ( progress.canceled() )
+                    {
+                        *msg = canceledMsg( from );
+                        return false;
+                    }
+
+                    auto curr = func( std::min< uint64_t >( kKernelChunk, size - copied ) );
+                    if ( curr < 0 )
+                    {
+                        if ( errno == EINTR )
+                            continue;
+                        if ( ( copied == 0 ) && ( ( errno == EXDEV ) || ( errno == ENOSYS ) || ( errno == EINVAL ) || ( errno == EOPNOTSUPP ) ) )
+                        {
+                            *supported = false;
+                            return false;
+                        }
+                        *msg = errnoMsg( QObject::tr( "Could not copy '%1': %2" ), from, errno );
+                        return false;
+                    }
+                    if ( curr == 0 )
+                    {
+                        if ( copied == 0 )   // some virtual file systems report nothing copied rather than an error
+                        {
+                            *supported = false;
+                            return false;
+                        }
+                        break;   // the source was truncated while copying
+                    }
+                    copied += curr;
+                    progress.addBytes( from, to, curr );
+                }
+                return true;
+            }
+
+            bool readWriteCopy( int srcFD, int dstFD, size_t bufferSize, const QString &from, const QString &to, CCopyProgress &progress, QString *msg )
+            {
+                std::vector< char > buffer( std::max< size_t >( bufferSize, 64 * 1024 ) );
+                while ( true )
+                {
+                    if ( progress.canceled() )
+                    {
+                        *msg = canceledMsg( from );
+                        return false;
+                    }
+
+                    auto numRead = ::read( srcFD, buffer.data(), buffer.size() );
+                    if ( numRead < 0 )
+                    {
+                        if ( errno == EINTR )
+                            continue;
+                        *msg = errnoMsg( QObject::tr( "Could not read '%1': %2" ), from, errno );
+                        return false;
+                    }
+                    if ( numRead == 0 )
+                        return true;
+
+                    for ( ssize_t written = 0; written < numRead; )
+                    {
+                        auto curr = ::write( dstFD, buffer.data() + written, numRead - written );
+                        if ( curr < 0 )
+                        {
+                            if ( errno == EINTR )
+                                continue;
+                            *msg = errnoMsg( QObject::tr( "Could not write '%1': %2" ), to, errno );
+                            return false;
+                        }
+                        written += curr;
+                    }
+                    progress.addBytes( from, to, numRead );
+                }
+            }
+
+            bool copyData( const QString &from, const QString &to, const SCopyOptions &options, CCopyProgress &progress, ECopyMethod *method, QString *msg )
+            {
+                if ( from.startsWith( ':' ) )   // a resource
+                    return qtCopyData( from, to, options, progress, method, msg );
+
+                auto srcFD = ::open( QFile::encodeName( from ).constData(), O_RDONLY | O_CLOEXEC );
+                if ( srcFD < 0 )
+                {
+                    *msg = errnoMsg( QObject::tr( "Could not open '%1': %2" ), from, errno );
+                    return false;
+                }
+
+                struct stat srcStat;
+                if ( ( ::fstat( srcFD, &srcStat ) != 0 ) || !S_ISREG( srcStat.st_mode ) )
+                {
+                    *msg = QObject::tr( "'%1' is not a regular file" ).arg( from );
+                    ::close( srcFD );
+                    return false;
+                }
+
+                // never O_TRUNC, the destination may be the source under another name (a hard link, a bind mount or just another path)
+                auto flags = O_WRONLY | O_CREAT | O_CLOEXEC | ( options.fOverwrite ? 0 : O_EXCL );
+                auto dstFD = ::open( QFile::encodeName( to ).constData(), flags, srcStat.st_mode & 07777 );
+                if ( dstFD < 0 )
+                {
+                    *msg = errnoMsg( QObject::tr( "Could not create '%1': %2" ), to, errno );
+                    ::close( srcFD );
+                    return false;
+                }
+
+                struct stat dstStat;
+                if ( ::fstat( dstFD, &dstStat ) != 0 )
+                {
+                    *msg = errnoMsg( QObject::tr( "Could not create '%1': %2" ), to, errno );
+                    ::close( srcFD );
+                    ::close( dstFD );
+                    return false;
+                }
+                if ( ( dstStat.st_dev == srcStat.st_dev ) && ( dstStat.st_ino == srcStat.st_ino ) )
+                {
+                    *msg = QObject::tr( "Could not copy '%1' onto '%2': they are the same file" ).arg( from ).arg( to );
+                    ::close( srcFD );
+                    ::close( dstFD );
+                    return false;
+                }
+
+                // an existing file keeps its mode when opened, and a new one was created through the umask, either way match the source like QFile::copy
+                // the owner of an existing file may not be us, then it keeps its mode
+                [[maybe_unused]] auto chmodOK = ::fchmod( dstFD, srcStat.st_mode & 07777 );
+                if ( options.fOverwrite && ( ::ftruncate( dstFD, 0 ) != 0 ) )
+                {
+                    *msg = errnoMsg( QObject::tr( "Could not write '%1': %2" ), to, errno );
+                    ::close( srcFD );
+                    ::close( dstFD );
+                    return false;
+                }
+
+                uint64_t size = srcStat.st_size;
+                auto aOK = false;
+                auto done = false;
+                if ( options.fAllowReflink && ( ::ioctl( dstFD, FICLONE, srcFD ) == 0 ) )
+                {
+                    progress.addBytes( from, to, size );
+                    *method = ECopyMethod::eReflink;
+                    aOK = done = true;
+                }
+
+                if ( !done && options.fAllowKernelCopy )
+                {
+                    auto supported = false;
+                    aOK = kernelCopy( [ srcFD, dstFD ]( size_t len ) { return ::copy_file_range( srcFD, nullptr, dstFD, nullptr, len, 0 ); }, size, from, to, progress, &supported, msg );
+                    if ( supported )
+                    {
+                        *method = ECopyMethod::eCopyFileRange;
+                        done = true;
+                    }
+                    else
+                    {
+                        aOK = kernelCopy( [ srcFD, dstFD ]( size_t len ) { return ::sendfile( dstFD, srcFD, nullptr, len ); }, size, from, to, progress, &supported, msg );
+                        if ( supported )
+                        {
+                            *method = ECopyMethod::eSendFile;
+                            done = true;
+                        }
+                    }
+                }
+
+                if ( !done )
+                {
+                    aOK = readWriteCopy( srcFD, dstFD, options.fBufferSize, from, to, progress, msg );
+                    *method = ECopyMethod::eReadWrite;
+                }
+
+                ::close( srcFD );
+                if ( ( ::close( dstFD ) != 0 ) && aOK )
+                {
+                    *msg = errnoMsg( QObject::tr( "Could not write '%1': %2" ), to, errno );
+                    aOK = false;
+                }
+                if ( !aOK )
+                    ::unlink( QFile::encodeName( to ).constData() );
+                return aOK;
+            }
+#endif
+
+            bool copyOne( const QString &from, const QString &to, const SCopyOptions &options, CCopyProgress &progress, ECopyMethod *method, QString *msg )
+            {
+                if ( progress.canceled() )
+                {
+                    *msg = canceledMsg( from );
+                    return false;
+                }
+
+                std::unordered_map< QFileDevice::FileTime, QDateTime > srcTimeStamps;
+                if ( options.fPreserveTimeStamps )
+                    srcTimeStamps = timeStamps( from );
+
+#ifdef Q_OS_LINUX
+                auto aOK = copyData( from, to, options, progress, method, msg );
+#else
+                auto aOK = qtCopyData( from, to, options, progress, method, msg );
+#endif
+                if ( !aOK )
+                    return false;
+                progress.fileFinished();
+
+                if ( options.fPreserveTimeStamps && !setTimeStamps( to, srcTimeStamps, msg ) )
+                    return false;
+                return true;
+            }
+        }
+
+        bool copyFile( const QString &from, const QString &to, const SCopyOptions &options, QString *msg, ECopyMethod *method )
+        {
+            CCopyProgress progress( options, std::max< qint64 >( 0, QFileInfo( from ).size() ), 1 );
+
+            QString lclMsg;
+            ECopyMethod lclMethod = ECopyMethod::eNone;
+            auto aOK = copyOne( from, to, options, progress, &lclMethod, &lclMsg );
+            progress.finished( from, to );
+            if ( msg )
+                *msg = lclMsg;
+            if ( method )
+                *method = lclMethod;
+            return aOK;
+        }
+
+        std::vector< SCopyResult > copyFiles( const std::vector< std::pair< QString, QString > > &files, const SCopyOptions &options )
+        {
+            std::vector< SCopyResult > retVal( files.size() );
+            uint64_t totalBytes = 0;
+            for ( size_t ii = 0; ii < files.size(); ++ii )
+            {
+                retVal[ ii ].fFrom = files[ ii ].first;
+                retVal[ ii ].fTo = files[ ii ].second;
+                retVal[ ii ].fBytes = std::max< qint64 >( 0, QFileInfo( files[ ii ].first ).size() );
+                totalBytes += retVal[ ii ].fBytes;
+            }
+
+            CCopyProgress progress( options, totalBytes, static_cast< int >( files.size() ) );
+            parallelFor< std::size_t >( retVal.size(), 1, options.fMaxThreads,
+                [ &retVal, &options, &progress ]( std::size_t ii )
+                {
+                    auto &&curr = retVal[ ii ];
+                    curr.fAOK = copyOne( curr.fFrom, curr.fTo, options, progress, &curr.fMethod, &curr.fErrorMsg );
+                } );
+
+            if ( !files.empty() )
+                progress.finished( files.back().first, files.back().second );
+            return retVal;
+        }
+    }
+}
@@ -21,9 +21,29 @@
 // SOFTWARE.
 
 #include "FileUtils.h"
+#include "DirReader.h"
+#include "MoveToTrash.h"
 
 #include <QFileInfo>
 #include <QDir>
+#include <QElapsedTimer>
+#include <QThread>
+
+#include <mutex>
+
+#ifdef Q_OS_LINUX
+    #include <algorithm>
+    #include <cerrno>
+    #include <condition_variable>
+    #include <cstring>
+    #include <fcntl.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #include <string>
+    #include <thread>
+    #include <utility>
+    #include <vector>
+#endif
 
 namespace NSABUtils
 {
@@ -54,21 +74,381 @@ namespace NSABUtils
             }
             else if ( fi.isDir() )
             {
-                QDir dir( path );
-                success = dir.removeRecursively();
+                success = removePaths( { path } ).fAOK;
                 if ( !success && msg )
                     *msg = QObject::tr( "Could remove directory (recursively) '%1'" ).arg( path );
             }
             return success;
         }
 
+        namespace
+        {
+            // shared by every path being removed, reports at most every fProgressIntervalMS
+            class CRemoveProgress
+            {
+            public:
+                CRemoveProgress( const SRemoveOptions &options, SRemoveResult &result ) :
+                    fOptions( options ),
+                    fResult( result )
+                {
+                    fTimer.start();
+                }
+
+                bool canceled() const { return fOptions.fCancelToken.isCanceled(); }
+
+                void removed( uint64_t count = 1 )
+                {
+                    fNumRemoved += count;
+                    report( false );
+                }
+
+                void addError( const QString &path, const QString &errorMsg )
+                {
+                    {
+                        std::lock_guard< std::mutex > lock( fErrorMutex );
+                        fResult.fErrors.push_back( { path, errorMsg } );
+                    }
+                    fNumErrors++;
+                    report( false );
+                }
+
+                void finished()
+                {
+                    fResult.fNumRemoved = fNumRemoved;
+                    fResult.fCanceled = canceled();
+                    fResult.fAOK = fResult.fErrors.empty() && !fResult.fCanceled;
+                    report( true );
+                }
+
+            private:
+                void report( bool force )
+                {
+                    if ( !fOptions.fProgressFunc )
+                        return;
+
+                    auto now = fTimer.elapsed();
+                    auto last = fLastReport.load();
+                    if ( !force && ( ( ( now - last ) < fOptions.fProgressIntervalMS ) || !fLastReport.compare_exchange_strong( last, now ) ) )
+                        return;
+
+                    std::lock_guard< std::mutex > lock( fReportMutex );
+                    fOptions.fProgressFunc( fNumRemoved, fNumErrors );
+                }
+
+                const SRemoveOptions &fOptions;
+                SRemoveResult &fResult;
+                QElapsedTimer fTimer;
+                std::atomic< uint64_t > fNumRemoved{ 0 };
+                std::atomic< uint64_t > fNumErrors{ 0 };
+                std::atomic< int64_t > fLastReport{ 0 };
+                std::mutex fErrorMutex;
+                std::mutex fReportMutex;
+            };
+
+#ifdef Q_OS_LINUX
+            QString errnoMsg( const std::string &path, int error )
+            {
+                return QObject::tr( "Could not remove '%1': %2" ).arg( QFile::decodeName( path.c_str() ) ).arg( QString::fromLocal8Bit( strerror( error ) ) );
+            }
+
+            // a directory is removed once it has been read and each of its sub directories has been removed
+            // everything is opened and removed relative to the parent's fd, so a directory swapped for a symbolic link is never followed
+            struct SDirNode
+            {
+                ~SDirNode()
+                {
+                    closeFD();
+                    if ( !fParent && ( fParentFD >= 0 ) )
+                        ::close( fParentFD );   // the top directories own their parent's fd
+                }
+
+                void closeFD()
+                {
+                    if ( fFD >= 0 )
+                        ::close( fFD );
+                    fFD = -1;
+                }
+
+                std::string fPath;   // for messages only
+                std::string fName;   // relative to fParentFD
+                std::shared_ptr< SDirNode > fParent;
+                int fParentFD{ -1 };   // the parent's fFD, which stays open until its last sub directory is released
+                int fFD{ -1 };   // only kept open while sub directories are waiting on it
+                bool fRemoveSelf{ true };
+                std::atomic< int > fPending{ 1 };   // reading this directory, plus one for each sub directory
+                std::atomic< bool > fFailed{ false };   // something below could not be removed, so neither can this
+            };
+
+            // the directories are read by a pool of threads from a shared stack, files are unlinked relative to the open directory
+            class CParallelRemover
+            {
+            public:
+                CParallelRemover( const SRemoveOptions &options, CRemoveProgress &progress ) :
+                    fOptions( options ),
+                    fProgress( progress )
+                {
+                }
+
+                void addDir( const std::string &path, bool removeSelf )
+                {
+                    auto node = std::make_shared< SDirNode >();
+                    node->fPath = path;
+                    node->fRemoveSelf = removeSelf;
+
+                    auto pos = path.find_last_of( '/' );
+                    auto parent = ( pos == std::string::npos ) ? std::string( "." ) : ( pos == 0 ) ? std::string( "/" ) : path.substr( 0, pos );
+                    node->fName = ( pos == std::string::npos ) ? path : path.substr( pos + 1 );
+                    if ( node->fName.empty() )
+                        node->fName = ".";
+                    node->fParentFD = ::open( parent.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+                    if ( node->fParentFD < 0 )
+                    {
+                        fProgress.addError( QFile::decodeName( path.c_str() ), errnoMsg( path, errno ) );
+                        return;
+                    }
+                    push( node );
+                }
+
+                void run()
+                {
+                    auto numThreads = ( fOptions.fMaxThreads > 0 ) ? fOptions.fMaxThreads : QThread::idealThreadCount();
+                    numThreads = std::max( 1, numThreads );
+                    std::vector< std::thread > threads;
+                    for ( int ii = 1; ii < numThreads; ++ii )
+                        threads.emplace_back( [ this ]() { worker(); } );
+                    worker();
+                    for ( auto &&ii : threads )
+                        ii.join();
+                }
+
+            private:
+                void push( const std::shared_ptr< SDirNode > &node )
+                {
+                    {
+                        std::lock_guard< std::mutex > lock( fMutex );
+                        fStack.push_back( node );
+                        fOutstanding++;
+                    }
+                    fCondition.notify_one();
+                }
+
+                void worker()
+                {
+                    while ( true )
+                    {
+                        std::shared_ptr< SDirNode > node;
+                        {
+                            std::unique_lock< std::mutex > lock( fMutex );
+                            fCondition.wait( lock, [ this ]() { return !fStack.empty() || ( fOutstanding == 0 ); } );
+                            if ( fStack.empty() )
+                                return;
+                            node = fStack.back();
+                            fStack.pop_back();
+                        }
+
+                        process( node );
+
+                        bool allDone = false;
+                        {
+                            std::lock_guard< std::mutex > lock( fMutex );
+                            allDone = ( --fOutstanding == 0 );
+                        }
+                        if ( allDone )
+                            fCondition.notify_all();
+                    }
+                }
+
+                void process( const std::shared_ptr< SDirNode > &node )
+                {
+                    if ( fProgress.canceled() )
+                    {
+                        node->fFailed = true;
+                        release( node );
+                        return;
+                    }
+
+                    CDirReader reader( node->fParentFD, node->fName.c_str(), false );
+                    if ( !reader.isOpen() )
+                    {
+                        if ( reader.error() != ENOENT )
+                        {
+                            fProgress.addError( QFile::decodeName( node->fPath.c_str() ), errnoMsg( node->fPath, reader.error() ) );
+                            node->fFailed = true;
+                        }
+                        release( node );
+                        return;
+                    }
+
+                    // read the whole directory before removing anything, unlinking while reading can skip entries
+                    std::vector< std::pair< std::string, bool > > entries;
+                    CDirReader::SEntry entry;
+                    while ( reader.next( entry ) )
+                        entries.emplace_back( entry.fName, reader.type( entry, false ) == EDirEntryType::eDir );
+                    if ( reader.error() != 0 )
+                    {
+                        fProgress.addError( QFile::decodeName( node->fPath.c_str() ), errnoMsg( node->fPath, reader.error() ) );
+                        node->fFailed = true;
+                    }
+
+                    // the sub directories are opened relative to this one after the reader is gone
+                    if ( std::any_of( entries.begin(), entries.end(), []( const std::pair< std::string, bool > &ii ) { return ii.second; } ) )
+                    {
+                        node->fFD = ::fcntl( reader.fd(), F_DUPFD_CLOEXEC, 0 );
+                        if ( node->fFD < 0 )
+                        {
+                            fProgress.addError( QFile::decodeName( node->fPath.c_str() ), errnoMsg( node->fPath, errno ) );
+                            node->fFailed = true;
+                            release( node );
+                            return;
+                        }
+                    }
+
+                    uint64_t numRemoved = 0;
+                    for ( auto &&ii : entries )
+                    {
+                        if ( fProgress.canceled() )
+                        {
+                            node->fFailed = true;
+                            break;
+                        }
+
+                        auto path = node->fPath + "/" + ii.first;
+                        if ( ii.second )
+                        {
+                            auto child = std::make_shared< SDirNode >();
+                            child->fPath = path;
+                            child->fName = ii.first;
+                            child->fParent = node;
+                            child->fParentFD = node->fFD;
+                            node->fPending++;
+                            push( child );
+                        }
+                        else if ( ::unlinkat( reader.fd(), ii.first.c_str(), 0 ) == 0 )
+                            numRemoved++;
+                        else if ( errno != ENOENT )
+                        {
+                            fProgress.addError( QFile::decodeName( path.c_str() ), errnoMsg( path, errno ) );
+                            node->fFailed = true;
+                        }
+                    }
+                    fProgress.removed( numRemoved );
+                    release( node );
+                }
+
+                // the last reference to a directory removes it, and then releases its parent
+                void release( std::shared_ptr< SDirNode > node )
+                {
+                    while ( node && ( --node->fPending == 0 ) )
+                    {
+                        node->closeFD();
+                        if ( !node->fFailed && node->fRemoveSelf )
+                        {
+                            if ( ::unlinkat( node->fParentFD, node->fName.c_str(), AT_REMOVEDIR ) == 0 )
+                                fProgress.removed();
+                            else if ( errno != ENOENT )
+                            {
+                                fProgress.addError( QFile::decodeName( node->fPath.c_str() ), errnoMsg( node->fPath, errno ) );
+                                node->fFailed = true;
+                            }
+                        }
+                        if ( node->fFailed && node->fParent )
+                            node->fParent->fFailed = true;
+                        node = node->fParent;
+                    }
+                }
+
+                const SRemoveOptions &fOptions;
+                CRemoveProgress &fProgress;
+                std::mutex fMutex;
+                std::condition_variable fCondition;
+                std::vector< std::shared_ptr< SDirNode > > fStack;   // depth first keeps the number of directories waiting on their children small
+                int64_t fOutstanding{ 0 };   // on the stack or being processed
+            };
+#endif
+        }
+
+        SRemoveResult removePaths( const QStringList &paths, const SRemoveOptions &options )
+        {
+            SRemoveResult retVal;
+            CRemoveProgress progress( options, retVal );
+            if ( options.fRecycleOptions )
+            {
+                for ( auto &&ii : moveFilesToTrash( paths, options.fRecycleOptions ) )
+                {
+                    if ( ii.fAOK )
+                        progress.removed();
+                    else
+                        progress.addError( ii.fPath, ii.fErrorMsg );
+                }
+                progress.finished();
+                return retVal;
+            }
+
+#ifdef Q_OS_LINUX
+            CParallelRemover remover( options, progress );
+#endif
+            for ( auto &&path : paths )
+            {
+                if ( progress.canceled() )
+                    break;
+                if ( path.isEmpty() )
+                    continue;
+
+                auto absPath = QFileInfo( path ).absoluteFilePath();
+#ifdef Q_OS_LINUX
+                auto nativePath = std::string( QFile::encodeName( absPath ).constData() );
+                struct stat st;
+                if ( ::lstat( nativePath.c_str(), &st ) != 0 )
+                {
+                    if ( errno != ENOENT )
+                        progress.addError( path, errnoMsg( nativePath, errno ) );
+                    continue;
+                }
+                if ( S_ISDIR( st.st_mode ) )
+                    remover.addDir( nativePath, options.fRemoveTopDir );
+                else if ( ::unlink( nativePath.c_str() ) == 0 )
+                    progress.removed();
+                else if ( errno != ENOENT )
+                    progress.addError( path, errnoMsg( nativePath, errno ) );
+#else
+                QFileInfo fi( absPath );
+                if ( !fi.exists() && !fi.isSymLink() )
+                    continue;
+                if ( fi.isDir() && !fi.isSymLink() )
+                {
+                    QDir dir( absPath );
+                    auto aOK = true;
+                    if ( options.fRemoveTopDir )
+                        aOK = dir.removeRecursively();
+                    else
+                    {
+                        for ( auto &&ii : dir.entryInfoList( QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot ) )
+                            aOK = ( ( ii.isDir() && !ii.isSymLink() ) ? QDir( ii.absoluteFilePath() ).removeRecursively() : QFile::remove( ii.absoluteFilePath() ) ) && aOK;
+                    }
+                    if ( aOK )
+                        progress.removed();
+                    else
+                        progress.addError( path, QObject::tr( "Could not remove '%1' recursively" ).arg( path ) );
+                }
+                else if ( QFile::remove( absPath ) )
+                    progress.removed();
+                else
+                    progress.addError( path, QObject::tr( "Could not remove file '%1'" ).arg( path ) );
+#endif
+            }
+#ifdef Q_OS_LINUX
+            remover.run();
+#endif
+            progress.finished();
+            return retVal;
+        }
+
         bool removeInsideOfDir( const QString &dirStr, QString *msg )
         {
-            QDir dir( dirStr );
-            auto retVal = dir.removeRecursively();
-            if ( !retVal && msg )
+            auto result = removePaths( { dirStr } );
+            if ( !result.fAOK && msg )
                 *msg = QObject::tr( "Could not remove '%1' recursively" ).arg( dirStr );
-            return retVal;
+            return result.fAOK;
         }
 
         bool removeInsideOfDir( const std::string &dir, std::string *msg )
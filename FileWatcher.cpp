@@ -0,0 +1,573 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "FileWatcher.h"
+#include "FileBasedCache.h"
+#include "DirReader.h"
+
+#include <QDir>
+#include <QFile>
+#include <QReadLocker>
+#include <QReadWriteLock>
+#include <QWriteLocker>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#ifdef Q_OS_LINUX
+    #include <cerrno>
+    #include <cstring>
+    #include <poll.h>
+    #include <unistd.h>
+    #include <sys/eventfd.h>
+    #include <sys/inotify.h>
+    #include <sys/stat.h>
+    #include <sys/vfs.h>
+#endif
+
+namespace NSABUtils
+{
+    namespace
+    {
+        bool isBelow( const QString &path, const QString &dir )
+        {
+            if ( !path.startsWith( dir ) )
+                return false;
+            return ( path.length() == dir.length() ) || ( path[ dir.length() ] == '/' ) || dir.endsWith( '/' );
+        }
+
+#ifdef Q_OS_LINUX
+        constexpr uint32_t kWatchMask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK;
+
+        // inotify only sees changes made through this machine, on a network filesystem another client's writes are never reported
+        QString networkFileSystem( const QString &dir )
+        {
+            struct statfs buf;
+            if ( ::statfs( QFile::encodeName( dir ).constData(), &buf ) != 0 )
+                return {};
+            switch ( static_cast< uint32_t >( buf.f_type ) )
+            {
+                case 0x6969:   // NFS_SUPER_MAGIC
+                    return "NFS";
+                case 0x517B:   // SMB_SUPER_MAGIC
+                case 0xFE534D42:   // SMB2_MAGIC_NUMBER
+                    return "SMB";
+                case 0xFF534D42:   // CIFS_MAGIC_NUMBER
+                    return "CIFS";
+                case 0x00C36400:   // CEPH_SUPER_MAGIC
+                    return "Ceph";
+                case 0x5346414F:   // AFS_SUPER_MAGIC
+                    return "AFS";
+                default:
+                    return {};
+            }
+        }
+#endif
+    }
+
+    class CFileWatcherImpl
+    {
+    public:
+        CFileWatcherImpl( CFileWatcher *parent );
+        ~CFileWatcherImpl();
+
+        bool addRoot( const QString &dir, QString *msg );
+        void removeRoot( const QString &dir );
+
+        void setHealthy( bool healthy );
+        void publish( const QStringList &files, const QStringList &dirs, bool all );
+
+#ifdef Q_OS_LINUX
+        void run();
+        void readEvents( QStringList &files, QStringList &dirs );
+        bool addWatches( const QString &dir, QString *msg );
+        void removeWatches( const QString &dir );
+        void resync();
+#endif
+
+        CFileWatcher *fParent{ nullptr };
+        int fFD{ -1 };
+        int fWakeFD{ -1 };
+        std::thread fThread;
+        std::atomic< bool > fStop{ false };
+        std::atomic< int > fCoalesceInterval{ 100 };
+
+        mutable QReadWriteLock fRootsLock;
+        QStringList fRoots;
+        std::atomic< bool > fHealthy{ false };
+
+        mutable std::shared_mutex fWatchMutex;   // isWatched is called on every cache lookup, so it only takes a shared lock
+        std::unordered_map< int, QString > fWatchToPath;
+        std::unordered_map< QString, int > fPathToWatch;
+        std::unordered_set< QString > fSymLinks;   // links in the watched directories, what they point to is not watched
+
+        std::mutex fCachesMutex;
+        std::set< CFileBasedCacheBase * > fCaches;
+    };
+
+    CFileWatcherImpl::CFileWatcherImpl( CFileWatcher *parent ) :
+        fParent( parent )
+    {
+#ifdef Q_OS_LINUX
+        fFD = ::inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+        fWakeFD = ::eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+        if ( ( fFD >= 0 ) && ( fWakeFD >= 0 ) )
+            fThread = std::thread( [ this ]() { run(); } );
+#endif
+    }
+
+    CFileWatcherImpl::~CFileWatcherImpl()
+    {
+        {
+            std::lock_guard< std::mutex > lock( fCachesMutex );
+            for ( auto &&ii : fCaches )
+                ii->setWatcher( nullptr );
+            fCaches.clear();
+        }
+
+#ifdef Q_OS_LINUX
+        fStop = true;
+        if ( fWakeFD >= 0 )
+        {
+            uint64_t one = 1;
+            [[maybe_unused]] auto numWritten = ::write( fWakeFD, &one, sizeof( one ) );
+        }
+        if ( fThread.joinable() )
+            fThread.join();
+        if ( fFD >= 0 )
+            ::close( fFD );
+        if ( fWakeFD >= 0 )
+            ::close( fWakeFD );
+#endif
+    }
+
+    void CFileWatcherImpl::setHealthy( bool healthy )
+    {
+        if ( fHealthy.exchange( healthy ) != healthy )
+            emit fParent->sigHealthChanged( healthy );
+    }
+
+    void CFileWatcherImpl::publish( const QStringList &files, const QStringList &dirs, bool all )
+    {
+        std::lock_guard< std::mutex > lock( fCachesMutex );
+        for ( auto &&ii : fCaches )
+        {
+            if ( all )
+                ii->queueInvalidateAll();
+            else
+                ii->queueInvalidate( files, dirs );
+        }
+    }
+
+    bool CFileWatcherImpl::addRoot( const QString &dir, QString *msg )
+    {
+#ifdef Q_OS_LINUX
+        if ( fFD < 0 )
+        {
+            if ( msg )
+                *msg = QObject::tr( "Could not initialize inotify" );
+            return false;
+        }
+
+        auto root = QDir( dir ).absolutePath();
+        if ( !QDir( root ).exists() )
+        {
+            if ( msg )
+                *msg = QObject::tr( "Directory '%1' does not exist." ).arg( root );
+            return false;
+        }
+
+        {
+            QReadLocker locker( &fRootsLock );
+            if ( fRoots.contains( root ) )
+                return true;
+        }
+
+        auto networkFS = networkFileSystem( root );
+        if ( !networkFS.isEmpty() )
+        {
+            if ( msg )
+                *msg = QObject::tr( "Directory '%1' is on a network filesystem (%2), changes made by other machines can not be watched" ).arg( root ).arg( networkFS );
+            return false;
+        }
+
+        if ( !addWatches( root, msg ) )
+        {
+            removeWatches( root );
+            return false;
+        }
+
+        bool wasEmpty = false;
+        {
+            QWriteLocker locker( &fRootsLock );
+            wasEmpty = fRoots.isEmpty();
+            fRoots << root;
+        }
+        // anything cached below the root was validated before the watch existed
+        publish( {}, { root }, false );
+        if ( wasEmpty )
+            setHealthy( true );
+        return true;
+#else
+        Q_UNUSED( dir );
+        if ( msg )
+            *msg = QObject::tr( "File watching is not supported on this platform" );
+        return false;
+#endif
+    }
+
+    void CFileWatcherImpl::removeRoot( const QString &dir )
+    {
+        auto root = QDir( dir ).absolutePath();
+        bool isEmpty = false;
+        {
+            QWriteLocker locker( &fRootsLock );
+            if ( !fRoots.removeAll( root ) )
+                return;
+            isEmpty = fRoots.isEmpty();
+        }
+#ifdef Q_OS_LINUX
+        removeWatches( root );
+#endif
+        if ( isEmpty )
+            setHealthy( false );
+    }
+
+#ifdef Q_OS_LINUX
+    // every directory below dir, links are not followed
+    bool CFileWatcherImpl::addWatches( const QString &dir, QString *msg )
+    {
+        std::vector< QString > stack = { dir };
+        while ( !stack.empty() )
+        {
+            auto curr = std::move( stack.back() );
+            stack.pop_back();
+
+            auto encoded = QFile::encodeName( curr );
+            auto wd = ::inotify_add_watch( fFD, encoded.constData(), kWatchMask );
+            if ( wd < 0 )
+            {
+                if ( ( errno == ENOENT ) || ( errno == ENOTDIR ) )   // removed since it was listed, the parent's event covers it
+                    continue;
+                if ( msg )
+                    *msg = QObject::tr( "Could not watch '%1': %2" ).arg( curr ).arg( QString::fromLocal8Bit( ::strerror( errno ) ) );
+                return false;
+            }
+
+            {
+                std::unique_lock< std::shared_mutex > lock( fWatchMutex );
+                fWatchToPath[ wd ] = curr;
+                fPathToWatch[ curr ] = wd;
+            }
+
+            NFileUtils::CDirReader reader( encoded.constData() );
+            NFileUtils::CDirReader::SEntry entry;
+            while ( reader.next( entry ) )
+            {
+                auto type = reader.type( entry, false );
+                if ( type == NFileUtils::EDirEntryType::eDir )
+                    stack.push_back( curr + '/' + QFile::decodeName( entry.fName ) );
+                else if ( type == NFileUtils::EDirEntryType::eSymLink )
+                {
+                    std::unique_lock< std::shared_mutex > lock( fWatchMutex );
+                    fSymLinks.insert( curr + '/' + QFile::decodeName( entry.fName ) );
+                }
+            }
+        }
+        return true;
+    }
+
+    void CFileWatcherImpl::removeWatches( const QString &dir )
+    {
+        std::unique_lock< std::shared_mutex > lock( fWatchMutex );
+        for ( auto ii = fPathToWatch.begin(); ii != fPathToWatch.end(); )
+        {
+            if ( !isBelow( ( *ii ).first, dir ) )
+            {
+                ++ii;
+                continue;
+            }
+            ::inotify_rm_watch( fFD, ( *ii ).second );
+            fWatchToPath.erase( ( *ii ).second );
+            ii = fPathToWatch.erase( ii );
+        }
+        for ( auto ii = fSymLinks.begin(); ii != fSymLinks.end(); )
+        {
+            if ( isBelow( *ii, dir ) )
+                ii = fSymLinks.erase( ii );
+            else
+                ++ii;
+        }
+    }
+
+    // events were dropped, existing watches are still in place but directories created in the gap may have none
+    void CFileWatcherImpl::resync()
+    {
+        setHealthy( false );
+        publish( {}, {}, true );
+
+        QStringList roots;
+        {
+            QReadLocker locker( &fRootsLock );
+            roots = fRoots;
+        }
+        bool aOK = true;
+        for ( auto &&ii : roots )
+            aOK = addWatches( ii, nullptr ) && aOK;
+
+        // anything added while resyncing was stat'ed, but may predate the new watches
+        publish( {}, {}, true );
+        setHealthy( aOK && !roots.isEmpty() );
+    }
+
+    void CFileWatcherImpl::readEvents( QStringList &files, QStringList &dirs )
+    {
+        alignas( struct inotify_event ) char buffer[ 64 * 1024 ];
+        while ( true )
+        {
+            auto numRead = ::read( fFD, buffer, sizeof( buffer ) );
+            if ( numRead <= 0 )
+                return;
+
+            for ( ssize_t pos = 0; pos < numRead; )
+            {
+                auto event = reinterpret_cast< const struct inotify_event * >( buffer + pos );
+                pos += sizeof( struct inotify_event ) + event->len;
+
+                if ( event->mask & IN_Q_OVERFLOW )
+                {
+                    files.clear();
+                    dirs.clear();
+                    resync();
+                    continue;
+                }
+
+                QString dirPath;
+                {
+                    std::unique_lock< std::shared_mutex > lock( fWatchMutex );
+                    auto watch = fWatchToPath.find( event->wd );
+                    if ( watch == fWatchToPath.end() )
+                        continue;
+                    dirPath = ( *watch ).second;
+                    if ( event->mask & IN_IGNORED )
+                    {
+                        fPathToWatch.erase( dirPath );
+                        fWatchToPath.erase( watch );
+                    }
+                }
+
+                if ( event->mask & ( IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF ) )
+                {
+                    dirs << dirPath;
+                    QReadLocker locker( &fRootsLock );
+                    if ( fRoots.contains( dirPath ) )   // a root that is gone can not be trusted
+                        setHealthy( false );
+                    continue;
+                }
+
+                auto path = ( event->len > 0 ) ? ( dirPath + '/' + QFile::decodeName( event->name ) ) : dirPath;
+                if ( !( event->mask & IN_ISDIR ) )
+                {
+                    // a link, even one to a directory, is reported as a file
+                    if ( event->mask & ( IN_CREATE | IN_MOVED_TO ) )
+                    {
+                        struct stat st;
+                        if ( ( ::lstat( QFile::encodeName( path ).constData(), &st ) == 0 ) && S_ISLNK( st.st_mode ) )
+                        {
+                            std::unique_lock< std::shared_mutex > lock( fWatchMutex );
+                            fSymLinks.insert( path );
+                        }
+                    }
+                    else if ( event->mask & ( IN_DELETE | IN_MOVED_FROM ) )
+                    {
+                        std::unique_lock< std::shared_mutex > lock( fWatchMutex );
+                        fSymLinks.erase( path );
+                    }
+                    files << path;
+                    continue;
+                }
+
+                if ( event->mask & ( IN_CREATE | IN_MOVED_TO ) )
+                {
+                    if ( !addWatches( path, nullptr ) )
+                        setHealthy( false );
+                    dirs << path;
+                }
+                else if ( event->mask & ( IN_DELETE | IN_MOVED_FROM ) )
+                {
+                    removeWatches( path );
+                    dirs << path;
+                }
+            }
+        }
+    }
+
+    void CFileWatcherImpl::run()
+    {
+        using TClock = std::chrono::steady_clock;
+
+        QStringList pendingSignal;
+        auto deadline = TClock::time_point::max();
+        while ( !fStop )
+        {
+            int timeout = -1;
+            if ( !pendingSignal.isEmpty() )
+                timeout = static_cast< int >( std::max< int64_t >( 0, std::chrono::duration_cast< std::chrono::milliseconds >( deadline - TClock::now() ).count() ) );
+
+            struct pollfd fds[ 2 ] = { { fFD, POLLIN, 0 }, { fWakeFD, POLLIN, 0 } };
+            if ( ( ::poll( fds, 2, timeout ) < 0 ) && ( errno != EINTR ) )
+                break;
+            if ( fStop )
+                break;
+
+            if ( fds[ 0 ].revents & POLLIN )
+            {
+                QStringList files;
+                QStringList dirs;
+                readEvents( files, dirs );
+                files.removeDuplicates();
+                dirs.removeDuplicates();
+                if ( !files.isEmpty() || !dirs.isEmpty() )
+                {
+                    publish( files, dirs, false );
+                    if ( pendingSignal.isEmpty() )
+                        deadline = TClock::now() + std::chrono::milliseconds( fCoalesceInterval.load() );
+                    pendingSignal << files << dirs;
+                }
+            }
+
+            if ( !pendingSignal.isEmpty() && ( TClock::now() >= deadline ) )
+            {
+                pendingSignal.removeDuplicates();
+                emit fParent->sigChanged( pendingSignal );
+                pendingSignal.clear();
+            }
+        }
+    }
+#endif
+
+    CFileWatcher::CFileWatcher( QObject *parent ) :
+        QObject( parent ),
+        fImpl( std::make_unique< CFileWatcherImpl >( this ) )
+    {
+    }
+
+    CFileWatcher::~CFileWatcher()
+    {
+    }
+
+    bool CFileWatcher::isSupported()
+    {
+#ifdef Q_OS_LINUX
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    bool CFileWatcher::addRoot( const QString &dir, QString *msg )
+    {
+        return fImpl->addRoot( dir, msg );
+    }
+
+    void CFileWatcher::removeRoot( const QString &dir )
+    {
+        fImpl->removeRoot( dir );
+    }
+
+    QStringList CFileWatcher::roots() const
+    {
+        QReadLocker locker( &fImpl->fRootsLock );
+        return fImpl->fRoots;
+    }
+
+    int CFileWatcher::numWatches() const
+    {
+        std::shared_lock< std::shared_mutex > lock( fImpl->fWatchMutex );
+        return static_cast< int >( fImpl->fWatchToPath.size() );
+    }
+
+    void CFileWatcher::registerCache( CFileBasedCacheBase *cache )
+    {
+        if ( !cache )
+            return;
+
+        {
+            std::lock_guard< std::mutex > lock( fImpl->fCachesMutex );
+            if ( !fImpl->fCaches.insert( cache ).second )
+                return;
+        }
+        cache->queueInvalidate( {}, roots() );
+        cache->setWatcher( this );
+    }
+
+    void CFileWatcher::unregisterCache( CFileBasedCacheBase *cache )
+    {
+        std::lock_guard< std::mutex > lock( fImpl->fCachesMutex );
+        if ( fImpl->fCaches.erase( cache ) )
+            cache->setWatcher( nullptr );
+    }
+
+    bool CFileWatcher::isHealthy() const
+    {
+        return fImpl->fHealthy;
+    }
+
+    bool CFileWatcher::isWatched( const QString &path ) const
+    {
+        if ( !fImpl->fHealthy )
+            return false;
+
+        {
+            QReadLocker locker( &fImpl->fRootsLock );
+            if ( !std::any_of( fImpl->fRoots.begin(), fImpl->fRoots.end(), [ &path ]( const QString &root ) { return isBelow( path, root ); } ) )
+                return false;
+        }
+
+        // the directory holding path has to have a watch of its own, links are never followed so nothing below a linked directory has one
+        // and a link itself only reports changes to the link, not to what it points to
+        auto pos = path.lastIndexOf( '/' );
+        auto dir = ( pos == 0 ) ? QString( "/" ) : path.left( pos );
+        std::shared_lock< std::shared_mutex > lock( fImpl->fWatchMutex );
+        if ( fImpl->fSymLinks.count( path ) )
+            return false;
+        return fImpl->fPathToWatch.count( dir ) || fImpl->fPathToWatch.count( path );
+    }
+
+    void CFileWatcher::setCoalesceInterval( int msecs )
+    {
+        fImpl->fCoalesceInterval = std::max( 0, msecs );
+    }
+
+    int CFileWatcher::coalesceInterval() const
+    {
+        return fImpl->fCoalesceInterval;
+    }
+}
@@ -0,0 +1,82 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __FILEWATCHER_H
+#define __FILEWATCHER_H
+
+#include "SABUtilsExport.h"
+#include "FileBasedCache.h"
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <memory>
+
+namespace NSABUtils
+{
+    // watches directory trees with inotify, every directory below a root gets a watch (QFileSystemWatcher tops out at a few thousand paths)
+    // linux only, on other platforms addRoot fails and the watcher is never healthy
+    // a root on a network filesystem (NFS, SMB/CIFS, ...) is refused, inotify never sees changes made by other clients
+    //
+    // events are read on a background thread, each batch read from the kernel is de-duplicated and published to the registered caches
+    // right away, sigChanged is coalesced over the coalesce interval
+    //
+    // while healthy (every root fully watched, no events dropped) the registered caches match watched paths without a stat
+    // an event queue overflow or a failed watch (fs.inotify.max_user_watches) makes the watcher unhealthy, the caches are
+    // invalidated and go back to stat'ing until the trees are watched again
+    //
+    // destroy the watcher only after its caches are no longer being used
+    class CFileWatcherImpl;
+    class SABUTILS_EXPORT CFileWatcher : public QObject, public CFileBasedCacheWatcher
+    {
+        Q_OBJECT;
+
+    public:
+        CFileWatcher( QObject *parent = nullptr );
+        virtual ~CFileWatcher() override;
+
+        static bool isSupported();
+
+        bool addRoot( const QString &dir, QString *msg = nullptr );
+        void removeRoot( const QString &dir );
+        QStringList roots() const;
+        int numWatches() const;
+
+        void registerCache( CFileBasedCacheBase *cache );   // entries below the roots are dropped, they were not watched when added
+        void unregisterCache( CFileBasedCacheBase *cache ) override;
+
+        bool isHealthy() const;
+        bool isWatched( const QString &path ) const override;   // healthy, path (absolute) is below a root, its directory has a watch and it is not a link
+
+        void setCoalesceInterval( int msecs );   // default 100ms
+        int coalesceInterval() const;
+
+    Q_SIGNALS:
+        void sigChanged( const QStringList &paths );   // files and directories, from the watcher thread
+        void sigHealthChanged( bool healthy );
+
+    private:
+        std::unique_ptr< CFileWatcherImpl > fImpl;
+    };
+}
+
+#endif
@@ -21,44 +21,616 @@
 // SOFTWARE.
 
 #include "FileUtils.h"
+#include "DirReader.h"
 #include <QDir>
+#include <QFile>
+#include <QThread>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 namespace NSABUtils
 {
     namespace NFileUtils
     {
+        namespace
+        {
+            // each worker owns a queue of directories, new sub directories go on the back of the owners queue
+            // an idle worker steals from the front of another workers queue
+            class CParallelDirWalker
+            {
+            public:
+                CParallelDirWalker( const SFindAllFilesOptions &options, QString *errorMsg ) :
+                    fOptions( options ),
+                    fNamePatterns( options.fNamePatterns.isEmpty() ? CPathPatternSet( options.fNameFilters ) : options.fNamePatterns ),
+                    fErrorMsg( errorMsg )
+                {
+                    auto numThreads = ( fOptions.fMaxThreads > 0 ) ? fOptions.fMaxThreads : QThread::idealThreadCount();
+                    if ( !fOptions.fRecursive )
+                        numThreads = 1;
+                    numThreads = std::max( 1, numThreads );
+                    for ( int ii = 0; ii < numThreads; ++ii )
+                        fQueues.push_back( std::make_unique< SQueue >() );
+                    fResults.resize( numThreads );
+                }
 
-        std::optional< QList< QFileInfo > > findAllFiles( const QDir &dir, const QStringList &nameFilters, bool recursive, bool sortByName, QString *errorMsg, std::function< bool( const QDir &dir ) > skipDir, std::function< bool( const QFileInfo &file ) > skipFile )
+                ~CParallelDirWalker()
+                {
+                    stop();
+                    join();
+                }
+
+                QList< QFileInfo > run( const QString &rootPath )
+                {
+                    fRootPath = rootPath;
+                    fPending = 1;
+                    fQueues[ 0 ]->fDirs.push_back( rootPath );
+
+                    // the calling thread is worker 0
+                    for ( size_t ii = 1; ii < fQueues.size(); ++ii )
+                        fThreads.emplace_back( [ this, ii ]() { worker( ii ); } );
+                    worker( 0 );
+                    join();
+
+                    auto retVal = fOptions.fSortByName ? sortedResults() : results();
+                    if ( ( fOptions.fMaxResults > 0 ) && ( retVal.count() > fOptions.fMaxResults ) )
+                        retVal.resize( fOptions.fMaxResults );
+                    return retVal;
+                }
+
+                // every worker runs in the background and each file is passed to the sink rather than collected
+                // the sink returns false to stop the walk, finishedFunc is called once the last worker is done
+                void start( const QString &rootPath, std::function< bool( const QFileInfo &fi ) > sink, std::function< void() > finishedFunc )
+                {
+                    fRootPath = rootPath;
+                    fSink = std::move( sink );
+                    fFinishedFunc = std::move( finishedFunc );
+                    fRunningWorkers = static_cast< int >( fQueues.size() );
+                    fPending = 1;
+                    fQueues[ 0 ]->fDirs.push_back( rootPath );
+                    for ( size_t ii = 0; ii < fQueues.size(); ++ii )
+                        fThreads.emplace_back( [ this, ii ]() { worker( ii ); } );
+                }
+
+                void stop()
+                {
+                    fStopped = true;
+                    fIdleCondition.notify_all();
+                }
+
+                void join()
+                {
+                    for ( auto &&ii : fThreads )
+                    {
+                        if ( ii.joinable() )
+                            ii.join();
+                    }
+                    fThreads.clear();
+                }
+
+            private:
+                struct SQueue
+                {
+                    std::mutex fMutex;
+                    std::deque< QString > fDirs;
+                };
+
+                struct SDirResult
+                {
+                    QString fPath;
+                    QList< QFileInfo > fFiles;
+                    std::vector< QString > fSubDirs;   // only kept when sorting
+                };
+
+                void worker( size_t id )
+                {
+                    runWorker( id );
+                    if ( fFinishedFunc && ( --fRunningWorkers == 0 ) )
+                        fFinishedFunc();
+                }
+
+                bool stopped() const { return fStopped || fOptions.fCancelToken.isCanceled(); }
+
+                void runWorker( size_t id )
+                {
+                    while ( !stopped() )
+                    {
+                        QString dir;
+                        if ( popOrSteal( id, dir ) )
+                        {
+                            processDir( id, dir );
+                            if ( --fPending == 0 )
+                                fIdleCondition.notify_all();
+                            continue;
+                        }
+
+                        std::unique_lock< std::mutex > lock( fIdleMutex );
+                        if ( ( fPending == 0 ) || stopped() )
+                            return;
+                        fIdleCondition.wait_for( lock, std::chrono::milliseconds( 1 ) );
+                    }
+                }
+
+                // newest from its own queue (depth first, keeps the queues short), oldest from the others (the largest remaining subtrees)
+                bool popOrSteal( size_t id, QString &dir )
+                {
+                    {
+                        auto &&queue = *fQueues[ id ];
+                        std::lock_guard< std::mutex > lock( queue.fMutex );
+                        if ( !queue.fDirs.empty() )
+                        {
+                            dir = std::move( queue.fDirs.back() );
+                            queue.fDirs.pop_back();
+                            return true;
+                        }
+                    }
+
+                    for ( size_t ii = 1; ii < fQueues.size(); ++ii )
+                    {
+                        auto &&queue = *fQueues[ ( id + ii ) % fQueues.size() ];
+                        std::lock_guard< std::mutex > lock( queue.fMutex );
+                        if ( !queue.fDirs.empty() )
+                        {
+                            dir = std::move( queue.fDirs.front() );
+                            queue.fDirs.pop_front();
+                            return true;
+                        }
+                    }
+                    return false;
+                }
+
+                bool skipDir( const QDir &dir )
+                {
+                    if ( !fOptions.fSkipDir )
+                        return false;
+                    if ( fOptions.fCallbacksThreadSafe )
+                        return fOptions.fSkipDir( dir );
+                    std::lock_guard< std::mutex > lock( fCallbackMutex );
+                    return fOptions.fSkipDir( dir );
+                }
+
+                bool skipFile( const QFileInfo &fi )
+                {
+                    if ( !fOptions.fSkipFile )
+                        return false;
+                    if ( fOptions.fCallbacksThreadSafe )
+                        return fOptions.fSkipFile( fi );
+                    std::lock_guard< std::mutex > lock( fCallbackMutex );
+                    return fOptions.fSkipFile( fi );
+                }
+
+                void setError( const QString &path )
+                {
+                    if ( !fErrorMsg )
+                        return;
+                    std::lock_guard< std::mutex > lock( fErrorMutex );
+                    *fErrorMsg = QString( "Directory '%1' does not exist." ).arg( path );
+                }
+
+                // a single listing per directory, the name filters only apply to the files
+                bool listDir( const QString &path, SDirResult &result, std::vector< QString > &subDirs )
+                {
+                    auto dir = QDir( path );
+                    if ( path != fRootPath )   // the root was checked by findAllFiles
+                    {
+                        if ( !dir.exists() || !dir.isReadable() )
+                        {
+                            setError( dir.absolutePath() );
+                            return false;
+                        }
+                        if ( skipDir( dir ) )
+                            return false;
+                    }
+
+                    auto entries = dir.entryInfoList( QDir::Files | QDir::AllDirs | QDir::NoDotAndDotDot, QDir::SortFlag::NoSort );
+                    for ( auto &&ii : entries )
+                    {
+                        if ( ii.isDir() )
+                        {
+                            if ( fOptions.fRecursive )
+                                subDirs.push_back( ii.absoluteFilePath() );
+                            continue;
+                        }
+
+                        if ( !fNamePatterns.isEmpty() && !fNamePatterns.matchesName( ii.fileName() ) )
+                            continue;
+                        if ( skipFile( ii ) )
+                            continue;
+                        result.fFiles << ii;
+                    }
+                    return true;
+                }
+
+#ifdef Q_OS_LINUX
+                // same filtering as the QDir listing (no hidden entries, no dangling links, links to directories are followed)
+                // but the only stat calls are for symbolic links and filesystems that do not fill in d_type
+                // the QFileInfo is built from the path alone, so size and times are only read if skipFile or the caller asks for them
+                bool listDirNative( const QString &path, SDirResult &result, std::vector< QString > &subDirs )
+                {
+                    CDirReader reader( QFile::encodeName( path ).constData() );
+                    if ( !reader.isOpen() )
+                    {
+                        setError( path );
+                        return false;
+                    }
+                    if ( ( path != fRootPath ) && skipDir( QDir( path ) ) )
+                        return false;
+
+                    auto prefix = path.endsWith( '/' ) ? path : ( path + '/' );
+                    CDirReader::SEntry entry;
+                    while ( reader.next( entry ) )
+                    {
+                        if ( entry.fName[ 0 ] == '.' )
+                            continue;
+
+                        auto type = reader.type( entry, true );
+                        if ( type == EDirEntryType::eDir )
+                        {
+                            if ( fOptions.fRecursive )
+                                subDirs.push_back( prefix + QFile::decodeName( entry.fName ) );
+                            continue;
+                        }
+                        if ( type != EDirEntryType::eFile )
+                            continue;
+
+                        auto fileName = QFile::decodeName( entry.fName );
+                        if ( !fNamePatterns.isEmpty() && !fNamePatterns.matchesName( fileName ) )
+                            continue;
+                        auto fi = QFileInfo( prefix + fileName );
+                        if ( skipFile( fi ) )
+                            continue;
+                        result.fFiles << fi;
+                    }
+                    return true;
+                }
+#endif
+
+                void processDir( size_t id, const QString &path )
+                {
+                    SDirResult result;
+                    result.fPath = path;
+                    std::vector< QString > subDirs;
+#ifdef Q_OS_LINUX
+                    auto aOK = fOptions.fUseNativeEnumeration ? listDirNative( path, result, subDirs ) : listDir( path, result, subDirs );
+#else
+                    auto aOK = listDir( path, result, subDirs );
+#endif
+                    if ( !aOK )
+                        return;
+
+                    if ( fOptions.fSortByName )
+                        std::sort( result.fFiles.begin(), result.fFiles.end(), []( const QFileInfo &lhs, const QFileInfo &rhs ) { return lhs.fileName() < rhs.fileName(); } );
+
+                    if ( !fSink && ( fOptions.fMaxResults > 0 ) )   // when streaming, the consumer counts
+                    {
+                        if ( ( fNumFound += result.fFiles.count() ) >= fOptions.fMaxResults )
+                            stop();
+                    }
+
+                    if ( fSink )
+                    {
+                        for ( auto &&ii : result.fFiles )
+                        {
+                            if ( !fSink( ii ) )
+                            {
+                                stop();
+                                return;
+                            }
+                        }
+                        result.fFiles.clear();
+                    }
+
+                    if ( !subDirs.empty() )
+                    {
+                        fPending += static_cast< int64_t >( subDirs.size() );
+                        {
+                            auto &&queue = *fQueues[ id ];
+                            std::lock_guard< std::mutex > lock( queue.fMutex );
+                            for ( auto &&ii : subDirs )
+                                queue.fDirs.push_back( ii );
+                        }
+                        fIdleCondition.notify_all();
+                    }
+
+                    if ( fOptions.fSortByName && !fSink )
+                    {
+                        std::sort( subDirs.begin(), subDirs.end() );
+                        result.fSubDirs = std::move( subDirs );
+                    }
+                    if ( !result.fFiles.isEmpty() || !result.fSubDirs.empty() )
+                        fResults[ id ].push_back( std::move( result ) );
+                }
+
+                QList< QFileInfo > results()
+                {
+                    qsizetype numFiles = 0;
+                    for ( auto &&ii : fResults )
+                    {
+                        for ( auto &&jj : ii )
+                            numFiles += jj.fFiles.count();
+                    }
+
+                    QList< QFileInfo > retVal;
+                    retVal.reserve( numFiles );
+                    for ( auto &&ii : fResults )
+                    {
+                        for ( auto &&jj : ii )
+                            retVal << jj.fFiles;
+                    }
+                    return retVal;
+                }
+
+                // rebuilds the order of the recursive walk, the files of a directory then each sub directory
+                QList< QFileInfo > sortedResults()
+                {
+                    std::unordered_map< QString, SDirResult * > byPath;
+                    qsizetype numFiles = 0;
+                    for ( auto &&ii : fResults )
+                    {
+                        for ( auto &&jj : ii )
+                        {
+                            byPath[ jj.fPath ] = &jj;
+                            numFiles += jj.fFiles.count();
+                        }
+                    }
+
+                    QList< QFileInfo > retVal;
+                    retVal.reserve( numFiles );
+                    std::vector< const SDirResult * > stack;
+                    auto push = [ &byPath, &stack ]( const QString &path )
+                    {
+                        auto pos = byPath.find( path );
+                        if ( pos != byPath.end() )
+                            stack.push_back( ( *pos ).second );
+                    };
+
+                    push( fRootPath );
+                    while ( !stack.empty() )
+                    {
+                        auto curr = stack.back();
+                        stack.pop_back();
+                        retVal << curr->fFiles;
+                        for ( auto ii = curr->fSubDirs.rbegin(); ii != curr->fSubDirs.rend(); ++ii )
+                            push( *ii );
+                    }
+                    return retVal;
+                }
+
+                SFindAllFilesOptions fOptions;
+                CPathPatternSet fNamePatterns;
+                QString *fErrorMsg{ nullptr };
+                QString fRootPath;
+                std::vector< std::unique_ptr< SQueue > > fQueues;
+                std::vector< std::vector< SDirResult > > fResults;   // per worker, adding a result never contends
+                std::atomic< int64_t > fPending{ 0 };
+                std::atomic< int64_t > fNumFound{ 0 };
+                std::atomic< bool > fStopped{ false };
+                std::atomic< int > fRunningWorkers{ 0 };
+                std::vector< std::thread > fThreads;
+                std::function< bool( const QFileInfo &fi ) > fSink;
+                std::function< void() > fFinishedFunc;
+                std::mutex fIdleMutex;
+                std::condition_variable fIdleCondition;
+                std::mutex fCallbackMutex;
+                std::mutex fErrorMutex;
+            };
+        }
+
+        // the hand off between the walk and CFileEnumerator::next, a full queue blocks the walk until the consumer catches up
+        class CFileEnumeratorImpl
         {
-            if ( !dir.exists() || !dir.isReadable() )
+        public:
+            CFileEnumeratorImpl( const SFindAllFilesOptions &options ) :
+                fOptions( options ),
+                fWalker( options, &fWalkErrorMsg )
             {
-                if ( errorMsg )
-                    *errorMsg = QString( "Directory '%1' does not exist." ).arg( dir.absolutePath() );
-                return {};
+                fMaxQueued = std::max( 1, fOptions.fMaxQueuedFiles );
+            }
+
+            ~CFileEnumeratorImpl()
+            {
+                cancel();
+                fWalker.join();
+            }
+
+            void start( const QString &rootPath )
+            {
+                fWalker.start(
+                    rootPath, [ this ]( const QFileInfo &fi ) { return push( fi ); },
+                    [ this ]()
+                    {
+                        std::lock_guard< std::mutex > lock( fMutex );
+                        fFinished = true;
+                        fNotEmpty.notify_all();
+                    } );
             }
-            if ( skipDir && skipDir( dir ) )
-                return {};
 
-            // qDebug() << dir.absolutePath();
-            auto files = dir.entryInfoList( nameFilters, QDir::Files, sortByName ? QDir::SortFlag::Name : QDir::SortFlag::NoSort );
-            QList< QFileInfo > retVal;
-            for ( auto &&ii : files )
+            bool push( const QFileInfo &fi )
             {
-                if ( skipFile && skipFile( ii ) )
-                    continue;
-                retVal << ii;
+                std::unique_lock< std::mutex > lock( fMutex );
+                while ( !fClosed && ( fQueue.size() >= fMaxQueued ) )
+                {
+                    if ( fOptions.fCancelToken.isCanceled() )
+                        return false;
+                    fNotFull.wait_for( lock, std::chrono::milliseconds( 10 ) );
+                }
+                if ( fClosed )
+                    return false;
+                fQueue.push_back( fi );
+                fNotEmpty.notify_one();
+                return true;
             }
-            if ( recursive )
+
+            std::optional< QFileInfo > next()
             {
-                auto subDirs = dir.entryInfoList( QDir::Filter::AllDirs | QDir::Filter::NoDotAndDotDot, sortByName ? QDir::SortFlag::Name : QDir::SortFlag::NoSort );
-                for ( auto &&ii : subDirs )
+                std::unique_lock< std::mutex > lock( fMutex );
+                if ( fClosed || ( ( fOptions.fMaxResults > 0 ) && ( fNumFound >= fOptions.fMaxResults ) ) )
+                    return {};
+
+                while ( fQueue.empty() && !fFinished )
                 {
-                    auto curr = findAllFiles( QDir( ii.absoluteFilePath() ), nameFilters, recursive, sortByName, errorMsg, skipDir, skipFile );
-                    if ( curr.has_value() )
-                        retVal << curr.value();
+                    if ( fOptions.fCancelToken.isCanceled() )
+                        return {};
+                    fNotEmpty.wait_for( lock, std::chrono::milliseconds( 10 ) );
                 }
+                if ( fQueue.empty() || fOptions.fCancelToken.isCanceled() )
+                    return {};
+
+                auto retVal = std::move( fQueue.front() );
+                fQueue.pop_front();
+                fNumFound++;
+                fNotFull.notify_one();
+                if ( ( fOptions.fMaxResults > 0 ) && ( fNumFound >= fOptions.fMaxResults ) )
+                    closeLocked();
+                return retVal;
+            }
+
+            void cancel()
+            {
+                std::lock_guard< std::mutex > lock( fMutex );
+                closeLocked();
+            }
+
+            void closeLocked()
+            {
+                fClosed = true;
+                fQueue.clear();
+                fWalker.stop();
+                fNotFull.notify_all();
+                fNotEmpty.notify_all();
+            }
+
+            QString errorMsg() const
+            {
+                std::lock_guard< std::mutex > lock( fMutex );
+                if ( !fErrorMsg.isEmpty() || !fFinished )   // the walk error is only stable once every worker is done
+                    return fErrorMsg;
+                return fWalkErrorMsg;
+            }
+
+            SFindAllFilesOptions fOptions;
+            bool fAOK{ true };
+            QString fErrorMsg;
+            QString fWalkErrorMsg;
+            int fNumFound{ 0 };
+
+            mutable std::mutex fMutex;
+            std::condition_variable fNotEmpty;
+            std::condition_variable fNotFull;
+            std::deque< QFileInfo > fQueue;
+            size_t fMaxQueued{ 4096 };
+            bool fFinished{ false };
+            bool fClosed{ false };
+
+            CParallelDirWalker fWalker;   // last, so the workers are stopped before the queue goes away
+        };
+
+        CFileEnumerator::CFileEnumerator( const QDir &dir, const SFindAllFilesOptions &options ) :
+            fImpl( std::make_unique< CFileEnumeratorImpl >( options ) )
+        {
+            if ( !dir.exists() || !dir.isReadable() )
+            {
+                fImpl->fAOK = false;
+                fImpl->fErrorMsg = QString( "Directory '%1' does not exist." ).arg( dir.absolutePath() );
+                fImpl->fFinished = true;
+                return;
+            }
+            if ( options.fSkipDir && options.fSkipDir( dir ) )
+            {
+                fImpl->fAOK = false;
+                fImpl->fFinished = true;
+                return;
+            }
+
+            fImpl->start( dir.absolutePath() );
+        }
+
+        CFileEnumerator::~CFileEnumerator()
+        {
+        }
+
+        std::optional< QFileInfo > CFileEnumerator::next()
+        {
+            return fImpl->next();
+        }
+
+        void CFileEnumerator::cancel()
+        {
+            fImpl->cancel();
+        }
+
+        bool CFileEnumerator::aOK() const
+        {
+            return fImpl->fAOK;
+        }
+
+        QString CFileEnumerator::errorMsg() const
+        {
+            return fImpl->errorMsg();
+        }
+
+        int CFileEnumerator::numFound() const
+        {
+            std::lock_guard< std::mutex > lock( fImpl->fMutex );
+            return fImpl->fNumFound;
+        }
+
+        bool visitAllFiles( const QDir &dir, const SFindAllFilesOptions &options, const std::function< bool( const QFileInfo &file ) > &visitor, QString *errorMsg )
+        {
+            CFileEnumerator enumerator( dir, options );
+            if ( !enumerator.aOK() )
+            {
+                if ( errorMsg )
+                    *errorMsg = enumerator.errorMsg();
+                return false;
             }
-            return retVal;
+
+            while ( auto curr = enumerator.next() )
+            {
+                if ( !visitor( curr.value() ) )
+                    break;
+            }
+            enumerator.cancel();
+            if ( errorMsg )
+                *errorMsg = enumerator.errorMsg();
+            return true;
+        }
+
+        std::optional< QList< QFileInfo > > findAllFiles( const QDir &dir, const SFindAllFilesOptions &options, QString *errorMsg )
+        {
+            if ( !dir.exists() || !dir.isReadable() )
+            {
+                if ( errorMsg )
+                    *errorMsg = QString( "Directory '%1' does not exist." ).arg( dir.absolutePath() );
+                return {};
+            }
+            if ( options.fSkipDir && options.fSkipDir( dir ) )
+                return {};
+
+            CParallelDirWalker walker( options, errorMsg );
+            return walker.run( dir.absolutePath() );
+        }
+
+        std::optional< QList< QFileInfo > > findAllFiles( const QDir &dir, const QStringList &nameFilters, bool recursive, bool sortByName, QString *errorMsg, std::function< bool( const QDir &dir ) > skipDir, std::function< bool( const QFileInfo &file ) > skipFile )
+        {
+            SFindAllFilesOptions options;
+            options.fNameFilters = nameFilters;
+            options.fRecursive = recursive;
+            options.fSortByName = sortByName;
+            options.fSkipDir = skipDir;
+            options.fSkipFile = skipFile;
+            // callers of this overload wrote their callbacks for the old single threaded walk, they may not be safe to call from a worker thread
+            if ( skipDir || skipFile )
+                options.fMaxThreads = 1;
+            return findAllFiles( dir, options, errorMsg );
         }
     }
 }
@@ -0,0 +1,355 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "HashBatch.h"
+#include "MD5.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include <QThreadPool>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+
+#include <atomic>
+#include <deque>
+#include <unordered_map>
+#include <algorithm>
+
+#ifdef Q_OS_WINDOWS
+    #include <QStorageInfo>
+#else
+    #include <sys/stat.h>
+#endif
+
+namespace NSABUtils
+{
+    class CHashBatchImpl
+    {
+    public:
+        struct SJob
+        {
+            int fIndex{ -1 };
+            QString fFileName;
+            qint64 fSize{ 0 };
+        };
+
+        CHashBatchImpl( CHashBatch *parent ) :
+            fParent( parent )
+        {
+            fPool.setMaxThreadCount( QThread::idealThreadCount() );
+        }
+
+        ~CHashBatchImpl()
+        {
+            fCanceled = true;
+            fPool.waitForDone();
+        }
+
+        bool start( const QStringList &files );
+        void runReader( quint64 device );
+        void addBytesHashed( qint64 numBytes );
+        void finishJob( const SJob &job, const QByteArray &md5, bool canceled );
+        void readerFinished();
+        void emitProgress( bool force );
+
+        CHashBatch *fParent{ nullptr };
+        QThreadPool fPool;
+        int fMaxReadersPerDevice{ 1 };
+        int fProgressInterval{ 100 };
+        EHashAlgorithm fAlgorithm{ EHashAlgorithm::eMD5 };
+        std::function< void( const SHashBatchResult &result ) > fResultFunc;
+
+        mutable QMutex fMutex;
+        std::unordered_map< quint64, std::deque< SJob > > fQueues;
+        THashBatchResults fResults;
+        int fActiveReaders{ 0 };
+        int fNumFinished{ 0 };
+        qint64 fBytesHashed{ 0 };
+        qint64 fTotalBytes{ 0 };
+        QElapsedTimer fProgressTimer;
+        bool fRunning{ false };
+        std::atomic< bool > fCanceled{ false };
+    };
+
+    bool CHashBatchImpl::start( const QStringList &files )
+    {
+        QMutexLocker locker( &fMutex );
+        if ( fRunning )
+            return false;
+
+        fCanceled = false;
+        fQueues.clear();
+        fResults.clear();
+        fResults.reserve( files.count() );
+        fNumFinished = 0;
+        fBytesHashed = 0;
+        fTotalBytes = 0;
+
+        for ( int ii = 0; ii < files.count(); ++ii )
+        {
+            SJob job;
+            job.fIndex = ii;
+            job.fFileName = QFileInfo( files[ ii ] ).absoluteFilePath();
+            auto device = CHashBatch::deviceID( job.fFileName, &job.fSize );
+
+            SHashBatchResult result;
+            result.fFileName = job.fFileName;
+            result.fSize = job.fSize;
+            fResults << result;
+
+            fTotalBytes += job.fSize;
+            fQueues[ device ].push_back( job );
+        }
+
+        if ( fQueues.empty() )
+        {
+            locker.unlock();
+            emit fParent->sigFinished( {}, false );
+            return true;
+        }
+
+        // largest files first within a device, devices holding the largest files get their readers started first
+        std::vector< std::pair< qint64, quint64 > > deviceOrder;
+        for ( auto &&ii : fQueues )
+        {
+            auto &&pending = ii.second;
+            std::stable_sort( pending.begin(), pending.end(), []( const SJob &lhs, const SJob &rhs ) { return lhs.fSize > rhs.fSize; } );
+            deviceOrder.emplace_back( pending.front().fSize, ii.first );
+        }
+        std::stable_sort( deviceOrder.begin(), deviceOrder.end(), []( const std::pair< qint64, quint64 > &lhs, const std::pair< qint64, quint64 > &rhs ) { return lhs.first > rhs.first; } );
+
+        fRunning = true;
+        fProgressTimer.start();
+        for ( auto &&ii : deviceOrder )
+        {
+            auto device = ii.second;
+            auto numReaders = std::min< size_t >( std::max( 1, fMaxReadersPerDevice ), fQueues[ device ].size() );
+            for ( size_t jj = 0; jj < numReaders; ++jj )
+            {
+                fActiveReaders++;
+                fPool.start( [ this, device ]() { runReader( device ); } );
+            }
+        }
+        return true;
+    }
+
+    void CHashBatchImpl::runReader( quint64 device )
+    {
+        while ( true )
+        {
+            SJob job;
+            EHashAlgorithm algorithm;
+            {
+                QMutexLocker locker( &fMutex );
+                auto &&pending = fQueues[ device ];
+                if ( pending.empty() )
+                    break;
+                job = pending.front();
+                pending.pop_front();
+                algorithm = fAlgorithm;
+            }
+
+            QByteArray md5;
+            if ( !fCanceled )
+            {
+                qint64 lastPos = 0;
+                md5 = getMd5(
+                    QFileInfo( job.fFileName ),
+                    [ this, &lastPos ]( qint64 pos )
+                    {
+                        addBytesHashed( pos - lastPos );
+                        lastPos = pos;
+                        return !fCanceled;
+                    },
+                    algorithm );
+            }
+            finishJob( job, md5, md5.isEmpty() && fCanceled );
+        }
+        readerFinished();
+    }
+
+    void CHashBatchImpl::addBytesHashed( qint64 numBytes )
+    {
+        QMutexLocker locker( &fMutex );
+        fBytesHashed += numBytes;
+        locker.unlock();
+        emitProgress( false );
+    }
+
+    void CHashBatchImpl::finishJob( const SJob &job, const QByteArray &md5, bool canceled )
+    {
+        QMutexLocker locker( &fMutex );
+        auto &&result = fResults[ job.fIndex ];
+        result.fMD5 = canceled ? QByteArray() : md5;
+        result.fCanceled = canceled;
+        fNumFinished++;
+        auto resultCopy = result;
+        auto resultFunc = fResultFunc;
+        locker.unlock();
+
+        if ( resultFunc )
+            resultFunc( resultCopy );
+        emitProgress( false );
+    }
+
+    void CHashBatchImpl::readerFinished()
+    {
+        QMutexLocker locker( &fMutex );
+        if ( --fActiveReaders > 0 )
+            return;
+
+        fRunning = false;
+        auto results = fResults;
+        bool canceled = fCanceled;
+        locker.unlock();
+
+        emitProgress( true );
+        emit fParent->sigFinished( results, canceled );
+    }
+
+    void CHashBatchImpl::emitProgress( bool force )
+    {
+        QMutexLocker locker( &fMutex );
+        if ( !force && ( fProgressTimer.elapsed() < fProgressInterval ) )
+            return;
+        fProgressTimer.restart();
+        auto numFinished = fNumFinished;
+        auto numFiles = static_cast< int >( fResults.count() );
+        auto bytesHashed = fBytesHashed;
+        auto totalBytes = fTotalBytes;
+        locker.unlock();
+
+        emit fParent->sigProgress( numFinished, numFiles, bytesHashed, totalBytes );
+    }
+
+    CHashBatch::CHashBatch( QObject *parent ) :
+        QObject( parent ),
+        fImpl( std::make_unique< CHashBatchImpl >( this ) )
+    {
+    }
+
+    CHashBatch::~CHashBatch()
+    {
+    }
+
+    void CHashBatch::setMaxReadersPerDevice( int value )
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        fImpl->fMaxReadersPerDevice = std::max( 1, value );
+    }
+
+    int CHashBatch::maxReadersPerDevice() const
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        return fImpl->fMaxReadersPerDevice;
+    }
+
+    void CHashBatch::setMaxThreads( int value )
+    {
+        fImpl->fPool.setMaxThreadCount( ( value > 0 ) ? value : QThread::idealThreadCount() );
+    }
+
+    int CHashBatch::maxThreads() const
+    {
+        return fImpl->fPool.maxThreadCount();
+    }
+
+    void CHashBatch::setProgressInterval( int msecs )
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        fImpl->fProgressInterval = std::max( 0, msecs );
+    }
+
+    int CHashBatch::progressInterval() const
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        return fImpl->fProgressInterval;
+    }
+
+    void CHashBatch::setAlgorithm( EHashAlgorithm algorithm )
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        fImpl->fAlgorithm = algorithm;
+    }
+
+    EHashAlgorithm CHashBatch::algorithm() const
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        return fImpl->fAlgorithm;
+    }
+
+    void CHashBatch::setResultFunc( std::function< void( const SHashBatchResult &result ) > func )
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        fImpl->fResultFunc = func;
+    }
+
+    bool CHashBatch::start( const QStringList &files )
+    {
+        return fImpl->start( files );
+    }
+
+    bool CHashBatch::isRunning() const
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        return fImpl->fRunning;
+    }
+
+    bool CHashBatch::waitForDone( int msecs )
+    {
+        return fImpl->fPool.waitForDone( msecs );
+    }
+
+    THashBatchResults CHashBatch::results() const
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        return fImpl->fResults;
+    }
+
+    void CHashBatch::slotCancel()
+    {
+        fImpl->fCanceled = true;
+    }
+
+    quint64 CHashBatch::deviceID( const QString &path, qint64 *size )
+    {
+#ifdef Q_OS_WINDOWS
+        QFileInfo fi( path );
+        if ( size )
+            *size = fi.exists() ? fi.size() : 0;
+        return qHash( QStorageInfo( fi.absolutePath() ).device() );
+#else
+        struct stat st;
+        if ( ::stat( QFile::encodeName( path ).constData(), &st ) != 0 )
+        {
+            if ( size )
+                *size = 0;
+            return 0;
+        }
+        if ( size )
+            *size = st.st_size;
+        return static_cast< quint64 >( st.st_dev );
+#endif
+    }
+}
@@ -0,0 +1,99 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __HASHBATCH_H
+#define __HASHBATCH_H
+
+#include "SABUtilsExport.h"
+#include "ContentHash.h"
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QList>
+#include <functional>
+#include <memory>
+
+namespace NSABUtils
+{
+    struct SABUTILS_EXPORT SHashBatchResult
+    {
+        QString fFileName;
+        QByteArray fMD5;   // formatted, empty on failure or cancel
+        qint64 fSize{ 0 };
+        bool fCanceled{ false };
+
+        bool aOK() const { return !fCanceled && !fMD5.isEmpty(); }
+    };
+    using THashBatchResults = QList< SHashBatchResult >;
+
+    // hashes a list of files, grouping the work by the device the file lives on
+    // each device gets at most maxReadersPerDevice concurrent readers, so a spinning disk
+    // or network share is read sequentially rather than thrashed by every pool thread
+    // within a device the largest files are hashed first
+    //
+    // rather than per file signals, progress is throttled and the results are delivered once via sigFinished
+    // if a result function is set, it is called from the worker thread as each file completes
+    class CHashBatchImpl;
+    class SABUTILS_EXPORT CHashBatch : public QObject
+    {
+        Q_OBJECT;
+
+    public:
+        CHashBatch( QObject *parent = nullptr );
+        virtual ~CHashBatch() override;
+
+        void setMaxReadersPerDevice( int value );   // default 1
+        int maxReadersPerDevice() const;
+
+        void setMaxThreads( int value );   // default QThread::idealThreadCount()
+        int maxThreads() const;
+
+        void setProgressInterval( int msecs );   // default 100ms
+        int progressInterval() const;
+
+        void setAlgorithm( EHashAlgorithm algorithm );   // default MD5
+        EHashAlgorithm algorithm() const;
+
+        void setResultFunc( std::function< void( const SHashBatchResult &result ) > func );   // called from the worker thread
+
+        bool start( const QStringList &files );   // returns false if a batch is already running
+        bool isRunning() const;
+        bool waitForDone( int msecs = -1 );
+        THashBatchResults results() const;   // in the same order as the files passed to start
+
+        static quint64 deviceID( const QString &path, qint64 *size = nullptr );   // st_dev on unix, the volume on windows
+
+    public Q_SLOTS:
+        void slotCancel();
+
+    Q_SIGNALS:
+        void sigProgress( int numFinished, int numFiles, qint64 bytesHashed, qint64 totalBytes );
+        void sigFinished( const NSABUtils::THashBatchResults &results, bool canceled );
+
+    private:
+        std::unique_ptr< CHashBatchImpl > fImpl;
+    };
+}
+
+#endif
@@ -21,6 +21,8 @@
 // SOFTWARE.
 
 #include "MD5.h"
+#include "DigestCache.h"
+#include "FileBasedCache.h"
 
 #include <QString>
 #include <QCryptographicHash>
@@ -34,9 +36,57 @@
 
 #include <QImageWriter>
 #include <QDataStream>
+#include <QElapsedTimer>
+#include <QtEndian>
+
+#include <array>
+#include <vector>
 
 namespace NSABUtils
 {
+    // hashes the file in blockSize steps, if useMemoryMap is set the file is mapped and hashed directly from the mapping
+    // progressFunc is called after every block, returning false stops the hash
+    // returns true when the whole file was hashed
+    static bool hashFile( QFile &file, CContentHash &hash, qint64 blockSize, bool useMemoryMap, const std::function< bool( qint64 pos, bool finished ) > &progressFunc = {} )
+    {
+        if ( blockSize <= 0 )
+            blockSize = CComputeMD5::kDefaultBlockSize;
+        blockSize = std::max( blockSize, hash.preferredBlockSize() );
+
+        auto size = file.size();
+        qint64 pos = 0;
+        if ( useMemoryMap && ( size > 0 ) )
+        {
+            auto data = file.map( 0, size );
+            if ( data )
+            {
+                bool keepGoing = true;
+                while ( keepGoing && ( pos < size ) )
+                {
+                    auto len = std::min( blockSize, size - pos );
+                    hash.addData( QByteArrayView( reinterpret_cast< const char * >( data + pos ), len ) );
+                    pos += len;
+                    if ( progressFunc )
+                        keepGoing = progressFunc( pos, pos == size );
+                }
+                file.unmap( data );
+                return pos == size;
+            }
+        }
+
+        QByteArray buffer( blockSize, Qt::Uninitialized );
+        qint64 len = 0;
+        bool keepGoing = true;
+        while ( keepGoing && ( ( len = file.read( buffer.data(), blockSize ) ) > 0 ) )
+        {
+            hash.addData( QByteArrayView( buffer.constData(), len ) );
+            pos += len;
+            if ( progressFunc )
+                keepGoing = progressFunc( pos, file.atEnd() );
+        }
+        return ( len >= 0 ) && file.atEnd();
+    }
+
     QByteArray formatMd5( const QByteArray &digest, bool isHex )
     {
         QByteArray md5Str = digest;
@@ -61,15 +111,15 @@ namespace NSABUtils
         return md5Str;
     }
 
-    QByteArray getMd5( const QByteArray &data )
+    QByteArray getMd5( const QByteArray &data, EHashAlgorithm algorithm )
     {
-        auto digest = QCryptographicHash::hash( data, QCryptographicHash::Md5 );
+        auto digest = CContentHash::hash( data, algorithm );
         return formatMd5( digest, false );
     }
 
-    QByteArray getMd5( const QStringList &data )
+    QByteArray getMd5( const QStringList &data, EHashAlgorithm algorithm )
     {
-        QCryptographicHash hash( QCryptographicHash::Md5 );
+        CContentHash hash( algorithm );
         for ( auto &&ii : data )
         {
             hash.addData( ii.toLatin1() );
@@ -77,69 +127,87 @@ namespace NSABUtils
         return hash.result();
     }
 
-    QByteArray getMd5( const QString &data, bool isFileName )
+    QByteArray getMd5( const QString &data, bool isFileName, EHashAlgorithm algorithm )
     {
         if ( isFileName )
-            return getMd5( QFileInfo( data ) );
+            return getMd5( QFileInfo( data ), algorithm );
 
         QByteArray inData = data.toLatin1();
-        return getMd5( inData, false );
+        return getMd5( inData, algorithm );
     }
 
-    std::string getMd5( const std::string &data, bool isFileName )
+    std::string getMd5( const std::string &data, bool isFileName, EHashAlgorithm algorithm )
     {
-        return getMd5( QString::fromStdString( data ), isFileName ).toStdString();
-    }
-
-    QByteArray getMd5( const QFileInfo &fi )
-    {
-        QFile file( fi.absoluteFilePath() );
-        if ( !file.open( QIODevice::ReadOnly ) )
-            return {};
-
-        QCryptographicHash hash( QCryptographicHash::Md5 );
-        if ( hash.addData( &file ) )
-            return formatMd5( hash.result(), false );
-
-        return {};
+        return getMd5( QString::fromStdString( data ), isFileName, algorithm ).toStdString();
     }
 
-    SABUTILS_EXPORT QByteArray getMd5( const QPixmap &pixMap )
+    QByteArray getMd5( const QFileInfo &fi, EHashAlgorithm algorithm )
     {
-        return getMd5( pixMap.toImage() );
+        return getMd5( fi, {}, algorithm );
     }
 
-    SABUTILS_EXPORT QByteArray getMd5( const QIcon &icon )
+    QByteArray getMd5( const QFileInfo &fi, const std::function< bool( qint64 pos ) > &progressFunc, EHashAlgorithm algorithm )
     {
-        auto sizes = icon.availableSizes();
-        QCryptographicHash hash( QCryptographicHash::Md5 );
-        for ( auto &&ii : sizes )
+        auto cache = CDigestCache::instance();
+        auto retVal = cache->find( fi, algorithm );
+        if ( !retVal.isEmpty() )
         {
-            auto data = getImageData( icon.pixmap( ii ).toImage() );
-            hash.addData( data );
+            if ( progressFunc )
+                progressFunc( fi.size() );
+            return retVal;
         }
-        return formatMd5( hash.result(), false );
+
+        QFile file( fi.absoluteFilePath() );
+        if ( !file.open( QIODevice::ReadOnly ) )
+            return {};
+
+        // captured before reading, a change during the read makes the entry a miss next time
+        auto node = SFileBasedCacheNode( QFileInfo( fi.absoluteFilePath() ) );
+        CContentHash hash( algorithm );
+        auto func = [ &progressFunc ]( qint64 pos, bool /*finished*/ ) { return !progressFunc || progressFunc( pos ); };
+        if ( !hashFile( file, hash, CComputeMD5::kDefaultBlockSize, false, func ) )
+            return {};
+
+        retVal = formatMd5( hash.result(), false );
+        cache->add( node, algorithm, retVal );
+        return retVal;
     }
 
-    SABUTILS_EXPORT QByteArray getMd5( const QImage &image )
+    SABUTILS_EXPORT QByteArray getMd5( const QPixmap &pixMap, EHashAlgorithm algorithm )
     {
-        QCryptographicHash hash( QCryptographicHash::Md5 );
-        hash.addData( getImageData( image ) );
-        return formatMd5( hash.result(), false );
+        return getMd5( pixMap.toImage(), algorithm );
     }
 
-    SABUTILS_EXPORT QByteArray getImageData( const QImage &img )
+    // walks the same byte stream the QDataStream based serialization produced, without building it
+    // the header is width, height and depth as big endian 32 bit values
+    // 32 bit images are sent a scanline at a time, each prefixed by its big endian length (QDataStream::writeBytes)
+    // note when the scanlines are unpadded only the first scanline is sent, this matches the original output and must be kept so digests do not change
+    // palettized images are expanded to one native endian QRgb per pixel via a lookup table, one scanline at a time
+    // sink is called with each piece of the stream (QByteArrayView)
+    template< typename SinkType >
+    static void visitImageData( const QImage &img, SinkType sink )
     {
         if ( img.isNull() )
-            return {};
-
-        QByteArray retVal;
-        QDataStream ds( &retVal, QDataStream::WriteOnly );
+            return;
 
         auto width = img.width();
         auto height = img.height();
         auto depth = img.depth();
-        ds << width << height << depth;
+
+        auto writeInt = [ &sink ]( quint32 value )
+        {
+            auto beValue = qToBigEndian( value );
+            sink( QByteArrayView( reinterpret_cast< const char * >( &beValue ), sizeof( beValue ) ) );
+        };
+        auto writeBytes = [ &sink, &writeInt ]( const uchar *data, qsizetype len )
+        {
+            writeInt( static_cast< quint32 >( len ) );
+            sink( QByteArrayView( reinterpret_cast< const char * >( data ), len ) );
+        };
+
+        writeInt( width );
+        writeInt( height );
+        writeInt( depth );
 
         auto bpl = img.bytesPerLine();
 
@@ -147,30 +215,84 @@ namespace NSABUtils
         {
             if ( ( img.format() >= QImage::Format::Format_ARGB32 ) && ( ( width * depth / 8 ) == bpl ) )
             {
-                ds.writeBytes( reinterpret_cast< const char * >( img.bits() ), bpl );
+                writeBytes( img.constBits(), bpl );
             }
             else
             {
                 for ( int line = 0; line < height; ++line )
-                {
-                    ds.writeBytes( reinterpret_cast< const char * >( img.constScanLine( line ) ), bpl );
-                }
+                    writeBytes( img.constScanLine( line ), bpl );
             }
+            return;
         }
-        else
+
+        // Mono, MonoLSB and Indexed8
+        std::array< QRgb, 256 > lookup{};
+        auto colorTable = img.colorTable();
+        std::copy_n( colorTable.cbegin(), std::min< qsizetype >( colorTable.size(), lookup.size() ), lookup.begin() );
+
+        std::vector< QRgb > row( width );
+        auto rowView = QByteArrayView( reinterpret_cast< const char * >( row.data() ), static_cast< qsizetype >( row.size() * sizeof( QRgb ) ) );
+        if ( img.format() == QImage::Format::Format_Indexed8 )
         {
-            const QVector< QRgb > &colortable = img.colorTable();
             for ( int y = 0; y < height; ++y )
             {
+                auto scanLine = img.constScanLine( y );
                 for ( int x = 0; x < width; ++x )
-                {
-                    auto curr = colortable[ img.pixelIndex( x, y ) ];
-                    retVal.push_back( QByteArray( reinterpret_cast< const char * >( &curr ), sizeof( QRgb ) ) );
-                }
+                    row[ x ] = lookup[ scanLine[ x ] ];
+                sink( rowView );
+            }
+        }
+        else
+        {
+            // every byte of a 1 bit scanline expands to 8 pixels, build those 8 pixel groups once for all 256 byte values
+            bool msbFirst = img.format() == QImage::Format::Format_Mono;
+            std::vector< std::array< QRgb, 8 > > expanded( 256 );
+            for ( int value = 0; value < 256; ++value )
+            {
+                for ( int bit = 0; bit < 8; ++bit )
+                    expanded[ value ][ bit ] = lookup[ ( value >> ( msbFirst ? ( 7 - bit ) : bit ) ) & 1 ];
+            }
+
+            auto fullBytes = width / 8;
+            auto remainder = width % 8;
+            for ( int y = 0; y < height; ++y )
+            {
+                auto scanLine = img.constScanLine( y );
+                auto pos = row.data();
+                for ( int ii = 0; ii < fullBytes; ++ii, pos += 8 )
+                    std::copy_n( expanded[ scanLine[ ii ] ].cbegin(), 8, pos );
+                if ( remainder )
+                    std::copy_n( expanded[ scanLine[ fullBytes ] ].cbegin(), remainder, pos );
+                sink( rowView );
             }
         }
+    }
+
+    SABUTILS_EXPORT QByteArray getMd5( const QIcon &icon, EHashAlgorithm algorithm )
+    {
+        auto sizes = icon.availableSizes();
+        CContentHash hash( algorithm );
+        for ( auto &&ii : sizes )
+        {
+            visitImageData( icon.pixmap( ii ).toImage(), [ &hash ]( QByteArrayView data ) { hash.addData( data ); } );
+        }
+        return formatMd5( hash.result(), false );
+    }
+
+    SABUTILS_EXPORT QByteArray getMd5( const QImage &image, EHashAlgorithm algorithm )
+    {
+        CContentHash hash( algorithm );
+        visitImageData( image, [ &hash ]( QByteArrayView data ) { hash.addData( data ); } );
+        return formatMd5( hash.result(), false );
+    }
+
+    SABUTILS_EXPORT QByteArray getImageData( const QImage &img )
+    {
+        QByteArray retVal;
+        visitImageData( img, [ &retVal ]( QByteArrayView data ) { retVal.append( data ); } );
         return retVal;
     }
+
     CComputeMD5::CComputeMD5( const QString &fileName ) :
         fFileInfo( fileName )
     {
@@ -208,7 +330,7 @@ namespace NSABUtils
 
     void CComputeMD5::processImage( const QImage &img )
     {
-        fMD5 = getMd5( img );
+        fMD5 = getMd5( img, fAlgorithm );
         emit sigFinishedReading( getThreadID(), QDateTime::currentDateTime(), fFileInfo.absoluteFilePath() );
         emit sigFinishedComputing( getThreadID(), QDateTime::currentDateTime(), fFileInfo.absoluteFilePath() );
     }
@@ -219,20 +341,39 @@ namespace NSABUtils
         if ( !file.open( QIODevice::ReadOnly ) || !file.isReadable() )
             return;
 
-        QCryptographicHash hash( QCryptographicHash::Md5 );
+        auto cache = CDigestCache::instance();
+        auto cached = cache->find( fFileInfo, fAlgorithm );
+        if ( !cached.isEmpty() )
+        {
+            emit sigReadPositionStatus( getThreadID(), QDateTime::currentDateTime(), fFileInfo.absoluteFilePath(), file.size() );
+            emit sigFinishedReading( getThreadID(), QDateTime::currentDateTime(), fFileInfo.absoluteFilePath() );
+            emit sigFinishedComputing( getThreadID(), QDateTime::currentDateTime(), fFileInfo.absoluteFilePath() );
+            fMD5 = cached;
+            return;
+        }
 
-        QByteArray buffer;
+        auto node = SFileBasedCacheNode( QFileInfo( fFileInfo.absoluteFilePath() ) );
+        CContentHash hash( fAlgorithm );
 
-        qint64 pos = 0;
-        while ( !fStopped && ( buffer = file.read( 4096 ) ).length() > 0 )
+        QElapsedTimer timer;
+        timer.start();
+        qint64 lastReportedPos = 0;
+        auto progressFunc = [ this, &timer, &lastReportedPos ]( qint64 pos, bool finished )
         {
-            pos += buffer.length();
-            hash.addData( buffer );
-            emit sigReadPositionStatus( getThreadID(), QDateTime::currentDateTime(), fFileInfo.absoluteFilePath(), pos );
-            processEvents();
-        }
+            bool report = finished || ( ( fProgressInterval == 0 ) && ( fProgressByteInterval == 0 ) );
+            report = report || ( ( fProgressInterval > 0 ) && ( timer.elapsed() >= fProgressInterval ) );
+            report = report || ( ( fProgressByteInterval > 0 ) && ( ( pos - lastReportedPos ) >= fProgressByteInterval ) );
+            if ( report )
+            {
+                lastReportedPos = pos;
+                timer.restart();
+                emit sigReadPositionStatus( getThreadID(), QDateTime::currentDateTime(), fFileInfo.absoluteFilePath(), pos );
+                processEvents();
+            }
+            return !fStopped;
+        };
 
-        if ( file.atEnd() )
+        if ( hashFile( file, hash, fBlockSize, fUseMemoryMap, progressFunc ) )
         {
             emit sigFinishedReading( getThreadID(), QDateTime::currentDateTime(), fFileInfo.absoluteFilePath() );
             if ( fStopped )
@@ -250,6 +391,7 @@ namespace NSABUtils
             }
 
             fMD5 = formatMd5( tmp, false );
+            cache->add( node, fAlgorithm, fMD5 );
         }
     }
 
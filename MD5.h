@@ -24,6 +24,7 @@
 #define __COMMON_MD5_H
 
 #include "SABUtilsExport.h"
+#include "ContentHash.h"
 
 class QByteArray;
 class QFileInfo;
@@ -33,20 +34,24 @@ class QPixmap;
 class QImage;
 #include <QRunnable>
 #include <string>
+#include <algorithm>
 #include <QObject>
 #include <QFileInfo>
+#include <functional>
 
 namespace NSABUtils
 {
-    SABUTILS_EXPORT QByteArray getMd5( const QByteArray &data );
-    SABUTILS_EXPORT QByteArray getMd5( const QFileInfo &fi );
-    SABUTILS_EXPORT QByteArray getMd5( const QStringList &data );
-    SABUTILS_EXPORT QByteArray getMd5( const QString &data, bool isFileName = false );
-    SABUTILS_EXPORT std::string getMd5( const std::string &data, bool isFileName = false );
-
-    SABUTILS_EXPORT QByteArray getMd5( const QIcon &icon );
-    SABUTILS_EXPORT QByteArray getMd5( const QPixmap &pixmap ); // only includes image data
-    SABUTILS_EXPORT QByteArray getMd5( const QImage &img );
+    // algorithm selects the digest, the default is MD5 and the result is always formatted by formatMd5
+    SABUTILS_EXPORT QByteArray getMd5( const QByteArray &data, EHashAlgorithm algorithm = EHashAlgorithm::eMD5 );
+    SABUTILS_EXPORT QByteArray getMd5( const QFileInfo &fi, EHashAlgorithm algorithm = EHashAlgorithm::eMD5 );
+    SABUTILS_EXPORT QByteArray getMd5( const QFileInfo &fi, const std::function< bool( qint64 pos ) > &progressFunc, EHashAlgorithm algorithm = EHashAlgorithm::eMD5 );   // progressFunc is called after every block, return false to stop, returns empty on failure or stop
+    SABUTILS_EXPORT QByteArray getMd5( const QStringList &data, EHashAlgorithm algorithm = EHashAlgorithm::eMD5 );
+    SABUTILS_EXPORT QByteArray getMd5( const QString &data, bool isFileName = false, EHashAlgorithm algorithm = EHashAlgorithm::eMD5 );
+    SABUTILS_EXPORT std::string getMd5( const std::string &data, bool isFileName = false, EHashAlgorithm algorithm = EHashAlgorithm::eMD5 );
+
+    SABUTILS_EXPORT QByteArray getMd5( const QIcon &icon, EHashAlgorithm algorithm = EHashAlgorithm::eMD5 );
+    SABUTILS_EXPORT QByteArray getMd5( const QPixmap &pixmap, EHashAlgorithm algorithm = EHashAlgorithm::eMD5 ); // only includes image data
+    SABUTILS_EXPORT QByteArray getMd5( const QImage &img, EHashAlgorithm algorithm = EHashAlgorithm::eMD5 );
     SABUTILS_EXPORT QByteArray getImageData( const QImage &img );
 
     SABUTILS_EXPORT QByteArray formatMd5( const QByteArray &digest, bool isHex );
@@ -56,7 +61,10 @@ namespace NSABUtils
         Q_OBJECT;
 
     public:
-        CComputeMD5( const QString &fileName );;
+        static constexpr qint64 kDefaultBlockSize{ 1024 * 1024 };
+        static constexpr int kDefaultProgressInterval{ 100 };
+
+        CComputeMD5( const QString &fileName );
 
         void run() override;
 
@@ -66,6 +74,26 @@ namespace NSABUtils
         QByteArray md5() const { return fMD5; }
 
         void stop() { slotStop(); }
+
+        // number of bytes read (or hashed from the mapping) per step, default 1MB
+        void setBlockSize( qint64 blockSize ) { fBlockSize = ( blockSize > 0 ) ? blockSize : kDefaultBlockSize; }
+        qint64 blockSize() const { return fBlockSize; }
+
+        // when true the file is mapped read only and hashed directly from the mapping, falls back to reading if the map fails
+        void setUseMemoryMap( bool value ) { fUseMemoryMap = value; }
+        bool useMemoryMap() const { return fUseMemoryMap; }
+
+        // sigReadPositionStatus (and the event processing) happens only when msecs have passed or bytes have been read since the last report
+        // a value of 0 disables that check, if both are 0 every block is reported
+        void setProgressInterval( int msecs ) { fProgressInterval = std::max( 0, msecs ); }   // default 100ms
+        int progressInterval() const { return fProgressInterval; }
+
+        void setProgressByteInterval( qint64 bytes ) { fProgressByteInterval = std::max< qint64 >( 0, bytes ); }   // default 0, disabled
+        qint64 progressByteInterval() const { return fProgressByteInterval; }
+
+        void setAlgorithm( EHashAlgorithm algorithm ) { fAlgorithm = algorithm; }   // default MD5
+        EHashAlgorithm algorithm() const { return fAlgorithm; }
+
     Q_SIGNALS:
         void sigStarted( unsigned long long threadID, const QDateTime &dt, const QString &filename );
         void sigFinishedReading( unsigned long long threadID, const QDateTime &dt, const QString &filename );
@@ -87,6 +115,11 @@ namespace NSABUtils
         QFileInfo fFileInfo;
         QByteArray fMD5;
         bool fStopped{ false };
+        qint64 fBlockSize{ kDefaultBlockSize };
+        bool fUseMemoryMap{ false };
+        int fProgressInterval{ kDefaultProgressInterval };
+        qint64 fProgressByteInterval{ 0 };
+        EHashAlgorithm fAlgorithm{ EHashAlgorithm::eMD5 };
     };
 
 }
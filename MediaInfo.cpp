@@ -23,11 +23,15 @@
 #include "MediaInfo.h"
 #include "MKVUtils.h"
 #include "FileBasedCache.h"
+#include "FileWatcher.h"
+#include "MetadataStore.h"
 #include "FFMpegFormats.h"
 #include "QtUtils.h"
 
 #include "utils.h"
 #include "FileUtils.h"
+#include <QDataStream>
+#include <QDir>
 #include <QFileInfo>
 #include <QRegularExpression>
 #include <QDebug>
@@ -35,6 +39,7 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QStandardPaths>
 #include <QThreadPool>
 #include <QTimer>
 
@@ -69,8 +74,19 @@ namespace NSABUtils
         }
 
         size_t size() const { return fStreamData.size(); }
+        // the strings are shared with the maps, so they are counted once
+        std::size_t estimatedSize() const
+        {
+            auto retVal = sizeof( *this ) + fKnownTagStreamDataMap.size() * 4 * sizeof( QString );
+            for ( auto &&ii : fStreamData )
+                retVal += ( ii.first.size() + ii.second.size() ) * sizeof( QChar ) + 6 * sizeof( QString );
+            return retVal;
+        }
         std::pair< QString, QString > operator[]( size_t idx ) const { return fStreamData[ idx ]; }
 
+        void write( QDataStream &ds ) const;
+        void read( QDataStream &ds );
+
         bool postProcess()
         {
             if ( fStreamType == EStreamType::eAudio )
@@ -392,35 +408,91 @@ namespace NSABUtils
         return ( pos != fStreamDataMap.end() );
     }
 
+    void CStreamData::write( QDataStream &ds ) const
+    {
+        ds << static_cast< qint32 >( fStreamType ) << static_cast< qint32 >( fStreamNum ) << fIsDefault;
+        ds << static_cast< quint32 >( fStreamData.size() );
+        for ( auto &&ii : fStreamData )
+            ds << ii.first << ii.second;
+
+        // replaceData can leave a value in the map that the pairs do not have (FFMpegCodec for instance), only those differences are written
+        std::map< QString, QString > replayed;
+        for ( auto &&ii : fStreamData )
+            replayed[ ii.first ] = ii.second;
+        std::vector< std::pair< QString, QString > > mapOnly;
+        for ( auto &&ii : fStreamDataMap )
+        {
+            auto pos = replayed.find( ii.first );
+            if ( ( pos == replayed.end() ) || ( ( *pos ).second != ii.second ) )
+                mapOnly.push_back( ii );
+        }
+        ds << static_cast< quint32 >( mapOnly.size() );
+        for ( auto &&ii : mapOnly )
+            ds << ii.first << ii.second;
+    }
+
+    void CStreamData::read( QDataStream &ds )
+    {
+        qint32 streamType = 0;
+        qint32 streamNum = 0;
+        quint32 numData = 0;
+        ds >> streamType >> streamNum >> fIsDefault >> numData;
+        fStreamType = static_cast< EStreamType >( streamType );
+        fStreamNum = streamNum;
+
+        fStreamData.clear();
+        fStreamDataMap.clear();
+        for ( quint32 ii = 0; ( ii < numData ) && ( ds.status() == QDataStream::Ok ); ++ii )
+        {
+            QString name;
+            QString value;
+            ds >> name >> value;
+            fStreamDataMap[ name ] = value;
+            fStreamData.emplace_back( std::move( name ), std::move( value ) );
+        }
+
+        quint32 numMapOnly = 0;
+        ds >> numMapOnly;
+        for ( quint32 ii = 0; ( ii < numMapOnly ) && ( ds.status() == QDataStream::Ok ); ++ii )
+        {
+            QString name;
+            QString value;
+            ds >> name >> value;
+            fStreamDataMap[ name ] = value;
+        }
+    }
+
     class CMediaInfoImpl
     {
     public:
-        static CFileBasedCache< std::shared_ptr< CMediaInfoImpl > > sMediaInfoCache;
+        static CConcurrentFileBasedCache< std::shared_ptr< CMediaInfoImpl > > sMediaInfoCache;   // used from the loading threads and the gui thread
         static QString sFFProbeEXE;
+        static constexpr quint32 kDatabaseSchemaVersion{ 1 };   // bump when write or read (here or in CStreamData) change
+        static CMetadataStore sDatabase;   // parsed files from earlier runs, unused until it is opened
 
         static std::shared_ptr< CMediaInfoImpl > createImpl()
         {
-            auto retVal = sMediaInfoCache.find( QString() );
-            if ( !retVal )
-            {
-                static std::shared_ptr< CMediaInfoImpl > sNullImpl = std::make_shared< CMediaInfoImpl >();
-                retVal = sNullImpl;
-                sMediaInfoCache.add( retVal );
-            }
-            return retVal;
+            return sMediaInfoCache.findOrCreate(
+                QString(),
+                []()
+                {
+                    static std::shared_ptr< CMediaInfoImpl > sNullImpl = std::make_shared< CMediaInfoImpl >();
+                    return sNullImpl;
+                } );
         }
 
+        // two threads asking for the same file share one load
         static std::shared_ptr< CMediaInfoImpl > createImpl( const QFileInfo &fi, bool loadNow )
         {
-            auto retVal = sMediaInfoCache.find( fi.absoluteFilePath() );
-            if ( !retVal )
-            {
-                retVal = std::make_shared< CMediaInfoImpl >( fi );
-                if ( loadNow )
-                    retVal->load();
-                sMediaInfoCache.add( retVal );
-            }
-            return retVal;
+            return sMediaInfoCache.findOrCreate(
+                fi,
+                [ &fi, loadNow ]()
+                {
+                    auto retVal = std::make_shared< CMediaInfoImpl >( fi );
+                    if ( !retVal->loadFromDatabase() && loadNow )
+                        retVal->load();
+                    return retVal;
+                } );
         }
 
         static std::shared_ptr< CMediaInfoImpl > createImpl( const QString &path, bool loadNow ) { return createImpl( std::move( QFileInfo( path ) ), loadNow ); }
@@ -468,16 +540,134 @@ namespace NSABUtils
 
         bool load()
         {
+            auto node = SFileBasedCacheNode( QFileInfo( fFileName ) );   // the file as it was before parsing, so a change while parsing is a miss later
             fAOK = initMediaInfo();
             fAOK = loadInfoFromFFProbe() && fAOK;
             fAOK = postProcess() && fAOK;
+            if ( fAOK )
+                saveToDatabase( node );
+            return fAOK;
+        }
+
+        // the streams as parsed in an earlier run, when the file has not changed since
+        bool loadFromDatabase()
+        {
+            if ( fFileName.isEmpty() || !sDatabase.isOpen() )
+                return false;
+
+            auto record = sDatabase.find( QFileInfo( fFileName ) );
+            if ( record.isEmpty() )
+                return false;
+
+            QDataStream ds( record );
+            ds.setVersion( QDataStream::Qt_6_0 );
+            read( ds );
+            fAOK = ds.status() == QDataStream::Ok;
+            if ( !fAOK )
+            {
+                fDefaultStreams.clear();
+                fData.clear();
+                fFFProbeData.clear();
+            }
             return fAOK;
         }
 
+        void saveToDatabase( const SFileBasedCacheNode &node ) const
+        {
+            if ( fFileName.isEmpty() || !sDatabase.isOpen() )
+                return;
+
+            QByteArray record;
+            QDataStream ds( &record, QIODevice::WriteOnly );
+            ds.setVersion( QDataStream::Qt_6_0 );
+            write( ds );
+            sDatabase.add( node, record );
+        }
+
+        // the parsed data, the file name is the key of the record
+        void write( QDataStream &ds ) const
+        {
+            ds << fVersion;
+            ds << static_cast< quint32 >( fDefaultStreams.size() );
+            for ( auto &&ii : fDefaultStreams )
+                ds << static_cast< qint32 >( ii.first ) << static_cast< quint64 >( ii.second );
+
+            ds << static_cast< quint32 >( fData.size() );
+            for ( auto &&ii : fData )
+            {
+                ds << static_cast< qint32 >( ii.first ) << static_cast< quint32 >( ii.second.size() );
+                for ( auto &&jj : ii.second )
+                {
+                    if ( jj )
+                        jj->write( ds );
+                    else
+                        CStreamData().write( ds );
+                }
+            }
+
+            ds << static_cast< quint32 >( fFFProbeData.size() );
+            for ( auto &&ii : fFFProbeData )
+                ds << static_cast< qint32 >( std::get< 0 >( ii ) ) << static_cast< qint32 >( std::get< 1 >( ii ) ) << std::get< 2 >( ii );
+        }
+
+        void read( QDataStream &ds )
+        {
+            ds >> fVersion;
+            quint32 numDefaults = 0;
+            ds >> numDefaults;
+            for ( quint32 ii = 0; ( ii < numDefaults ) && ( ds.status() == QDataStream::Ok ); ++ii )
+            {
+                qint32 streamType = 0;
+                quint64 streamNum = 0;
+                ds >> streamType >> streamNum;
+                fDefaultStreams[ static_cast< EStreamType >( streamType ) ] = static_cast< size_t >( streamNum );
+            }
+
+            quint32 numTypes = 0;
+            ds >> numTypes;
+            for ( quint32 ii = 0; ( ii < numTypes ) && ( ds.status() == QDataStream::Ok ); ++ii )
+            {
+                qint32 streamType = 0;
+                quint32 numStreams = 0;
+                ds >> streamType >> numStreams;
+                auto &&streams = fData[ static_cast< EStreamType >( streamType ) ];
+                for ( quint32 jj = 0; ( jj < numStreams ) && ( ds.status() == QDataStream::Ok ); ++jj )
+                {
+                    auto stream = std::make_shared< CStreamData >();
+                    stream->read( ds );
+                    streams.push_back( stream );
+                }
+            }
+
+            quint32 numFFProbe = 0;
+            ds >> numFFProbe;
+            for ( quint32 ii = 0; ( ii < numFFProbe ) && ( ds.status() == QDataStream::Ok ); ++ii )
+            {
+                qint32 streamType = 0;
+                qint32 streamNum = 0;
+                QString value;
+                ds >> streamType >> streamNum >> value;
+                fFFProbeData.emplace_back( static_cast< EStreamType >( streamType ), streamNum, value );
+            }
+        }
+
         bool aOK() const { return fAOK; }
         QString fileName() const { return fFileName; }
         QString version() const { return fVersion; }
 
+        std::size_t estimatedSize() const
+        {
+            auto retVal = sizeof( *this ) + fFileName.size() * sizeof( QChar );
+            for ( auto &&ii : fData )
+            {
+                for ( auto &&jj : ii.second )
+                    retVal += jj ? jj->estimatedSize() : 0;
+            }
+            for ( auto &&ii : fFFProbeData )
+                retVal += sizeof( ii ) + std::get< 2 >( ii ).size() * sizeof( QChar );
+            return retVal;
+        }
+
         bool initMediaInfo()
         {
             auto mediaInfo = std::make_unique< MediaInfoDLL::MediaInfo >();
@@ -1199,8 +1389,9 @@ namespace NSABUtils
         bool fQueued{ false };
     };
 
-    CFileBasedCache< std::shared_ptr< CMediaInfoImpl > > CMediaInfoImpl::sMediaInfoCache;
+    CConcurrentFileBasedCache< std::shared_ptr< CMediaInfoImpl > > CMediaInfoImpl::sMediaInfoCache;
     QString CMediaInfoImpl::sFFProbeEXE;
+    CMetadataStore CMediaInfoImpl::sDatabase( CMediaInfoImpl::kDatabaseSchemaVersion );
 
     void CMediaInfo::setFFProbeEXE( const QString &path )
     {
@@ -1212,22 +1403,58 @@ namespace NSABUtils
         return CMediaInfoImpl::sFFProbeEXE;
     }
 
+    void CMediaInfo::setFileWatcher( CFileWatcher *watcher )
+    {
+        if ( auto current = CMediaInfoImpl::sMediaInfoCache.watcher() )
+            current->unregisterCache( &CMediaInfoImpl::sMediaInfoCache );
+        if ( watcher )
+            watcher->registerCache( &CMediaInfoImpl::sMediaInfoCache );
+    }
+
+    void CMediaInfo::setCacheLimits( std::size_t maxEntries, std::size_t maxBytes )
+    {
+        CMediaInfoImpl::sMediaInfoCache.setLimits( maxEntries, maxBytes, []( const std::shared_ptr< CMediaInfoImpl > &impl ) { return impl ? impl->estimatedSize() : 0; } );
+    }
+
+    SFileBasedCacheStats CMediaInfo::cacheStats()
+    {
+        return CMediaInfoImpl::sMediaInfoCache.stats();
+    }
+
+    QString CMediaInfo::defaultDatabaseFileName()
+    {
+        return QDir( QStandardPaths::writableLocation( QStandardPaths::CacheLocation ) ).absoluteFilePath( "mediainfo.dat" );
+    }
+
+    bool CMediaInfo::openDatabase( const QString &fileName, QString *msg )
+    {
+        return CMediaInfoImpl::sDatabase.open( fileName.isEmpty() ? defaultDatabaseFileName() : fileName, msg );
+    }
+
+    void CMediaInfo::closeDatabase()
+    {
+        CMediaInfoImpl::sDatabase.close();
+    }
+
     CMediaInfo::CMediaInfo() :
         fImpl( nullptr )
     {
         fImpl = CMediaInfoImpl::createImpl();
+        CMediaInfoImpl::sMediaInfoCache.pin( fImpl->fileName() );
     }
 
     CMediaInfo::CMediaInfo( const QString &fileName, bool loadNow /*= true*/ ) :
         fImpl( nullptr )
     {
         fImpl = CMediaInfoImpl::createImpl( fileName, loadNow );
+        CMediaInfoImpl::sMediaInfoCache.pin( fImpl->fileName() );
     }
 
     CMediaInfo::CMediaInfo( const QFileInfo &fi, bool loadNow /*= true*/ ) :
         fImpl( nullptr )
     {
         fImpl = CMediaInfoImpl::createImpl( fi, loadNow );
+        CMediaInfoImpl::sMediaInfoCache.pin( fImpl->fileName() );
     }
 
     CMediaInfo::CMediaInfo( const QString &fileName ) :   // loads immediately use the mgr for delayed load
@@ -1257,6 +1484,7 @@ namespace NSABUtils
 
     CMediaInfo ::~CMediaInfo()
     {
+        CMediaInfoImpl::sMediaInfoCache.unpin( fImpl->fileName() );
     }
 
     bool CMediaInfo ::aOK() const
@@ -1772,6 +2000,9 @@ namespace NSABUtils
     std::shared_ptr< CMediaInfo > CMediaInfoMgr::getMediaInfo( const QFileInfo &fi )
     {
         auto retVal = std::shared_ptr< CMediaInfo >( new CMediaInfo( fi, false ) );
+        if ( retVal->aOK() )   // parsed earlier in this run, or found unchanged in the database
+            return retVal;
+
         fMutex.lock();
         fQueuedMediaInfo[ fi.absoluteFilePath() ] = retVal;
         fMutex.unlock();
@@ -168,6 +168,8 @@ namespace NSABUtils
 
     class CStreamData;
     class CMediaInfoImpl;
+    class CFileWatcher;
+    struct SFileBasedCacheStats;
     struct SABUTILS_EXPORT SResolutionInfo
     {
         std::pair< int, int > fResolution{ 0, 0 };
@@ -211,6 +213,21 @@ namespace NSABUtils
         static void setFFProbeEXE( const QString &path );
         static QString ffprobeEXE();
 
+        // the media info cache takes its invalidations from the watcher, and skips the stat on lookups of watched files, nullptr stops
+        static void setFileWatcher( CFileWatcher *watcher );
+
+        // the media info cache is unbounded by default, 0 is unlimited, maxBytes is estimated from the parsed data when a file is added
+        // the limits are approximate, they are split over the cache's 16 shards and a limit below 16 still keeps up to one file per shard
+        // a file with a live CMediaInfo is pinned and never evicted
+        static void setCacheLimits( std::size_t maxEntries, std::size_t maxBytes = 0 );
+        static SFileBasedCacheStats cacheStats();
+
+        // every parsed file (its streams, default streams and ffprobe data) is saved to the database, keyed by path, size and modification time
+        // on later runs an unchanged file is read from the database rather than parsed, the database is not used until it is opened
+        static QString defaultDatabaseFileName();   // <cache location>/mediainfo.dat
+        static bool openDatabase( const QString &fileName = {}, QString *msg = nullptr );   // empty uses defaultDatabaseFileName
+        static void closeDatabase();
+
         CMediaInfo( const QString &fileName );
         CMediaInfo( const QFileInfo &fi );
         ~CMediaInfo();
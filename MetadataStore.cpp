@@ -0,0 +1,312 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "MetadataStore.h"
+#include "FileBasedCache.h"
+#include "RecordLog.h"
+
+#include <QDataStream>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QObject>
+
+#include <vector>
+
+namespace NSABUtils
+{
+    namespace
+    {
+        constexpr quint32 kMagic = 0x5341424D;   // SABM
+        constexpr quint32 kVersion = 1;
+
+        enum class ERecordType : quint8
+        {
+            eAdd = 1,
+            eInvalidate = 2
+        };
+
+        // returns the offset of the record, where its length is written
+        qint64 writeAddRecord( QDataStream &ds, const SFileBasedCacheNode &node, const QByteArray &record )
+        {
+            ds << static_cast< quint8 >( ERecordType::eAdd ) << node.filePath() << static_cast< quint64 >( node.size() ) << node.modificationTime().toMSecsSinceEpoch();
+            auto retVal = ds.device()->pos();
+            ds << record;
+            return retVal;
+        }
+    }
+
+    class CMetadataStoreImpl
+    {
+    public:
+        CMetadataStoreImpl( quint32 schemaVersion ) :
+            fLog( kMagic, kVersion, schemaVersion )
+        {
+            fLog.setAutoCompactRatio( 2 );
+        }
+
+        bool open( const QString &fileName, QString *msg );
+        void close();
+
+        bool readIndexRecord( QDataStream &ds );
+        bool compact( QString *msg );
+        void autoCompact();
+
+        QByteArray readRecord( qint64 offset );
+
+        mutable QMutex fMutex;
+        CRecordLog fLog;
+        CFileBasedCache< qint64 > fIndex;   // the offset of each record, 0 is the header so it is never a record
+    };
+
+    CMetadataStore::CMetadataStore( quint32 schemaVersion ) :
+        fImpl( std::make_unique< CMetadataStoreImpl >( schemaVersion ) )
+    {
+    }
+
+    CMetadataStore::~CMetadataStore()
+    {
+        close();
+    }
+
+    bool CMetadataStore::open( const QString &fileName, QString *msg )
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        return fImpl->open( fileName, msg );
+    }
+
+    void CMetadataStore::close()
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        fImpl->close();
+    }
+
+    bool CMetadataStore::isOpen() const
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        return fImpl->fLog.isOpen();
+    }
+
+    QString CMetadataStore::fileName() const
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        return fImpl->fLog.fileName();
+    }
+
+    quint32 CMetadataStore::schemaVersion() const
+    {
+        return fImpl->fLog.schemaVersion();
+    }
+
+    QByteArray CMetadataStore::find( const QFileInfo &fi ) const
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        if ( !fImpl->fLog.isOpen() )
+            return {};
+
+        // looked up by path and stat'ed again, so a file info made before the file changed still misses
+        auto offset = fImpl->fIndex.find( QFileInfo( fi.absoluteFilePath() ) );
+        if ( offset <= 0 )
+            return {};
+        return fImpl->readRecord( offset );
+    }
+
+    void CMetadataStore::add( const QFileInfo &fi, const QByteArray &record )
+    {
+        add( SFileBasedCacheNode( QFileInfo( fi.absoluteFilePath() ) ), record );
+    }
+
+    void CMetadataStore::add( const SFileBasedCacheNode &node, const QByteArray &record )
+    {
+        if ( record.isEmpty() )
+            return;
+
+        QMutexLocker locker( &fImpl->fMutex );
+        if ( !fImpl->fLog.isOpen() )
+            return;
+
+        auto offset = writeAddRecord( fImpl->fLog.appendStream(), node, record );
+        fImpl->fLog.recordAdded();
+        fImpl->fIndex.add( node, offset );
+        fImpl->autoCompact();
+    }
+
+    void CMetadataStore::invalidate( const QString &path )
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        if ( !fImpl->fLog.isOpen() )
+            return;
+
+        auto absPath = QFileInfo( path ).absoluteFilePath();
+        if ( !fImpl->fIndex.contains( absPath, true ) )
+            return;
+
+        fImpl->fIndex.remove( absPath );
+        fImpl->fLog.appendStream() << static_cast< quint8 >( ERecordType::eInvalidate ) << absPath;
+        fImpl->fLog.recordAdded();
+    }
+
+    void CMetadataStore::invalidateAll()
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        if ( !fImpl->fLog.isOpen() )
+            return;
+
+        fImpl->fIndex.clear();
+        fImpl->compact( nullptr );
+    }
+
+    bool CMetadataStore::compact( QString *msg )
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        if ( !fImpl->fLog.isOpen() )
+        {
+            if ( msg )
+                *msg = QObject::tr( "Metadata store is not open" );
+            return false;
+        }
+        return fImpl->compact( msg );
+    }
+
+    void CMetadataStore::setAutoCompactRatio( int value )
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        fImpl->fLog.setAutoCompactRatio( value );
+    }
+
+    int CMetadataStore::autoCompactRatio() const
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        return fImpl->fLog.autoCompactRatio();
+    }
+
+    std::size_t CMetadataStore::numEntries() const
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        return fImpl->fIndex.size();
+    }
+
+    std::size_t CMetadataStore::numRecords() const
+    {
+        QMutexLocker locker( &fImpl->fMutex );
+        return fImpl->fLog.numRecords();
+    }
+
+    bool CMetadataStoreImpl::open( const QString &fileName, QString *msg )
+    {
+        close();
+        if ( !fLog.open( fileName, [ this ]( QDataStream &ds ) { return readIndexRecord( ds ); }, msg ) )
+        {
+            fIndex.clear();
+            return false;
+        }
+        return true;
+    }
+
+    void CMetadataStoreImpl::close()
+    {
+        fLog.close();
+        fIndex.clear();
+    }
+
+    bool CMetadataStoreImpl::readIndexRecord( QDataStream &ds )
+    {
+        // only the keys are read, each record is skipped over and read when its file is found
+        quint8 type = 0;
+        ds >> type;
+        if ( type == static_cast< quint8 >( ERecordType::eAdd ) )
+        {
+            QString path;
+            quint64 size = 0;
+            qint64 msecs = 0;
+            quint32 length = 0;
+            ds >> path >> size >> msecs;
+            auto offset = ds.device()->pos();
+            ds >> length;
+            auto next = offset + static_cast< qint64 >( sizeof( length ) ) + length;
+            if ( ( ds.status() != QDataStream::Ok ) || ( length == 0xFFFFFFFF ) || ( next > ds.device()->size() ) || !ds.device()->seek( next ) )
+                return false;
+
+            fIndex.add( SFileBasedCacheNode( path, size, QDateTime::fromMSecsSinceEpoch( msecs ) ), offset );
+            return true;
+        }
+        else if ( type == static_cast< quint8 >( ERecordType::eInvalidate ) )
+        {
+            QString path;
+            ds >> path;
+            if ( ds.status() != QDataStream::Ok )
+                return false;
+            fIndex.remove( path );
+            return true;
+        }
+        return false;
+    }
+
+    QByteArray CMetadataStoreImpl::readRecord( qint64 offset )
+    {
+        QByteArray retVal;
+        if ( fLog.seek( offset ) )
+            fLog.stream() >> retVal;
+        if ( fLog.stream().status() != QDataStream::Ok )
+        {
+            fLog.stream().resetStatus();
+            retVal.clear();
+        }
+        return retVal;
+    }
+
+    void CMetadataStoreImpl::autoCompact()
+    {
+        if ( fLog.needsCompact( fIndex.size() ) )
+            compact( nullptr );
+    }
+
+    bool CMetadataStoreImpl::compact( QString *msg )
+    {
+        // the live records are copied from the current log, the index is only moved to the new offsets once the new log is in place
+        std::vector< std::pair< SFileBasedCacheNode, qint64 > > offsets;
+        auto aOK = fLog.compact(
+            [ this, &offsets ]( QDataStream &ds )
+            {
+                offsets.reserve( fIndex.size() );
+                fIndex.forEach(
+                    [ this, &ds, &offsets ]( const SFileBasedCacheNode &node, qint64 offset )
+                    {
+                        auto record = readRecord( offset );
+                        if ( !record.isEmpty() )
+                            offsets.emplace_back( node, writeAddRecord( ds, node, record ) );
+                    } );
+                return offsets.size();
+            },
+            msg );
+
+        if ( !fLog.isOpen() )
+            fIndex.clear();
+        else if ( aOK )
+        {
+            fIndex.clear();
+            for ( auto &&ii : offsets )
+                fIndex.add( ii.first, ii.second );
+        }
+        return aOK;
+    }
+}
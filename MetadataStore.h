@@ -0,0 +1,75 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#ifndef __METADATASTORE_H
+#define __METADATASTORE_H
+
+#include "SABUtilsExport.h"
+
+#include <QByteArray>
+#include <QString>
+#include <memory>
+
+class QFileInfo;
+namespace NSABUtils
+{
+    struct SFileBasedCacheNode;
+
+    // persistent store of one opaque record per file, keyed by path, size and modification time (SFileBasedCacheNode)
+    // so data derived from an unchanged file is found without opening it again, and any change to the file is a miss
+    //
+    // like the digest cache the store is an append only log, but only the index (node and file offset) is kept in memory
+    // a record is read from disk when it is found, so opening a large store only reads the keys
+    // the schema version belongs to the owner of the records, a store written with a different schema is discarded when opened
+    class CMetadataStoreImpl;
+    class SABUTILS_EXPORT CMetadataStore
+    {
+    public:
+        CMetadataStore( quint32 schemaVersion );
+        ~CMetadataStore();
+
+        bool open( const QString &fileName, QString *msg = nullptr );   // fails without touching a file that is not a metadata store
+        void close();
+        bool isOpen() const;
+        QString fileName() const;
+        quint32 schemaVersion() const;
+
+        // returns an empty record if the file has changed or was never added
+        QByteArray find( const QFileInfo &fi ) const;
+        void add( const SFileBasedCacheNode &node, const QByteArray &record );   // node is the file as it was when the record was made
+        void add( const QFileInfo &fi, const QByteArray &record );   // uses the current size and timestamp of the file
+
+        void invalidate( const QString &path );
+        void invalidateAll();
+
+        bool compact( QString *msg = nullptr );
+        void setAutoCompactRatio( int value );   // default 2, compacts when there are more than ratio x the live records, 0 disables
+        int autoCompactRatio() const;
+
+        std::size_t numEntries() const;   // live files
+        std::size_t numRecords() const;   // records in the log
+
+    private:
+        std::unique_ptr< CMetadataStoreImpl > fImpl;
+    };
+}
+
+#endif
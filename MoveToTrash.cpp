@@ -21,6 +21,7 @@
 // SOFTWARE.
 
 #include "MoveToTrash.h"
+#include "FileUtils.h"
 
 #include <QFileInfo>
 #include <QDir>
@@ -48,6 +49,9 @@ namespace NSABUtils
         bool moveToTrashImpl( const QString &path, QString *msg, std::shared_ptr< SRecycleOptions > options );
         bool moveToTrash( const QString &path, QString *msg, std::shared_ptr< SRecycleOptions > options )
         {
+            if ( !options )
+                options = std::make_shared< SRecycleOptions >();
+
             QFileInfo fi( path );
             auto nativePath = QDir::toNativeSeparators( fi.absoluteFilePath() );
             if ( options->fVerbose )
@@ -60,12 +64,55 @@ namespace NSABUtils
                     *msg = QObject::tr( "Could not move '%1' to the recycle bin." ).arg( path );
                 if ( options->fDeleteOnRecycleFailure )
                 {
-                    aOK = QFile::remove( path );
-                    if ( !aOK )
+                    // directories are removed as well as files
+                    aOK = removePaths( { path } ).fAOK;
+                    if ( !aOK && msg )
                         *msg += QObject::tr( "\nCould not remove '%1'." ).arg( path );
                 }
             }
             return aOK;
         }
+
+        std::vector< STrashResult > moveFilesToTrashImpl( const QStringList &paths, std::shared_ptr< SRecycleOptions > options );
+#ifndef Q_OS_LINUX
+        std::vector< STrashResult > moveFilesToTrashImpl( const QStringList &paths, std::shared_ptr< SRecycleOptions > options )
+        {
+            std::vector< STrashResult > retVal( paths.size() );
+            for ( qsizetype ii = 0; ii < paths.size(); ++ii )
+            {
+                retVal[ ii ].fPath = paths[ ii ];
+                retVal[ ii ].fAOK = moveToTrashImpl( QDir::toNativeSeparators( paths[ ii ] ), &retVal[ ii ].fErrorMsg, options );
+            }
+            return retVal;
+        }
+#endif
+
+        std::vector< STrashResult > moveFilesToTrash( const QStringList &paths, std::shared_ptr< SRecycleOptions > options )
+        {
+            if ( !options )
+                options = std::make_shared< SRecycleOptions >();
+
+            QStringList absPaths;
+            absPaths.reserve( paths.size() );
+            for ( auto &&ii : paths )
+                absPaths << QFileInfo( ii ).absoluteFilePath();
+
+            auto retVal = moveFilesToTrashImpl( absPaths, options );
+            for ( qsizetype ii = 0; ii < paths.size(); ++ii )
+            {
+                auto &&curr = retVal[ ii ];
+                curr.fPath = paths[ ii ];
+                if ( options->fVerbose )
+                    std::cout << "Recycle of '" << QDir::toNativeSeparators( absPaths[ ii ] ).toStdString() << "' " << ( curr.fAOK ? "succeeded" : "failed" ) << "." << std::endl;
+                if ( curr.fAOK || !options->fDeleteOnRecycleFailure )
+                    continue;
+
+                auto removed = removePaths( { absPaths[ ii ] } );
+                curr.fAOK = removed.fAOK;
+                if ( !curr.fAOK )
+                    curr.fErrorMsg += QObject::tr( "\nCould not remove '%1'." ).arg( paths[ ii ] );
+            }
+            return retVal;
+        }
     }
 }
@@ -30,6 +30,7 @@
 #include <set>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 #include <QStringList>
 #include <QFileDevice>
 #include <QList>
@@ -57,6 +58,19 @@ namespace NSABUtils
         SABUTILS_EXPORT bool moveToTrash( const QFileInfo &info, QString *msg = nullptr, std::shared_ptr< SRecycleOptions > options = {} );
         SABUTILS_EXPORT bool moveToTrash( const QString &fileName, QString *msg = nullptr, std::shared_ptr< SRecycleOptions > options = {} );
         SABUTILS_EXPORT bool moveToTrash( const std::string &fileName, std::string *msg = nullptr, std::shared_ptr< SRecycleOptions > options = {} );
+
+        struct SABUTILS_EXPORT STrashResult
+        {
+            QString fPath;
+            bool fAOK{ false };   // a path that does not exist is not an error
+            QString fErrorMsg;
+            QString fTrashPath;   // where it was moved, empty when it was removed (fDeleteOnRecycleFailure) or not found
+        };
+
+        // on linux each path goes to the XDG trash of its own file system ($topdir/.Trash/$uid or $topdir/.Trash-$uid, the home trash on the home file system)
+        // so it is always a rename, each trash directory is scanned once for the names in use and the .trashinfo files are written before the renames
+        // the results are in the order of paths
+        SABUTILS_EXPORT std::vector< STrashResult > moveFilesToTrash( const QStringList &paths, std::shared_ptr< SRecycleOptions > options = {} );
     }
 }
 #endif
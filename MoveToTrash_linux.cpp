@@ -21,70 +21,311 @@
 // SOFTWARE.
 
 #include "MoveToTrash.h"
+#include "DirReader.h"
 
 #include <QString>
+#include <QFile>
 #include <QFileInfo>
 #include <QDateTime>
 #include <QDir>
-#include <QTextStream>
-#include <QFileInfo>
 #include <QUrl>
 
-namespace NFileUtils
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace NSABUtils
 {
-    bool moveToTrashImpl( const QString &fileName, QString *msg, std::shared_ptr< SRecycleOptions > options )
+    namespace NFileUtils
     {
-        QFileInfo fi( fileName );
-        if ( !fi.exists() )
+        namespace
         {
-            if ( msg )
-                *msg = QObject::tr( "File or Directory '%1' does not exist." ).arg( fileName );
+            QString errnoString( int error )
+            {
+                return QString::fromLocal8Bit( strerror( error ) );
+            }
 
-            return true;
-        }
+            // the files and info directories of one trash, with every name already in use
+            struct STrashDir
+            {
+                bool fAOK{ false };
+                QString fErrorMsg;
+                QString fTopDir;   // the info files record paths relative to it, empty for the home trash which records absolute paths
+                QString fFilesDir;
+                QString fInfoDir;
+                std::unordered_set< std::string > fUsedNames;
+            };
 
-        auto currentTime = QDateTime::currentDateTime();
+            bool makeDir( const QString &path, mode_t mode )
+            {
+                if ( ::mkdir( QFile::encodeName( path ).constData(), mode ) == 0 )
+                    return true;
+                if ( errno != EEXIST )
+                    return false;
 
-        QString trashFilePath = QDir::homePath() + "/.local/share/Trash/files/";   // trash file path contain delete files
-        QString trashInfoPath = QDir::homePath() + "/.local/share/Trash/info/";   // trash info path contain delete files information
+                struct stat st;
+                return ( ::lstat( QFile::encodeName( path ).constData(), &st ) == 0 ) && S_ISDIR( st.st_mode );
+            }
 
-        if ( !NFileUtils::mkdir( trashFilePath.toStdString(), true ) )
-        {
-            if ( msg )
-                *msg = QString::tr( "Could not make directory '%1'" ).arg( trashFilePath );
-            return false;
+            // one scan of each directory for the names in use, .trashinfo is dropped from the info names
+            void scanNames( STrashDir &trashDir )
+            {
+                CDirReader::SEntry entry;
+                CDirReader files( QFile::encodeName( trashDir.fFilesDir ).constData() );
+                while ( files.next( entry ) )
+                    trashDir.fUsedNames.insert( entry.fName );
+
+                static const std::string kSuffix = ".trashinfo";
+                CDirReader infos( QFile::encodeName( trashDir.fInfoDir ).constData() );
+                while ( infos.next( entry ) )
+                {
+                    std::string name( entry.fName );
+                    if ( ( name.length() > kSuffix.length() ) && ( name.compare( name.length() - kSuffix.length(), kSuffix.length(), kSuffix ) == 0 ) )
+                        trashDir.fUsedNames.insert( name.substr( 0, name.length() - kSuffix.length() ) );
+                }
+            }
+
+            bool openTrashDir( STrashDir &trashDir, const QString &trashPath, mode_t mode )
+            {
+                trashDir.fFilesDir = trashPath + "/files";
+                trashDir.fInfoDir = trashPath + "/info";
+                if ( !makeDir( trashPath, mode ) || !makeDir( trashDir.fFilesDir, mode ) || !makeDir( trashDir.fInfoDir, mode ) )
+                {
+                    trashDir.fErrorMsg = QObject::tr( "Could not make the trash directory '%1': %2" ).arg( trashPath ).arg( errnoString( errno ) );
+                    return false;
+                }
+                scanNames( trashDir );
+                trashDir.fAOK = true;
+                return true;
+            }
+
+            QString homeTrashPath()
+            {
+                auto dataHome = qEnvironmentVariable( "XDG_DATA_HOME" );
+                if ( dataHome.isEmpty() || !QDir::isAbsolutePath( dataHome ) )
+                    dataHome = QDir::homePath() + "/.local/share";
+                return dataHome + "/Trash";
+            }
+
+            // the top most directory on the same device as path
+            QString mountPoint( const QString &path, dev_t device )
+            {
+                auto retVal = path;
+                while ( true )
+                {
+                    auto parent = QFileInfo( retVal ).absolutePath();
+                    if ( parent == retVal )
+                        return retVal;
+
+                    struct stat st;
+                    if ( ( ::stat( QFile::encodeName( parent ).constData(), &st ) != 0 ) || ( st.st_dev != device ) )
+                        return retVal;
+                    retVal = parent;
+                }
+            }
+
+            // the trash directories are made and scanned once per device
+            class CTrashDirs
+            {
+            public:
+                CTrashDirs()
+                {
+                    fHomeTrash = homeTrashPath();
+                    QDir().mkpath( QFileInfo( fHomeTrash ).absolutePath() );
+
+                    struct stat st;
+                    if ( ::stat( QFile::encodeName( QFileInfo( fHomeTrash ).absolutePath() ).constData(), &st ) == 0 )
+                        fHomeDevice = st.st_dev;
+                }
+
+                STrashDir &trashDir( const QString &path, dev_t device )
+                {
+                    auto pos = fTrashDirs.find( device );
+                    if ( pos != fTrashDirs.end() )
+                        return ( *pos ).second;
+
+                    auto &&retVal = fTrashDirs[ device ];
+                    if ( fHomeDevice.has_value() && ( device == fHomeDevice.value() ) )
+                    {
+                        openTrashDir( retVal, fHomeTrash, 0700 );
+                        return retVal;
+                    }
+
+                    retVal.fTopDir = mountPoint( path, device );
+                    auto uid = QString::number( ::getuid() );
+
+                    // an administrator created $topdir/.Trash, it must be a sticky directory and not a link
+                    auto sharedTrash = retVal.fTopDir + "/.Trash";
+                    struct stat st;
+                    if ( ( ::lstat( QFile::encodeName( sharedTrash ).constData(), &st ) == 0 ) && S_ISDIR( st.st_mode ) && ( st.st_mode & S_ISVTX ) && openTrashDir( retVal, sharedTrash + "/" + uid, 0700 ) )
+                        return retVal;
+
+                    retVal.fErrorMsg.clear();
+                    openTrashDir( retVal, retVal.fTopDir + "/.Trash-" + uid, 0700 );
+                    return retVal;
+                }
+
+            private:
+                QString fHomeTrash;
+                std::optional< dev_t > fHomeDevice;
+                std::unordered_map< dev_t, STrashDir > fTrashDirs;
+            };
+
+            // "name", "name.2", "name.3"... or "stem.2.ext" when there is an extension
+            std::string uniqueName( STrashDir &trashDir, const QString &fileName )
+            {
+                auto name = std::string( QFile::encodeName( fileName ).constData() );
+                if ( trashDir.fUsedNames.insert( name ).second )
+                    return name;
+
+                QFileInfo fi( fileName );
+                auto stem = fi.completeBaseName();
+                auto suffix = fi.suffix();
+                auto hasSuffix = !stem.isEmpty() && !suffix.isEmpty();
+                for ( int ii = 2;; ++ii )
+                {
+                    auto candidate = hasSuffix ? QString( "%1.%2.%3" ).arg( stem ).arg( ii ).arg( suffix ) : QString( "%1.%2" ).arg( fileName ).arg( ii );
+                    name = QFile::encodeName( candidate ).constData();
+                    if ( trashDir.fUsedNames.insert( name ).second )
+                        return name;
+                }
+            }
+
+            struct SPending
+            {
+                qsizetype fIndex{ 0 };
+                STrashDir *fTrashDir{ nullptr };
+                QByteArray fInfo;
+                std::string fName;
+                std::string fInfoPath;
+            };
+
+            // O_EXCL reserves the name even if another process is trashing into the same directory, a name taken since the scan is skipped
+            bool writeTrashInfo( SPending &item, const QString &fileName, QString &errorMsg )
+            {
+                while ( true )
+                {
+                    item.fName = uniqueName( *item.fTrashDir, fileName );
+                    item.fInfoPath = std::string( QFile::encodeName( item.fTrashDir->fInfoDir ).constData() ) + "/" + item.fName + ".trashinfo";
+                    auto fd = ::open( item.fInfoPath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600 );
+                    if ( fd < 0 )
+                    {
+                        if ( errno == EEXIST )
+                            continue;
+                        errorMsg = QObject::tr( "Could not open file '%1' for write: %2" ).arg( QFile::decodeName( item.fInfoPath.c_str() ) ).arg( errnoString( errno ) );
+                        return false;
+                    }
+                    auto aOK = ( ::write( fd, item.fInfo.constData(), item.fInfo.size() ) == item.fInfo.size() );
+                    aOK = ( ::close( fd ) == 0 ) && aOK;
+                    if ( !aOK )
+                    {
+                        errorMsg = QObject::tr( "Could not write file '%1'" ).arg( QFile::decodeName( item.fInfoPath.c_str() ) );
+                        ::unlink( item.fInfoPath.c_str() );
+                        return false;
+                    }
+                    return true;
+                }
+            }
+
+            // never replaces a file in the trash, file systems without RENAME_NOREPLACE fall back to checking first
+            bool renameNoReplace( const char *from, const char *to )
+            {
+                if ( ::renameat2( AT_FDCWD, from, AT_FDCWD, to, RENAME_NOREPLACE ) == 0 )
+                    return true;
+                if ( ( errno != EINVAL ) && ( errno != ENOSYS ) )
+                    return false;
+
+                struct stat st;
+                if ( ::lstat( to, &st ) == 0 )
+                {
+                    errno = EEXIST;
+                    return false;
+                }
+                return ::rename( from, to ) == 0;
+            }
         }
-        if ( !NFileUtils::mkdir( trashInfoPath.toStdString(), true ) )
+
+        std::vector< STrashResult > moveFilesToTrashImpl( const QStringList &paths, std::shared_ptr< SRecycleOptions > /*options*/ )
         {
-            if ( msg )
-                *msg = QString::tr( "Could not make directory '%1'" ).arg( trashInfoPath );
-            return false;
-        }
+            std::vector< STrashResult > retVal( paths.size() );
+            auto deletionDate = QDateTime::currentDateTime().toString( "yyyy-MM-dd'T'hh:mm:ss" ).toUtf8();
 
-        // create file format for trash info file----- START
-        QFile infoFile( trashInfoPath + fi.fileName() + ".trashinfo" );   //filename+extension+.trashinfo //  create file information file in /.local/share/Trash/info/ folder
+            CTrashDirs trashDirs;
+            std::vector< SPending > pending;
+            pending.reserve( paths.size() );
 
-        if ( !infoFile.open( QIODevice::WriteOnly ) || !infoFile.isOpen() )
-        {
-            if ( msg )
-                *msg = QString::tr( "Could not open file '%1' for write" ).arg( infoFile.absoluteFilePath() );
-            return false;
-        }
+            // write every .trashinfo first, so a file is never in the trash without one
+            for ( qsizetype ii = 0; ii < paths.size(); ++ii )
+            {
+                auto &&curr = retVal[ ii ];
+                curr.fPath = paths[ ii ];
 
-        QTextStream stream( &infoFile );   // for write data on open file
+                auto nativePath = QFile::encodeName( paths[ ii ] );
+                struct stat st;
+                if ( ::lstat( nativePath.constData(), &st ) != 0 )
+                {
+                    curr.fAOK = ( errno == ENOENT );
+                    curr.fErrorMsg = curr.fAOK ? QObject::tr( "File or Directory '%1' does not exist." ).arg( paths[ ii ] ) : QObject::tr( "Could not stat '%1': %2" ).arg( paths[ ii ] ).arg( errnoString( errno ) );
+                    continue;
+                }
 
-        stream << "[Trash Info]" << "\n";
-        stream << "Path=" + QString( QUrl::toPercentEncoding( fi.absoluteFilePath(), "~_-./" ) ) << "\n";   // convert path string in percentage decoding scheme string
-        stream << "DeletionDate=" + currentTime.toString( "yyyy-MM-dd" ) + "T" + currentTime.toString( "hh:mm:ss" ) << "\n";   // get date and time format YYYY-MM-DDThh:mm:ss
+                auto &&trashDir = trashDirs.trashDir( paths[ ii ], st.st_dev );
+                if ( !trashDir.fAOK )
+                {
+                    curr.fErrorMsg = trashDir.fErrorMsg;
+                    continue;
+                }
 
-        infoFile.close();
+                auto recordedPath = trashDir.fTopDir.isEmpty() ? paths[ ii ] : QDir( trashDir.fTopDir ).relativeFilePath( paths[ ii ] );
+                SPending item;
+                item.fIndex = ii;
+                item.fTrashDir = &trashDir;
+                item.fInfo = QByteArray( "[Trash Info]\nPath=" ) + QUrl::toPercentEncoding( recordedPath, "~_-./" ) + "\nDeletionDate=" + deletionDate + "\n";
+                if ( writeTrashInfo( item, QFileInfo( paths[ ii ] ).fileName(), curr.fErrorMsg ) )
+                    pending.push_back( item );
+            }
 
-        // create info file format of trash file----- END
+            // then the renames, each on its own file system, a name taken in files since the scan gets a new name and .trashinfo
+            for ( auto &&item : pending )
+            {
+                auto &&curr = retVal[ item.fIndex ];
+                auto nativePath = QFile::encodeName( curr.fPath );
+                while ( true )
+                {
+                    auto trashPath = std::string( QFile::encodeName( item.fTrashDir->fFilesDir ).constData() ) + "/" + item.fName;
+                    if ( renameNoReplace( nativePath.constData(), trashPath.c_str() ) )
+                    {
+                        curr.fAOK = true;
+                        curr.fTrashPath = QFile::decodeName( trashPath.c_str() );
+                        break;
+                    }
 
-        QDir file;
-        auto retVal = file.rename( fi.absoluteFilePath(), trashFilePath + fi.fileName() );   // rename(file old path, file trash path)
-        if ( !retVal && msg )
-            *msg = QObject::tr( "Could not rename file '%1' to '%2'" ).arg( fi.absoluteFilePath() ).arg( trashFilePath + fi.fileName() );
-        return retVal;
+                    auto error = errno;
+                    ::unlink( item.fInfoPath.c_str() );
+                    if ( error != EEXIST )
+                    {
+                        curr.fErrorMsg = QObject::tr( "Could not rename file '%1' to '%2': %3" ).arg( curr.fPath ).arg( QFile::decodeName( trashPath.c_str() ) ).arg( errnoString( error ) );
+                        break;
+                    }
+                    if ( !writeTrashInfo( item, QFileInfo( curr.fPath ).fileName(), curr.fErrorMsg ) )
+                        break;
+                }
+            }
+            return retVal;
+        }
+
+        bool moveToTrashImpl( const QString &fileName, QString *msg, std::shared_ptr< SRecycleOptions > options )
+        {
+            auto results = moveFilesToTrashImpl( { QFileInfo( fileName ).absoluteFilePath() }, options );
+            if ( msg )
+                *msg = results.front().fErrorMsg;
+            return results.front().fAOK;
+        }
     }
 }
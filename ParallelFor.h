@@ -0,0 +1,62 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020-2021 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#ifndef __PARALLELFOR_H
+#define __PARALLELFOR_H
+
+#include <QThread>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace NSABUtils
+{
+    // calls func( ii ) for every ii in [0, count) on up to maxThreads threads (QThread::idealThreadCount when 0), the calling thread is one of them
+    // small batches are not worth starting threads for, large ones are claimed in chunks, only one thread is used per chunk
+    template< typename TIndex, typename TFunc >
+    void parallelFor( TIndex count, TIndex chunkSize, int maxThreads, TFunc &&func )
+    {
+        chunkSize = std::max< TIndex >( 1, chunkSize );
+        std::atomic< TIndex > next{ 0 };
+        auto worker = [ count, chunkSize, &next, &func ]()
+        {
+            for ( auto start = next.fetch_add( chunkSize ); start < count; start = next.fetch_add( chunkSize ) )
+            {
+                auto end = std::min( start + chunkSize, count );
+                for ( auto ii = start; ii < end; ++ii )
+                    func( ii );
+            }
+        };
+
+        auto numThreads = ( maxThreads > 0 ) ? maxThreads : QThread::idealThreadCount();
+        numThreads = std::max( 1, static_cast< int >( std::min< TIndex >( numThreads, ( count + chunkSize - 1 ) / chunkSize ) ) );
+        std::vector< std::thread > threads;
+        for ( int ii = 1; ii < numThreads; ++ii )
+            threads.emplace_back( worker );
+        worker();
+        for ( auto &&ii : threads )
+            ii.join();
+    }
+}
+
+#endif
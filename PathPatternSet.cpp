@@ -0,0 +1,170 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "PathPatternSet.h"
+
+#include <algorithm>
+
+namespace NSABUtils
+{
+    namespace NFileUtils
+    {
+        namespace
+        {
+            bool hasWildcards( const QString &pattern )
+            {
+                return pattern.contains( '*' ) || pattern.contains( '?' ) || pattern.contains( '[' );
+            }
+
+            bool isSeparator( QChar ch )
+            {
+                return ( ch == '/' ) || ( ch == '\\' );
+            }
+
+            QStringList splitPath( const QString &path )
+            {
+                QStringList retVal;
+                qsizetype start = 0;
+                for ( qsizetype ii = 0; ii <= path.length(); ++ii )
+                {
+                    if ( ( ii < path.length() ) && !isSeparator( path[ ii ] ) )
+                        continue;
+                    if ( ii > start )
+                        retVal << path.mid( start, ii - start );
+                    start = ii + 1;
+                }
+                return retVal;
+            }
+        }
+
+        CPathPatternSet::CPathPatternSet( const QStringList &patterns, Qt::CaseSensitivity caseSensitivity, EPatternType patternType ) :
+            fCaseSensitivity( caseSensitivity )
+        {
+            QStringList combined;
+            for ( auto pattern : patterns )
+            {
+                if ( pattern.isEmpty() )
+                    continue;
+
+                if ( patternType == EPatternType::eExtension )
+                    pattern = "*." + ( pattern.startsWith( '.' ) ? pattern.mid( 1 ) : pattern );
+                fPatterns << pattern;
+
+                if ( std::any_of( pattern.begin(), pattern.end(), isSeparator ) )
+                {
+                    auto components = splitPath( pattern );
+                    if ( components.isEmpty() )
+                        continue;
+                    std::vector< QRegularExpression > regExs;
+                    for ( auto ii = components.rbegin(); ii != components.rend(); ++ii )
+                        regExs.push_back( toRegEx( *ii ) );
+                    fPathPatterns.push_back( std::move( regExs ) );
+                    continue;
+                }
+
+                if ( pattern == "*" )
+                    fMatchAll = true;
+                else if ( pattern.startsWith( "*." ) && !hasWildcards( pattern.mid( 2 ) ) )
+                {
+                    auto extension = pattern.mid( 2 );
+                    fMaxExtensionDots = std::max( fMaxExtensionDots, static_cast< int >( extension.count( '.' ) ) );
+                    fExtensions.insert( fold( extension ) );
+                }
+                else if ( !hasWildcards( pattern ) )
+                    fNames.insert( fold( pattern ) );
+                else
+                    combined << QRegularExpression::wildcardToRegularExpression( pattern );
+            }
+
+            if ( !combined.isEmpty() )
+            {
+                fCombined = QRegularExpression( "(?:" + combined.join( ")|(?:" ) + ")", ( fCaseSensitivity == Qt::CaseInsensitive ) ? QRegularExpression::CaseInsensitiveOption : QRegularExpression::NoPatternOption );
+                fCombined.optimize();
+                fHasCombined = true;
+            }
+        }
+
+        QRegularExpression CPathPatternSet::toRegEx( const QString &pattern ) const
+        {
+            auto retVal = QRegularExpression( QRegularExpression::wildcardToRegularExpression( pattern ), ( fCaseSensitivity == Qt::CaseInsensitive ) ? QRegularExpression::CaseInsensitiveOption : QRegularExpression::NoPatternOption );
+            retVal.optimize();
+            return retVal;
+        }
+
+        bool CPathPatternSet::matchesName( const QString &fileName ) const
+        {
+            if ( fMatchAll )
+                return true;
+            if ( fileName.isEmpty() )
+                return false;
+
+            if ( !fExtensions.empty() || !fNames.empty() )
+            {
+                auto folded = fold( fileName );
+                if ( fNames.find( folded ) != fNames.end() )
+                    return true;
+
+                // the last extension, then the longer ones the patterns need ("gz", "tar.gz")
+                auto pos = folded.length();
+                for ( int ii = 0; !fExtensions.empty() && ( ii <= fMaxExtensionDots ); ++ii )
+                {
+                    pos = folded.lastIndexOf( '.', pos - 1 );
+                    if ( pos < 0 )
+                        break;
+                    if ( fExtensions.find( folded.mid( pos + 1 ) ) != fExtensions.end() )
+                        return true;
+                    if ( pos == 0 )
+                        break;
+                }
+            }
+
+            return fHasCombined && fCombined.match( fileName ).hasMatch();
+        }
+
+        bool CPathPatternSet::matchesPath( const QString &path ) const
+        {
+            auto components = splitPath( path );
+            if ( components.isEmpty() )
+                return false;
+            if ( matchesName( components.back() ) )
+                return true;
+
+            for ( auto &&regExs : fPathPatterns )
+            {
+                auto matches = true;
+                auto currName = components.size() - 1;
+                for ( size_t ii = 0; matches && ( ii < regExs.size() ) && ( currName >= 0 ); ++ii, --currName )
+                    matches = regExs[ ii ].match( components[ currName ] ).hasMatch();
+                if ( matches )
+                    return true;
+            }
+            return false;
+        }
+
+        bool CPathPatternSet::matchesExtension( const QString &extension ) const
+        {
+            if ( extension.isEmpty() )
+                return false;
+            return matchesName( extension.startsWith( '.' ) ? extension : ( '.' + extension ) );
+        }
+    }
+}
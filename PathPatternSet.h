@@ -0,0 +1,83 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __PATHPATTERNSET_H
+#define __PATHPATTERNSET_H
+
+#include "SABUtilsExport.h"
+
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+#include <unordered_set>
+#include <vector>
+
+namespace NSABUtils
+{
+    namespace NFileUtils
+    {
+        // a set of wildcard patterns compiled once, for matching many names against the same patterns
+        // the matching is the same as QDir::match (case insensitive by default), but:
+        //     pure extension globs ("*.mkv") are a hash lookup on the extension
+        //     names without wildcards are a hash lookup on the name
+        //     everything else is a single combined regular expression
+        //     patterns with directories ("season*/*.mkv") are compared component by component from the end, the same as fileCompare
+        //
+        // the set is immutable once built, so it can be shared by threads
+        class SABUTILS_EXPORT CPathPatternSet
+        {
+        public:
+            enum class EPatternType
+            {
+                eFileName,
+                eExtension   // "mkv", ".mkv" or "m?v", matched by matchesExtension as extCompare does
+            };
+
+            CPathPatternSet() {}
+            CPathPatternSet( const QStringList &patterns, Qt::CaseSensitivity caseSensitivity = Qt::CaseInsensitive, EPatternType patternType = EPatternType::eFileName );
+
+            bool isEmpty() const { return fPatterns.isEmpty(); }
+            QStringList patterns() const { return fPatterns; }
+            Qt::CaseSensitivity caseSensitivity() const { return fCaseSensitivity; }
+
+            bool matchesName( const QString &fileName ) const;   // a name without directories, the directory patterns are not used
+            bool matchesPath( const QString &path ) const;   // the name against the name patterns, then the directory patterns
+            bool matchesExtension( const QString &extension ) const;   // with or without the leading "."
+
+        private:
+            QString fold( const QString &value ) const { return ( fCaseSensitivity == Qt::CaseInsensitive ) ? value.toCaseFolded() : value; }
+            QRegularExpression toRegEx( const QString &pattern ) const;
+
+            QStringList fPatterns;
+            Qt::CaseSensitivity fCaseSensitivity{ Qt::CaseInsensitive };
+            bool fMatchAll{ false };
+            std::unordered_set< QString > fExtensions;   // folded, without the "*."
+            int fMaxExtensionDots{ 0 };   // "*.tar.gz" is one
+            std::unordered_set< QString > fNames;   // folded
+            QRegularExpression fCombined;
+            bool fHasCombined{ false };
+            std::vector< std::vector< QRegularExpression > > fPathPatterns;   // the components of each, last first
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,225 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "RecordLog.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QObject>
+#include <QSaveFile>
+
+#include <algorithm>
+
+namespace NSABUtils
+{
+    namespace
+    {
+        constexpr std::size_t kMinRecordsForCompact = 1024;
+    }
+
+    CRecordLog::CRecordLog( quint32 magic, quint32 version, quint32 schemaVersion ) :
+        fMagic( magic ),
+        fVersion( version ),
+        fSchemaVersion( schemaVersion )
+    {
+    }
+
+    CRecordLog::~CRecordLog()
+    {
+        close();
+    }
+
+    bool CRecordLog::open( const QString &fileName, const TReadFunc &readRecord, QString *msg )
+    {
+        close();
+
+        fFileName = QFileInfo( fileName ).absoluteFilePath();
+        if ( !QDir().mkpath( QFileInfo( fFileName ).absolutePath() ) )
+        {
+            if ( msg )
+                *msg = QObject::tr( "Could not create directory '%1'" ).arg( QFileInfo( fFileName ).absolutePath() );
+            return false;
+        }
+
+        fFile = std::make_unique< QFile >( fFileName );
+        if ( !fFile->open( QIODevice::ReadWrite ) )
+        {
+            if ( msg )
+                *msg = QObject::tr( "Could not open '%1': %2" ).arg( fFileName ).arg( fFile->errorString() );
+            fFile.reset();
+            return false;
+        }
+
+        fStream.setDevice( fFile.get() );
+        fStream.setVersion( QDataStream::Qt_6_0 );
+        if ( !load( readRecord, msg ) )
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void CRecordLog::close()
+    {
+        fStream.setDevice( nullptr );
+        fFile.reset();
+        fNumRecords = 0;
+    }
+
+    bool CRecordLog::isOpen() const
+    {
+        return fFile.get() != nullptr;
+    }
+
+    QString CRecordLog::fileName() const
+    {
+        return fFileName;
+    }
+
+    bool CRecordLog::load( const TReadFunc &readRecord, QString *msg )
+    {
+        fNumRecords = 0;
+        if ( fFile->size() == 0 )
+            return writeHeader( fStream );
+
+        quint32 magic = 0;
+        fStream >> magic;
+        if ( ( fStream.status() != QDataStream::Ok ) || ( magic != fMagic ) )
+        {
+            if ( msg )
+                *msg = QObject::tr( "'%1' is not a cache file, it was left unchanged" ).arg( fFileName );
+            return false;
+        }
+
+        quint32 version = 0;
+        quint32 schemaVersion = 0;
+        fStream >> version >> schemaVersion;
+        if ( ( fStream.status() != QDataStream::Ok ) || ( version != fVersion ) || ( schemaVersion != fSchemaVersion ) )
+        {
+            // ours, but an older layout of the file or of the records, start over rather than fail
+            fStream.resetStatus();
+            if ( !fFile->resize( 0 ) || !fFile->seek( 0 ) )
+            {
+                if ( msg )
+                    *msg = QObject::tr( "Could not reset '%1': %2" ).arg( fFileName ).arg( fFile->errorString() );
+                return false;
+            }
+            return writeHeader( fStream );
+        }
+
+        auto lastGood = fFile->pos();
+        while ( !fStream.atEnd() )
+        {
+            if ( !readRecord( fStream ) || ( fStream.status() != QDataStream::Ok ) )
+            {
+                fStream.setStatus( QDataStream::ReadCorruptData );
+                break;
+            }
+            fNumRecords++;
+            lastGood = fFile->pos();
+        }
+
+        if ( fStream.status() != QDataStream::Ok )
+        {
+            // a partially written record from a crash, drop it so new records append cleanly
+            fStream.resetStatus();
+            fFile->resize( lastGood );
+        }
+        fFile->seek( fFile->size() );
+        return true;
+    }
+
+    bool CRecordLog::writeHeader( QDataStream &ds ) const
+    {
+        ds << fMagic << fVersion << fSchemaVersion;
+        return ds.status() == QDataStream::Ok;
+    }
+
+    QDataStream &CRecordLog::appendStream()
+    {
+        fFile->seek( fFile->size() );   // reading a record back moves the position
+        return fStream;
+    }
+
+    void CRecordLog::recordAdded()
+    {
+        fNumRecords++;
+        fFile->flush();
+    }
+
+    bool CRecordLog::seek( qint64 offset )
+    {
+        fStream.resetStatus();
+        return fFile && fFile->seek( offset );
+    }
+
+    void CRecordLog::setAutoCompactRatio( int value )
+    {
+        fAutoCompactRatio = std::max( 0, value );
+    }
+
+    bool CRecordLog::needsCompact( std::size_t numLive ) const
+    {
+        if ( ( fAutoCompactRatio <= 0 ) || ( fNumRecords < kMinRecordsForCompact ) )
+            return false;
+        return fNumRecords > ( numLive * static_cast< std::size_t >( fAutoCompactRatio ) );
+    }
+
+    bool CRecordLog::compact( const TWriteFunc &writeLive, QString *msg )
+    {
+        QSaveFile file( fFileName );
+        if ( !file.open( QIODevice::WriteOnly ) )
+        {
+            if ( msg )
+                *msg = QObject::tr( "Could not open '%1': %2" ).arg( fFileName ).arg( file.errorString() );
+            return false;
+        }
+
+        QDataStream ds( &file );
+        ds.setVersion( fStream.version() );
+        writeHeader( ds );
+        auto numRecords = writeLive( ds );
+
+        // the open log has to be closed before it can be replaced (windows), either way it is reopened
+        fStream.setDevice( nullptr );
+        fFile.reset();
+        bool aOK = ( ds.status() == QDataStream::Ok ) && file.commit();
+        if ( !aOK && msg )
+            *msg = QObject::tr( "Could not write '%1': %2" ).arg( fFileName ).arg( file.errorString() );
+
+        auto numOldRecords = fNumRecords;
+        fFile = std::make_unique< QFile >( fFileName );
+        if ( !fFile->open( QIODevice::ReadWrite ) )
+        {
+            if ( msg )
+                *msg = QObject::tr( "Could not open '%1': %2" ).arg( fFileName ).arg( fFile->errorString() );
+            close();
+            return false;
+        }
+        fStream.setDevice( fFile.get() );
+        fFile->seek( fFile->size() );
+        fNumRecords = aOK ? numRecords : numOldRecords;
+        return aOK;
+    }
+}
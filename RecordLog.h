@@ -0,0 +1,85 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#ifndef __RECORDLOG_H
+#define __RECORDLOG_H
+
+#include "SABUtilsExport.h"
+
+#include <QDataStream>
+#include <QString>
+#include <functional>
+#include <memory>
+
+class QFile;
+namespace NSABUtils
+{
+    // the file behind the persistent caches, a header (magic, layout version, schema version) followed by records appended as they happen
+    // the owner reads and writes the records, the log opens and replays the file, drops a torn record at the end (from a crash) and compacts
+    //
+    // a file with a different magic is not ours and is never modified, open fails
+    // a file with our magic but another version or schema is an older layout and is started over
+    // the log is not thread safe, the owner locks around it
+    class SABUTILS_EXPORT CRecordLog
+    {
+    public:
+        using TReadFunc = std::function< bool( QDataStream &ds ) >;   // reads one record, false when it is corrupt or cut short
+        using TWriteFunc = std::function< std::size_t( QDataStream &ds ) >;   // writes every live record, returns how many it wrote
+
+        CRecordLog( quint32 magic, quint32 version, quint32 schemaVersion = 0 );
+        ~CRecordLog();
+
+        bool open( const QString &fileName, const TReadFunc &readRecord, QString *msg = nullptr );
+        void close();
+        bool isOpen() const;
+        QString fileName() const;
+        quint32 schemaVersion() const { return fSchemaVersion; }
+
+        QDataStream &appendStream();   // positioned at the end of the file, call recordAdded once the record is written
+        void recordAdded();
+        bool seek( qint64 offset );   // for records read back after open, read them with stream()
+        QDataStream &stream() { return fStream; }
+
+        // the live records are written to a new file that replaces the log, writeLive can still read the current log
+        // on failure the current log is kept, unless it could not be reopened in which case the log is closed
+        bool compact( const TWriteFunc &writeLive, QString *msg = nullptr );
+        bool needsCompact( std::size_t numLive ) const;   // more than ratio x numLive records
+
+        void setAutoCompactRatio( int value );   // 0 disables
+        int autoCompactRatio() const { return fAutoCompactRatio; }
+        std::size_t numRecords() const { return fNumRecords; }
+
+    private:
+        bool load( const TReadFunc &readRecord, QString *msg );
+        bool writeHeader( QDataStream &ds ) const;
+
+        quint32 fMagic{ 0 };
+        quint32 fVersion{ 0 };
+        quint32 fSchemaVersion{ 0 };
+        QString fFileName;
+        std::unique_ptr< QFile > fFile;
+        QDataStream fStream;
+        std::size_t fNumRecords{ 0 };
+        int fAutoCompactRatio{ 4 };
+    };
+}
+
+#endif
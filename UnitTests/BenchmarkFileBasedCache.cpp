@@ -0,0 +1,168 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "../FileBasedCache.h"
+#include "../FileStat.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+#include <atomic>
+#include <iostream>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace
+{
+    class CBenchmarkFileBasedCache : public ::testing::Test
+    {
+    protected:
+        void SetUp() override { ASSERT_TRUE( fDir.isValid() ); }
+
+        QString writeFile( const QString &name, const QByteArray &data )
+        {
+            auto path = fDir.filePath( name );
+            QFile file( path );
+            EXPECT_TRUE( file.open( QIODevice::WriteOnly | QIODevice::Truncate ) );
+            file.write( data );
+            return path;
+        }
+
+        // runs func( threadNum ) on numThreads threads and returns the elapsed ms
+        template< typename FuncType >
+        static qint64 runThreads( int numThreads, FuncType func )
+        {
+            QElapsedTimer timer;
+            timer.start();
+            std::vector< std::thread > threads;
+            for ( int ii = 0; ii < numThreads; ++ii )
+                threads.emplace_back( func, ii );
+            for ( auto &&ii : threads )
+                ii.join();
+            return timer.elapsed();
+        }
+
+        QTemporaryDir fDir;
+    };
+
+    // SAB_BENCHMARK_CACHE_ENTRIES sets the number of entries saved and loaded (default 100000)
+    TEST_F( CBenchmarkFileBasedCache, SaveAndLoad )
+    {
+        auto numEntries = qEnvironmentVariableIntValue( "SAB_BENCHMARK_CACHE_ENTRIES" );
+        if ( numEntries <= 0 )
+            numEntries = 100000;
+
+        // the files do not need to exist, nothing is stat'ed until it is looked up
+        NSABUtils::CFileBasedCache< QString > cache;
+        for ( int ii = 0; ii < numEntries; ++ii )
+        {
+            auto path = fDir.filePath( QString( "dir%1/file%2.mkv" ).arg( ii % 100 ).arg( ii ) );
+            cache.add( NSABUtils::SFileBasedCacheNode( path, ii, QDateTime::fromMSecsSinceEpoch( ii * 1000LL ) ), path );
+        }
+
+        auto cacheFile = fDir.filePath( "large.dat" );
+        QElapsedTimer timer;
+        timer.start();
+        ASSERT_TRUE( cache.save( cacheFile ) );
+        auto saveTime = timer.restart();
+
+        NSABUtils::CFileBasedCache< QString > loaded;
+        ASSERT_TRUE( loaded.load( cacheFile ) );
+        auto loadTime = timer.elapsed();
+        EXPECT_EQ( static_cast< std::size_t >( numEntries ), loaded.size() );
+
+        std::cout << std::setw( 32 ) << "save: " << saveTime << " ms" << std::endl;
+        std::cout << std::setw( 32 ) << "load: " << loadTime << " ms" << std::endl;
+    }
+
+    // SAB_BENCHMARK_CACHE_LOOKUPS sets the lookups per thread (default 200000)
+    TEST_F( CBenchmarkFileBasedCache, Contention )
+    {
+        auto numLookups = qEnvironmentVariableIntValue( "SAB_BENCHMARK_CACHE_LOOKUPS" );
+        if ( numLookups <= 0 )
+            numLookups = 200000;
+
+        // stat'ed once up front, so the benchmark measures the locking and not the file system
+        QStringList paths;
+        for ( int ii = 0; ii < 1000; ++ii )
+            paths << writeFile( QString( "file%1.txt" ).arg( ii ), QByteArray( ii % 100, 'x' ) );
+        auto stats = NSABUtils::NFileUtils::fileStats( paths );
+
+        NSABUtils::CFileBasedCache< int > cache;
+        NSABUtils::CConcurrentFileBasedCache< int > concurrentCache;
+        for ( int ii = 0; ii < paths.size(); ++ii )
+        {
+            cache.add( paths[ ii ], stats[ ii ], ii );
+            concurrentCache.add( paths[ ii ], stats[ ii ], ii );
+        }
+
+        std::atomic< int64_t > numFound{ 0 };
+        std::mutex mutex;
+        auto mutexTime = runThreads(
+            16,
+            [ & ]( int threadNum )
+            {
+                int64_t found = 0;
+                for ( int ii = 0; ii < numLookups; ++ii )
+                {
+                    auto pos = ( threadNum * 7919 + ii ) % paths.size();
+                    std::lock_guard< std::mutex > lock( mutex );
+                    found += ( cache.find( paths[ pos ], stats[ pos ] ) == pos ) ? 1 : 0;
+                }
+                numFound += found;
+            } );
+        EXPECT_EQ( 16LL * numLookups, numFound.load() );
+
+        numFound = 0;
+        auto shardedTime = runThreads(
+            16,
+            [ & ]( int threadNum )
+            {
+                int64_t found = 0;
+                for ( int ii = 0; ii < numLookups; ++ii )
+                {
+                    auto pos = ( threadNum * 7919 + ii ) % paths.size();
+                    found += ( concurrentCache.find( paths[ pos ], stats[ pos ] ) == pos ) ? 1 : 0;
+                }
+                numFound += found;
+            } );
+        EXPECT_EQ( 16LL * numLookups, numFound.load() );
+
+        std::cout << std::setw( 32 ) << "CFileBasedCache + mutex: " << mutexTime << " ms" << std::endl;
+        std::cout << std::setw( 32 ) << "CConcurrentFileBasedCache: " << shardedTime << " ms" << std::endl;
+    }
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication appl( argc, argv );
+    ::testing::InitGoogleTest( &argc, argv );
+    int retVal = RUN_ALL_TESTS();
+    return retVal;
+}
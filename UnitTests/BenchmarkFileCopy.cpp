@@ -0,0 +1,93 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "../FileUtils.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+#include <iostream>
+#include "gtest/gtest.h"
+
+// SAB_BENCHMARK_COPY_MB sets the size of the benchmark file (default 64)
+namespace
+{
+    class CBenchmarkFileCopy : public ::testing::Test
+    {
+    protected:
+        void SetUp() override { ASSERT_TRUE( fDir.isValid() ); }
+
+        QString writeFile( const QString &name, qint64 size )
+        {
+            auto path = fDir.filePath( name );
+            QFile file( path );
+            EXPECT_TRUE( file.open( QIODevice::WriteOnly ) );
+            QByteArray block( 1024 * 1024, 0 );
+            for ( int ii = 0; ii < block.size(); ++ii )
+                block[ ii ] = static_cast< char >( ( ii * 31 + name.length() ) & 0xff );
+            for ( qint64 written = 0; written < size; written += block.size() )
+                file.write( block.constData(), std::min< qint64 >( block.size(), size - written ) );
+            file.close();
+            // one at a time, the metadata change time can not be set on linux so setting all of them fails before the modification time
+            auto tenDaysAgo = QDateTime::currentDateTime().addDays( -10 );
+            EXPECT_TRUE( NSABUtils::NFileUtils::setTimeStamp( path, tenDaysAgo, QFileDevice::FileAccessTime ) );
+            EXPECT_TRUE( NSABUtils::NFileUtils::setTimeStamp( path, tenDaysAgo, QFileDevice::FileModificationTime ) );
+            return path;
+        }
+
+        QTemporaryDir fDir;
+    };
+
+    TEST_F( CBenchmarkFileCopy, CopyMethods )
+    {
+        auto sizeMB = qEnvironmentVariableIntValue( "SAB_BENCHMARK_COPY_MB" );
+        if ( sizeMB <= 0 )
+            sizeMB = 64;
+        auto from = writeFile( "large.bin", sizeMB * 1024LL * 1024LL );
+
+        QElapsedTimer timer;
+        timer.start();
+        ASSERT_TRUE( QFile::copy( from, fDir.filePath( "large.qfile" ) ) );
+        std::cout << "QFile::copy " << timer.restart() << " ms" << std::endl;
+
+        NSABUtils::NFileUtils::SCopyOptions options;
+        NSABUtils::NFileUtils::ECopyMethod used;
+        ASSERT_TRUE( NSABUtils::NFileUtils::copyFile( from, fDir.filePath( "large.copy" ), options, nullptr, &used ) );
+        std::cout << "copyFile " << timer.restart() << " ms, method " << static_cast< int >( used ) << std::endl;
+
+        options.fAllowReflink = options.fAllowKernelCopy = false;
+        ASSERT_TRUE( NSABUtils::NFileUtils::copyFile( from, fDir.filePath( "large.buffered" ), options ) );
+        std::cout << "copyFile, buffered " << timer.restart() << " ms" << std::endl;
+    }
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication appl( argc, argv );
+    ::testing::InitGoogleTest( &argc, argv );
+    int retVal = RUN_ALL_TESTS();
+    return retVal;
+}
@@ -0,0 +1,297 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "../FileUtils.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+#include <iostream>
+#include <iomanip>
+#include <set>
+#include "gtest/gtest.h"
+
+// SAB_BENCHMARK_FINDALLFILES_DIR walks an existing tree (a NAS share for instance) instead of generating one
+// the generated tree has SAB_BENCHMARK_FINDALLFILES_DIRS directories (default 2000) of 50 files each, 20000 gives the 1M entry tree
+namespace
+{
+    // the single threaded recursive walk findAllFiles used before the parallel walker
+    std::optional< QList< QFileInfo > > legacyFindAllFiles( const QDir &dir, const QStringList &nameFilters, bool recursive, bool sortByName )
+    {
+        if ( !dir.exists() || !dir.isReadable() )
+            return {};
+
+        auto files = dir.entryInfoList( nameFilters, QDir::Files, sortByName ? QDir::SortFlag::Name : QDir::SortFlag::NoSort );
+        QList< QFileInfo > retVal;
+        for ( auto &&ii : files )
+            retVal << ii;
+        if ( recursive )
+        {
+            auto subDirs = dir.entryInfoList( QDir::Filter::AllDirs | QDir::Filter::NoDotAndDotDot, sortByName ? QDir::SortFlag::Name : QDir::SortFlag::NoSort );
+            for ( auto &&ii : subDirs )
+            {
+                auto curr = legacyFindAllFiles( QDir( ii.absoluteFilePath() ), nameFilters, recursive, sortByName );
+                if ( curr.has_value() )
+                    retVal << curr.value();
+            }
+        }
+        return retVal;
+    }
+
+    QStringList toPaths( const QList< QFileInfo > &files )
+    {
+        QStringList retVal;
+        retVal.reserve( files.count() );
+        for ( auto &&ii : files )
+            retVal << ii.absoluteFilePath();
+        return retVal;
+    }
+
+    class CBenchmarkFindAllFiles : public ::testing::Test
+    {
+    protected:
+        void SetUp() override
+        {
+            fRoot = qEnvironmentVariable( "SAB_BENCHMARK_FINDALLFILES_DIR" );
+            if ( !fRoot.isEmpty() )
+                return;
+
+            ASSERT_TRUE( fTempDir.isValid() );
+            fRoot = fTempDir.path();
+
+            auto numDirs = qEnvironmentVariableIntValue( "SAB_BENCHMARK_FINDALLFILES_DIRS" );
+            if ( numDirs <= 0 )
+                numDirs = 2000;
+
+            // a few levels deep and uneven, so some workers run out of work and have to steal
+            for ( int ii = 0; ii < numDirs; ++ii )
+            {
+                auto path = QString( "%1/d%2/d%3/d%4" ).arg( fRoot ).arg( ii % 7 ).arg( ii % 53 ).arg( ii );
+                ASSERT_TRUE( QDir().mkpath( path ) );
+                for ( int jj = 0; jj < 50; ++jj )
+                {
+                    QFile file( QString( "%1/file%2.%3" ).arg( path ).arg( jj ).arg( ( jj % 5 ) ? "txt" : "jpg" ) );
+                    ASSERT_TRUE( file.open( QIODevice::WriteOnly ) );
+                }
+            }
+        }
+
+        template< typename FuncType >
+        QList< QFileInfo > run( const std::string &label, FuncType func )
+        {
+            QElapsedTimer timer;
+            timer.start();
+            auto retVal = func();
+            auto elapsed = timer.elapsed();
+            std::cout << std::setw( 32 ) << std::left << label << std::right << std::setw( 10 ) << elapsed << " ms " << std::setw( 10 ) << retVal.count() << " files" << std::endl;
+            return retVal;
+        }
+
+        QTemporaryDir fTempDir;
+        QString fRoot;
+    };
+
+    TEST_F( CBenchmarkFindAllFiles, Unsorted )
+    {
+        auto legacy = run( "legacy", [ this ]() { return legacyFindAllFiles( QDir( fRoot ), {}, true, false ).value(); } );
+        auto single = run( "1 thread",
+                           [ this ]()
+                           {
+                               NSABUtils::NFileUtils::SFindAllFilesOptions options;
+                               options.fMaxThreads = 1;
+                               return NSABUtils::NFileUtils::findAllFiles( QDir( fRoot ), options ).value();
+                           } );
+        auto parallel = run( "ideal thread count", [ this ]() { return NSABUtils::NFileUtils::findAllFiles( QDir( fRoot ), {}, true ).value(); } );
+
+        auto legacyPaths = toPaths( legacy );
+        auto singlePaths = toPaths( single );
+        auto parallelPaths = toPaths( parallel );
+        legacyPaths.sort();
+        singlePaths.sort();
+        parallelPaths.sort();
+        EXPECT_EQ( legacyPaths, singlePaths );
+        EXPECT_EQ( legacyPaths, parallelPaths );
+    }
+
+    TEST_F( CBenchmarkFindAllFiles, SortedAndFiltered )
+    {
+        auto legacy = run( "legacy, sorted *.jpg", [ this ]() { return legacyFindAllFiles( QDir( fRoot ), { "*.jpg" }, true, true ).value(); } );
+        auto parallel = run( "ideal thread count, sorted *.jpg", [ this ]() { return NSABUtils::NFileUtils::findAllFiles( QDir( fRoot ), { "*.jpg" }, true, true ).value(); } );
+
+        // sorted output is deterministic and in the same order as the recursive walk
+        EXPECT_EQ( toPaths( legacy ), toPaths( parallel ) );
+    }
+
+    TEST_F( CBenchmarkFindAllFiles, Streaming )
+    {
+        auto all = run( "ideal thread count", [ this ]() { return NSABUtils::NFileUtils::findAllFiles( QDir( fRoot ), {}, true ).value(); } );
+
+        QElapsedTimer timer;
+        timer.start();
+        NSABUtils::NFileUtils::SFindAllFilesOptions options;
+        options.fMaxQueuedFiles = 64;
+        auto streamed = run(
+            "streamed, small queue",
+            [ this, &options, &timer ]()
+            {
+                QList< QFileInfo > retVal;
+                EXPECT_TRUE( NSABUtils::NFileUtils::visitAllFiles(
+                    QDir( fRoot ), options,
+                    [ &retVal, &timer ]( const QFileInfo &fi )
+                    {
+                        if ( retVal.isEmpty() )
+                            std::cout << std::setw( 32 ) << std::left << "first file" << std::right << std::setw( 10 ) << timer.elapsed() << " ms" << std::endl;
+                        retVal << fi;
+                        return true;
+                    } ) );
+                return retVal;
+            } );
+        auto allPaths = toPaths( all );
+        auto streamedPaths = toPaths( streamed );
+        allPaths.sort();
+        streamedPaths.sort();
+        EXPECT_EQ( allPaths, streamedPaths );
+    }
+
+    TEST_F( CBenchmarkFindAllFiles, FileStats )
+    {
+        auto files = NSABUtils::NFileUtils::findAllFiles( QDir( fRoot ), {}, true ).value();
+        auto paths = toPaths( files );
+
+        QElapsedTimer timer;
+        timer.start();
+        qint64 qfileInfoSize = 0;
+        for ( auto &&ii : paths )
+        {
+            QFileInfo fi( ii );
+            qfileInfoSize += fi.size() + ( fi.lastModified().isValid() ? 0 : 1 );
+        }
+        std::cout << std::setw( 32 ) << std::left << "QFileInfo" << std::right << std::setw( 10 ) << timer.restart() << " ms " << std::setw( 10 ) << paths.count() << " files" << std::endl;
+
+        auto stats = NSABUtils::NFileUtils::fileStats( paths, true, 1 );
+        std::cout << std::setw( 32 ) << std::left << "fileStats, 1 thread" << std::right << std::setw( 10 ) << timer.restart() << " ms" << std::endl;
+        stats = NSABUtils::NFileUtils::fileStats( paths );
+        std::cout << std::setw( 32 ) << std::left << "fileStats" << std::right << std::setw( 10 ) << timer.restart() << " ms" << std::endl;
+
+        ASSERT_EQ( static_cast< size_t >( paths.count() ), stats.size() );
+        qint64 statSize = 0;
+        for ( qsizetype ii = 0; ii < paths.count(); ++ii )
+        {
+            EXPECT_TRUE( stats[ ii ].fIsFile );
+            statSize += stats[ ii ].fSize;
+            if ( ii < 100 )
+            {
+                // the same values, at the same resolution, as QFileInfo
+                QFileInfo fi( paths[ ii ] );
+                EXPECT_EQ( fi.size(), static_cast< qint64 >( stats[ ii ].fSize ) );
+                EXPECT_EQ( fi.lastModified(), stats[ ii ].fileTime( QFileDevice::FileModificationTime ) );
+                EXPECT_EQ( NSABUtils::NFileUtils::timeStamps( paths[ ii ], { QFileDevice::FileModificationTime } ), NSABUtils::NFileUtils::timeStamps( stats[ ii ], { QFileDevice::FileModificationTime } ) );
+            }
+        }
+        EXPECT_EQ( qfileInfoSize, statSize );
+        EXPECT_FALSE( NSABUtils::NFileUtils::fileStat( fRoot + "/missing" ).exists() );
+        EXPECT_TRUE( NSABUtils::NFileUtils::fileStat( fRoot ).fIsDir );
+    }
+
+    TEST_F( CBenchmarkFindAllFiles, RemovePaths )
+    {
+        if ( !qEnvironmentVariable( "SAB_BENCHMARK_FINDALLFILES_DIR" ).isEmpty() )
+            return;
+
+        auto numFiles = NSABUtils::NFileUtils::findAllFiles( QDir( fRoot ), {}, true ).value().count();
+
+        // the contents only, then the directory, missing paths are not errors
+        uint64_t lastReported = 0;
+        NSABUtils::NFileUtils::SRemoveOptions options;
+        options.fRemoveTopDir = false;
+        options.fProgressFunc = [ &lastReported ]( uint64_t numRemoved, uint64_t /*numErrors*/ ) { lastReported = numRemoved; };
+
+        QElapsedTimer timer;
+        timer.start();
+        auto result = NSABUtils::NFileUtils::removePaths( { fRoot, fRoot + "/missing" }, options );
+        std::cout << std::setw( 32 ) << std::left << "removePaths" << std::right << std::setw( 10 ) << timer.elapsed() << " ms " << std::setw( 10 ) << result.fNumRemoved << " removed" << std::endl;
+        EXPECT_TRUE( result.fAOK );
+        EXPECT_TRUE( result.fErrors.empty() );
+        EXPECT_LT( numFiles, static_cast< qsizetype >( result.fNumRemoved ) );
+        EXPECT_EQ( result.fNumRemoved, lastReported );
+        EXPECT_TRUE( QDir( fRoot ).exists() );
+        EXPECT_TRUE( QDir( fRoot ).isEmpty() );
+
+        result = NSABUtils::NFileUtils::removePaths( { fRoot } );
+        EXPECT_TRUE( result.fAOK );
+        EXPECT_EQ( 1, result.fNumRemoved );
+        EXPECT_FALSE( QDir( fRoot ).exists() );
+    }
+
+#ifdef Q_OS_LINUX
+    TEST_F( CBenchmarkFindAllFiles, Native )
+    {
+        auto runWith = [ this ]( bool native, bool statFiles )
+        {
+            NSABUtils::NFileUtils::SFindAllFilesOptions options;
+            options.fUseNativeEnumeration = native;
+            if ( statFiles )
+                options.fSkipFile = []( const QFileInfo &fi ) { return fi.size() < 0; };
+            options.fCallbacksThreadSafe = true;
+            return NSABUtils::NFileUtils::findAllFiles( QDir( fRoot ), options ).value();
+        };
+
+        auto qdir = run( "QDir", [ &runWith ]() { return runWith( false, false ); } );
+        auto native = run( "getdents64", [ &runWith ]() { return runWith( true, false ); } );
+        run( "QDir, skipFile reads size", [ &runWith ]() { return runWith( false, true ); } );
+        run( "getdents64, skipFile reads size", [ &runWith ]() { return runWith( true, true ); } );
+
+        auto qdirPaths = toPaths( qdir );
+        auto nativePaths = toPaths( native );
+        qdirPaths.sort();
+        nativePaths.sort();
+        EXPECT_EQ( qdirPaths, nativePaths );
+
+        QElapsedTimer timer;
+        timer.start();
+        auto subDirs = NSABUtils::NFileUtils::getSubDirs( fRoot.toStdString(), true, false );
+        std::cout << std::setw( 32 ) << std::left << "getSubDirs" << std::right << std::setw( 10 ) << timer.elapsed() << " ms " << std::setw( 10 ) << subDirs.size() << " dirs" << std::endl;
+        std::set< std::string > uniqueDirs( subDirs.begin(), subDirs.end() );
+        EXPECT_EQ( uniqueDirs.size(), subDirs.size() );
+
+        if ( !qEnvironmentVariable( "SAB_BENCHMARK_FINDALLFILES_DIR" ).isEmpty() )
+            return;
+
+        timer.restart();
+        EXPECT_TRUE( NSABUtils::NFileUtils::removeInsideOfDir( fRoot ) );
+        std::cout << std::setw( 32 ) << std::left << "removeInsideOfDir" << std::right << std::setw( 10 ) << timer.elapsed() << " ms" << std::endl;
+        EXPECT_FALSE( QDir( fRoot ).exists() );
+    }
+#endif
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication appl( argc, argv );
+    ::testing::InitGoogleTest( &argc, argv );
+    int retVal = RUN_ALL_TESTS();
+    return retVal;
+}
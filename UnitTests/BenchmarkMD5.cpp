@@ -0,0 +1,232 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "../MD5.h"
+
+#include <QCoreApplication>
+#include <QTemporaryFile>
+#include <QThreadPool>
+#include <QEventLoop>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QImage>
+#include <QDataStream>
+#include <QCryptographicHash>
+
+#include <iostream>
+#include <iomanip>
+#include "gtest/gtest.h"
+
+// size of the generated file can be set via SAB_BENCHMARK_MD5_MB, default is 64MB
+namespace
+{
+    class CBenchmarkMD5 : public ::testing::Test
+    {
+    protected:
+        void SetUp() override
+        {
+            auto sizeMB = qEnvironmentVariableIntValue( "SAB_BENCHMARK_MD5_MB" );
+            if ( sizeMB <= 0 )
+                sizeMB = 64;
+            fSize = static_cast< qint64 >( sizeMB ) * 1024 * 1024;
+
+            ASSERT_TRUE( fFile.open() );
+            QByteArray block( 1024 * 1024, Qt::Uninitialized );
+            QRandomGenerator generator( 0x5AB );
+            for ( qint64 written = 0; written < fSize; written += block.size() )
+            {
+                generator.fillRange( reinterpret_cast< quint32 * >( block.data() ), block.size() / sizeof( quint32 ) );
+                ASSERT_EQ( block.size(), fFile.write( block ) );
+            }
+            fFile.close();
+        }
+
+        // runs the compute on the thread pool, with the signals queued back to this thread
+        // just like a GUI using CComputeMD5 would see them
+        std::pair< QByteArray, double > run( const QString &label, std::function< void( NSABUtils::CComputeMD5 * ) > setupFunc )
+        {
+            auto computer = std::make_unique< NSABUtils::CComputeMD5 >( fFile.fileName() );
+            computer->setAutoDelete( false );
+            if ( setupFunc )
+                setupFunc( computer.get() );
+
+            uint64_t numStatus = 0;
+            QEventLoop loop;
+            QObject receiver;
+            QObject::connect( computer.get(), &NSABUtils::CComputeMD5::sigReadPositionStatus, &receiver, [ &numStatus ]() { numStatus++; }, Qt::QueuedConnection );
+            QObject::connect( computer.get(), &NSABUtils::CComputeMD5::sigFinished, &loop, &QEventLoop::quit, Qt::QueuedConnection );
+
+            QElapsedTimer timer;
+            timer.start();
+            QThreadPool::globalInstance()->start( computer.get() );
+            loop.exec();
+            QThreadPool::globalInstance()->waitForDone();
+            auto elapsed = std::max< qint64 >( 1, timer.nsecsElapsed() );
+
+            auto gbPerSec = ( 1.0 * fSize / ( 1024.0 * 1024.0 * 1024.0 ) ) / ( elapsed / 1e9 );
+            std::cout << std::setw( 32 ) << std::left << label.toStdString() << std::right << std::fixed << std::setprecision( 3 ) << std::setw( 10 ) << gbPerSec << " GB/s " << std::setw( 10 ) << numStatus << " status signals" << std::endl;
+            return { computer->md5(), gbPerSec };
+        }
+
+        QTemporaryFile fFile;
+        qint64 fSize{ 0 };
+    };
+
+    TEST_F( CBenchmarkMD5, ReadStrategies )
+    {
+        auto legacy = run( "4KB blocks, every block", []( NSABUtils::CComputeMD5 *computer )
+                           {
+                               computer->setBlockSize( 4096 );
+                               computer->setProgressInterval( 0 );
+                           } );
+        auto streaming = run( "1MB blocks, 100ms progress", {} );
+        auto mapped = run( "Memory mapped, 100ms progress", []( NSABUtils::CComputeMD5 *computer ) { computer->setUseMemoryMap( true ); } );
+        auto byBytes = run( "4MB blocks, every 64MB", []( NSABUtils::CComputeMD5 *computer )
+                            {
+                                computer->setBlockSize( 4 * 1024 * 1024 );
+                                computer->setProgressInterval( 0 );
+                                computer->setProgressByteInterval( 64 * 1024 * 1024 );
+                            } );
+
+        EXPECT_FALSE( legacy.first.isEmpty() );
+        EXPECT_EQ( legacy.first, streaming.first );
+        EXPECT_EQ( legacy.first, mapped.first );
+        EXPECT_EQ( legacy.first, byBytes.first );
+        EXPECT_EQ( legacy.first, NSABUtils::getMd5( QFileInfo( fFile.fileName() ) ) );
+    }
+
+    TEST_F( CBenchmarkMD5, Algorithms )
+    {
+        for ( auto &&algorithm : { NSABUtils::EHashAlgorithm::eMD5, NSABUtils::EHashAlgorithm::eXXHash64, NSABUtils::EHashAlgorithm::eBLAKE3 } )
+        {
+            auto mapped = run( NSABUtils::toString( algorithm ) + ", memory mapped", [ algorithm ]( NSABUtils::CComputeMD5 *computer )
+                               {
+                                   computer->setAlgorithm( algorithm );
+                                   computer->setUseMemoryMap( true );
+                               } );
+            EXPECT_FALSE( mapped.first.isEmpty() );
+            EXPECT_EQ( mapped.first, NSABUtils::getMd5( QFileInfo( fFile.fileName() ), algorithm ) );
+        }
+    }
+}
+
+namespace
+{
+    // the QDataStream based serialization getImageData used before it streamed the scanlines, digests must not change
+    QByteArray legacyImageData( const QImage &img )
+    {
+        if ( img.isNull() )
+            return {};
+
+        QByteArray retVal;
+        QDataStream ds( &retVal, QDataStream::WriteOnly );
+
+        auto width = img.width();
+        auto height = img.height();
+        auto depth = img.depth();
+        ds << width << height << depth;
+
+        auto bpl = img.bytesPerLine();
+
+        if ( ( img.format() == QImage::Format::Format_RGB32 ) || ( img.format() >= QImage::Format::Format_ARGB32 ) )
+        {
+            if ( ( img.format() >= QImage::Format::Format_ARGB32 ) && ( ( width * depth / 8 ) == bpl ) )
+            {
+                ds.writeBytes( reinterpret_cast< const char * >( img.bits() ), bpl );
+            }
+            else
+            {
+                for ( int line = 0; line < height; ++line )
+                {
+                    ds.writeBytes( reinterpret_cast< const char * >( img.constScanLine( line ) ), bpl );
+                }
+            }
+        }
+        else
+        {
+            const QVector< QRgb > &colortable = img.colorTable();
+            for ( int y = 0; y < height; ++y )
+            {
+                for ( int x = 0; x < width; ++x )
+                {
+                    auto curr = colortable[ img.pixelIndex( x, y ) ];
+                    retVal.push_back( QByteArray( reinterpret_cast< const char * >( &curr ), sizeof( QRgb ) ) );
+                }
+            }
+        }
+        return retVal;
+    }
+
+    QImage randomImage( int width, int height, QImage::Format format )
+    {
+        QImage retVal( width, height, format );
+        QRandomGenerator generator( 0x5AB );
+        if ( ( format == QImage::Format_Mono ) || ( format == QImage::Format_MonoLSB ) )
+            retVal.setColorTable( { qRgb( 0, 0, 0 ), qRgb( 255, 255, 255 ) } );
+        else if ( format == QImage::Format_Indexed8 )
+        {
+            QVector< QRgb > colorTable;
+            for ( int ii = 0; ii < 256; ++ii )
+                colorTable.push_back( generator.generate() );
+            retVal.setColorTable( colorTable );
+        }
+        for ( int y = 0; y < height; ++y )
+        {
+            auto line = retVal.scanLine( y );
+            for ( qsizetype ii = 0; ii < retVal.bytesPerLine(); ++ii )
+                line[ ii ] = static_cast< uchar >( generator.bounded( 256 ) );
+        }
+        return retVal;
+    }
+
+    TEST( BenchmarkImageMD5, Formats )
+    {
+        // odd widths to exercise the padded scanlines and the partial bytes of the 1 bit formats
+        for ( auto &&format : { QImage::Format_Mono, QImage::Format_MonoLSB, QImage::Format_Indexed8, QImage::Format_RGB32, QImage::Format_ARGB32, QImage::Format_RGB888 } )
+        {
+            auto img = randomImage( 4001, 3001, format );
+            auto label = QString( "format %1" ).arg( static_cast< int >( format ) ).toStdString();
+
+            QElapsedTimer timer;
+            timer.start();
+            auto legacy = legacyImageData( img );
+            auto legacyMD5 = NSABUtils::formatMd5( QCryptographicHash::hash( legacy, QCryptographicHash::Md5 ), false );
+            auto legacyElapsed = timer.restart();
+
+            auto md5 = NSABUtils::getMd5( img );
+            auto elapsed = timer.restart();
+
+            std::cout << std::setw( 32 ) << std::left << label << std::right << std::setw( 10 ) << legacyElapsed << " ms legacy " << std::setw( 10 ) << elapsed << " ms streamed" << std::endl;
+
+            EXPECT_EQ( legacy, NSABUtils::getImageData( img ) ) << label;
+            EXPECT_EQ( legacyMD5, md5 ) << label;
+        }
+    }
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication appl( argc, argv );
+    ::testing::InitGoogleTest( &argc, argv );
+    int retVal = RUN_ALL_TESTS();
+    return retVal;
+}
@@ -0,0 +1,103 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "../MetadataStore.h"
+#include "../FileBasedCache.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+#include <iostream>
+#include <iomanip>
+#include "gtest/gtest.h"
+
+namespace
+{
+    class CBenchmarkMetadataStore : public ::testing::Test
+    {
+    protected:
+        void SetUp() override
+        {
+            ASSERT_TRUE( fDir.isValid() );
+            fStoreFile = fDir.filePath( "store/metadata.dat" );
+            fDataFile = fDir.filePath( "data.mkv" );
+
+            QFile file( fDataFile );
+            ASSERT_TRUE( file.open( QIODevice::WriteOnly | QIODevice::Truncate ) );
+            file.write( "hello world" );
+        }
+
+        QTemporaryDir fDir;
+        QString fStoreFile;
+        QString fDataFile;
+    };
+
+    // SAB_BENCHMARK_CACHE_ENTRIES (default 100000) entries of SAB_BENCHMARK_RECORD_BYTES (default 1024, a parsed media file is closer to 16k)
+    TEST_F( CBenchmarkMetadataStore, ColdLoad )
+    {
+        auto numEntries = qEnvironmentVariableIntValue( "SAB_BENCHMARK_CACHE_ENTRIES" );
+        if ( numEntries <= 0 )
+            numEntries = 100000;
+        auto recordBytes = qEnvironmentVariableIntValue( "SAB_BENCHMARK_RECORD_BYTES" );
+        if ( recordBytes <= 0 )
+            recordBytes = 1024;
+
+        QElapsedTimer timer;
+        timer.start();
+        {
+            // the files do not need to exist, nothing is stat'ed until it is looked up
+            NSABUtils::CMetadataStore store( 1 );
+            ASSERT_TRUE( store.open( fStoreFile ) );
+            auto record = QByteArray( recordBytes, 'x' );
+            for ( int ii = 0; ii < numEntries; ++ii )
+            {
+                auto path = fDir.filePath( QString( "dir%1/file%2.mkv" ).arg( ii % 100 ).arg( ii ) );
+                store.add( NSABUtils::SFileBasedCacheNode( path, ii, QDateTime::fromMSecsSinceEpoch( ii * 1000LL ) ), record );
+            }
+            store.add( QFileInfo( fDataFile ), "LIVE" );
+        }
+        auto writeTime = timer.restart();
+
+        NSABUtils::CMetadataStore store( 1 );
+        ASSERT_TRUE( store.open( fStoreFile ) );
+        auto openTime = timer.restart();
+        EXPECT_EQ( static_cast< std::size_t >( numEntries ) + 1, store.numEntries() );
+        EXPECT_EQ( "LIVE", store.find( QFileInfo( fDataFile ) ) );
+        auto findTime = timer.elapsed();
+
+        std::cout << std::setw( 32 ) << "write: " << writeTime << " ms" << std::endl;
+        std::cout << std::setw( 32 ) << "cold open: " << openTime << " ms" << std::endl;
+        std::cout << std::setw( 32 ) << "first find: " << findTime << " ms" << std::endl;
+    }
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication appl( argc, argv );
+    ::testing::InitGoogleTest( &argc, argv );
+    int retVal = RUN_ALL_TESTS();
+    return retVal;
+}
@@ -0,0 +1,77 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "../PathPatternSet.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+
+#include <iostream>
+#include "gtest/gtest.h"
+
+namespace
+{
+    // SAB_BENCHMARK_PATTERN_NAMES sets the number of names matched (default 100000)
+    TEST( BenchmarkPathPatternSet, MatchesName )
+    {
+        auto numNames = qEnvironmentVariableIntValue( "SAB_BENCHMARK_PATTERN_NAMES" );
+        if ( numNames <= 0 )
+            numNames = 100000;
+
+        QStringList patterns;
+        for ( auto &&ext : { "mkv", "mp4", "avi", "m4v", "mov", "wmv", "ts", "mpg", "mpeg", "webm", "srt", "sub", "idx", "nfo", "jpg", "png" } )
+            patterns << QString( "*.%1" ).arg( ext );
+        patterns << "*-sample.*"
+                 << "*.part?"
+                 << "thumbs.db"
+                 << "*trailer*";
+
+        QStringList names;
+        for ( int ii = 0; ii < numNames; ++ii )
+            names << QString( "Some Movie Name (%1) - part%2.%3" ).arg( 1950 + ( ii % 70 ) ).arg( ii ).arg( ( ii % 3 ) ? "mkv" : "txt" );
+
+        QElapsedTimer timer;
+        timer.start();
+        int qdirMatches = 0;
+        for ( auto &&name : names )
+            qdirMatches += QDir::match( patterns, name ) ? 1 : 0;
+        auto qdirElapsed = timer.restart();
+
+        NSABUtils::NFileUtils::CPathPatternSet patternSet( patterns );
+        int setMatches = 0;
+        for ( auto &&name : names )
+            setMatches += patternSet.matchesName( name ) ? 1 : 0;
+        auto setElapsed = timer.elapsed();
+
+        std::cout << "QDir::match " << qdirElapsed << " ms, CPathPatternSet " << setElapsed << " ms, " << names.count() << " names " << patterns.count() << " patterns" << std::endl;
+        EXPECT_EQ( qdirMatches, setMatches );
+    }
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication appl( argc, argv );
+    ::testing::InitGoogleTest( &argc, argv );
+    int retVal = RUN_ALL_TESTS();
+    return retVal;
+}
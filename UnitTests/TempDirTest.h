@@ -0,0 +1,84 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#ifndef __TEMPDIRTEST_H
+#define __TEMPDIRTEST_H
+
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QString>
+#include <QTemporaryDir>
+
+#include <algorithm>
+#include "gtest/gtest.h"
+
+// the fixture shared by the tests that work on files, each test gets its own temporary directory
+class CTempDirTest : public ::testing::Test
+{
+protected:
+    void SetUp() override { ASSERT_TRUE( fDir.isValid() ); }
+
+    // name is relative to fDir, missing directories are made and an existing file is replaced
+    QString writeFile( const QString &name, const QByteArray &data )
+    {
+        auto path = fDir.filePath( name );
+        QDir().mkpath( QFileInfo( path ).absolutePath() );
+        QFile file( path );
+        EXPECT_TRUE( file.open( QIODevice::WriteOnly | QIODevice::Truncate ) );
+        file.write( data );
+        return path;
+    }
+
+    // size bytes of pattern( seed ), the seed is the name's length so files of the same size but different names differ
+    QString writeFile( const QString &name, qint64 size )
+    {
+        auto path = fDir.filePath( name );
+        QDir().mkpath( QFileInfo( path ).absolutePath() );
+        QFile file( path );
+        EXPECT_TRUE( file.open( QIODevice::WriteOnly | QIODevice::Truncate ) );
+        auto block = pattern( std::min< qint64 >( size, 1024 * 1024 ), static_cast< int >( name.length() ) );   // the pattern repeats every 256 bytes
+        for ( qint64 written = 0; written < size; written += block.size() )
+            file.write( block.constData(), std::min< qint64 >( block.size(), size - written ) );
+        return path;
+    }
+
+    static QByteArray pattern( qint64 size, int seed = 0 )
+    {
+        QByteArray retVal( size, 0 );
+        for ( qint64 ii = 0; ii < size; ++ii )
+            retVal[ ii ] = static_cast< char >( ( ii * 31 + seed ) & 0xff );
+        return retVal;
+    }
+
+    static QByteArray contents( const QString &path )
+    {
+        QFile file( path );
+        if ( !file.open( QIODevice::ReadOnly ) )
+            return {};
+        return file.readAll();
+    }
+
+    QTemporaryDir fDir;
+};
+
+#endif
@@ -0,0 +1,95 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "../BackupFile.h"
+#include "../FileStat.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include "TempDirTest.h"
+#include "gtest/gtest.h"
+
+namespace
+{
+    class CTestBackupFile : public CTempDirTest
+    {
+    protected:
+        QStringList backups() const { return QDir( fDir.path() ).entryList( { "*.bak" }, QDir::Files, QDir::Name ); }
+    };
+
+    TEST_F( CTestBackupFile, Rotation )
+    {
+        NSABUtils::NFileUtils::SBackupOptions options;
+        options.fMoveOrCopy = NSABUtils::NFileUtils::EMoveOrCopy::eCopy;
+
+        QString backupFile;
+        auto path = writeFile( "movie.part1.mkv", "data" );
+        for ( int ii = 0; ii < 3; ++ii )
+        {
+            QString msg;
+            ASSERT_TRUE( NSABUtils::NFileUtils::backup( path, options, &msg, &backupFile ) ) << msg.toStdString();
+        }
+        EXPECT_EQ( fDir.filePath( "movie.part1.mkv (2).bak" ), backupFile );
+        EXPECT_EQ( QStringList( { "movie.part1.mkv (1).bak", "movie.part1.mkv (2).bak", "movie.part1.mkv.bak" } ), backups() );
+
+        // the next slot follows the highest, the oldest are dropped
+        options.fMaxBackups = 2;
+        ASSERT_TRUE( NSABUtils::NFileUtils::backup( path, options, nullptr, &backupFile ) );
+        EXPECT_EQ( fDir.filePath( "movie.part1.mkv (3).bak" ), backupFile );
+        EXPECT_EQ( QStringList( { "movie.part1.mkv (2).bak", "movie.part1.mkv (3).bak" } ), backups() );
+
+        // a move leaves no file behind, and only the plain backup is replaced when not keeping backups
+        options = {};
+        options.fKeepBackups = false;
+        ASSERT_TRUE( NSABUtils::NFileUtils::backup( path, options, nullptr, &backupFile ) );
+        EXPECT_EQ( fDir.filePath( "movie.part1.mkv.bak" ), backupFile );
+        EXPECT_FALSE( QFileInfo::exists( path ) );
+        EXPECT_EQ( 3, backups().count() );
+    }
+
+    TEST_F( CTestBackupFile, HardLink )
+    {
+        NSABUtils::NFileUtils::SBackupOptions options;
+        options.fMoveOrCopy = NSABUtils::NFileUtils::EMoveOrCopy::eCopy;
+        options.fAllowHardLink = true;
+
+        QString backupFile;
+        auto path = writeFile( "large.bin", QByteArray( 1024 * 1024, 'x' ) );
+        ASSERT_TRUE( NSABUtils::NFileUtils::backup( path, options, nullptr, &backupFile ) );
+        auto lhs = NSABUtils::NFileUtils::fileStat( path );
+        auto rhs = NSABUtils::NFileUtils::fileStat( backupFile );
+        EXPECT_EQ( lhs.fSize, rhs.fSize );
+#ifdef Q_OS_UNIX
+        EXPECT_EQ( lhs.fInode, rhs.fInode );
+#endif
+    }
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication appl( argc, argv );
+    ::testing::InitGoogleTest( &argc, argv );
+    int retVal = RUN_ALL_TESTS();
+    return retVal;
+}
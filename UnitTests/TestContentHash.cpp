@@ -0,0 +1,80 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020-2021 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "../ContentHash.h"
+#include "gtest/gtest.h"
+
+namespace
+{
+    // the official test vectors use the input bytes 0, 1, ... 250, 0, 1, ...
+    QByteArray testInput( int len )
+    {
+        QByteArray retVal( len, Qt::Uninitialized );
+        for ( int ii = 0; ii < len; ++ii )
+            retVal[ ii ] = static_cast< char >( ii % 251 );
+        return retVal;
+    }
+
+    QByteArray hashInPieces( const QByteArray &data, NSABUtils::EHashAlgorithm algorithm, int pieceSize, int maxThreads )
+    {
+        NSABUtils::CContentHash hash( algorithm );
+        hash.setMaxThreads( maxThreads );
+        for ( int pos = 0; pos < data.length(); pos += pieceSize )
+            hash.addData( QByteArrayView( data ).mid( pos, pieceSize ) );
+        return hash.result();
+    }
+
+    TEST( TestContentHash, XXHash64 )
+    {
+        EXPECT_EQ( "ef46db3751d8e999", NSABUtils::CContentHash::hash( QByteArray(), NSABUtils::EHashAlgorithm::eXXHash64 ).toHex() );
+        EXPECT_EQ( "d24ec4f1a98c6e5b", NSABUtils::CContentHash::hash( "a", NSABUtils::EHashAlgorithm::eXXHash64 ).toHex() );
+        EXPECT_EQ( "44bc2cf5ad770999", NSABUtils::CContentHash::hash( "abc", NSABUtils::EHashAlgorithm::eXXHash64 ).toHex() );
+        EXPECT_EQ( "fbcea83c8a378bf1", NSABUtils::CContentHash::hash( "Nobody inspects the spammish repetition", NSABUtils::EHashAlgorithm::eXXHash64 ).toHex() );
+
+        auto data = testInput( 100000 );
+        auto expected = NSABUtils::CContentHash::hash( data, NSABUtils::EHashAlgorithm::eXXHash64 );
+        EXPECT_EQ( expected, hashInPieces( data, NSABUtils::EHashAlgorithm::eXXHash64, 7, 1 ) );
+        EXPECT_EQ( expected, hashInPieces( data, NSABUtils::EHashAlgorithm::eXXHash64, 4096, 1 ) );
+    }
+
+    TEST( TestContentHash, BLAKE3 )
+    {
+        auto algorithm = NSABUtils::EHashAlgorithm::eBLAKE3;
+        EXPECT_EQ( "af1349b9f5f9a1a6a0404dea36dcc9499bcb25c9adc112b7cc9a93cae41f3262", NSABUtils::CContentHash::hash( testInput( 0 ), algorithm ).toHex() );
+        EXPECT_EQ( "2d3adedff11b61f14c886e35afa036736dcd87a74d27b5c1510225d0f592e213", NSABUtils::CContentHash::hash( testInput( 1 ), algorithm ).toHex() );
+        EXPECT_EQ( "10108970eeda3eb932baac1428c7a2163b0e924c9a9e25b35bba72b28f70bd11", NSABUtils::CContentHash::hash( testInput( 1023 ), algorithm ).toHex() );
+        EXPECT_EQ( "42214739f095a406f3fc83deb889744ac00df831c10daa55189b5d121c855af7", NSABUtils::CContentHash::hash( testInput( 1024 ), algorithm ).toHex() );
+        EXPECT_EQ( "d00278ae47eb27b34faecf67b4fe263f82d5412916c1ffd97c8cb7fb814b8444", NSABUtils::CContentHash::hash( testInput( 1025 ), algorithm ).toHex() );
+        EXPECT_EQ( "e776b6028c7cd22a4d0ba182a8bf62205d2ef576467e838ed6f2529b85fba24a", NSABUtils::CContentHash::hash( testInput( 2048 ), algorithm ).toHex() );
+        EXPECT_EQ( "bc3e3d41a1146b069abffad3c0d44860cf664390afce4d9661f7902e7943e085", NSABUtils::CContentHash::hash( testInput( 102400 ), algorithm ).toHex() );
+    }
+
+    TEST( TestContentHash, BLAKE3Threads )
+    {
+        auto algorithm = NSABUtils::EHashAlgorithm::eBLAKE3;
+        auto data = testInput( 5 * 1024 * 1024 + 7 );
+        auto expected = hashInPieces( data, algorithm, data.length(), 1 );
+        EXPECT_EQ( expected, hashInPieces( data, algorithm, data.length(), 8 ) );
+        EXPECT_EQ( expected, hashInPieces( data, algorithm, 1000, 8 ) );
+        EXPECT_EQ( expected, hashInPieces( data, algorithm, 1024 * 1024, 8 ) );
+    }
+}
@@ -0,0 +1,112 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "../ContentSniff.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QTemporaryDir>
+#include "gtest/gtest.h"
+
+namespace
+{
+    using NSABUtils::NFileUtils::ETextEncoding;
+
+    NSABUtils::NFileUtils::SContentSniff sniff( const QByteArray &data )
+    {
+        return NSABUtils::NFileUtils::sniffContent( data.constData(), data.size() );
+    }
+
+    TEST( TestContentSniff, Buffers )
+    {
+        EXPECT_EQ( ETextEncoding::eASCII, sniff( "hello world\r\n\tthe end" ).fEncoding );
+        EXPECT_EQ( ETextEncoding::eUTF8, sniff( "caf\xc3\xa9 costs 5\xe2\x82\xac" ).fEncoding );
+        EXPECT_EQ( ETextEncoding::eOther, sniff( "caf\xe9 in latin1" ).fEncoding );
+        EXPECT_EQ( ETextEncoding::eOther, sniff( "an overlong slash \xc0\xaf" ).fEncoding );
+        EXPECT_EQ( ETextEncoding::eUTF8, sniff( "cut off at the end of the block \xe2\x82" ).fEncoding );
+
+        auto bom = sniff( "\xef\xbb\xbfwith a BOM" );
+        EXPECT_EQ( ETextEncoding::eUTF8BOM, bom.fEncoding );
+        EXPECT_EQ( 3U, bom.fBOMSize );
+        EXPECT_EQ( ETextEncoding::eUTF16LE, sniff( QByteArray( "\xff\xfeh\0i\0", 6 ) ).fEncoding );
+        EXPECT_EQ( ETextEncoding::eUTF16BE, sniff( QByteArray( "\xfe\xff\0h\0i", 6 ) ).fEncoding );
+        EXPECT_EQ( ETextEncoding::eUTF32LE, sniff( QByteArray( "\xff\xfe\0\0h\0\0\0", 8 ) ).fEncoding );
+        EXPECT_TRUE( sniff( QByteArray( "\xff\xfeh\0i\0", 6 ) ).isText() );
+
+        // past the first 16 bytes, and in the tail, so both the vector and scalar paths are used
+        EXPECT_TRUE( sniff( QByteArray( "0123456789abcdef0123456789\0abcdef", 33 ) ).fIsBinary );
+        EXPECT_TRUE( sniff( "0123456789abcdef012\x7f" ).fIsBinary );
+        EXPECT_TRUE( sniff( "0123456789abcdef\x1b" ).fIsBinary );
+        EXPECT_TRUE( sniff( "\x01" ).fIsBinary );
+        EXPECT_FALSE( sniff( "0123456789abcdef0123456789abcdef\x0b\x0c" ).fIsBinary );
+
+        auto empty = sniff( QByteArray() );
+        EXPECT_TRUE( empty.fAOK );
+        EXPECT_FALSE( empty.isText() );
+        EXPECT_EQ( ETextEncoding::eNone, empty.fEncoding );
+    }
+
+    TEST( TestContentSniff, Files )
+    {
+        QTemporaryDir dir;
+        ASSERT_TRUE( dir.isValid() );
+
+        QStringList paths;
+        for ( int ii = 0; ii < 200; ++ii )
+        {
+            auto path = dir.filePath( QString( "file%1" ).arg( ii ) );
+            QFile file( path );
+            ASSERT_TRUE( file.open( QIODevice::WriteOnly ) );
+            QByteArray data( 8192, 'x' );
+            if ( ii % 2 )
+                data[ 100 + ii ] = 0;
+            file.write( data );
+            paths << path;
+        }
+        paths << dir.filePath( "missing" );
+
+        auto results = NSABUtils::NFileUtils::sniffFiles( paths, 4096, 4 );
+        ASSERT_EQ( static_cast< size_t >( paths.count() ), results.size() );
+        for ( int ii = 0; ii < 200; ++ii )
+        {
+            EXPECT_TRUE( results[ ii ].fAOK );
+            EXPECT_EQ( ( ii % 2 ) != 0, results[ ii ].fIsBinary ) << ii;
+            EXPECT_EQ( 4096U, results[ ii ].fNumBytes );
+        }
+        EXPECT_FALSE( results.back().fAOK );
+
+        // the position of an open file is left alone
+        QFile file( paths[ 1 ] );
+        ASSERT_TRUE( file.open( QIODevice::ReadOnly ) );
+        file.seek( 10 );
+        EXPECT_TRUE( NSABUtils::NFileUtils::sniffContent( file ).fIsBinary );
+        EXPECT_EQ( 10, file.pos() );
+    }
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication appl( argc, argv );
+    ::testing::InitGoogleTest( &argc, argv );
+    int retVal = RUN_ALL_TESTS();
+    return retVal;
+}
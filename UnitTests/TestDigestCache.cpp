@@ -0,0 +1,179 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "../DigestCache.h"
+#include "../FileBasedCache.h"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include "gtest/gtest.h"
+
+namespace
+{
+    class CTestDigestCache : public ::testing::Test
+    {
+    protected:
+        void SetUp() override
+        {
+            ASSERT_TRUE( fDir.isValid() );
+            fCacheFile = fDir.filePath( "digests.dat" );
+            fDataFile = fDir.filePath( "data.txt" );
+            writeData( "hello world" );
+            ASSERT_TRUE( NSABUtils::CDigestCache::instance()->open( fCacheFile ) );
+        }
+
+        void TearDown() override { NSABUtils::CDigestCache::instance()->close(); }
+
+        void writeData( const QByteArray &data, int secsOffset = 0 )
+        {
+            QFile file( fDataFile );
+            ASSERT_TRUE( file.open( QIODevice::WriteOnly | QIODevice::Truncate ) );
+            file.write( data );
+            file.setFileTime( QDateTime::currentDateTime().addSecs( secsOffset ), QFileDevice::FileModificationTime );
+        }
+
+        QTemporaryDir fDir;
+        QString fCacheFile;
+        QString fDataFile;
+    };
+
+    TEST_F( CTestDigestCache, FindAndChange )
+    {
+        auto cache = NSABUtils::CDigestCache::instance();
+        EXPECT_TRUE( cache->find( QFileInfo( fDataFile ), NSABUtils::EHashAlgorithm::eMD5 ).isEmpty() );
+
+        cache->add( QFileInfo( fDataFile ), NSABUtils::EHashAlgorithm::eMD5, "DIGEST" );
+        cache->add( QFileInfo( fDataFile ), NSABUtils::EHashAlgorithm::eXXHash64, "XXDIGEST" );
+        EXPECT_EQ( "DIGEST", cache->find( QFileInfo( fDataFile ), NSABUtils::EHashAlgorithm::eMD5 ) );
+        EXPECT_EQ( "XXDIGEST", cache->find( QFileInfo( fDataFile ), NSABUtils::EHashAlgorithm::eXXHash64 ) );
+        EXPECT_TRUE( cache->find( QFileInfo( fDataFile ), NSABUtils::EHashAlgorithm::eBLAKE3 ).isEmpty() );
+
+        writeData( "hello world, again", 10 );
+        EXPECT_TRUE( cache->find( QFileInfo( fDataFile ), NSABUtils::EHashAlgorithm::eMD5 ).isEmpty() );
+
+        // a new version of the file drops the digests of the old version
+        cache->add( QFileInfo( fDataFile ), NSABUtils::EHashAlgorithm::eMD5, "DIGEST2" );
+        EXPECT_EQ( "DIGEST2", cache->find( QFileInfo( fDataFile ), NSABUtils::EHashAlgorithm::eMD5 ) );
+        EXPECT_EQ( 1U, cache->numEntries() );
+    }
+
+    TEST_F( CTestDigestCache, Persist )
+    {
+        auto cache = NSABUtils::CDigestCache::instance();
+        cache->add( QFileInfo( fDataFile ), NSABUtils::EHashAlgorithm::eMD5, "DIGEST" );
+        cache->close();
+        EXPECT_TRUE( cache->find( QFileInfo( fDataFile ), NSABUtils::EHashAlgorithm::eMD5 ).isEmpty() );
+
+        ASSERT_TRUE( cache->open( fCacheFile ) );
+        EXPECT_EQ( "DIGEST", cache->find( QFileInfo( fDataFile ), NSABUtils::EHashAlgorithm::eMD5 ) );
+
+        cache->invalidate( fDataFile );
+        EXPECT_TRUE( cache->find( QFileInfo( fDataFile ), NSABUtils::EHashAlgorithm::eMD5 ).isEmpty() );
+        cache->close();
+
+        ASSERT_TRUE( cache->open( fCacheFile ) );
+        EXPECT_TRUE( cache->find( QFileInfo( fDataFile ), NSABUtils::EHashAlgorithm::eMD5 ).isEmpty() );
+    }
+
+    TEST_F( CTestDigestCache, TornRecord )
+    {
+        auto cache = NSABUtils::CDigestCache::instance();
+        cache->add( QFileInfo( fDataFile ), NSABUtils::EHashAlgorithm::eMD5, "DIGEST" );
+        cache->close();
+
+        QFile file( fCacheFile );
+        ASSERT_TRUE( file.open( QIODevice::Append ) );
+        file.write( QByteArray( "\x01\x00\x00", 3 ) );
+        file.close();
+
+        ASSERT_TRUE( cache->open( fCacheFile ) );
+        EXPECT_EQ( "DIGEST", cache->find( QFileInfo( fDataFile ), NSABUtils::EHashAlgorithm::eMD5 ) );
+        EXPECT_EQ( 1U, cache->numRecords() );
+    }
+
+    TEST_F( CTestDigestCache, Compact )
+    {
+        auto cache = NSABUtils::CDigestCache::instance();
+        cache->setAutoCompactRatio( 0 );
+        for ( int ii = 0; ii < 100; ++ii )
+            cache->add( QFileInfo( fDataFile ), NSABUtils::EHashAlgorithm::eMD5, QByteArray::number( ii ) );
+        EXPECT_EQ( 100U, cache->numRecords() );
+        auto origSize = QFileInfo( fCacheFile ).size();
+
+        ASSERT_TRUE( cache->compact() );
+        EXPECT_EQ( 1U, cache->numRecords() );
+        EXPECT_LT( QFileInfo( fCacheFile ).size(), origSize );
+        EXPECT_EQ( "99", cache->find( QFileInfo( fDataFile ), NSABUtils::EHashAlgorithm::eMD5 ) );
+
+        cache->close();
+        ASSERT_TRUE( cache->open( fCacheFile ) );
+        EXPECT_EQ( "99", cache->find( QFileInfo( fDataFile ), NSABUtils::EHashAlgorithm::eMD5 ) );
+        cache->setAutoCompactRatio( 4 );
+    }
+
+    TEST_F( CTestDigestCache, ForeignFileIsLeftAlone )
+    {
+        auto cache = NSABUtils::CDigestCache::instance();
+        cache->close();
+
+        // a data file picked by mistake must never be reset
+        QString msg;
+        EXPECT_FALSE( cache->open( fDataFile, &msg ) );
+        EXPECT_FALSE( msg.isEmpty() );
+        EXPECT_FALSE( cache->isOpen() );
+
+        QFile file( fDataFile );
+        ASSERT_TRUE( file.open( QIODevice::ReadOnly ) );
+        EXPECT_EQ( "hello world", file.readAll() );
+    }
+
+    TEST_F( CTestDigestCache, OlderVersionIsReset )
+    {
+        auto cache = NSABUtils::CDigestCache::instance();
+        cache->add( QFileInfo( fDataFile ), NSABUtils::EHashAlgorithm::eMD5, "DIGEST" );
+        cache->close();
+
+        {
+            QFile file( fCacheFile );
+            ASSERT_TRUE( file.open( QIODevice::WriteOnly | QIODevice::Truncate ) );
+            QDataStream ds( &file );
+            ds.setVersion( QDataStream::Qt_6_0 );
+            ds << static_cast< quint32 >( 0x53414244 ) << static_cast< quint32 >( 1 ) << QString( "an older layout" );
+        }
+
+        ASSERT_TRUE( cache->open( fCacheFile ) );
+        EXPECT_EQ( 0U, cache->numRecords() );
+        EXPECT_TRUE( cache->find( QFileInfo( fDataFile ), NSABUtils::EHashAlgorithm::eMD5 ).isEmpty() );
+    }
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication appl( argc, argv );
+    ::testing::InitGoogleTest( &argc, argv );
+    int retVal = RUN_ALL_TESTS();
+    return retVal;
+}
@@ -0,0 +1,129 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "../DirCompare.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include "gtest/gtest.h"
+
+#include <map>
+
+namespace
+{
+    class CTestDirCompare : public ::testing::Test
+    {
+    protected:
+        void SetUp() override
+        {
+            ASSERT_TRUE( fDir.isValid() );
+            fLHS = fDir.filePath( "lhs" );
+            fRHS = fDir.filePath( "rhs" );
+            fModTime = QDateTime::currentDateTime().addDays( -1 );
+        }
+
+        void writeFile( const QString &root, const QString &relPath, const QByteArray &data )
+        {
+            auto path = QDir( root ).absoluteFilePath( relPath );
+            ASSERT_TRUE( QDir().mkpath( QFileInfo( path ).absolutePath() ) );
+            QFile file( path );
+            ASSERT_TRUE( file.open( QIODevice::WriteOnly | QIODevice::Truncate ) );
+            file.write( data );
+            ASSERT_TRUE( file.setFileTime( fModTime, QFileDevice::FileModificationTime ) );
+        }
+
+        std::map< QString, NSABUtils::NFileUtils::EDirCompareResult > compare( bool reportIdentical )
+        {
+            NSABUtils::NFileUtils::CDirCompare dirCompare;
+            dirCompare.setReportIdentical( reportIdentical );
+            QString msg;
+            EXPECT_TRUE( dirCompare.start( fLHS, fRHS, &msg ) ) << msg.toStdString();
+            EXPECT_TRUE( dirCompare.waitForDone() );
+
+            std::map< QString, NSABUtils::NFileUtils::EDirCompareResult > retVal;
+            for ( auto &&ii : dirCompare.results() )
+                retVal[ ii.fRelativePath ] = ii.fResult;
+            return retVal;
+        }
+
+        QTemporaryDir fDir;
+        QString fLHS;
+        QString fRHS;
+        QDateTime fModTime;
+    };
+
+    TEST_F( CTestDirCompare, AddedRemovedChangedIdentical )
+    {
+        writeFile( fLHS, "identical.txt", "same" );
+        writeFile( fRHS, "identical.txt", "same" );
+        writeFile( fLHS, "sub/identical.txt", "same in a sub directory" );
+        writeFile( fRHS, "sub/identical.txt", "same in a sub directory" );
+        writeFile( fLHS, "removed.txt", "only on the left" );
+        writeFile( fRHS, "added.txt", "only on the right" );
+        writeFile( fLHS, "sub/resized.txt", "short" );
+        writeFile( fRHS, "sub/resized.txt", "much longer" );
+        writeFile( fLHS, "changed.txt", "abcd" );   // same size and time, only the content differs
+        writeFile( fRHS, "changed.txt", "abce" );
+        writeFile( fLHS, "empty.txt", {} );
+        writeFile( fRHS, "empty.txt", {} );
+
+        using NSABUtils::NFileUtils::EDirCompareResult;
+        auto results = compare( true );
+        EXPECT_EQ( EDirCompareResult::eIdentical, results[ "identical.txt" ] );
+        EXPECT_EQ( EDirCompareResult::eIdentical, results[ "sub/identical.txt" ] );
+        EXPECT_EQ( EDirCompareResult::eIdentical, results[ "empty.txt" ] );
+        EXPECT_EQ( EDirCompareResult::eOnlyLeft, results[ "removed.txt" ] );
+        EXPECT_EQ( EDirCompareResult::eOnlyRight, results[ "added.txt" ] );
+        EXPECT_EQ( EDirCompareResult::eMetaDataDiffers, results[ "sub/resized.txt" ] );
+        EXPECT_EQ( EDirCompareResult::eContentDiffers, results[ "changed.txt" ] );
+
+        // identical entries are left out unless asked for
+        results = compare( false );
+        EXPECT_EQ( 4U, results.size() );
+        EXPECT_EQ( 0U, results.count( "identical.txt" ) );
+        EXPECT_EQ( EDirCompareResult::eContentDiffers, results[ "changed.txt" ] );
+    }
+
+    TEST_F( CTestDirCompare, RemovedDirectory )
+    {
+        writeFile( fLHS, "keep.txt", "kept" );
+        writeFile( fRHS, "keep.txt", "kept" );
+        writeFile( fLHS, "gone/a.txt", "a" );
+        writeFile( fLHS, "gone/b.txt", "b" );
+
+        // a directory on one side only is reported once, for the whole subtree
+        auto results = compare( false );
+        ASSERT_EQ( 1U, results.size() );
+        EXPECT_EQ( NSABUtils::NFileUtils::EDirCompareResult::eOnlyLeft, results[ "gone" ] );
+    }
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication appl( argc, argv );
+    ::testing::InitGoogleTest( &argc, argv );
+    int retVal = RUN_ALL_TESTS();
+    return retVal;
+}
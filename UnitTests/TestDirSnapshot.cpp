@@ -0,0 +1,168 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "../DirSnapshot.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QThread>
+#include "gtest/gtest.h"
+
+namespace
+{
+    class CTestDirSnapshot : public ::testing::Test
+    {
+    protected:
+        void SetUp() override
+        {
+            ASSERT_TRUE( fDir.isValid() );
+            writeFile( "a/f1.txt", "one" );
+            writeFile( "a/b/f2.txt", "two" );
+            writeFile( "c/f3.txt", "three" );
+        }
+
+        void writeFile( const QString &relPath, const QByteArray &data, int secsOffset = -60 )
+        {
+            auto path = fDir.filePath( relPath );
+            ASSERT_TRUE( QDir().mkpath( QFileInfo( path ).absolutePath() ) );
+            QFile file( path );
+            ASSERT_TRUE( file.open( QIODevice::WriteOnly | QIODevice::Truncate ) );
+            file.write( data );
+            file.setFileTime( QDateTime::currentDateTime().addSecs( secsOffset ), QFileDevice::FileModificationTime );
+        }
+
+        QStringList sorted( QStringList list )
+        {
+            list.sort();
+            return list;
+        }
+
+        QTemporaryDir fDir;
+    };
+
+    TEST_F( CTestDirSnapshot, ScanAndRescan )
+    {
+        NSABUtils::NFileUtils::CDirSnapshot snapshot;
+        ASSERT_TRUE( snapshot.scan( fDir.path() ) );
+        EXPECT_EQ( 3U, snapshot.numFiles() );
+        EXPECT_EQ( 4U, snapshot.numDirs() );
+        EXPECT_EQ( sorted( { fDir.filePath( "a/f1.txt" ), fDir.filePath( "a/b/f2.txt" ), fDir.filePath( "c/f3.txt" ) } ), sorted( snapshot.files() ) );
+
+        auto diff = snapshot.rescan();
+        ASSERT_TRUE( diff.has_value() );
+        EXPECT_TRUE( diff->isEmpty() );
+
+        writeFile( "a/new.txt", "new" );
+        writeFile( "a/b/f2.txt", "two, longer" );
+        writeFile( "d/e/f4.txt", "four" );
+        ASSERT_TRUE( QDir( fDir.filePath( "c" ) ).removeRecursively() );
+
+        diff = snapshot.rescan();
+        ASSERT_TRUE( diff.has_value() );
+        EXPECT_EQ( sorted( { fDir.filePath( "a/new.txt" ), fDir.filePath( "d/e/f4.txt" ) } ), sorted( diff->fAdded ) );
+        EXPECT_EQ( QStringList( { fDir.filePath( "c/f3.txt" ) } ), diff->fRemoved );
+        EXPECT_EQ( QStringList( { fDir.filePath( "a/b/f2.txt" ) } ), diff->fModified );
+        EXPECT_EQ( 4U, snapshot.numFiles() );
+        EXPECT_EQ( 5U, snapshot.numDirs() );
+    }
+
+    TEST_F( CTestDirSnapshot, StatFiles )
+    {
+        NSABUtils::NFileUtils::CDirSnapshot snapshot;
+        snapshot.setStatFiles( true );
+        ASSERT_TRUE( snapshot.scan( fDir.path() ) );
+
+        writeFile( "a/f1.txt", "one, modified in place", -30 );
+        auto diff = snapshot.rescan();
+        ASSERT_TRUE( diff.has_value() );
+        EXPECT_TRUE( diff->fAdded.isEmpty() );
+        EXPECT_TRUE( diff->fRemoved.isEmpty() );
+        EXPECT_EQ( QStringList( { fDir.filePath( "a/f1.txt" ) } ), diff->fModified );
+    }
+
+    TEST_F( CTestDirSnapshot, SaveAndLoad )
+    {
+        NSABUtils::NFileUtils::CDirSnapshot snapshot;
+        ASSERT_TRUE( snapshot.scan( fDir.path() ) );
+        auto fileName = fDir.filePath( "snapshot.dat" );
+        QString msg;
+        ASSERT_TRUE( snapshot.save( fileName, &msg ) ) << msg.toStdString();
+
+        NSABUtils::NFileUtils::CDirSnapshot loaded;
+        ASSERT_TRUE( loaded.load( fileName, &msg ) ) << msg.toStdString();
+        EXPECT_EQ( snapshot.rootPath(), loaded.rootPath() );
+        EXPECT_EQ( snapshot.files(), loaded.files() );
+
+        // the snapshot file itself is the only change
+        auto diff = loaded.rescan();
+        ASSERT_TRUE( diff.has_value() );
+        EXPECT_EQ( QStringList( { fileName } ), diff->fAdded );
+        EXPECT_TRUE( diff->fRemoved.isEmpty() );
+        EXPECT_TRUE( diff->fModified.isEmpty() );
+
+        QFile file( fileName );
+        ASSERT_TRUE( file.open( QIODevice::WriteOnly | QIODevice::Truncate ) );
+        file.write( "garbage" );
+        file.close();
+        EXPECT_FALSE( loaded.load( fileName ) );
+        EXPECT_EQ( 0U, loaded.numFiles() );
+    }
+
+    TEST_F( CTestDirSnapshot, NamesOfRemovedFilesAreDropped )
+    {
+        NSABUtils::NFileUtils::CDirSnapshot snapshot;
+        ASSERT_TRUE( snapshot.scan( fDir.path() ) );
+
+        // a temp file replaced by another with a new name on every rescan
+        QString prev;
+        for ( int ii = 0; ii < 600; ++ii )
+        {
+            if ( !prev.isEmpty() )
+                ASSERT_TRUE( QFile::remove( fDir.filePath( prev ) ) );
+            prev = QString( "tmp/%1_%2" ).arg( ii, 6, 10, QChar( '0' ) ).arg( QString( 200, 'x' ) );
+            writeFile( prev, "temp" );
+            QThread::msleep( 2 );   // so the directory time changes
+            ASSERT_TRUE( snapshot.rescan().has_value() );
+        }
+        EXPECT_EQ( 4U, snapshot.numFiles() );
+
+        // 600 names of 200+ characters, without dropping them the pool alone is over 120k
+        auto fileName = fDir.filePath( "snapshot.dat" );
+        ASSERT_TRUE( snapshot.save( fileName ) );
+        EXPECT_LT( QFileInfo( fileName ).size(), 100 * 1024 );
+
+        NSABUtils::NFileUtils::CDirSnapshot loaded;
+        ASSERT_TRUE( loaded.load( fileName ) );
+        EXPECT_EQ( snapshot.files(), loaded.files() );
+    }
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication appl( argc, argv );
+    ::testing::InitGoogleTest( &argc, argv );
+    int retVal = RUN_ALL_TESTS();
+    return retVal;
+}
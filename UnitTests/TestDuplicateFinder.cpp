@@ -0,0 +1,173 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "../DuplicateFinder.h"
+#include "../DigestCache.h"
+#include "../MD5.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#ifdef Q_OS_LINUX
+    #include <unistd.h>
+#endif
+
+#include "TempDirTest.h"
+#include "gtest/gtest.h"
+
+namespace
+{
+    class CTestDuplicateFinder : public CTempDirTest
+    {
+    protected:
+        static constexpr qint64 kSampleSize{ 4096 };
+        static constexpr qint64 kFileSize{ 64 * 1024 };
+
+        void TearDown() override { NSABUtils::CDigestCache::instance()->close(); }
+
+        static QByteArray content( char fill, qint64 size = kFileSize ) { return QByteArray( size, fill ); }
+
+        std::pair< NSABUtils::TDuplicateGroups, NSABUtils::SDuplicateFinderStats > find( const QStringList &paths )
+        {
+            QList< QFileInfo > files;
+            for ( auto &&ii : paths )
+                files << QFileInfo( ii );
+
+            NSABUtils::CDuplicateFinder finder;
+            finder.setSampleSize( kSampleSize );
+            EXPECT_TRUE( finder.start( files ) );
+            EXPECT_TRUE( finder.waitForDone() );
+            EXPECT_FALSE( finder.isRunning() );
+            return { finder.groups(), finder.stats() };
+        }
+    };
+
+    TEST_F( CTestDuplicateFinder, UniqueSizesAreNotRead )
+    {
+        auto paths = QStringList( { writeFile( "a", content( 'a', 100 ) ), writeFile( "b", content( 'a', 101 ) ), writeFile( "c", content( 'a', kFileSize ) ), writeFile( "empty1", QByteArray() ), writeFile( "empty2", QByteArray() ) } );
+        auto &&[ groups, stats ] = find( paths );
+        EXPECT_TRUE( groups.isEmpty() );
+        EXPECT_EQ( 3, stats.fNumFiles );   // empty files are ignored
+        EXPECT_EQ( 100 + 101 + kFileSize, stats.fTotalBytes );
+        EXPECT_EQ( 0, stats.fNumSizeCandidates );
+        EXPECT_EQ( 0, stats.fBytesRead );
+    }
+
+    TEST_F( CTestDuplicateFinder, SamplesRejectDifferentFiles )
+    {
+        // a different head is rejected by the sample, a difference between the samples needs the full hash
+        auto head = content( 'a' );
+        head[ 0 ] = 'b';
+        auto middle = content( 'a' );
+        middle[ kFileSize / 2 ] = 'b';
+        auto paths = QStringList( { writeFile( "a", content( 'a' ) ), writeFile( "head", head ) } );
+        auto &&[ groups, stats ] = find( paths );
+        EXPECT_TRUE( groups.isEmpty() );
+        EXPECT_EQ( 2, stats.fNumSizeCandidates );
+        EXPECT_EQ( 0, stats.fNumSampleCandidates );
+        EXPECT_EQ( 2 * 2 * kSampleSize, stats.fBytesRead );
+
+        paths = QStringList( { fDir.filePath( "a" ), writeFile( "middle", middle ) } );
+        auto &&[ middleGroups, middleStats ] = find( paths );
+        EXPECT_TRUE( middleGroups.isEmpty() );
+        EXPECT_EQ( 2, middleStats.fNumSampleCandidates );
+        EXPECT_EQ( 2 * 2 * kSampleSize + 2 * kFileSize, middleStats.fBytesRead );
+    }
+
+    TEST_F( CTestDuplicateFinder, Duplicates )
+    {
+        auto paths = QStringList( { writeFile( "c", content( 'a' ) ), writeFile( "a", content( 'a' ) ), writeFile( "b", content( 'a' ) ), writeFile( "other", content( 'b' ) ), writeFile( "small1", "small" ), writeFile( "small2", "small" ) } );
+        paths << paths.front();   // the same path twice is not its own duplicate
+        auto &&[ groups, stats ] = find( paths );
+        ASSERT_EQ( 2, groups.size() );
+
+        // largest first, the files sorted
+        EXPECT_EQ( kFileSize, groups[ 0 ].fSize );
+        EXPECT_EQ( QStringList( { fDir.filePath( "a" ), fDir.filePath( "b" ), fDir.filePath( "c" ) } ), groups[ 0 ].fFiles );
+        EXPECT_EQ( NSABUtils::getMd5( QFileInfo( fDir.filePath( "a" ) ) ), groups[ 0 ].fMD5 );
+        EXPECT_TRUE( groups[ 0 ].fHardLinks.isEmpty() );
+        EXPECT_EQ( 5, groups[ 1 ].fSize );
+        EXPECT_EQ( QStringList( { fDir.filePath( "small1" ), fDir.filePath( "small2" ) } ), groups[ 1 ].fFiles );
+
+        EXPECT_EQ( 6, stats.fNumFiles );
+        EXPECT_EQ( 2, stats.fNumGroups );
+        EXPECT_EQ( 3, stats.fNumDuplicates );
+        EXPECT_EQ( 2 * kFileSize + 5, stats.fDuplicateBytes );
+        EXPECT_EQ( 0, stats.fCacheHits );
+    }
+
+#ifdef Q_OS_LINUX
+    TEST_F( CTestDuplicateFinder, HardLinks )
+    {
+        auto original = writeFile( "a", content( 'a' ) );
+        auto copy = writeFile( "b", content( 'a' ) );
+        auto link = fDir.filePath( "link" );
+        ASSERT_EQ( 0, ::link( QFile::encodeName( original ).constData(), QFile::encodeName( link ).constData() ) );
+
+        // the link is another name for the original, it is not hashed and reclaims nothing
+        auto &&[ groups, stats ] = find( { link, copy, original } );
+        ASSERT_EQ( 1, groups.size() );
+        EXPECT_EQ( 2, groups[ 0 ].fFiles.size() );
+        EXPECT_TRUE( groups[ 0 ].fFiles.contains( copy ) );
+        EXPECT_EQ( 1, groups[ 0 ].fHardLinks.size() );
+        EXPECT_EQ( 1, stats.fNumHardLinks );
+        EXPECT_EQ( 2, stats.fNumSizeCandidates );
+        EXPECT_EQ( 1, stats.fNumDuplicates );
+        EXPECT_EQ( kFileSize, stats.fDuplicateBytes );
+
+        // links to a single file are not duplicates
+        auto &&[ linkGroups, linkStats ] = find( { link, original } );
+        EXPECT_TRUE( linkGroups.isEmpty() );
+        EXPECT_EQ( 1, linkStats.fNumHardLinks );
+        EXPECT_EQ( 0, linkStats.fBytesRead );
+    }
+#endif
+
+    TEST_F( CTestDuplicateFinder, CacheHitsAreNotRead )
+    {
+        ASSERT_TRUE( NSABUtils::CDigestCache::instance()->open( fDir.filePath( "digests.dat" ) ) );
+        auto paths = QStringList( { writeFile( "a", content( 'a' ) ), writeFile( "b", content( 'a' ) ) } );
+
+        auto &&[ groups, stats ] = find( paths );
+        ASSERT_EQ( 1, groups.size() );
+        EXPECT_EQ( 0, stats.fCacheHits );
+        EXPECT_EQ( 2 * 2 * kSampleSize + 2 * kFileSize, stats.fBytesRead );
+
+        // only the samples are read once the full hashes are cached
+        auto &&[ cachedGroups, cachedStats ] = find( paths );
+        ASSERT_EQ( 1, cachedGroups.size() );
+        EXPECT_EQ( groups[ 0 ].fMD5, cachedGroups[ 0 ].fMD5 );
+        EXPECT_EQ( 2, cachedStats.fCacheHits );
+        EXPECT_EQ( 2 * kFileSize, cachedStats.fBytesFromCache );
+        EXPECT_EQ( 2 * 2 * kSampleSize, cachedStats.fBytesRead );
+    }
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication appl( argc, argv );
+    ::testing::InitGoogleTest( &argc, argv );
+    int retVal = RUN_ALL_TESTS();
+    return retVal;
+}
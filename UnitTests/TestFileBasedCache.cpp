@@ -0,0 +1,242 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "../FileBasedCache.h"
+#include "../FileStat.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+
+#include <thread>
+#include <vector>
+#include "TempDirTest.h"
+#include "gtest/gtest.h"
+
+namespace
+{
+    class CTestFileBasedCache : public CTempDirTest
+    {
+    protected:
+        // runs func( threadNum ) on numThreads threads and returns the elapsed ms
+        template< typename FuncType >
+        static qint64 runThreads( int numThreads, FuncType func )
+        {
+            QElapsedTimer timer;
+            timer.start();
+            std::vector< std::thread > threads;
+            for ( int ii = 0; ii < numThreads; ++ii )
+                threads.emplace_back( func, ii );
+            for ( auto &&ii : threads )
+                ii.join();
+            return timer.elapsed();
+        }
+    };
+
+    TEST_F( CTestFileBasedCache, Concurrent )
+    {
+        auto path = writeFile( "data.txt", "hello" );
+
+        NSABUtils::CConcurrentFileBasedCache< int > cache;
+        EXPECT_EQ( 0, cache.find( path ) );
+        cache.add( path, 42 );
+        EXPECT_EQ( 42, cache.find( path ) );
+        EXPECT_TRUE( cache.contains( path ) );
+        EXPECT_EQ( 1U, cache.size() );
+
+        // a changed file is a miss, the stale entry is replaced by the next add
+        writeFile( "data.txt", "hello world" );
+        EXPECT_EQ( 0, cache.find( path ) );
+        EXPECT_TRUE( cache.contains( path, true ) );
+        EXPECT_EQ( 7, cache.findOrCreate( path, []() { return 7; } ) );
+        EXPECT_EQ( 7, cache.find( path ) );
+        EXPECT_EQ( 1U, cache.size() );
+
+        cache.queueInvalidate( { path }, {} );
+        EXPECT_TRUE( cache.empty() );
+    }
+
+    TEST_F( CTestFileBasedCache, Validation )
+    {
+        auto path = writeFile( "data.txt", "hello" );
+
+        // never stat'ed, the entry is trusted until it is invalidated
+        NSABUtils::CFileBasedCache< int > cache;
+        cache.setValidation( NSABUtils::EFileBasedCacheValidation::eExternal );
+        cache.add( path, 42 );
+        writeFile( "data.txt", "hello world" );
+        EXPECT_EQ( 42, cache.find( path ) );
+        EXPECT_TRUE( cache.contains( path ) );
+        cache.queueInvalidate( { path }, {} );
+        EXPECT_EQ( 0, cache.find( path ) );
+
+        // trusted for the time to live, a minute is never reached by a slow machine
+        NSABUtils::CConcurrentFileBasedCache< int > trustedCache;
+        trustedCache.setValidation( NSABUtils::EFileBasedCacheValidation::eTimeToLive, 60000 );
+        trustedCache.add( path, 7 );
+        writeFile( "data.txt", "hello again world" );
+        EXPECT_EQ( 7, trustedCache.find( path ) );
+
+        // then compared against the file, a slow machine only sleeps longer than the time to live
+        NSABUtils::CConcurrentFileBasedCache< int > concurrentCache;
+        concurrentCache.setValidation( NSABUtils::EFileBasedCacheValidation::eTimeToLive, 1 );
+        concurrentCache.add( path, 7 );
+        QThread::msleep( 20 );
+        EXPECT_EQ( 7, concurrentCache.find( path ) );   // unchanged, revalidated
+        writeFile( "data.txt", "hello" );
+        QThread::msleep( 20 );
+        EXPECT_EQ( 0, concurrentCache.find( path ) );
+        EXPECT_EQ( 9, concurrentCache.findOrCreate( path, []() { return 9; } ) );
+        EXPECT_EQ( 9, concurrentCache.find( path ) );
+    }
+
+    TEST_F( CTestFileBasedCache, Eviction )
+    {
+        QStringList paths;
+        for ( int ii = 0; ii < 10; ++ii )
+            paths << writeFile( QString( "file%1.txt" ).arg( ii ), QByteArray( ii + 1, 'x' ) );
+
+        NSABUtils::CFileBasedCache< int > cache;
+        cache.setLimits( 4 );
+        cache.pin( paths[ 1 ] );
+        for ( int ii = 0; ii < paths.size(); ++ii )
+        {
+            cache.add( paths[ ii ], ii + 1 );
+            EXPECT_EQ( 1, cache.find( paths[ 0 ] ) );   // keeps the first entry referenced
+        }
+        EXPECT_EQ( 4U, cache.size() );
+        EXPECT_TRUE( cache.contains( paths[ 0 ] ) );   // recently used
+        EXPECT_TRUE( cache.contains( paths[ 1 ] ) );   // pinned
+        EXPECT_TRUE( cache.contains( paths[ 9 ] ) );   // newest
+
+        auto stats = cache.stats();
+        EXPECT_EQ( 6U, stats.fEvictions );
+        EXPECT_EQ( 4U, stats.fNumEntries );
+        EXPECT_EQ( 1U, stats.fNumPinned );
+        EXPECT_EQ( 0U, stats.fMisses );
+
+        // the byte budget, each entry costs its value
+        cache.unpin( paths[ 1 ] );
+        cache.setLimits( 0, 10, []( int value ) { return static_cast< std::size_t >( value ); } );
+        stats = cache.stats();
+        EXPECT_LE( stats.fNumBytes, 10U );
+        EXPECT_EQ( 0U, stats.fNumPinned );
+        EXPECT_EQ( 0, cache.find( paths[ 5 ] ) );
+        EXPECT_EQ( 1U, cache.stats().fMisses );
+
+        NSABUtils::CConcurrentFileBasedCache< int, 2 > concurrentCache;
+        concurrentCache.setLimits( 4 );
+        for ( int ii = 0; ii < paths.size(); ++ii )
+            concurrentCache.add( paths[ ii ], ii + 1 );
+        EXPECT_LE( concurrentCache.size(), 4U );
+        EXPECT_EQ( paths.size() - concurrentCache.size(), concurrentCache.stats().fEvictions );
+
+        // the shares add up to the limit, a limit below the number of shards keeps one entry per shard
+        NSABUtils::CConcurrentFileBasedCache< int, 4 > unevenCache;
+        unevenCache.setLimits( 6 );
+        NSABUtils::CConcurrentFileBasedCache< int, 4 > smallCache;
+        smallCache.setLimits( 1 );
+        for ( int ii = 0; ii < paths.size(); ++ii )
+        {
+            unevenCache.add( paths[ ii ], ii + 1 );
+            smallCache.add( paths[ ii ], ii + 1 );
+        }
+        EXPECT_LE( unevenCache.size(), 6U );
+        EXPECT_GE( smallCache.size(), 1U );
+        EXPECT_LE( smallCache.size(), 4U );
+    }
+
+    TEST_F( CTestFileBasedCache, SaveAndLoad )
+    {
+        QStringList paths;
+        for ( int ii = 0; ii < 3; ++ii )
+            paths << writeFile( QString( "file%1.txt" ).arg( ii ), QByteArray( ii + 1, 'x' ) );
+
+        NSABUtils::CFileBasedCache< QString > cache;
+        for ( auto &&ii : paths )
+            cache.add( ii, QFileInfo( ii ).fileName() );
+        auto cacheFile = fDir.filePath( "cache.dat" );
+        QString msg;
+        ASSERT_TRUE( cache.save( cacheFile, &msg ) ) << msg.toStdString();
+
+        // the changed file is only noticed when it is looked up, even when lookups do not stat
+        writeFile( "file1.txt", "changed" );
+        NSABUtils::CConcurrentFileBasedCache< QString > loaded;
+        loaded.setValidation( NSABUtils::EFileBasedCacheValidation::eExternal );
+        ASSERT_TRUE( loaded.load( cacheFile, &msg ) ) << msg.toStdString();
+        EXPECT_EQ( 3U, loaded.size() );
+        EXPECT_EQ( "file0.txt", loaded.find( paths[ 0 ] ) );
+        EXPECT_EQ( QString(), loaded.find( paths[ 1 ] ) );
+        EXPECT_EQ( "file2.txt", loaded.find( paths[ 2 ] ) );
+
+        // a torn file and a missing file fail and leave the cache empty
+        QFile::resize( cacheFile, QFileInfo( cacheFile ).size() - 3 );
+        EXPECT_FALSE( cache.load( cacheFile, &msg ) );
+        EXPECT_TRUE( cache.empty() );
+        EXPECT_FALSE( cache.load( fDir.filePath( "missing.dat" ) ) );
+    }
+
+    TEST_F( CTestFileBasedCache, FindOrCreateOnce )
+    {
+        std::vector< QString > paths;
+        for ( int ii = 0; ii < 4; ++ii )
+            paths.push_back( writeFile( QString( "file%1.txt" ).arg( ii ), QByteArray( ii + 1, 'x' ) ) );
+
+        NSABUtils::CConcurrentFileBasedCache< std::shared_ptr< int > > cache;
+        std::atomic< int > numCreated{ 0 };
+        std::vector< std::shared_ptr< int > > results( 16 * paths.size() );
+        runThreads(
+            16,
+            [ & ]( int threadNum )
+            {
+                for ( size_t ii = 0; ii < paths.size(); ++ii )
+                {
+                    results[ threadNum * paths.size() + ii ] = cache.findOrCreate(
+                        paths[ ii ],
+                        [ & ]()
+                        {
+                            ++numCreated;
+                            QThread::msleep( 50 );   // long enough that every thread asks while it is being created
+                            return std::make_shared< int >( static_cast< int >( ii ) );
+                        } );
+                }
+            } );
+
+        EXPECT_EQ( static_cast< int >( paths.size() ), numCreated.load() );
+        for ( size_t ii = 0; ii < results.size(); ++ii )
+            EXPECT_EQ( cache.find( paths[ ii % paths.size() ] ), results[ ii ] );
+
+        // an exception reaches the caller and nothing is added
+        auto failing = writeFile( "throws.txt", "x" );
+        EXPECT_THROW( cache.findOrCreate( failing, []() -> std::shared_ptr< int > { throw std::runtime_error( "failed" ); } ), std::runtime_error );
+        EXPECT_FALSE( cache.contains( failing ) );
+    }
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication appl( argc, argv );
+    ::testing::InitGoogleTest( &argc, argv );
+    int retVal = RUN_ALL_TESTS();
+    return retVal;
+}
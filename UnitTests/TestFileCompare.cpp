@@ -0,0 +1,119 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "../FileCompare.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include "TempDirTest.h"
+#include "gtest/gtest.h"
+
+namespace
+{
+    class CTestFileCompare : public CTempDirTest
+    {
+    };
+
+    // 64 bytes is several blocks on the reader threads, the default block size is a single block read inline
+    const std::initializer_list< qint64 > kBlockSizes{ 64, NSABUtils::NFileUtils::CFileCompare::kDefaultBlockSize };
+
+    TEST_F( CTestFileCompare, EqualFiles )
+    {
+        auto lhs = writeFile( "lhs.bin", pattern( 1000 ) );
+        auto rhs = writeFile( "rhs.bin", pattern( 1000 ) );
+        for ( auto &&blockSize : kBlockSizes )
+        {
+            QString msg;
+            EXPECT_TRUE( NSABUtils::NFileUtils::CFileCompare::compareContents( QFileInfo( lhs ), QFileInfo( rhs ), blockSize, &msg ) ) << blockSize;
+            EXPECT_TRUE( msg.isEmpty() );
+        }
+    }
+
+    TEST_F( CTestFileCompare, DifferInLastBlock )
+    {
+        auto data = pattern( 1000 );
+        auto lhs = writeFile( "lhs.bin", data );
+        data[ data.size() - 1 ] = ~data[ data.size() - 1 ];
+        auto rhs = writeFile( "rhs.bin", data );
+        for ( auto &&blockSize : kBlockSizes )
+            EXPECT_FALSE( NSABUtils::NFileUtils::CFileCompare::compareContents( QFileInfo( lhs ), QFileInfo( rhs ), blockSize ) ) << blockSize;
+    }
+
+    TEST_F( CTestFileCompare, UnequalSizes )
+    {
+        auto lhs = writeFile( "lhs.bin", pattern( 1000 ) );
+        auto rhs = writeFile( "rhs.bin", pattern( 999 ) );
+        for ( auto &&blockSize : kBlockSizes )
+            EXPECT_FALSE( NSABUtils::NFileUtils::CFileCompare::compareContents( QFileInfo( lhs ), QFileInfo( rhs ), blockSize ) ) << blockSize;
+
+        // the content check rejects different sizes even when the size is not part of the policy
+        NSABUtils::NFileUtils::CFileCompare compare( lhs, rhs );
+        compare.setCheckSize( false );
+        EXPECT_FALSE( compare.compareContent() );
+    }
+
+    TEST_F( CTestFileCompare, EmptyFiles )
+    {
+        auto lhs = writeFile( "lhs.bin", QByteArray() );
+        auto rhs = writeFile( "rhs.bin", QByteArray() );
+        auto other = writeFile( "other.bin", "x" );
+        for ( auto &&blockSize : kBlockSizes )
+        {
+            EXPECT_TRUE( NSABUtils::NFileUtils::CFileCompare::compareContents( QFileInfo( lhs ), QFileInfo( rhs ), blockSize ) ) << blockSize;
+            EXPECT_FALSE( NSABUtils::NFileUtils::CFileCompare::compareContents( QFileInfo( lhs ), QFileInfo( other ), blockSize ) ) << blockSize;
+        }
+    }
+
+    TEST_F( CTestFileCompare, ContentModes )
+    {
+        auto lhs = writeFile( "lhs.bin", pattern( 1000 ) );
+        auto rhs = writeFile( "rhs.bin", pattern( 1000 ) );
+        auto data = pattern( 1000 );
+        data[ 0 ] = ~data[ 0 ];
+        auto changed = writeFile( "changed.bin", data );
+
+        for ( auto &&mode : { NSABUtils::NFileUtils::EContentCompareMode::eBytes, NSABUtils::NFileUtils::EContentCompareMode::eDigest } )
+        {
+            NSABUtils::NFileUtils::SFileCompareOptions options;
+            options.fContentCompareMode = mode;
+            options.fUseCachedDigests = false;
+            EXPECT_TRUE( NSABUtils::NFileUtils::CFileCompare( QFileInfo( lhs ), QFileInfo( rhs ), options ).compareContent() );
+            EXPECT_FALSE( NSABUtils::NFileUtils::CFileCompare( QFileInfo( lhs ), QFileInfo( changed ), options ).compareContent() );
+        }
+    }
+
+    TEST_F( CTestFileCompare, MissingFile )
+    {
+        auto lhs = writeFile( "lhs.bin", pattern( 10 ) );
+        QString msg;
+        EXPECT_FALSE( NSABUtils::NFileUtils::CFileCompare::compareContents( QFileInfo( lhs ), QFileInfo( fDir.filePath( "missing.bin" ) ), 64, &msg ) );
+    }
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication appl( argc, argv );
+    ::testing::InitGoogleTest( &argc, argv );
+    int retVal = RUN_ALL_TESTS();
+    return retVal;
+}
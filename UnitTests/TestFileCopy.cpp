@@ -0,0 +1,175 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "../FileUtils.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include "TempDirTest.h"
+#include "gtest/gtest.h"
+
+namespace
+{
+    class CTestFileCopy : public CTempDirTest
+    {
+    protected:
+        // ten days old, so a preserved time stamp is easy to tell from the time of the copy
+        QString writeFile( const QString &name, qint64 size )
+        {
+            auto path = CTempDirTest::writeFile( name, size );
+            // one at a time, the metadata change time can not be set on linux so setting all of them fails before the modification time
+            auto tenDaysAgo = QDateTime::currentDateTime().addDays( -10 );
+            EXPECT_TRUE( NSABUtils::NFileUtils::setTimeStamp( path, tenDaysAgo, QFileDevice::FileAccessTime ) );
+            EXPECT_TRUE( NSABUtils::NFileUtils::setTimeStamp( path, tenDaysAgo, QFileDevice::FileModificationTime ) );
+            return path;
+        }
+    };
+
+    TEST_F( CTestFileCopy, EachMethod )
+    {
+        auto from = writeFile( "source.bin", 3 * 1024 * 1024 + 17 );
+
+        NSABUtils::NFileUtils::SCopyOptions options;
+        options.fBufferSize = 64 * 1024;
+        for ( auto &&method : { 0, 1, 2 } )
+        {
+            options.fAllowReflink = ( method == 0 );
+            options.fAllowKernelCopy = ( method <= 1 );
+
+            auto to = fDir.filePath( QString( "copy%1.bin" ).arg( method ) );
+            QString msg;
+            NSABUtils::NFileUtils::ECopyMethod used;
+            ASSERT_TRUE( NSABUtils::NFileUtils::copyFile( from, to, options, &msg, &used ) ) << msg.toStdString();
+            EXPECT_EQ( contents( from ), contents( to ) );
+            EXPECT_EQ( QFileInfo( from ).lastModified().toSecsSinceEpoch(), QFileInfo( to ).lastModified().toSecsSinceEpoch() );
+            if ( method == 2 )
+                EXPECT_EQ( NSABUtils::NFileUtils::ECopyMethod::eReadWrite, used );
+        }
+
+        // the same as QFile::copy, an existing file is not overwritten unless asked
+        auto existing = fDir.filePath( "copy0.bin" );
+        options = {};
+        EXPECT_FALSE( NSABUtils::NFileUtils::copyFile( from, existing, options ) );
+        options.fOverwrite = true;
+        EXPECT_TRUE( NSABUtils::NFileUtils::copyFile( from, existing, options ) );
+
+        EXPECT_FALSE( NSABUtils::NFileUtils::copyFile( fDir.filePath( "missing.bin" ), fDir.filePath( "missing.copy" ), options ) );
+        EXPECT_FALSE( QFileInfo::exists( fDir.filePath( "missing.copy" ) ) );
+    }
+
+    TEST_F( CTestFileCopy, Batch )
+    {
+        ASSERT_TRUE( QDir( fDir.path() ).mkpath( "out" ) );
+        std::vector< std::pair< QString, QString > > files;
+        qint64 totalSize = 0;
+        for ( int ii = 0; ii < 20; ++ii )
+        {
+            auto size = ii * 64 * 1024 + ii;
+            files.push_back( { writeFile( QString( "file%1.bin" ).arg( ii ), size ), fDir.filePath( QString( "out/file%1.bin" ).arg( ii ) ) } );
+            totalSize += size;
+        }
+
+        NSABUtils::NFileUtils::SCopyOptions options;
+        options.fMaxThreads = 4;
+        NSABUtils::NFileUtils::SCopyProgress lastProgress;
+        options.fProgressFunc = [ &lastProgress ]( const NSABUtils::NFileUtils::SCopyProgress &progress ) { lastProgress = progress; };
+        auto results = NSABUtils::NFileUtils::copyFiles( files, options );
+        ASSERT_EQ( files.size(), results.size() );
+        for ( size_t ii = 0; ii < files.size(); ++ii )
+        {
+            EXPECT_TRUE( results[ ii ].fAOK ) << results[ ii ].fErrorMsg.toStdString();
+            EXPECT_EQ( files[ ii ].second, results[ ii ].fTo );
+            EXPECT_EQ( contents( files[ ii ].first ), contents( files[ ii ].second ) );
+        }
+        EXPECT_EQ( totalSize, static_cast< qint64 >( lastProgress.fBytesCopied ) );
+        EXPECT_EQ( totalSize, static_cast< qint64 >( lastProgress.fTotalBytes ) );
+        EXPECT_EQ( 20, lastProgress.fFilesCopied );
+
+        // canceled before it starts, nothing is copied
+        options.fOverwrite = true;
+        options.fCancelToken.cancel();
+        results = NSABUtils::NFileUtils::copyFiles( files, options );
+        for ( auto &&ii : results )
+            EXPECT_FALSE( ii.fAOK );
+    }
+
+    TEST_F( CTestFileCopy, SameFile )
+    {
+        auto from = writeFile( "source.bin", 1024 );
+        auto data = contents( from );
+        auto link = fDir.filePath( "link.bin" );
+        ASSERT_TRUE( QFile::link( from, link ) );
+
+        // overwriting a file with itself, by the same name or through a link, must leave it alone
+        NSABUtils::NFileUtils::SCopyOptions options;
+        options.fOverwrite = true;
+        QString msg;
+        EXPECT_FALSE( NSABUtils::NFileUtils::copyFile( from, from, options, &msg ) );
+        EXPECT_FALSE( msg.isEmpty() );
+        EXPECT_FALSE( NSABUtils::NFileUtils::copyFile( from, link, options ) );
+        EXPECT_FALSE( NSABUtils::NFileUtils::copyFile( link, from, options ) );
+        EXPECT_EQ( data, contents( from ) );
+        EXPECT_TRUE( QFileInfo::exists( link ) );
+    }
+
+    TEST_F( CTestFileCopy, Permissions )
+    {
+        auto from = writeFile( "source.bin", 1024 );
+        auto to = writeFile( "existing.bin", 4096 );
+        ASSERT_TRUE( QFile::setPermissions( from, QFileDevice::ReadOwner | QFileDevice::WriteOwner | QFileDevice::ReadGroup ) );
+        ASSERT_TRUE( QFile::setPermissions( to, QFileDevice::ReadOwner | QFileDevice::WriteOwner | QFileDevice::ReadOther ) );
+
+        // an overwritten file gets the permissions of the source, like a new one
+        NSABUtils::NFileUtils::SCopyOptions options;
+        options.fOverwrite = true;
+        ASSERT_TRUE( NSABUtils::NFileUtils::copyFile( from, to, options ) );
+        EXPECT_EQ( contents( from ), contents( to ) );
+        EXPECT_EQ( QFile::permissions( from ), QFile::permissions( to ) );
+
+        auto created = fDir.filePath( "created.bin" );
+        ASSERT_TRUE( NSABUtils::NFileUtils::copyFile( from, created, options ) );
+        EXPECT_EQ( QFile::permissions( from ), QFile::permissions( created ) );
+    }
+
+    TEST_F( CTestFileCopy, LegacyCopy )
+    {
+        // the same as QFile::copy, the copy is not dated back to the source and an existing file is not replaced
+        auto from = writeFile( "source.bin", 1024 );
+        auto to = fDir.filePath( "legacy.bin" );
+        ASSERT_TRUE( NSABUtils::NFileUtils::copy( from.toStdString(), to.toStdString() ) );
+        EXPECT_EQ( contents( from ), contents( to ) );
+        EXPECT_GT( QFileInfo( to ).lastModified(), QFileInfo( from ).lastModified().addDays( 1 ) );
+        EXPECT_FALSE( NSABUtils::NFileUtils::copy( from.toStdString(), to.toStdString() ) );
+    }
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication appl( argc, argv );
+    ::testing::InitGoogleTest( &argc, argv );
+    int retVal = RUN_ALL_TESTS();
+    return retVal;
+}
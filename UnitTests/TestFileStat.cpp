@@ -0,0 +1,187 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "../FileStat.h"
+#include "../FileUtils.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include "TempDirTest.h"
+#include "gtest/gtest.h"
+
+namespace
+{
+    class CTestFileStat : public CTempDirTest
+    {
+    };
+
+    TEST_F( CTestFileStat, FilesDirectoriesAndMissingPaths )
+    {
+        auto file = writeFile( "file.txt", 1000 );
+        auto stat = NSABUtils::NFileUtils::fileStat( file );
+        EXPECT_TRUE( stat.exists() );
+        EXPECT_TRUE( stat.fIsFile );
+        EXPECT_FALSE( stat.fIsDir );
+        EXPECT_FALSE( stat.fIsSymLink );
+        EXPECT_EQ( 1000u, stat.fSize );
+        EXPECT_EQ( QFileInfo( file ).lastModified(), stat.fileTime( QFileDevice::FileModificationTime ) );
+
+        auto dir = NSABUtils::NFileUtils::fileStat( fDir.path() );
+        EXPECT_TRUE( dir.exists() );
+        EXPECT_TRUE( dir.fIsDir );
+        EXPECT_FALSE( dir.fIsFile );
+
+        auto missing = NSABUtils::NFileUtils::fileStat( fDir.filePath( "missing.txt" ) );
+        EXPECT_FALSE( missing.exists() );
+        EXPECT_FALSE( missing.fileTime( QFileDevice::FileModificationTime ).isValid() );
+        EXPECT_TRUE( missing.timeStamps( { QFileDevice::FileModificationTime } ).empty() );
+        EXPECT_FALSE( NSABUtils::NFileUtils::fileStat( QString() ).exists() );
+
+        // the batch gives the same answers, in the order of the paths
+        auto stats = NSABUtils::NFileUtils::fileStats( { fDir.filePath( "missing.txt" ), file, fDir.path() } );
+        ASSERT_EQ( 3, stats.size() );
+        EXPECT_FALSE( stats[ 0 ].exists() );
+        EXPECT_TRUE( stats[ 1 ].fIsFile );
+        EXPECT_EQ( stat.fInode, stats[ 1 ].fInode );
+        EXPECT_EQ( stat.fDevice, stats[ 1 ].fDevice );
+        EXPECT_TRUE( stats[ 2 ].fIsDir );
+    }
+
+    TEST_F( CTestFileStat, Permissions )
+    {
+        auto file = writeFile( "file.txt", 10 );
+        ASSERT_TRUE( QFile::setPermissions( file, QFile::ReadOwner | QFile::WriteOwner | QFile::ReadGroup ) );
+        EXPECT_EQ( 0640u, NSABUtils::NFileUtils::fileStat( file ).fPermissions );
+
+        ASSERT_TRUE( QFile::setPermissions( file, QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner | QFile::ReadGroup | QFile::ExeGroup | QFile::ReadOther | QFile::ExeOther ) );
+        EXPECT_EQ( 0755u, NSABUtils::NFileUtils::fileStat( file ).fPermissions );
+    }
+
+    // the change and birth times agree with QFileInfo, and are close to when the file was written
+    TEST_F( CTestFileStat, ChangeAndBirthTimes )
+    {
+        auto before = QDateTime::currentDateTime().addSecs( -2 );
+        auto file = writeFile( "file.txt", 10 );
+        auto modified = QDateTime::fromSecsSinceEpoch( 1600000000 );
+        ASSERT_TRUE( NSABUtils::NFileUtils::setTimeStamp( file, modified, QFileDevice::FileModificationTime ) );
+        auto after = QDateTime::currentDateTime().addSecs( 2 );
+
+        auto stat = NSABUtils::NFileUtils::fileStat( file );
+        QFileInfo fi( file );
+        EXPECT_EQ( modified, stat.fileTime( QFileDevice::FileModificationTime ) );
+
+        auto changed = stat.fileTime( QFileDevice::FileMetadataChangeTime );
+        EXPECT_EQ( fi.fileTime( QFileDevice::FileMetadataChangeTime ), changed );
+        EXPECT_LE( before, changed );   // setting the modification time changes the metadata
+        EXPECT_GE( after, changed );
+
+        // not every file system records it, when it does it is when the file was made
+        auto birth = stat.fileTime( QFileDevice::FileBirthTime );
+        EXPECT_EQ( fi.fileTime( QFileDevice::FileBirthTime ), birth );
+        if ( birth.isValid() )
+        {
+            EXPECT_LE( before, birth );
+            EXPECT_GE( after, birth );
+        }
+        else
+            EXPECT_EQ( NSABUtils::NFileUtils::SFileStat::kUnknownTime, stat.fBirthTime );
+    }
+
+    // the SFileStat overload gives the same answer as comparing QFileInfo's times directly
+    TEST_F( CTestFileStat, CompareTimeStamp )
+    {
+        auto lhs = writeFile( "lhs.txt", 10 );
+        auto rhs = writeFile( "rhs.txt", 10 );
+        auto when = QDateTime::fromSecsSinceEpoch( 1600000000 );
+        for ( auto &&ii : { lhs, rhs } )
+            ASSERT_TRUE( NSABUtils::NFileUtils::setTimeStamp( ii, when, QFileDevice::FileAccessTime ) );
+        ASSERT_TRUE( NSABUtils::NFileUtils::setTimeStamp( lhs, when, QFileDevice::FileModificationTime ) );
+        ASSERT_TRUE( NSABUtils::NFileUtils::setTimeStamp( rhs, when.addSecs( 3 ), QFileDevice::FileModificationTime ) );
+
+        auto lhsStat = NSABUtils::NFileUtils::fileStat( lhs );
+        auto rhsStat = NSABUtils::NFileUtils::fileStat( rhs );
+        for ( auto &&tolerance : { 0, 2, 3 } )
+        {
+            for ( auto &&timeToCheck : { QFileDevice::FileModificationTime, QFileDevice::FileAccessTime } )
+            {
+                auto expected = NSABUtils::NFileUtils::compareTimeStamp( QFileInfo( lhs ).fileTime( timeToCheck ), QFileInfo( rhs ).fileTime( timeToCheck ), tolerance );
+                EXPECT_EQ( expected, NSABUtils::NFileUtils::compareTimeStamp( lhsStat, rhsStat, tolerance, { timeToCheck } ) ) << "tolerance " << tolerance << " time " << timeToCheck;
+                EXPECT_EQ( expected, NSABUtils::NFileUtils::compareTimeStamp( QFileInfo( lhs ), QFileInfo( rhs ), tolerance, timeToCheck ) ) << "tolerance " << tolerance << " time " << timeToCheck;
+            }
+            auto both = std::list< QFileDevice::FileTime >( { QFileDevice::FileModificationTime, QFileDevice::FileAccessTime } );
+            EXPECT_EQ( tolerance >= 3, NSABUtils::NFileUtils::compareTimeStamp( lhsStat, rhsStat, tolerance, both ) );
+            EXPECT_EQ( tolerance >= 3, NSABUtils::NFileUtils::compareTimeStamp( QFileInfo( lhs ), QFileInfo( rhs ), tolerance, both ) );
+        }
+
+        // a missing file only matches another missing file
+        auto missing = NSABUtils::NFileUtils::fileStat( fDir.filePath( "missing.txt" ) );
+        EXPECT_FALSE( NSABUtils::NFileUtils::compareTimeStamp( lhsStat, missing, 0, { QFileDevice::FileModificationTime } ) );
+        EXPECT_FALSE( NSABUtils::NFileUtils::compareTimeStamp( QFileInfo( lhs ), QFileInfo( fDir.filePath( "missing.txt" ) ), 0, QFileDevice::FileModificationTime ) );
+    }
+
+#ifdef Q_OS_LINUX
+    TEST_F( CTestFileStat, SymLinks )
+    {
+        auto file = writeFile( "file.txt", 100 );
+        auto link = fDir.filePath( "link" );
+        auto dangling = fDir.filePath( "dangling" );
+        ASSERT_TRUE( QFile::link( file, link ) );
+        ASSERT_TRUE( QFile::link( fDir.filePath( "missing.txt" ), dangling ) );
+
+        // followed, the link is the file
+        auto followed = NSABUtils::NFileUtils::fileStat( link );
+        EXPECT_TRUE( followed.fIsFile );
+        EXPECT_FALSE( followed.fIsSymLink );
+        EXPECT_EQ( 100u, followed.fSize );
+        EXPECT_EQ( NSABUtils::NFileUtils::fileStat( file ).fInode, followed.fInode );
+
+        // not followed, the link itself
+        auto notFollowed = NSABUtils::NFileUtils::fileStat( link, false );
+        EXPECT_TRUE( notFollowed.exists() );
+        EXPECT_TRUE( notFollowed.fIsSymLink );
+        EXPECT_FALSE( notFollowed.fIsFile );
+        EXPECT_NE( followed.fInode, notFollowed.fInode );
+        EXPECT_EQ( static_cast< uint64_t >( QFile::encodeName( file ).size() ), notFollowed.fSize );   // the length of the target
+
+        // a dangling link only exists when it is not followed
+        EXPECT_FALSE( NSABUtils::NFileUtils::fileStat( dangling ).exists() );
+        EXPECT_TRUE( NSABUtils::NFileUtils::fileStat( dangling, false ).fIsSymLink );
+
+        auto stats = NSABUtils::NFileUtils::fileStats( { link, dangling }, false );
+        ASSERT_EQ( 2, stats.size() );
+        EXPECT_TRUE( stats[ 0 ].fIsSymLink );
+        EXPECT_TRUE( stats[ 1 ].fIsSymLink );
+    }
+#endif
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication appl( argc, argv );
+    ::testing::InitGoogleTest( &argc, argv );
+    int retVal = RUN_ALL_TESTS();
+    return retVal;
+}
@@ -0,0 +1,204 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "../FileUtils.h"
+#include "../MoveToTrash.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+#ifdef Q_OS_LINUX
+    #include <unistd.h>
+#endif
+
+#include "TempDirTest.h"
+#include "gtest/gtest.h"
+
+namespace
+{
+    class CTestFileUtilsRemove : public CTempDirTest
+    {
+    protected:
+        // 3 files and 2 directories below tree, 6 paths with tree itself
+        QString writeTree()
+        {
+            writeFile( "tree/a.txt", QByteArray( "a" ) );
+            writeFile( "tree/sub/b.txt", QByteArray( "b" ) );
+            writeFile( "tree/sub/deeper/c.txt", QByteArray( "c" ) );
+            return fDir.filePath( "tree" );
+        }
+
+        QStringList entries( const QString &dir ) const { return QDir( dir ).entryList( QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot, QDir::Name ); }
+    };
+
+    TEST_F( CTestFileUtilsRemove, TreeAndFiles )
+    {
+        auto tree = writeTree();
+        auto file = writeFile( "loose.txt", QByteArray( "loose" ) );
+        auto result = NSABUtils::NFileUtils::removePaths( { tree, file, fDir.filePath( "missing.txt" ) } );
+        EXPECT_TRUE( result.fAOK );
+        EXPECT_FALSE( result.fCanceled );
+        EXPECT_TRUE( result.fErrors.empty() );
+        EXPECT_EQ( 7, result.fNumRemoved );   // a path that does not exist is not an error
+        EXPECT_TRUE( entries( fDir.path() ).isEmpty() );
+    }
+
+    TEST_F( CTestFileUtilsRemove, KeepTopDir )
+    {
+        auto tree = writeTree();
+        NSABUtils::NFileUtils::SRemoveOptions options;
+        options.fRemoveTopDir = false;
+        auto result = NSABUtils::NFileUtils::removePaths( { tree }, options );
+        EXPECT_TRUE( result.fAOK );
+        EXPECT_EQ( 5, result.fNumRemoved );
+        EXPECT_TRUE( QFileInfo( tree ).isDir() );
+        EXPECT_TRUE( entries( tree ).isEmpty() );
+    }
+
+    TEST_F( CTestFileUtilsRemove, CancelBeforeStart )
+    {
+        auto tree = writeTree();
+        NSABUtils::NFileUtils::SRemoveOptions options;
+        options.fCancelToken.cancel();
+        auto result = NSABUtils::NFileUtils::removePaths( { tree }, options );
+        EXPECT_FALSE( result.fAOK );
+        EXPECT_TRUE( result.fCanceled );
+        EXPECT_TRUE( result.fErrors.empty() );
+        EXPECT_EQ( 0, result.fNumRemoved );
+        EXPECT_TRUE( QFileInfo::exists( fDir.filePath( "tree/sub/deeper/c.txt" ) ) );
+    }
+
+#ifdef Q_OS_LINUX
+    TEST_F( CTestFileUtilsRemove, SymLinksAreNotFollowed )
+    {
+        auto tree = writeTree();
+        auto outside = writeFile( "outside/keep.txt", QByteArray( "keep" ) );
+        ASSERT_TRUE( QFile::link( fDir.filePath( "outside" ), fDir.filePath( "tree/sub/dirLink" ) ) );
+        ASSERT_TRUE( QFile::link( outside, fDir.filePath( "tree/fileLink" ) ) );
+
+        auto result = NSABUtils::NFileUtils::removePaths( { tree } );
+        EXPECT_TRUE( result.fAOK );
+        EXPECT_EQ( 8, result.fNumRemoved );
+        EXPECT_FALSE( QFileInfo::exists( tree ) );
+        EXPECT_EQ( "keep", contents( outside ) );
+    }
+
+    // a single thread reads the top directory first, so the cancel lands before any sub directory is read
+    TEST_F( CTestFileUtilsRemove, CancelMidWalk )
+    {
+        auto tree = writeTree();
+        NSABUtils::NFileUtils::SRemoveOptions options;
+        options.fMaxThreads = 1;
+        options.fProgressIntervalMS = 0;
+        int numReports = 0;
+        options.fProgressFunc = [ &options, &numReports ]( uint64_t /*numRemoved*/, uint64_t /*numErrors*/ )
+        {
+            numReports++;
+            options.fCancelToken.cancel();
+        };
+
+        auto result = NSABUtils::NFileUtils::removePaths( { tree }, options );
+        EXPECT_FALSE( result.fAOK );
+        EXPECT_TRUE( result.fCanceled );
+        EXPECT_TRUE( result.fErrors.empty() );
+        EXPECT_EQ( 1, result.fNumRemoved );
+        EXPECT_LE( 2, numReports );   // the final report is always made
+
+        // what was removed stays removed, the rest is left alone
+        EXPECT_FALSE( QFileInfo::exists( fDir.filePath( "tree/a.txt" ) ) );
+        EXPECT_TRUE( QFileInfo::exists( fDir.filePath( "tree/sub/b.txt" ) ) );
+        EXPECT_TRUE( QFileInfo::exists( fDir.filePath( "tree/sub/deeper/c.txt" ) ) );
+    }
+
+    TEST_F( CTestFileUtilsRemove, ReadOnlySubDir )
+    {
+        if ( ::geteuid() == 0 )
+            GTEST_SKIP() << "root can remove from a read only directory";
+
+        auto tree = writeTree();
+        auto locked = writeFile( "tree/locked/file.txt", QByteArray( "locked" ) );
+        auto lockedDir = fDir.filePath( "tree/locked" );
+        ASSERT_TRUE( QFile::setPermissions( lockedDir, QFile::ReadOwner | QFile::ExeOwner | QFile::ReadGroup | QFile::ExeGroup | QFile::ReadOther | QFile::ExeOther ) );
+
+        NSABUtils::NFileUtils::SRemoveOptions options;
+        options.fProgressIntervalMS = 0;
+        uint64_t lastErrors = 0;
+        options.fProgressFunc = [ &lastErrors ]( uint64_t /*numRemoved*/, uint64_t numErrors ) { lastErrors = numErrors; };
+        auto result = NSABUtils::NFileUtils::removePaths( { tree }, options );
+
+        QFile::setPermissions( lockedDir, QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner );   // so the temporary directory can be cleaned up
+
+        // only the file is an error, the directories that are not empty because of it are not listed
+        EXPECT_FALSE( result.fAOK );
+        EXPECT_FALSE( result.fCanceled );
+        ASSERT_EQ( 1, result.fErrors.size() );
+        EXPECT_EQ( locked, result.fErrors.front().fPath );
+        EXPECT_TRUE( result.fErrors.front().fErrorMsg.contains( locked ) );
+        EXPECT_EQ( 1, lastErrors );
+
+        // everything else is removed
+        EXPECT_EQ( 5, result.fNumRemoved );
+        EXPECT_EQ( QStringList( { "locked" } ), entries( tree ) );
+        EXPECT_EQ( QStringList( { "file.txt" } ), entries( lockedDir ) );
+    }
+
+    // XDG_DATA_HOME points the home trash at a temporary directory on the same file system as the files being trashed
+    TEST_F( CTestFileUtilsRemove, Trash )
+    {
+        QTemporaryDir dataHome;
+        ASSERT_TRUE( dataHome.isValid() );
+        auto oldDataHome = qgetenv( "XDG_DATA_HOME" );
+        qputenv( "XDG_DATA_HOME", QFile::encodeName( dataHome.path() ) );
+
+        auto tree = writeTree();
+        auto file = writeFile( "loose.txt", QByteArray( "loose" ) );
+        NSABUtils::NFileUtils::SRemoveOptions options;
+        options.fRecycleOptions = std::make_shared< NSABUtils::NFileUtils::SRecycleOptions >();
+        auto result = NSABUtils::NFileUtils::removePaths( { tree, file }, options );
+
+        if ( oldDataHome.isNull() )
+            qunsetenv( "XDG_DATA_HOME" );
+        else
+            qputenv( "XDG_DATA_HOME", oldDataHome );
+
+        // each path is moved as a whole
+        EXPECT_TRUE( result.fAOK );
+        EXPECT_TRUE( result.fErrors.empty() );
+        EXPECT_EQ( 2, result.fNumRemoved );
+        EXPECT_TRUE( entries( fDir.path() ).isEmpty() );
+        EXPECT_EQ( "c", contents( dataHome.filePath( "Trash/files/tree/sub/deeper/c.txt" ) ) );
+        EXPECT_EQ( "loose", contents( dataHome.filePath( "Trash/files/loose.txt" ) ) );
+        EXPECT_EQ( QStringList( { "loose.txt.trashinfo", "tree.trashinfo" } ), entries( dataHome.filePath( "Trash/info" ) ) );
+    }
+#endif
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication appl( argc, argv );
+    ::testing::InitGoogleTest( &argc, argv );
+    int retVal = RUN_ALL_TESTS();
+    return retVal;
+}
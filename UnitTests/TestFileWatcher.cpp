@@ -0,0 +1,144 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "../FileWatcher.h"
+#include "../FileBasedCache.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QThread>
+#include "gtest/gtest.h"
+
+namespace
+{
+    class CTestFileWatcher : public ::testing::Test
+    {
+    protected:
+        void SetUp() override
+        {
+            if ( !NSABUtils::CFileWatcher::isSupported() )
+                GTEST_SKIP();
+            ASSERT_TRUE( fDir.isValid() );
+            ASSERT_TRUE( QDir().mkpath( fDir.filePath( "sub" ) ) );
+            fFile = fDir.filePath( "sub/data.txt" );
+            writeData( "hello" );
+        }
+
+        void writeData( const QByteArray &data )
+        {
+            QFile file( fFile );
+            ASSERT_TRUE( file.open( QIODevice::WriteOnly | QIODevice::Truncate ) );
+            file.write( data );
+        }
+
+        template< typename FuncType >
+        bool waitFor( FuncType func )
+        {
+            QElapsedTimer timer;
+            timer.start();
+            while ( !func() )
+            {
+                if ( timer.elapsed() > 5000 )
+                    return false;
+                QThread::msleep( 10 );
+            }
+            return true;
+        }
+
+        QTemporaryDir fDir;
+        QString fFile;
+    };
+
+    TEST_F( CTestFileWatcher, InvalidatesCache )
+    {
+        NSABUtils::CFileWatcher watcher;
+        NSABUtils::CFileBasedCache< int > cache;
+        watcher.registerCache( &cache );
+        EXPECT_FALSE( watcher.isHealthy() );
+
+        QString msg;
+        ASSERT_TRUE( watcher.addRoot( fDir.path(), &msg ) ) << msg.toStdString();
+        EXPECT_TRUE( watcher.isHealthy() );
+        EXPECT_EQ( 2, watcher.numWatches() );
+        EXPECT_TRUE( watcher.isWatched( fFile ) );
+        EXPECT_FALSE( watcher.isWatched( fDir.path() + "2/data.txt" ) );
+
+        cache.add( fFile, 42 );
+        EXPECT_EQ( 42, cache.find( fFile ) );
+
+        writeData( "hello world" );
+        EXPECT_TRUE( waitFor( [ & ]() { return cache.find( fFile ) == 0; } ) );
+
+        // new directories are watched as they appear
+        ASSERT_TRUE( QDir().mkpath( fDir.filePath( "sub/new/deeper" ) ) );
+        EXPECT_TRUE( waitFor( [ & ]() { return watcher.numWatches() == 4; } ) );
+
+        cache.add( fFile, 7 );
+        EXPECT_EQ( 7, cache.find( fFile ) );
+        ASSERT_TRUE( QDir( fDir.filePath( "sub" ) ).removeRecursively() );
+        EXPECT_TRUE( waitFor( [ & ]() { return cache.find( fFile ) == 0; } ) );
+        EXPECT_TRUE( waitFor( [ & ]() { return watcher.numWatches() == 1; } ) );
+
+        watcher.unregisterCache( &cache );
+        EXPECT_EQ( nullptr, cache.watcher() );
+    }
+
+    TEST_F( CTestFileWatcher, SymLinksAreNotWatched )
+    {
+        QTemporaryDir outside;
+        ASSERT_TRUE( outside.isValid() );
+        auto target = outside.filePath( "target.txt" );
+        {
+            QFile file( target );
+            ASSERT_TRUE( file.open( QIODevice::WriteOnly ) );
+        }
+        ASSERT_TRUE( QFile::link( outside.path(), fDir.filePath( "linkedDir" ) ) );
+        ASSERT_TRUE( QFile::link( target, fDir.filePath( "linkedFile" ) ) );
+
+        NSABUtils::CFileWatcher watcher;
+        QString msg;
+        ASSERT_TRUE( watcher.addRoot( fDir.path(), &msg ) ) << msg.toStdString();
+        EXPECT_TRUE( watcher.isWatched( fFile ) );
+        EXPECT_TRUE( watcher.isWatched( fDir.filePath( "sub" ) ) );
+
+        // changes to what the links point to are never reported
+        EXPECT_FALSE( watcher.isWatched( fDir.filePath( "linkedDir/target.txt" ) ) );
+        EXPECT_FALSE( watcher.isWatched( fDir.filePath( "linkedFile" ) ) );
+
+        // and neither are links created after the watch
+        auto late = fDir.filePath( "sub/late" );
+        EXPECT_TRUE( watcher.isWatched( late ) );
+        ASSERT_TRUE( QFile::link( target, late ) );
+        EXPECT_TRUE( waitFor( [ & ]() { return !watcher.isWatched( late ); } ) );
+    }
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication appl( argc, argv );
+    ::testing::InitGoogleTest( &argc, argv );
+    int retVal = RUN_ALL_TESTS();
+    return retVal;
+}
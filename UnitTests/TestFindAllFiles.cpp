@@ -0,0 +1,370 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "../FileUtils.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+
+#include <atomic>
+#include <thread>
+#include "TempDirTest.h"
+#include "gtest/gtest.h"
+
+namespace
+{
+    QStringList toPaths( const QList< QFileInfo > &files )
+    {
+        QStringList retVal;
+        for ( auto &&ii : files )
+            retVal << ii.absoluteFilePath();
+        return retVal;
+    }
+
+    // 6 files, 3 of them below sub directories
+    class CTestFindAllFiles : public CTempDirTest
+    {
+    protected:
+        void SetUp() override
+        {
+            CTempDirTest::SetUp();
+            for ( auto &&ii : { "tree/a.txt", "tree/b.jpg", "tree/d1/c.txt", "tree/d1/d.txt", "tree/d1/e/f.jpg", "tree/d2/g.txt" } )
+                writeFile( ii, QByteArray( "data" ) );
+            fRoot = fDir.filePath( "tree" );
+        }
+
+        // numDirs directories of numFiles files each, with no files at the top
+        QString writeWideTree( const QString &name, int numDirs, int numFiles )
+        {
+            for ( int ii = 0; ii < numDirs; ++ii )
+            {
+                for ( int jj = 0; jj < numFiles; ++jj )
+                    writeFile( QString( "%1/d%2/file%3.txt" ).arg( name ).arg( ii ).arg( jj ), QByteArray( "data" ) );
+            }
+            return fDir.filePath( name );
+        }
+
+        QStringList allPaths() const
+        {
+            auto retVal = toPaths( NSABUtils::NFileUtils::findAllFiles( QDir( fRoot ), {}, true ).value() );
+            retVal.sort();
+            return retVal;
+        }
+
+        QString fRoot;
+    };
+
+    TEST_F( CTestFindAllFiles, Streaming )
+    {
+        auto all = allPaths();
+        ASSERT_EQ( 6, all.count() );
+
+        NSABUtils::NFileUtils::SFindAllFilesOptions options;
+        options.fMaxQueuedFiles = 2;
+        QStringList streamed;
+        EXPECT_TRUE( NSABUtils::NFileUtils::visitAllFiles( QDir( fRoot ), options,
+                                                           [ &streamed ]( const QFileInfo &fi )
+                                                           {
+                                                               streamed << fi.absoluteFilePath();
+                                                               return true;
+                                                           } ) );
+        streamed.sort();
+        EXPECT_EQ( all, streamed );
+
+        NSABUtils::NFileUtils::CFileEnumerator enumerator( QDir( fRoot ), options );
+        EXPECT_TRUE( enumerator.aOK() );
+        QStringList enumerated;
+        while ( auto curr = enumerator.next() )
+            enumerated << curr.value().absoluteFilePath();
+        enumerated.sort();
+        EXPECT_EQ( all, enumerated );
+        EXPECT_EQ( 6, enumerator.numFound() );
+
+        // the visitor stops the walk
+        int numVisited = 0;
+        EXPECT_TRUE( NSABUtils::NFileUtils::visitAllFiles( QDir( fRoot ), options,
+                                                           [ &numVisited ]( const QFileInfo & )
+                                                           {
+                                                               numVisited++;
+                                                               return false;
+                                                           } ) );
+        EXPECT_EQ( 1, numVisited );
+    }
+
+    TEST_F( CTestFindAllFiles, MaxResults )
+    {
+        NSABUtils::NFileUtils::SFindAllFilesOptions options;
+        options.fMaxResults = 4;
+        EXPECT_EQ( 4, NSABUtils::NFileUtils::findAllFiles( QDir( fRoot ), options ).value().count() );
+
+        NSABUtils::NFileUtils::CFileEnumerator enumerator( QDir( fRoot ), options );
+        int numFound = 0;
+        while ( enumerator.next() )
+            numFound++;
+        EXPECT_EQ( 4, numFound );
+        EXPECT_EQ( 4, enumerator.numFound() );
+        EXPECT_FALSE( enumerator.next().has_value() );
+
+        int numVisited = 0;
+        EXPECT_TRUE( NSABUtils::NFileUtils::visitAllFiles( QDir( fRoot ), options,
+                                                           [ &numVisited ]( const QFileInfo & )
+                                                           {
+                                                               numVisited++;
+                                                               return true;
+                                                           } ) );
+        EXPECT_EQ( 4, numVisited );
+    }
+
+    TEST_F( CTestFindAllFiles, MissingDirectory )
+    {
+        NSABUtils::NFileUtils::CFileEnumerator enumerator( QDir( fDir.filePath( "missing" ) ), {} );
+        EXPECT_FALSE( enumerator.aOK() );
+        EXPECT_FALSE( enumerator.errorMsg().isEmpty() );
+        EXPECT_FALSE( enumerator.next().has_value() );
+
+        QString errorMsg;
+        EXPECT_FALSE( NSABUtils::NFileUtils::visitAllFiles( QDir( fDir.filePath( "missing" ) ), {}, []( const QFileInfo & ) { return true; }, &errorMsg ) );
+        EXPECT_FALSE( errorMsg.isEmpty() );
+        EXPECT_FALSE( NSABUtils::NFileUtils::findAllFiles( QDir( fDir.filePath( "missing" ) ), {} ).has_value() );
+    }
+
+    TEST_F( CTestFindAllFiles, CancelBeforeStart )
+    {
+        NSABUtils::NFileUtils::SFindAllFilesOptions options;
+        options.fCancelToken.cancel();
+
+        NSABUtils::NFileUtils::CFileEnumerator enumerator( QDir( fRoot ), options );
+        EXPECT_FALSE( enumerator.next().has_value() );
+        EXPECT_EQ( 0, enumerator.numFound() );
+
+        int numVisited = 0;
+        NSABUtils::NFileUtils::visitAllFiles( QDir( fRoot ), options,
+                                              [ &numVisited ]( const QFileInfo & )
+                                              {
+                                                  numVisited++;
+                                                  return true;
+                                              } );
+        EXPECT_EQ( 0, numVisited );
+        EXPECT_TRUE( NSABUtils::NFileUtils::findAllFiles( QDir( fRoot ), options ).value().isEmpty() );
+    }
+
+    TEST_F( CTestFindAllFiles, CancelMidWalk )
+    {
+        NSABUtils::NFileUtils::SFindAllFilesOptions options;
+        options.fMaxQueuedFiles = 2;
+        {
+            NSABUtils::NFileUtils::CFileEnumerator enumerator( QDir( fRoot ), options );
+            EXPECT_TRUE( enumerator.next().has_value() );
+            EXPECT_TRUE( enumerator.next().has_value() );
+            enumerator.cancel();
+            EXPECT_FALSE( enumerator.next().has_value() );
+            EXPECT_EQ( 2, enumerator.numFound() );
+        }
+
+        // the token stops the walk from any thread, a queued file is not returned once it is set
+        int numVisited = 0;
+        EXPECT_TRUE( NSABUtils::NFileUtils::visitAllFiles( QDir( fRoot ), options,
+                                                           [ &options, &numVisited ]( const QFileInfo & )
+                                                           {
+                                                               if ( ++numVisited == 2 )
+                                                                   options.fCancelToken.cancel();
+                                                               return true;
+                                                           } ) );
+        EXPECT_EQ( 2, numVisited );
+
+        // findAllFiles returns what was found so far, a single thread finishes the directory it is reading
+        auto wide = writeWideTree( "wide", 10, 10 );
+        NSABUtils::NFileUtils::SFindAllFilesOptions findOptions;
+        findOptions.fMaxThreads = 1;
+        findOptions.fSkipFile = [ &findOptions ]( const QFileInfo & )
+        {
+            findOptions.fCancelToken.cancel();
+            return false;
+        };
+        EXPECT_EQ( 10, NSABUtils::NFileUtils::findAllFiles( QDir( wide ), findOptions ).value().count() );
+    }
+
+    // a consumer that does not call next holds the walk back to one directory, and then to fMaxQueuedFiles files past the consumer
+    TEST_F( CTestFindAllFiles, QueueBlocksTheWalk )
+    {
+        auto wide = writeWideTree( "wide", 10, 10 );
+
+        std::atomic< int > numDirs{ 0 };
+        std::atomic< int > numFiles{ 0 };
+        NSABUtils::NFileUtils::SFindAllFilesOptions options;
+        options.fMaxThreads = 1;
+        options.fMaxQueuedFiles = 4;
+        options.fSkipDir = [ &numDirs ]( const QDir & )
+        {
+            numDirs++;
+            return false;
+        };
+        options.fSkipFile = [ &numFiles ]( const QFileInfo & )
+        {
+            numFiles++;
+            return false;
+        };
+
+        NSABUtils::NFileUtils::CFileEnumerator enumerator( QDir( wide ), options );
+        QThread::msleep( 100 );   // a slow machine only gets less far
+        EXPECT_LE( numDirs.load(), 1 );
+        EXPECT_LE( numFiles.load(), 10 );
+
+        int numFound = 0;
+        while ( enumerator.next() )
+        {
+            numFound++;
+            EXPECT_LE( numFiles.load() - numFound, 4 + 10 );   // the queue, and the rest of the directory being pushed
+        }
+        EXPECT_EQ( 100, numFound );
+        EXPECT_EQ( 10, numDirs.load() );
+        EXPECT_EQ( 100, numFiles.load() );
+    }
+
+    // the order of the recursive walk, the files of a directory by name then each sub directory by name, whatever the thread count
+    TEST_F( CTestFindAllFiles, SortedOrder )
+    {
+        writeFile( "tree/d1/zz.txt", QByteArray( "data" ) );   // a plain sort of the paths puts it after d1/e/f.jpg
+        auto expected = QStringList( { "a.txt", "b.jpg", "d1/c.txt", "d1/d.txt", "d1/zz.txt", "d1/e/f.jpg", "d2/g.txt" } );
+        for ( auto &&ii : expected )
+            ii = fRoot + "/" + ii;
+
+        for ( auto &&native : { false, true } )
+        {
+            for ( auto &&numThreads : { 1, 4 } )
+            {
+                NSABUtils::NFileUtils::SFindAllFilesOptions options;
+                options.fSortByName = true;
+                options.fMaxThreads = numThreads;
+                options.fUseNativeEnumeration = native;
+                EXPECT_EQ( expected, toPaths( NSABUtils::NFileUtils::findAllFiles( QDir( fRoot ), options ).value() ) ) << "native " << native << " threads " << numThreads;
+
+                options.fNameFilters = QStringList( { "*.jpg" } );
+                EXPECT_EQ( QStringList( { fRoot + "/b.jpg", fRoot + "/d1/e/f.jpg" } ), toPaths( NSABUtils::NFileUtils::findAllFiles( QDir( fRoot ), options ).value() ) );
+
+                options.fNameFilters.clear();
+                options.fRecursive = false;
+                EXPECT_EQ( QStringList( { fRoot + "/a.txt", fRoot + "/b.jpg" } ), toPaths( NSABUtils::NFileUtils::findAllFiles( QDir( fRoot ), options ).value() ) );
+
+                // unsorted finds the same files
+                options.fRecursive = true;
+                options.fSortByName = false;
+                auto unsorted = toPaths( NSABUtils::NFileUtils::findAllFiles( QDir( fRoot ), options ).value() );
+                unsorted.sort();
+                auto sortedExpected = expected;
+                sortedExpected.sort();
+                EXPECT_EQ( sortedExpected, unsorted );
+            }
+        }
+    }
+
+    // callers of the legacy overload wrote their callbacks for the single threaded walk
+    TEST_F( CTestFindAllFiles, LegacyCallbacksOnCallingThread )
+    {
+        auto caller = std::this_thread::get_id();
+        bool otherThread = false;
+        auto files = NSABUtils::NFileUtils::findAllFiles(
+            QDir( fRoot ), {}, true, true, nullptr,
+            [ caller, &otherThread ]( const QDir &dir )
+            {
+                otherThread = otherThread || ( std::this_thread::get_id() != caller );
+                return dir.dirName() == "d1";
+            },
+            [ caller, &otherThread ]( const QFileInfo &fi )
+            {
+                otherThread = otherThread || ( std::this_thread::get_id() != caller );
+                return fi.suffix() == "jpg";
+            } );
+        EXPECT_FALSE( otherThread );
+        EXPECT_EQ( QStringList( { fRoot + "/a.txt", fRoot + "/d2/g.txt" } ), toPaths( files.value() ) );
+    }
+
+#ifdef Q_OS_LINUX
+    // getdents64 filters the same way as QDir, no hidden entries, no dangling links and links to directories are followed
+    TEST_F( CTestFindAllFiles, Native )
+    {
+        writeFile( "tree/.hidden.txt", QByteArray( "data" ) );
+        writeFile( "tree/.hiddenDir/h.txt", QByteArray( "data" ) );
+        writeFile( "outside/o.txt", QByteArray( "data" ) );
+        ASSERT_TRUE( QFile::link( fRoot + "/a.txt", fRoot + "/fileLink" ) );
+        ASSERT_TRUE( QFile::link( fDir.filePath( "outside" ), fRoot + "/d2/dirLink" ) );
+        ASSERT_TRUE( QFile::link( fDir.filePath( "missing" ), fRoot + "/dangling" ) );
+
+        auto findWith = [ this ]( bool native )
+        {
+            NSABUtils::NFileUtils::SFindAllFilesOptions options;
+            options.fUseNativeEnumeration = native;
+            auto retVal = toPaths( NSABUtils::NFileUtils::findAllFiles( QDir( fRoot ), options ).value() );
+            retVal.sort();
+            return retVal;
+        };
+
+        auto native = findWith( true );
+        EXPECT_EQ( findWith( false ), native );
+        EXPECT_EQ( 8, native.count() );
+        EXPECT_TRUE( native.contains( fRoot + "/fileLink" ) );
+        EXPECT_TRUE( native.contains( fRoot + "/d2/dirLink/o.txt" ) );
+        EXPECT_FALSE( native.contains( fRoot + "/dangling" ) );
+        EXPECT_FALSE( native.contains( fRoot + "/.hidden.txt" ) );
+    }
+
+    // links are followed, but a directory that was already read is listed without being read again
+    TEST_F( CTestFindAllFiles, GetSubDirsLinkLoop )
+    {
+        ASSERT_TRUE( QDir( fDir.path() ).mkpath( "subDirs/a/b" ) );
+        ASSERT_TRUE( QDir( fDir.path() ).mkpath( "subDirs/c" ) );
+        ASSERT_TRUE( QDir( fDir.path() ).mkpath( "subDirs/.hidden" ) );
+        auto top = fDir.filePath( "subDirs" );
+        ASSERT_TRUE( QFile::link( top, top + "/a/loop" ) );
+        ASSERT_TRUE( QFile::link( top + "/c", top + "/cLink" ) );
+
+        auto getSubDirs = [ &top ]( bool recursive, bool includeTopDir )
+        {
+            QStringList retVal;
+            for ( auto &&ii : NSABUtils::NFileUtils::getSubDirs( top.toStdString(), recursive, includeTopDir ) )
+                retVal << QString::fromStdString( ii ).mid( top.length() );
+            return retVal;
+        };
+
+        auto subDirs = getSubDirs( true, false );
+        subDirs.sort();
+        EXPECT_EQ( QStringList( { "/a", "/a/b", "/a/loop", "/c", "/cLink" } ), subDirs );
+
+        subDirs = getSubDirs( false, true );
+        ASSERT_FALSE( subDirs.isEmpty() );
+        EXPECT_EQ( QString(), subDirs.front() );
+        subDirs.sort();
+        EXPECT_EQ( QStringList( { "", "/a", "/c", "/cLink" } ), subDirs );
+    }
+#endif
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication appl( argc, argv );
+    ::testing::InitGoogleTest( &argc, argv );
+    int retVal = RUN_ALL_TESTS();
+    return retVal;
+}
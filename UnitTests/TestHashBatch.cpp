@@ -0,0 +1,104 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "../HashBatch.h"
+#include "../MD5.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+
+#include "TempDirTest.h"
+#include "gtest/gtest.h"
+
+namespace
+{
+    class CTestHashBatch : public CTempDirTest
+    {
+    };
+
+    TEST_F( CTestHashBatch, MatchesSingleFile )
+    {
+        QStringList files;
+        for ( int ii = 0; ii < 8; ++ii )
+            files << writeFile( QString( "file%1.bin" ).arg( ii ), ii * 300000 + 17 );
+        auto empty = writeFile( "empty.bin", 0 );
+        files << empty;
+
+        for ( auto algorithm : { NSABUtils::EHashAlgorithm::eMD5, NSABUtils::EHashAlgorithm::eXXHash64 } )
+        {
+            NSABUtils::CHashBatch batch;
+            batch.setMaxReadersPerDevice( 2 );
+            batch.setAlgorithm( algorithm );
+            ASSERT_TRUE( batch.start( files ) );
+            ASSERT_TRUE( batch.waitForDone() );
+
+            auto results = batch.results();
+            ASSERT_EQ( files.count(), results.count() );
+            for ( int ii = 0; ii < files.count(); ++ii )
+            {
+                // in the order passed to start
+                EXPECT_EQ( QFileInfo( files[ ii ] ).absoluteFilePath(), results[ ii ].fFileName );
+                EXPECT_TRUE( results[ ii ].aOK() ) << files[ ii ].toStdString();
+                EXPECT_EQ( NSABUtils::getMd5( QFileInfo( files[ ii ] ), algorithm ), results[ ii ].fMD5 ) << files[ ii ].toStdString();
+                EXPECT_EQ( QFileInfo( files[ ii ] ).size(), results[ ii ].fSize );
+            }
+            EXPECT_EQ( 0, results.back().fSize );
+        }
+    }
+
+    TEST_F( CTestHashBatch, UnreadableFile )
+    {
+        auto good = writeFile( "good.bin", 4096 );
+        auto unreadable = writeFile( "unreadable.bin", 4096 );
+        auto missing = fDir.filePath( "missing.bin" );
+        ASSERT_TRUE( QFile::setPermissions( unreadable, QFileDevice::WriteOwner ) );
+        QFile check( unreadable );
+        auto canRead = check.open( QIODevice::ReadOnly );   // root reads anything
+
+        NSABUtils::CHashBatch batch;
+        ASSERT_TRUE( batch.start( { good, unreadable, missing } ) );
+        ASSERT_TRUE( batch.waitForDone() );
+
+        auto results = batch.results();
+        ASSERT_EQ( 3, results.count() );
+        EXPECT_TRUE( results[ 0 ].aOK() );
+        EXPECT_EQ( NSABUtils::getMd5( QFileInfo( good ) ), results[ 0 ].fMD5 );
+        if ( !canRead )
+        {
+            EXPECT_FALSE( results[ 1 ].aOK() );
+            EXPECT_FALSE( results[ 1 ].fCanceled );
+            EXPECT_TRUE( results[ 1 ].fMD5.isEmpty() );
+        }
+        EXPECT_FALSE( results[ 2 ].aOK() );
+        EXPECT_FALSE( results[ 2 ].fCanceled );
+        QFile::setPermissions( unreadable, QFileDevice::ReadOwner | QFileDevice::WriteOwner );
+    }
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication appl( argc, argv );
+    ::testing::InitGoogleTest( &argc, argv );
+    int retVal = RUN_ALL_TESTS();
+    return retVal;
+}
@@ -0,0 +1,129 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "../MediaInfo.h"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include "gtest/gtest.h"
+
+namespace
+{
+    class CTestMediaInfo : public ::testing::Test
+    {
+    protected:
+        void SetUp() override
+        {
+            ASSERT_TRUE( fDir.isValid() );
+            fDatabaseFile = fDir.filePath( "mediainfo.dat" );
+            fMediaFile = fDir.filePath( "tone.wav" );
+            writeWav( fMediaFile );
+            ASSERT_TRUE( NSABUtils::CMediaInfo::openDatabase( fDatabaseFile ) );
+        }
+
+        void TearDown() override { NSABUtils::CMediaInfo::closeDatabase(); }
+
+        // one second of 8kHz 16 bit mono silence, small enough to write here and parsed without ffprobe
+        static void writeWav( const QString &fileName )
+        {
+            const quint32 kSampleRate = 8000;
+            const quint32 kDataSize = kSampleRate * 2;
+
+            QFile file( fileName );
+            ASSERT_TRUE( file.open( QIODevice::WriteOnly | QIODevice::Truncate ) );
+            QDataStream ds( &file );
+            ds.setByteOrder( QDataStream::LittleEndian );
+            ds.writeRawData( "RIFF", 4 );
+            ds << static_cast< quint32 >( 36 + kDataSize );
+            ds.writeRawData( "WAVEfmt ", 8 );
+            ds << static_cast< quint32 >( 16 ) << static_cast< quint16 >( 1 ) << static_cast< quint16 >( 1 ) << kSampleRate << kSampleRate * 2 << static_cast< quint16 >( 2 ) << static_cast< quint16 >( 16 );
+            ds.writeRawData( "data", 4 );
+            ds << kDataSize;
+            file.write( QByteArray( kDataSize, 0 ) );
+        }
+
+        // drops the parsed file from the in memory cache, by filling it with other files until it is evicted
+        void evict( const QString &fileName )
+        {
+            NSABUtils::CMediaInfo::setCacheLimits( 1 );
+            for ( int ii = 0; ( ii < 1000 ) && NSABUtils::CMediaInfoMgr::instance()->isMediaCached( fileName ); ++ii )
+            {
+                auto other = fDir.filePath( QString( "other%1.wav" ).arg( ii ) );
+                writeWav( other );
+                NSABUtils::CMediaInfo mediaInfo( other );
+            }
+            NSABUtils::CMediaInfo::setCacheLimits( 0 );
+            ASSERT_FALSE( NSABUtils::CMediaInfoMgr::instance()->isMediaCached( fileName ) );
+        }
+
+        QTemporaryDir fDir;
+        QString fDatabaseFile;
+        QString fMediaFile;
+    };
+
+    TEST_F( CTestMediaInfo, DatabaseRoundTrip )
+    {
+        NSABUtils::TMediaTagMap parsedTags;
+        {
+            NSABUtils::CMediaInfo mediaInfo( fMediaFile );
+            ASSERT_TRUE( mediaInfo.aOK() );
+            EXPECT_EQ( 1, mediaInfo.numAudioStreams() );
+            parsedTags = mediaInfo.getMediaTags();
+        }
+        evict( fMediaFile );
+
+        // same size and timestamp but no longer a wav file, so only a record read back from the database can be valid
+        auto modTime = QFileInfo( fMediaFile ).fileTime( QFileDevice::FileModificationTime );
+        {
+            QFile file( fMediaFile );
+            auto size = file.size();
+            ASSERT_TRUE( file.open( QIODevice::WriteOnly | QIODevice::Truncate ) );
+            file.write( QByteArray( size, 'x' ) );
+            ASSERT_TRUE( file.setFileTime( modTime, QFileDevice::FileModificationTime ) );
+        }
+
+        {
+            NSABUtils::CMediaInfo mediaInfo( fMediaFile );
+            ASSERT_TRUE( mediaInfo.aOK() );
+            EXPECT_EQ( 1, mediaInfo.numAudioStreams() );
+            EXPECT_EQ( parsedTags, mediaInfo.getMediaTags() );
+        }
+        evict( fMediaFile );
+
+        // and without the database the file is parsed again, and has no audio
+        NSABUtils::CMediaInfo::closeDatabase();
+        NSABUtils::CMediaInfo mediaInfo( fMediaFile );
+        EXPECT_EQ( 0, mediaInfo.numAudioStreams() );
+    }
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication appl( argc, argv );
+    ::testing::InitGoogleTest( &argc, argv );
+    int retVal = RUN_ALL_TESTS();
+    return retVal;
+}
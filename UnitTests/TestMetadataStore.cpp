@@ -0,0 +1,142 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "../MetadataStore.h"
+#include "../FileBasedCache.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+#include "gtest/gtest.h"
+
+namespace
+{
+    class CTestMetadataStore : public ::testing::Test
+    {
+    protected:
+        void SetUp() override
+        {
+            ASSERT_TRUE( fDir.isValid() );
+            fStoreFile = fDir.filePath( "store/metadata.dat" );
+            fDataFile = fDir.filePath( "data.mkv" );
+            writeData( "hello world" );
+        }
+
+        void writeData( const QByteArray &data, int secsOffset = 0 )
+        {
+            QFile file( fDataFile );
+            ASSERT_TRUE( file.open( QIODevice::WriteOnly | QIODevice::Truncate ) );
+            file.write( data );
+            file.setFileTime( QDateTime::currentDateTime().addSecs( secsOffset ), QFileDevice::FileModificationTime );
+        }
+
+        QTemporaryDir fDir;
+        QString fStoreFile;
+        QString fDataFile;
+    };
+
+    TEST_F( CTestMetadataStore, FindAndChange )
+    {
+        NSABUtils::CMetadataStore store( 1 );
+        ASSERT_TRUE( store.open( fStoreFile ) );
+        EXPECT_TRUE( store.find( QFileInfo( fDataFile ) ).isEmpty() );
+
+        store.add( QFileInfo( fDataFile ), "RECORD1" );
+        EXPECT_EQ( "RECORD1", store.find( QFileInfo( fDataFile ) ) );
+        store.add( QFileInfo( fDataFile ), "RECORD2" );
+        EXPECT_EQ( "RECORD2", store.find( QFileInfo( fDataFile ) ) );
+        EXPECT_EQ( 1U, store.numEntries() );
+        EXPECT_EQ( 2U, store.numRecords() );
+
+        writeData( "hello world, again", 10 );
+        EXPECT_TRUE( store.find( QFileInfo( fDataFile ) ).isEmpty() );
+
+        store.add( QFileInfo( fDataFile ), "RECORD3" );
+        store.invalidate( fDataFile );
+        EXPECT_TRUE( store.find( QFileInfo( fDataFile ) ).isEmpty() );
+        EXPECT_EQ( 0U, store.numEntries() );
+    }
+
+    TEST_F( CTestMetadataStore, ReopenAndCompact )
+    {
+        {
+            NSABUtils::CMetadataStore store( 1 );
+            ASSERT_TRUE( store.open( fStoreFile ) );
+            store.add( QFileInfo( fDataFile ), "RECORD1" );
+            store.add( QFileInfo( fDataFile ), "RECORD2" );
+        }
+
+        {
+            NSABUtils::CMetadataStore store( 1 );
+            ASSERT_TRUE( store.open( fStoreFile ) );
+            EXPECT_EQ( "RECORD2", store.find( QFileInfo( fDataFile ) ) );
+            EXPECT_EQ( 2U, store.numRecords() );
+            EXPECT_TRUE( store.compact() );
+            EXPECT_EQ( 1U, store.numRecords() );
+            EXPECT_EQ( "RECORD2", store.find( QFileInfo( fDataFile ) ) );
+            store.add( QFileInfo( fDir.filePath( "missing.mkv" ) ), "TORN" );
+        }
+
+        // a record cut short by a crash is dropped, the rest of the store is kept
+        {
+            QFile file( fStoreFile );
+            ASSERT_TRUE( file.resize( file.size() - 1 ) );
+        }
+        {
+            NSABUtils::CMetadataStore store( 1 );
+            ASSERT_TRUE( store.open( fStoreFile ) );
+            EXPECT_EQ( 1U, store.numEntries() );
+            EXPECT_EQ( "RECORD2", store.find( QFileInfo( fDataFile ) ) );
+        }
+
+        // records from an older schema are discarded
+        NSABUtils::CMetadataStore store( 2 );
+        ASSERT_TRUE( store.open( fStoreFile ) );
+        EXPECT_EQ( 0U, store.numEntries() );
+        EXPECT_TRUE( store.find( QFileInfo( fDataFile ) ).isEmpty() );
+    }
+
+    TEST_F( CTestMetadataStore, ForeignFileIsLeftAlone )
+    {
+        // a data file picked by mistake must never be reset
+        NSABUtils::CMetadataStore store( 1 );
+        QString msg;
+        EXPECT_FALSE( store.open( fDataFile, &msg ) );
+        EXPECT_FALSE( msg.isEmpty() );
+        EXPECT_FALSE( store.isOpen() );
+
+        QFile file( fDataFile );
+        ASSERT_TRUE( file.open( QIODevice::ReadOnly ) );
+        EXPECT_EQ( "hello world", file.readAll() );
+    }
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication appl( argc, argv );
+    ::testing::InitGoogleTest( &argc, argv );
+    int retVal = RUN_ALL_TESTS();
+    return retVal;
+}
@@ -0,0 +1,165 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "../MoveToTrash.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QUrl>
+
+#include "gtest/gtest.h"
+
+namespace
+{
+#ifdef Q_OS_LINUX
+    // XDG_DATA_HOME points the home trash at a temporary directory on the same file system as the files being trashed
+    class CTestMoveToTrash : public ::testing::Test
+    {
+    protected:
+        void SetUp() override
+        {
+            ASSERT_TRUE( fDataHome.isValid() );
+            ASSERT_TRUE( fDir.isValid() );
+            fOldDataHome = qgetenv( "XDG_DATA_HOME" );
+            qputenv( "XDG_DATA_HOME", QFile::encodeName( fDataHome.path() ) );
+        }
+
+        void TearDown() override
+        {
+            if ( fOldDataHome.isNull() )
+                qunsetenv( "XDG_DATA_HOME" );
+            else
+                qputenv( "XDG_DATA_HOME", fOldDataHome );
+        }
+
+        QString writeFile( const QString &name, const QByteArray &data = "data" )
+        {
+            auto path = fDir.filePath( name );
+            QDir().mkpath( QFileInfo( path ).absolutePath() );
+            QFile file( path );
+            EXPECT_TRUE( file.open( QIODevice::WriteOnly ) );
+            file.write( data );
+            return path;
+        }
+
+        QString filesDir() const { return fDataHome.filePath( "Trash/files" ); }
+        QString infoDir() const { return fDataHome.filePath( "Trash/info" ); }
+
+        QByteArray readInfo( const QString &name ) const
+        {
+            QFile file( infoDir() + "/" + name + ".trashinfo" );
+            if ( !file.open( QIODevice::ReadOnly ) )
+                return {};
+            return file.readAll();
+        }
+
+        QTemporaryDir fDataHome;
+        QTemporaryDir fDir;
+        QByteArray fOldDataHome;
+    };
+
+    TEST_F( CTestMoveToTrash, Layout )
+    {
+        auto path = writeFile( "my file.txt" );
+        auto before = QDateTime::currentDateTime().addSecs( -1 );
+        auto results = NSABUtils::NFileUtils::moveFilesToTrash( { path } );
+        ASSERT_EQ( 1, results.size() );
+        ASSERT_TRUE( results[ 0 ].fAOK ) << results[ 0 ].fErrorMsg.toStdString();
+        EXPECT_EQ( path, results[ 0 ].fPath );
+        EXPECT_EQ( filesDir() + "/my file.txt", results[ 0 ].fTrashPath );
+        EXPECT_FALSE( QFileInfo::exists( path ) );
+        EXPECT_TRUE( QFileInfo::exists( results[ 0 ].fTrashPath ) );
+
+        // the home trash records the absolute path, percent encoded
+        auto lines = readInfo( "my file.txt" ).split( '\n' );
+        ASSERT_EQ( 4, lines.size() );
+        EXPECT_EQ( "[Trash Info]", lines[ 0 ] );
+        EXPECT_EQ( "Path=" + QUrl::toPercentEncoding( path, "~_-./" ), lines[ 1 ] );
+        EXPECT_TRUE( lines[ 1 ].contains( "my%20file.txt" ) );
+        ASSERT_TRUE( lines[ 2 ].startsWith( "DeletionDate=" ) );
+        auto deletionDate = QDateTime::fromString( QString::fromUtf8( lines[ 2 ].mid( 13 ) ), "yyyy-MM-dd'T'hh:mm:ss" );
+        ASSERT_TRUE( deletionDate.isValid() );
+        EXPECT_LE( before, deletionDate );
+        EXPECT_TRUE( lines[ 3 ].isEmpty() );
+
+        EXPECT_EQ( QStringList( { "my file.txt" } ), QDir( filesDir() ).entryList( QDir::AllEntries | QDir::NoDotAndDotDot ) );
+        EXPECT_EQ( QStringList( { "my file.txt.trashinfo" } ), QDir( infoDir() ).entryList( QDir::AllEntries | QDir::NoDotAndDotDot ) );
+    }
+
+    TEST_F( CTestMoveToTrash, Collisions )
+    {
+        ASSERT_TRUE( NSABUtils::NFileUtils::moveFilesToTrash( { writeFile( "a/movie.mkv" ) } ).front().fAOK );
+
+        // a name in files or in info is in use, even without the other half
+        QDir().mkpath( filesDir() );
+        QFile( filesDir() + "/movie.3.mkv" ).open( QIODevice::WriteOnly );
+        QFile( infoDir() + "/movie.4.mkv.trashinfo" ).open( QIODevice::WriteOnly );
+
+        auto results = NSABUtils::NFileUtils::moveFilesToTrash( { writeFile( "b/movie.mkv" ), writeFile( "c/movie.mkv" ), writeFile( "d/README" ), writeFile( "e/README" ) } );
+        ASSERT_EQ( 4, results.size() );
+        for ( auto &&ii : results )
+            ASSERT_TRUE( ii.fAOK ) << ii.fErrorMsg.toStdString();
+        EXPECT_EQ( filesDir() + "/movie.2.mkv", results[ 0 ].fTrashPath );
+        EXPECT_EQ( filesDir() + "/movie.5.mkv", results[ 1 ].fTrashPath );
+        EXPECT_EQ( filesDir() + "/README", results[ 2 ].fTrashPath );
+        EXPECT_EQ( filesDir() + "/README.2", results[ 3 ].fTrashPath );
+
+        // each is paired with its own .trashinfo, and nothing was replaced
+        EXPECT_TRUE( readInfo( "movie.2.mkv" ).contains( QUrl::toPercentEncoding( fDir.filePath( "b/movie.mkv" ), "~_-./" ) ) );
+        EXPECT_TRUE( readInfo( "movie.5.mkv" ).contains( QUrl::toPercentEncoding( fDir.filePath( "c/movie.mkv" ), "~_-./" ) ) );
+        EXPECT_TRUE( readInfo( "README.2" ).contains( QUrl::toPercentEncoding( fDir.filePath( "e/README" ), "~_-./" ) ) );
+        EXPECT_EQ( 0, QFileInfo( filesDir() + "/movie.3.mkv" ).size() );
+        EXPECT_TRUE( readInfo( "movie.4.mkv" ).isEmpty() );
+        EXPECT_FALSE( QFileInfo::exists( filesDir() + "/movie.4.mkv" ) );
+        EXPECT_FALSE( QFileInfo::exists( infoDir() + "/movie.3.mkv.trashinfo" ) );
+    }
+
+    TEST_F( CTestMoveToTrash, DirectoriesAndMissingPaths )
+    {
+        writeFile( "dir/sub/file.txt" );
+        auto missing = fDir.filePath( "missing.txt" );
+        auto results = NSABUtils::NFileUtils::moveFilesToTrash( { fDir.filePath( "dir" ), missing } );
+        ASSERT_EQ( 2, results.size() );
+        ASSERT_TRUE( results[ 0 ].fAOK ) << results[ 0 ].fErrorMsg.toStdString();
+        EXPECT_TRUE( QFileInfo::exists( filesDir() + "/dir/sub/file.txt" ) );
+        EXPECT_FALSE( QFileInfo::exists( fDir.filePath( "dir" ) ) );
+        EXPECT_FALSE( readInfo( "dir" ).isEmpty() );
+
+        // a path that does not exist is not an error, and leaves nothing in the trash
+        EXPECT_TRUE( results[ 1 ].fAOK );
+        EXPECT_TRUE( results[ 1 ].fTrashPath.isEmpty() );
+        EXPECT_FALSE( QFileInfo::exists( infoDir() + "/missing.txt.trashinfo" ) );
+    }
+#endif
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication appl( argc, argv );
+    ::testing::InitGoogleTest( &argc, argv );
+    int retVal = RUN_ALL_TESTS();
+    return retVal;
+}
@@ -0,0 +1,69 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2023 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "../PathPatternSet.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include "gtest/gtest.h"
+
+namespace
+{
+    TEST( TestPathPatternSet, SameAsQDirMatch )
+    {
+        QStringList patterns = { "*.mkv", "*.MP4", "*.tar.gz", "cover.jpg", "*.?vi", "season [0-9]*", "*-sample.*" };
+        NSABUtils::NFileUtils::CPathPatternSet patternSet( patterns );
+
+        QStringList names = { "movie.mkv", "MOVIE.MKV", "movie.mp4", "movie.mkv.part", "backup.tar.gz", "backup.gz", ".mkv", "mkv", "cover.jpg", "Cover.JPG", "back.jpg", "movie.avi", "movie.divx", "Season 1", "season x", "movie-sample.mkv", "movie-sample", "" };
+        for ( auto &&name : names )
+            EXPECT_EQ( QDir::match( patterns, name ), patternSet.matchesName( name ) ) << name.toStdString();
+
+        EXPECT_TRUE( NSABUtils::NFileUtils::CPathPatternSet( { "*" } ).matchesName( "anything.at.all" ) );
+        EXPECT_FALSE( NSABUtils::NFileUtils::CPathPatternSet( { "*.mkv" }, Qt::CaseSensitive ).matchesName( "movie.MKV" ) );
+        EXPECT_TRUE( NSABUtils::NFileUtils::CPathPatternSet().isEmpty() );
+    }
+
+    TEST( TestPathPatternSet, PathsAndExtensions )
+    {
+        NSABUtils::NFileUtils::CPathPatternSet patternSet( { "*.nfo", "season*/*.mkv", "extras\\trailer*" } );
+        EXPECT_TRUE( patternSet.matchesPath( "/media/show/movie.nfo" ) );
+        EXPECT_TRUE( patternSet.matchesPath( "/media/show/Season 1/episode.mkv" ) );
+        EXPECT_FALSE( patternSet.matchesPath( "/media/show/specials/episode.mkv" ) );
+        EXPECT_TRUE( patternSet.matchesPath( "C:\\media\\show\\extras\\trailer1.mkv" ) );
+        EXPECT_FALSE( patternSet.matchesPath( "/media/show/trailer1.mkv" ) );
+
+        NSABUtils::NFileUtils::CPathPatternSet extensions( { "mkv", ".mp4", "?vi" }, Qt::CaseInsensitive, NSABUtils::NFileUtils::CPathPatternSet::EPatternType::eExtension );
+        EXPECT_TRUE( extensions.matchesExtension( "MKV" ) );
+        EXPECT_TRUE( extensions.matchesExtension( ".mp4" ) );
+        EXPECT_TRUE( extensions.matchesExtension( "avi" ) );
+        EXPECT_FALSE( extensions.matchesExtension( "txt" ) );
+        EXPECT_FALSE( extensions.matchesExtension( "" ) );
+    }
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication appl( argc, argv );
+    ::testing::InitGoogleTest( &argc, argv );
+    int retVal = RUN_ALL_TESTS();
+    return retVal;
+}
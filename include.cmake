@@ -45,6 +45,7 @@ ELSE()
         set( OS_SRCS 
             SystemInfo_linux.cpp 
             MoveToTrash_linux.cpp
+            DirReader_linux.cpp
         )
 ENDIF()
 
@@ -55,16 +56,26 @@ set(qtproject_SRCS
     BackgroundFileCheck.cpp
     ButtonEnabler.cpp
     CollapsableGroupBox.cpp
+    ContentHash.cpp
+    ContentSniff.cpp
     DelayComboBox.cpp
     DelayLineEdit.cpp
     DelaySpinBox.cpp
+    DigestCache.cpp
+    DirCompare.cpp
+    DirSnapshot.cpp
     DoubleProgressDlg.cpp
+    DuplicateFinder.cpp
     FileCompare.cpp
+    FileStat.cpp
     BackupFile.cpp
     FileBasedCache.cpp
     FileUtils.cpp
+    FileUtils_Copy.cpp
     FileUtils_Remove.cpp
+    FileWatcher.cpp
     FindAllFiles.cpp
+    HashBatch.cpp
     FileSIDInfo.cpp
     FromString.cpp
     GPUDetect.cpp
@@ -73,10 +84,13 @@ set(qtproject_SRCS
     JsonUtils.cpp
     LineEditWithSuffix.cpp
     MD5.cpp
+    MetadataStore.cpp
     MoveToTrash.cpp
+    PathPatternSet.cpp
     MenuBarEx.cpp
     QtDumper.cpp
     QtUtils.cpp
+    RecordLog.cpp
     RegExUtils.cpp
     SABUtilsResources.cpp
     ScrollMessageBox.cpp
@@ -109,7 +123,11 @@ set(qtproject_H
     DelayComboBox.h
     DelayLineEdit.h
     DelaySpinBox.h
+    DirCompare.h
     DoubleProgressDlg.h
+    DuplicateFinder.h
+    FileWatcher.h
+    HashBatch.h
     HyperLinkLineEdit.h
     ImageScrollBar.h
     LineEditWithSuffix.h
@@ -128,8 +146,14 @@ set(qtproject_H
 set(project_H
     AutoFetch.h
     CantorHash.h
+    ContentHash.h
+    ContentSniff.h
+    DigestCache.h
+    DirReader.h
+    DirSnapshot.h
     EnumUtils.h
     FileCompare.h
+    FileStat.h
     FFMpegFormats.h
     BackupFile.h
     FileUtils.h
@@ -141,9 +165,13 @@ set(project_H
     QtHashUtils.h
     JsonUtils.h
     MetaUtils.h
+    MetadataStore.h
     MoveToTrash.h
+    ParallelFor.h
+    PathPatternSet.h
     QtDumper.h
     QtUtils.h
+    RecordLog.h
     RevertValue.h
     RegExUtils.h
     SABUtilsExport.h